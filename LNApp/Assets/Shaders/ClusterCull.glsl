@@ -0,0 +1,118 @@
+//#lne_head [[Cp main]]
+#version 460
+
+#extension GL_EXT_scalar_block_layout :     enable
+
+// One workgroup per meshlet of a submesh. The meshlets outside the frustum or facing away from the eye are dropped,
+// the indices of the others are appended to the index buffer of the frame. The submesh is then drawn from it by a single
+// indirect draw whose vertex count is the number of indices appended. The 16 bit source indices are widened.
+// The meshlets, the source indices and the indices of the frame are all ranges of the index arena.
+
+#ifdef COMP
+
+layout(local_size_x = 64) in;
+
+layout(push_constant) uniform Constants {
+    uint uJobIndex;
+};
+
+struct Meshlet {
+    vec3 center;
+    float radius;
+    vec3 coneApex;
+    float coneCutoff;
+    vec3 coneAxis;
+    uint baseIndex;
+    uint indexCount;
+    uint padding[3];
+};
+
+struct CullJob {
+    // VkDrawIndirectCommand
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+
+    mat4 model;
+    // world space, the normals point inside
+    vec4 frustumPlanes[6];
+    vec3 eyePosition;
+    uint baseMeshlet;
+    uint meshletCount;
+    uint testCones;
+    // 2 when the source indices are 16 bit pairs
+    uint indexStride;
+    // first index of the geometry in the arena, in indices of its stride
+    uint baseSourceIndex;
+};
+
+layout(scalar, set = 0, binding = 0) readonly buffer Meshlets {
+    Meshlet meshlets[];
+};
+
+layout(set = 0, binding = 1) readonly buffer SourceIndices {
+    uint sourceIndices[];
+};
+
+layout(set = 0, binding = 2) writeonly buffer FrameIndices {
+    uint frameIndices[];
+};
+
+layout(scalar, set = 0, binding = 3) buffer Jobs {
+    CullJob jobs[];
+};
+
+uint LoadSourceIndex(uint index) {
+    index += jobs[uJobIndex].baseSourceIndex;
+    if (jobs[uJobIndex].indexStride == 2)
+        return (sourceIndices[index >> 1] >> ((index & 1u) * 16u)) & 0xFFFFu;
+    return sourceIndices[index];
+}
+
+shared bool sIsVisible;
+shared uint sOutputOffset;
+
+bool IsVisible(Meshlet meshlet) {
+    mat4 model = jobs[uJobIndex].model;
+    vec3 center = (model * vec4(meshlet.center, 1.0)).xyz;
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+    float radius = meshlet.radius * scale;
+    for (int i = 0; i < 6; ++i) {
+        vec4 plane = jobs[uJobIndex].frustumPlanes[i];
+        if (dot(plane.xyz, center) + plane.w < -radius)
+            return false;
+    }
+
+    // a cutoff of 1 marks the meshlets whose normals are too spread
+    if (jobs[uJobIndex].testCones != 0 && meshlet.coneCutoff < 1.0) {
+        vec3 apex = (model * vec4(meshlet.coneApex, 1.0)).xyz;
+        vec3 axis = normalize(mat3(model) * meshlet.coneAxis);
+        if (dot(normalize(apex - jobs[uJobIndex].eyePosition), axis) >= meshlet.coneCutoff)
+            return false;
+    }
+    return true;
+}
+
+void main() {
+    uint meshletIndex = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+    // the same for the whole workgroup
+    if (meshletIndex >= jobs[uJobIndex].meshletCount)
+        return;
+
+    Meshlet meshlet = meshlets[jobs[uJobIndex].baseMeshlet + meshletIndex];
+    if (gl_LocalInvocationIndex == 0) {
+        sIsVisible = IsVisible(meshlet);
+        if (sIsVisible)
+            sOutputOffset = jobs[uJobIndex].firstVertex + atomicAdd(jobs[uJobIndex].vertexCount, meshlet.indexCount);
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (sIsVisible == false)
+        return;
+    for (uint i = gl_LocalInvocationIndex; i < meshlet.indexCount; i += gl_WorkGroupSize.x)
+        frameIndices[sOutputOffset + i] = LoadSourceIndex(meshlet.baseIndex + i);
+}
+
+#endif
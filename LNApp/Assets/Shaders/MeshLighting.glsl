@@ -43,23 +43,74 @@ struct Vertex {
     vec2 uv;
 };
 
-layout(scalar, set = 1, binding = 0) readonly buffer VertexBuffer {
-    Vertex vertices[];
-} vertexBuffer;
+const uint VERTEX_FORMAT_FLOAT = 0;
+const uint VERTEX_FORMAT_PACKED = 1;
 
-layout(set = 1, binding = 1) readonly buffer IndexBuffer {
+// the vertices of every geometry, 8 words per vertex when they are floats, 4 when they are packed
+layout(set = 1, binding = 0) readonly buffer VertexArena {
+    uint words[];
+} vertexArena;
+
+// the indices of every geometry, 16 bit indices are packed in pairs, all are relative to the first vertex of the submesh
+layout(set = 1, binding = 1) readonly buffer IndexArena {
     uint indices[];
-} indexBuffer;
+} indexArena;
+
+layout(push_constant) uniform DrawConstants {
+    // in words of the vertex arena: the decoding header (format, bounds count, 2 words of padding, then the bounds of
+    // 8 words, quantized positions being min + position * scale) and the first vertex of the geometry
+    uint uDecodeOffset;
+    uint uVertexOffset;
+    uint uBaseVertex;
+    uint uIndexStride;
+};
+
+vec3 DecodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    // unfolds the lower half of the octahedron
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
+uint LoadIndex(uint index) {
+    if (uIndexStride == 2)
+        return (indexArena.indices[index >> 1] >> ((index & 1u) * 16u)) & 0xFFFFu;
+    return indexArena.indices[index];
+}
+
+Vertex LoadVertex(uint index) {
+    Vertex vertex;
+    if (vertexArena.words[uDecodeOffset] == VERTEX_FORMAT_PACKED) {
+        uint base = uVertexOffset + index * 4;
+        uvec4 data = uvec4(vertexArena.words[base], vertexArena.words[base + 1], vertexArena.words[base + 2], vertexArena.words[base + 3]);
+        // the upper half of the second word is the index of the bounds of the submesh
+        uint bounds = uDecodeOffset + 4 + (data.y >> 16) * 8;
+        vec3 boundsMin = uintBitsToFloat(uvec3(vertexArena.words[bounds], vertexArena.words[bounds + 1], vertexArena.words[bounds + 2]));
+        vec3 boundsScale = uintBitsToFloat(uvec3(vertexArena.words[bounds + 4], vertexArena.words[bounds + 5], vertexArena.words[bounds + 6]));
+        vertex.position = boundsMin + vec3(data.x & 0xFFFFu, data.x >> 16, data.y & 0xFFFFu) * boundsScale;
+        vertex.normal = DecodeOctahedral(unpackSnorm2x16(data.z));
+        vertex.uv = unpackHalf2x16(data.w);
+    } else {
+        uint base = uVertexOffset + index * 8;
+        vertex.position = uintBitsToFloat(uvec3(vertexArena.words[base], vertexArena.words[base + 1], vertexArena.words[base + 2]));
+        vertex.normal = uintBitsToFloat(uvec3(vertexArena.words[base + 3], vertexArena.words[base + 4], vertexArena.words[base + 5]));
+        vertex.uv = uintBitsToFloat(uvec2(vertexArena.words[base + 6], vertexArena.words[base + 7]));
+    }
+    return vertex;
+}
 
 void main() {
-    uint currentIndex = indexBuffer.indices[gl_VertexIndex];
-    gl_Position = uViewProj * uModel * vec4(vertexBuffer.vertices[currentIndex].position, 1.0);
-    oUVs = vertexBuffer.vertices[currentIndex].uv;
+    uint currentIndex = uBaseVertex + LoadIndex(uint(gl_VertexIndex));
+    Vertex v = LoadVertex(currentIndex);
+    gl_Position = uViewProj * uModel * vec4(v.position, 1.0);
+    oUVs = v.uv;
 
-    oWorldPos = (uModel * vec4(vertexBuffer.vertices[currentIndex].position, 1.0)).xyz;
+    oWorldPos = (uModel * vec4(v.position, 1.0)).xyz;
 
     mat3 normalMatrix = transpose(inverse(mat3(uModel)));
-    oNormal = normalize(normalMatrix * vertexBuffer.vertices[currentIndex].normal);
+    oNormal = normalize(normalMatrix * v.normal);
 }
 
 #endif
@@ -0,0 +1,145 @@
+//#lne_head [[Cp main]]
+#version 460
+
+// Builds up to 12 mips in one dispatch. Each workgroup reduces a 64x64 tile of mip 0 down to a single texel of mip 6,
+// the last workgroup to finish (per layer) then reduces mip 6 down to mip 12.
+// The mips are written through UNORM views, sRGB is encoded and decoded by hand.
+
+#ifdef COMP
+
+layout(local_size_x = 256) in;
+
+layout(push_constant) uniform Constants {
+    vec2 uInvInputSize;
+    // mips to generate, mip 0 excluded
+    uint uMipCount;
+    // workgroups per layer
+    uint uWorkGroupCount;
+    uint uIsSrgb;
+};
+
+layout(set = 0, binding = 0) uniform sampler2DArray srcMip;
+layout(set = 0, binding = 1, rgba8) uniform writeonly image2DArray dstMips[12];
+// mip 6 again, read back by the last workgroup
+layout(set = 0, binding = 2, rgba8) uniform coherent image2DArray dstMip6;
+layout(set = 0, binding = 3) coherent buffer Counters {
+    uint counters[6];
+};
+
+shared vec4 sTile[16][16];
+shared bool sIsLastWorkGroup;
+
+vec3 LinearToSrgb(vec3 color) {
+    return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, step(vec3(0.0031308), color));
+}
+
+vec3 SrgbToLinear(vec3 color) {
+    return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), color));
+}
+
+vec4 Encode(vec4 color) {
+    return uIsSrgb != 0 ? vec4(LinearToSrgb(color.rgb), color.a) : color;
+}
+
+vec4 Decode(vec4 color) {
+    return uIsSrgb != 0 ? vec4(SrgbToLinear(color.rgb), color.a) : color;
+}
+
+// the array is only indexed with constants, no dynamic indexing feature needed
+void StoreMip(uint mip, ivec2 texel, uint layer, vec4 color) {
+    ivec3 coords = ivec3(texel, layer);
+    color = Encode(color);
+    switch (mip) {
+    case 1: if (all(lessThan(texel, imageSize(dstMips[0]).xy))) imageStore(dstMips[0], coords, color); break;
+    case 2: if (all(lessThan(texel, imageSize(dstMips[1]).xy))) imageStore(dstMips[1], coords, color); break;
+    case 3: if (all(lessThan(texel, imageSize(dstMips[2]).xy))) imageStore(dstMips[2], coords, color); break;
+    case 4: if (all(lessThan(texel, imageSize(dstMips[3]).xy))) imageStore(dstMips[3], coords, color); break;
+    case 5: if (all(lessThan(texel, imageSize(dstMips[4]).xy))) imageStore(dstMips[4], coords, color); break;
+    case 6: if (all(lessThan(texel, imageSize(dstMip6).xy))) imageStore(dstMip6, coords, color); break;
+    case 7: if (all(lessThan(texel, imageSize(dstMips[6]).xy))) imageStore(dstMips[6], coords, color); break;
+    case 8: if (all(lessThan(texel, imageSize(dstMips[7]).xy))) imageStore(dstMips[7], coords, color); break;
+    case 9: if (all(lessThan(texel, imageSize(dstMips[8]).xy))) imageStore(dstMips[8], coords, color); break;
+    case 10: if (all(lessThan(texel, imageSize(dstMips[9]).xy))) imageStore(dstMips[9], coords, color); break;
+    case 11: if (all(lessThan(texel, imageSize(dstMips[10]).xy))) imageStore(dstMips[10], coords, color); break;
+    case 12: if (all(lessThan(texel, imageSize(dstMips[11]).xy))) imageStore(dstMips[11], coords, color); break;
+    }
+}
+
+// average of the 2x2 texels under a texel of the mip after the source
+vec4 LoadQuad(ivec2 texel, uint layer, bool fromMip6) {
+    if (fromMip6 == false) {
+        // the bilinear sample at the corner shared by the 4 texels averages them, after the sRGB decode
+        return textureLod(srcMip, vec3((vec2(texel * 2) + 1.0) * uInvInputSize, layer), 0.0);
+    }
+
+    ivec2 last = imageSize(dstMip6).xy - 1;
+    ivec2 base = texel * 2;
+    vec4 sum = Decode(imageLoad(dstMip6, ivec3(min(base, last), layer)));
+    sum += Decode(imageLoad(dstMip6, ivec3(min(base + ivec2(1, 0), last), layer)));
+    sum += Decode(imageLoad(dstMip6, ivec3(min(base + ivec2(0, 1), last), layer)));
+    sum += Decode(imageLoad(dstMip6, ivec3(min(base + ivec2(1, 1), last), layer)));
+    return sum * 0.25;
+}
+
+// reduces a tile 64 texels wide of mip firstMip - 1 to a single texel of mip firstMip + 5
+void ReduceTile(uint firstMip, ivec2 tile, uint layer, bool fromMip6) {
+    uint thread = gl_LocalInvocationIndex;
+    ivec2 local = ivec2(thread % 16, thread / 16);
+
+    // each thread builds a 2x2 block of the first mip and averages it for the second one
+    vec4 sum = vec4(0.0);
+    for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 2; ++i) {
+            ivec2 texel = tile * 32 + local * 2 + ivec2(i, j);
+            vec4 color = LoadQuad(texel, layer, fromMip6);
+            StoreMip(firstMip, texel, layer, color);
+            sum += color;
+        }
+    }
+    if (uMipCount <= firstMip)
+        return;
+
+    vec4 color = sum * 0.25;
+    StoreMip(firstMip + 1, tile * 16 + local, layer, color);
+    sTile[local.y][local.x] = color;
+
+    for (uint mip = firstMip + 2; mip <= firstMip + 5 && mip <= uMipCount; ++mip) {
+        uint size = 64u >> (mip - firstMip + 1);
+        ivec2 texel = ivec2(thread % size, thread / size);
+        bool isActive = thread < size * size;
+
+        barrier();
+        if (isActive) {
+            color = (sTile[texel.y * 2][texel.x * 2] + sTile[texel.y * 2][texel.x * 2 + 1]
+                + sTile[texel.y * 2 + 1][texel.x * 2] + sTile[texel.y * 2 + 1][texel.x * 2 + 1]) * 0.25;
+        }
+        barrier();
+        if (isActive) {
+            sTile[texel.y][texel.x] = color;
+            StoreMip(mip, tile * int(size) + texel, layer, color);
+        }
+    }
+}
+
+void main() {
+    uint layer = gl_WorkGroupID.z;
+    ReduceTile(1, ivec2(gl_WorkGroupID.xy), layer, false);
+    if (uMipCount <= 6)
+        return;
+
+    // mip 6 was written by the first thread, make it visible before counting this workgroup as done
+    if (gl_LocalInvocationIndex == 0) {
+        memoryBarrierImage();
+        sIsLastWorkGroup = atomicAdd(counters[layer], 1u) == uWorkGroupCount - 1;
+    }
+    barrier();
+    if (sIsLastWorkGroup == false)
+        return;
+
+    if (gl_LocalInvocationIndex == 0)
+        counters[layer] = 0;
+    memoryBarrierImage();
+    ReduceTile(7, ivec2(0), layer, true);
+}
+
+#endif
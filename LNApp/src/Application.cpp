@@ -33,6 +33,12 @@ public:
         m_SkyboxPipeline = lne::ApplicationBase::GetRenderer().CreateGraphicsPipeline(desc);
         m_SkyboxMaterial = lnnew lne::Material(m_SkyboxPipeline);
 
+#if defined(LNE_DEBUG)
+        // edits to the textures and models show up without restarting
+        lne::ApplicationBase::GetRenderer().SetHotReload(true);
+#endif
+        lne::ApplicationBase::GetRenderer().SetClusterCulling(true);
+        lne::ApplicationBase::GetRenderer().SetVertexFormat(lne::EVertexFormat::ePacked);
         m_Texture = lne::ApplicationBase::GetRenderer().CreateTexture(lne::ApplicationBase::GetAssetsPath() + "Textures\\UVChecker.png");
         std::string cubemapPath = lne::ApplicationBase::GetAssetsPath() + "Textures\\Skybox\\";
         m_CubemapTexture = lne::ApplicationBase::GetRenderer().CreateCubemapTexture({
@@ -49,40 +55,14 @@ public:
         m_BasicMaterial2->SetProperty("uColor", glm::vec4(0.25f, 0.25f, 0.25f, 0.25f));
         m_SkyboxMaterial->SetTexture("tAlbedo", m_CubemapTexture);
 
-    #pragma region CubeGen
-        std::vector<lne::Vertex> tesselatedVertices{};
-        std::vector<uint32_t> tesselatedIndices{};
-        GenerateCube(tesselatedVertices, tesselatedIndices, 1);
-
-        lne::SafePtr<lne::StorageBuffer> tesselatedVertexBuffer = lne::ApplicationBase::GetRenderer()
-            .CreateGeometryBuffer(tesselatedVertices.data(), tesselatedVertices.size() * sizeof(lne::Vertex));
-        lne::SafePtr<lne::StorageBuffer> tesselatedIndexBuffer = lne::ApplicationBase::GetRenderer()
-            .CreateGeometryBuffer(tesselatedIndices.data(), tesselatedIndices.size() * sizeof(uint32_t));
-
-        m_TesselatedCubeGeo.VertexGPUBuffer = tesselatedVertexBuffer;
-        m_TesselatedCubeGeo.VertexCount = (uint32_t)tesselatedVertices.size();
-        m_TesselatedCubeGeo.IndexGPUBuffer = tesselatedIndexBuffer;
-        m_TesselatedCubeGeo.IndexCount = (uint32_t)tesselatedIndices.size();
-    #pragma endregion
-
-    #pragma region SphereGen
-        std::vector<lne::Vertex> sphereVertices{};
-        std::vector<uint32_t> sphereIndices{};
-        GenerateUVSphere(sphereVertices, sphereIndices);
-
-        lne::SafePtr<lne::StorageBuffer> sphereVertexBuffer = lne::ApplicationBase::GetRenderer()
-            .CreateGeometryBuffer(sphereVertices.data(), sphereVertices.size() * sizeof(lne::Vertex));
-        lne::SafePtr<lne::StorageBuffer> sphereIndexBuffer = lne::ApplicationBase::GetRenderer()
-            .CreateGeometryBuffer(sphereIndices.data(), sphereIndices.size() * sizeof(uint32_t));
-
-        m_SphereGeo.VertexGPUBuffer = sphereVertexBuffer;
-        m_SphereGeo.VertexCount = (uint32_t)sphereVertices.size();
-        m_SphereGeo.IndexGPUBuffer = sphereIndexBuffer;
-        m_SphereGeo.IndexCount = (uint32_t)sphereIndices.size();
+    #pragma region PrimitiveGen
+        // the skybox draws the same cube, it is generated and uploaded once
+        m_Cube = lne::ProceduralMesh::CreateCube(1);
+        m_Sphere = lne::ProceduralMesh::CreateUVSphere();
     #pragma endregion
 
     #pragma region LoadModels
-        m_Duck = lnnew lne::StaticMesh(lne::ApplicationBase::GetAssetsPath() + "Models\\gltf\\Models\\Duck\\gltf\\Duck.gltf", m_BasePipeline);
+        m_Duck = lne::ApplicationBase::GetRenderer().CreateStaticMeshAsync(lne::ApplicationBase::GetAssetsPath() + "Models\\gltf\\Models\\Duck\\gltf\\Duck.gltf", m_BasePipeline);
     #pragma endregion
 
     #pragma region TransformInit
@@ -145,10 +125,10 @@ public:
 
         lne::ApplicationBase::GetRenderer().BeginRenderPass(fb);
 
-        lne::ApplicationBase::GetRenderer().Draw(m_BasicMaterial, m_TesselatedCubeGeo, m_CubeTransform);
-        lne::ApplicationBase::GetRenderer().Draw(m_BasicMaterial2, m_SphereGeo, m_SphereTransform);
+        lne::ApplicationBase::GetRenderer().Draw(m_BasicMaterial, m_Cube->GetGeometry(), m_CubeTransform);
+        lne::ApplicationBase::GetRenderer().Draw(m_BasicMaterial2, m_Sphere->GetGeometry(), m_SphereTransform);
         lne::ApplicationBase::GetRenderer().Draw(m_Duck, m_DuckTransform);
-        lne::ApplicationBase::GetRenderer().Draw(m_SkyboxMaterial, m_TesselatedCubeGeo, m_SkyboxTransform);
+        lne::ApplicationBase::GetRenderer().Draw(m_SkyboxMaterial, m_Cube->GetGeometry(), m_SkyboxTransform);
 
         lne::ApplicationBase::GetRenderer().EndRenderPass(fb);
     }
@@ -260,8 +240,8 @@ private:
     lne::SafePtr<lne::GfxPipeline> m_SkyboxPipeline{};
     lne::SafePtr<lne::Material> m_SkyboxMaterial{};
 
-    lne::Geometry m_TesselatedCubeGeo;
-    lne::Geometry m_SphereGeo;
+    lne::SafePtr<lne::ProceduralMesh> m_Cube{};
+    lne::SafePtr<lne::ProceduralMesh> m_Sphere{};
     lne::SafePtr<lne::Texture> m_Texture{};
     lne::SafePtr<lne::Texture> m_CubemapTexture{};
     lne::SafePtr<lne::StaticMesh> m_Duck{};
@@ -285,148 +265,6 @@ private:
 
 
 private:
-    void GenerateCube(std::vector<lne::Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t tesselationLevel)
-    {
-        float step = 2.0f / tesselationLevel;
-
-        auto addQuad = [&](glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 normal)
-        {
-            uint32_t startIndex = (uint32_t)vertices.size();
-            vertices.push_back({ p0, normal, {0.0f, 0.0f} });
-            vertices.push_back({ p1, normal, {1.0f, 0.0f} });
-            vertices.push_back({ p2, normal, {1.0f, 1.0f} });
-            vertices.push_back({ p3, normal, {0.0f, 1.0f} });
-
-            indices.push_back(startIndex + 0);
-            indices.push_back(startIndex + 1);
-            indices.push_back(startIndex + 2);
-            indices.push_back(startIndex + 2);
-            indices.push_back(startIndex + 3);
-            indices.push_back(startIndex + 0);
-        };
-
-        for (uint32_t i = 0; i < tesselationLevel; ++i)
-        {
-            for (uint32_t j = 0; j < tesselationLevel; ++j)
-            {
-                float x0 = -1.0f + i * step;
-                float x1 = x0 + step;
-                float y0 = -1.0f + j * step;
-                float y1 = y0 + step;
-
-                // Front face
-                addQuad({ x0, y0, 1.0f }, { x1, y0, 1.0f }, { x1, y1, 1.0f }, { x0, y1, 1.0f }, { 0.0f, 0.0f, 1.0f });
-                // Back face
-                addQuad({ x1, y0, -1.0f }, { x0, y0, -1.0f }, { x0, y1, -1.0f }, { x1, y1, -1.0f }, { 0.0f, 0.0f, -1.0f });
-                // Left face
-                addQuad({ -1.0f, y0, x0 }, { -1.0f, y0, x1 }, { -1.0f, y1, x1 }, { -1.0f, y1, x0 }, { -1.0f, 0.0f, 0.0f });
-                // Right face
-                addQuad({ 1.0f, y0, x1 }, { 1.0f, y0, x0 }, { 1.0f, y1, x0 }, { 1.0f, y1, x1 }, { 1.0f, 0.0f, 0.0f });
-                // Top face
-                addQuad({ x0, 1.0f, y0 }, { x0, 1.0f, y1 }, { x1, 1.0f, y1 }, { x1, 1.0f, y0 }, { 0.0f, 1.0f, 0.0f });
-                // Bottom face
-                addQuad({ x0, -1.0f, y0 }, { x1, -1.0f, y0 }, { x1, -1.0f, y1 }, { x0, -1.0f, y1 }, { 0.0f, -1.0f, 0.0f });
-            }
-        }
-    }
-
-    void GenerateUVSphere(std::vector<lne::Vertex>& vertices, std::vector<uint32_t>& indices, float radius = 1.f, uint32_t nLatitude = 32, uint32_t nLongitude = 32)
-    {
-        if (nLatitude < 1)
-            nLatitude = 1;
-        if (nLongitude < 3)
-            nLongitude = 3;
-
-        uint32_t nVertices = nLatitude * (nLongitude + 1) + (nLongitude * 2);
-        //-1 to nLat because it wouldn't make sense otherwise.
-        uint32_t nIndices = 2 * 3 * nLongitude + 2 * 3 * (nLatitude - 1) * nLongitude;
-
-        vertices.resize(nVertices);
-        indices.resize(nIndices);
-
-        // here, latitude points should be mapped between -90 and 90 degrees (or -PI/2 to PI/2).
-        // +1 to nLat because it wouldn't make sense otherwise.
-        float latitudeSlope = glm::pi<float>() / (float)(nLatitude + 1);
-        // here, longitude points should be mapped between -180 and 180 degrees (or -PI to PI).
-        float longitudeSlope = (2.f * glm::pi<float>()) / (float)nLongitude;
-
-        uint32_t count = 0;
-        // add north pole
-        for (uint32_t i = 1; i <= nLongitude; ++i)
-        {
-            vertices[count].Position = { 0.0f, radius, 0.0f };
-            vertices[count].TexCoord = { (float)i / ((float)nLongitude + 1.0f), 0.0f };
-            vertices[count].Normal = { 0.0f, 1.0f, 0.0f };
-            ++count;
-        }
-
-        //middle quads
-        for (uint32_t i = 1; i < (nLatitude + 1); ++i)
-        {
-            float pLat = latitudeSlope * (float)i;
-            for (uint32_t j = 0; j < nLongitude + 1; ++j)
-            {
-                float pLon = longitudeSlope * (float)j;
-                glm::vec3 point = { sinf(pLat) * cosf(pLon), cosf(pLat), sinf(pLat) * sinf(pLon) };
-
-                vertices[count].Position = { radius * point.x, radius * point.y, radius * point.z };
-                vertices[count].TexCoord = { (float)j / (float)nLongitude, (float)i / (float)(nLatitude + 1) };
-                vertices[count].Normal = glm::vec3(point);
-
-                ++count;
-            }
-        }
-
-        //add south pole
-        for (uint32_t i = 1; i <= nLongitude; ++i)
-        {
-            vertices[count].Position = { 0.0f, -radius, 0.0f };
-            vertices[count].TexCoord = { (float)i / ((float)nLongitude + 1.0f), 1.0f };
-            vertices[count].Normal = { 0.0f, -1.0f, 0.0f };
-            ++count;
-        }
-
-        count = 0;
-        //north pole indices
-        for (uint32_t i = 0; i < nLongitude; ++i)
-        {
-            indices[count++] = i;
-            indices[count++] = (nLongitude - 1) + i + 2;
-            indices[count++] = (nLongitude - 1) + i + 1;
-        }
-
-        //middle quads
-        for (uint32_t i = 0; i < nLatitude - 1; ++i)
-        {
-            for (uint32_t j = 0; j < nLongitude; ++j)
-            {
-                uint32_t index[4] = {
-                    nLongitude + i * (nLongitude + 1) + j,
-                    nLongitude + i * (nLongitude + 1) + (j + 1),
-                    nLongitude + (i + 1) * (nLongitude + 1) + (j + 1),
-                    nLongitude + (i + 1) * (nLongitude + 1) + j
-                };
-
-                indices[count++] = index[0];
-                indices[count++] = index[1];
-                indices[count++] = index[2];
-
-                indices[count++] = index[0];
-                indices[count++] = index[2];
-                indices[count++] = index[3];
-            }
-        }
-
-        //south pole indices
-        const uint32_t southPoleIndex = nVertices - nLongitude;
-        for (uint32_t i = 0; i < nLongitude; ++i)
-        {
-            indices[count++] = southPoleIndex + i;
-            indices[count++] = southPoleIndex - (nLongitude + 1) + i;
-            indices[count++] = southPoleIndex - (nLongitude + 1) + i + 1;
-        }
-    }
-
     float Lerp(float a, float b, float t, float deltaTime)
     {
         return glm::mix(a, b, 1.0f - std::pow(1.0f - t, deltaTime));
@@ -0,0 +1,100 @@
+project "LNCook"
+    kind "ConsoleApp"
+    language "C++"
+
+    targetdir ("%{wks.location}/bin/" .. OutputDir .. "/%{prj.name}")
+    objdir ("%{wks.location}/bin-inter/" .. OutputDir .. "/%{prj.name}")
+    
+    vectorextensions "SSE2"
+
+    -- offline asset cooker: LNCook [assets directory] [--force] [--packed-vertices] [--pack <file>]
+    files 
+    {
+        "src/**.h",
+        "src/**.cpp"
+    }
+
+    includedirs
+    {
+        "src",
+        "%{wks.location}/LNEngine/src",
+        "%{wks.location}/LNEngine/src/Engine",
+        "%{IncludeDir.GLM}",
+        "%{IncludeDir.SPDLOG}",
+        "%{IncludeDir.VMA}",
+        "%{IncludeDir.enkiTS}",
+    }
+
+    links
+    {
+        "LNEngine",
+    }
+
+    pchheader "pch.h"
+    pchsource "src/pch.cpp"
+
+    forceincludes "pch.h"
+
+    CopyDLLs()
+    
+    filter "system:linux"
+        cppdialect "C++20"
+        systemversion "latest"
+        defines 
+        {
+            "LNE_PLATFORM_LINUX"
+        }
+
+        includedirs
+        {
+            "/usr/include/vulkan"
+        }
+
+    filter "system:windows"
+        cppdialect "C++20"
+        systemversion "latest"
+        defines 
+        {
+            "LNE_PLATFORM_WINDOWS"
+        }
+        
+        includedirs
+        {
+            os.getenv("VULKAN_SDK") .. "/Include"
+        }
+
+    filter "configurations:Debug"
+        runtime "Debug"
+        symbols "On"
+        optimize "Off"
+        flags
+        {
+            "NoRuntimeChecks",
+            "NoIncrementalLink",
+        }
+        defines 
+        { 
+            "_DEBUG", "DEBUG", "LNE_DEBUG",
+        }
+
+        linkoptions { "/ignore:4099" }
+
+    filter "configurations:Release"
+        runtime "Release"
+        symbols "On"
+        optimize "On"
+        flags
+        {
+            "NoRuntimeChecks",
+            "NoIncrementalLink",
+        }
+        defines
+        { 
+            "LNE_DEBUG",
+        }
+
+    filter "configurations:Dist"
+        runtime "Release"
+        symbols "Off"
+        optimize "On"
+        defines "NDEBUG"    
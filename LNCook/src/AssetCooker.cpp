@@ -0,0 +1,373 @@
+#include <enkiTS/src/TaskScheduler.h>
+
+#include "Engine/Core/Utils/Log.h"
+#include "Engine/Graphics/Shader.h"
+#include "Engine/Resources/MeshFile.h"
+#include "Engine/Resources/PackFile.h"
+#include "Engine/Resources/TextureFile.h"
+
+#include "AssetCooker.h"
+
+using namespace lne;
+
+namespace
+{
+struct AssetType
+{
+    std::string_view Extension;
+    EAssetKind Kind;
+};
+
+// hdr images aren't cooked: TextureFile::CookFromImage only writes 8 bit sRGB mips
+constexpr AssetType s_AssetTypes[] =
+{
+    { ".png", EAssetKind::eTexture },
+    { ".jpg", EAssetKind::eTexture },
+    { ".jpeg", EAssetKind::eTexture },
+    { ".tga", EAssetKind::eTexture },
+    { ".bmp", EAssetKind::eTexture },
+    { ".gltf", EAssetKind::eMesh },
+    { ".glb", EAssetKind::eMesh },
+    { ".obj", EAssetKind::eMesh },
+    { ".fbx", EAssetKind::eMesh },
+    { ".glsl", EAssetKind::eShader },
+};
+
+std::string_view GetCookedExtension(EAssetKind kind)
+{
+    switch (kind)
+    {
+    case EAssetKind::eTexture: return TextureFile::s_Extension;
+    case EAssetKind::eMesh: return MeshFile::s_Extension;
+    case EAssetKind::eShader: return Shader::s_CookedExtension;
+    default: return "";
+    }
+}
+
+uint32_t GetCookedVersion(EAssetKind kind)
+{
+    switch (kind)
+    {
+    case EAssetKind::eTexture: return TextureFileHeader::s_Version;
+    case EAssetKind::eMesh: return MeshFileHeader::s_Version;
+    case EAssetKind::eShader: return Shader::s_CookedVersion;
+    default: return 0;
+    }
+}
+
+// a mesh cooked with the other vertex format is cooked again, the manifest doesn't record it
+bool HasVertexFormat(const std::filesystem::path& cooked, EVertexFormat vertexFormat)
+{
+    MeshFileHeader header{};
+    std::ifstream file(cooked, std::ios::binary);
+    return file.read((char*)&header, sizeof(MeshFileHeader)).good() && header.VertexFormat == vertexFormat;
+}
+
+std::string ReadText(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::string DecodeUri(std::string_view uri)
+{
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit((unsigned char)uri[i + 1]) && std::isxdigit((unsigned char)uri[i + 2]))
+        {
+            decoded += (char)std::stoi(std::string(uri.substr(i + 1, 2)), nullptr, 16);
+            i += 2;
+        }
+        else
+            decoded += uri[i];
+    }
+    return decoded;
+}
+
+// the buffers and images of a glTF are the "uri" strings of its json, embedded data excepted
+std::vector<std::string> FindGltfUris(std::string_view json)
+{
+    static constexpr std::string_view key = "\"uri\"";
+    std::vector<std::string> uris;
+    for (size_t position = json.find(key); position != std::string_view::npos; position = json.find(key, position))
+    {
+        position += key.size();
+        size_t begin = json.find_first_not_of(" \t\r\n:", position);
+        if (begin == std::string_view::npos || json[begin] != '"')
+            continue;
+        size_t end = json.find('"', begin + 1);
+        if (end == std::string_view::npos)
+            break;
+        std::string_view uri = json.substr(begin + 1, end - begin - 1);
+        if (uri.starts_with("data:") == false)
+            uris.push_back(DecodeUri(uri));
+        position = end + 1;
+    }
+    return uris;
+}
+
+// a binary glTF starts with its json chunk: magic, version, length, then the chunk length and type
+std::string_view GetGlbJson(std::string_view glb)
+{
+    constexpr uint32_t glbMagic = 0x46546C67; // "glTF"
+    constexpr uint32_t jsonChunk = 0x4E4F534A; // "JSON"
+    uint32_t words[5];
+    if (glb.size() < sizeof(words))
+        return {};
+    memcpy(words, glb.data(), sizeof(words));
+    if (words[0] != glbMagic || words[4] != jsonChunk)
+        return {};
+    return glb.substr(sizeof(words), std::min<size_t>(words[3], glb.size() - sizeof(words)));
+}
+
+// the value of the lines starting with one of the keywords, the last token of the line for the texture maps that take options
+std::vector<std::string> FindObjStatements(std::string_view text, std::string_view keyword, bool lastToken)
+{
+    std::vector<std::string> values;
+    std::istringstream stream{ std::string(text) };
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (line.empty() == false && line.back() == '\r')
+            line.pop_back();
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line.compare(begin, keyword.size(), keyword) != 0)
+            continue;
+        size_t valueBegin = line.find_first_of(" \t", begin);
+        if (valueBegin == std::string::npos)
+            continue;
+        size_t valueEnd = line.find_last_not_of(" \t");
+        std::string value = line.substr(valueBegin, valueEnd - valueBegin + 1);
+        if (lastToken)
+            value = value.substr(value.find_last_of(" \t") + 1);
+        else
+            value = value.substr(value.find_first_not_of(" \t"));
+        values.push_back(value);
+    }
+    return values;
+}
+}
+
+AssetCooker::AssetCooker(std::filesystem::path root, std::shared_ptr<enki::TaskScheduler> taskScheduler, EVertexFormat vertexFormat)
+    : m_Root(std::move(root)), m_TaskScheduler(std::move(taskScheduler)), m_VertexFormat(vertexFormat)
+{
+}
+
+bool AssetCooker::Run(bool force)
+{
+    Scan();
+    APP_INFO("Found {0} assets in {1}", m_Jobs.size(), m_Root.string());
+
+    enki::TaskSet stampTask((uint32_t)m_Jobs.size(), [this, force](enki::TaskSetPartition range, uint32_t)
+    {
+        for (uint32_t i = range.start; i < range.end; ++i)
+            Stamp(m_Jobs[i], force);
+    });
+    m_TaskScheduler->AddTaskSetToPipe(&stampTask);
+    m_TaskScheduler->WaitforTask(&stampTask);
+
+    std::vector<CookJob*> dirtyJobs;
+    for (auto& job : m_Jobs)
+    {
+        if (job.IsDirty)
+            dirtyJobs.push_back(&job);
+    }
+
+    // a model import takes orders of magnitude longer than a shader, one asset per range keeps the workers busy
+    enki::TaskSet cookTask((uint32_t)dirtyJobs.size(), [this, &dirtyJobs](enki::TaskSetPartition range, uint32_t)
+    {
+        for (uint32_t i = range.start; i < range.end; ++i)
+            dirtyJobs[i]->Succeeded = Cook(*dirtyJobs[i]);
+    });
+    cookTask.m_MinRange = 1;
+    m_TaskScheduler->AddTaskSetToPipe(&cookTask);
+    m_TaskScheduler->WaitforTask(&cookTask);
+
+    // the jobs point into the loaded entries until the new ones are set
+    RemoveStaleOutputs();
+
+    std::vector<AssetManifestEntry> entries;
+    entries.reserve(m_Jobs.size());
+    for (auto& job : m_Jobs)
+    {
+        if (job.Succeeded == false)
+        {
+            APP_ERROR("Failed to cook {0}", job.Entry.Source);
+            ++m_FailedCount;
+            continue;
+        }
+        if (job.IsDirty)
+            ++m_CookedCount;
+        else
+            ++m_UpToDateCount;
+        entries.push_back(std::move(job.Entry));
+    }
+    m_Jobs.clear();
+
+    auto& manifest = AssetManifest::Get();
+    manifest.SetEntries(std::move(entries));
+    if (manifest.Save() == false)
+        return false;
+    return m_FailedCount == 0;
+}
+
+void AssetCooker::Scan()
+{
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(m_Root, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error)
+            break;
+        if (it.depth() == 0 && it->is_directory() && it->path().filename() == AssetManifest::s_CookedDirectory)
+        {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_regular_file() == false)
+            continue;
+
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+        auto type = std::find_if(std::begin(s_AssetTypes), std::end(s_AssetTypes), [&extension](const AssetType& type) { return type.Extension == extension; });
+        if (type == std::end(s_AssetTypes))
+            continue;
+
+        CookJob job;
+        job.Entry.Kind = type->Kind;
+        job.Entry.Version = GetCookedVersion(type->Kind);
+        job.Entry.Source = MakeRelative(it->path());
+        job.Entry.Cooked = std::format("{}/{}{}", AssetManifest::s_CookedDirectory, job.Entry.Source, GetCookedExtension(type->Kind));
+        m_Jobs.push_back(std::move(job));
+    }
+
+    // the iteration order is unspecified, the manifest shouldn't change when the assets don't
+    std::sort(m_Jobs.begin(), m_Jobs.end(), [](const CookJob& a, const CookJob& b) { return a.Entry.Source < b.Entry.Source; });
+}
+
+void AssetCooker::Stamp(CookJob& job, bool force) const
+{
+    AssetManifestEntry& entry = job.Entry;
+    job.Previous = AssetManifest::Get().Find(entry.Source);
+    const AssetManifestEntry* previous = job.Previous;
+    if (AssetManifest::StampFile(m_Root / entry.Source, entry.SourceStamp, previous ? &previous->SourceStamp : nullptr) == false)
+    {
+        job.Succeeded = false;
+        return;
+    }
+
+    for (auto& path : FindDependencies(entry))
+    {
+        AssetDependency dependency{ path };
+        const AssetStamp* previousStamp = nullptr;
+        if (previous)
+        {
+            auto it = std::find_if(previous->Dependencies.begin(), previous->Dependencies.end(),
+                [&path](const AssetDependency& previousDependency) { return previousDependency.Path == path; });
+            if (it != previous->Dependencies.end())
+                previousStamp = &it->Stamp;
+        }
+        if (AssetManifest::StampFile(m_Root / path, dependency.Stamp, previousStamp) == false)
+        {
+            APP_WARN("{0} references {1}, which can't be read", entry.Source, path);
+            continue;
+        }
+        entry.Dependencies.push_back(std::move(dependency));
+    }
+
+    std::error_code error;
+    job.IsDirty = force || previous == nullptr || previous->Version != entry.Version || previous->Cooked != entry.Cooked
+        || std::filesystem::exists(m_Root / entry.Cooked, error) == false
+        || (entry.Kind == EAssetKind::eMesh && HasVertexFormat(m_Root / entry.Cooked, m_VertexFormat) == false)
+        || previous->SourceStamp.Hash != entry.SourceStamp.Hash
+        || std::equal(previous->Dependencies.begin(), previous->Dependencies.end(), entry.Dependencies.begin(), entry.Dependencies.end(),
+            [](const AssetDependency& a, const AssetDependency& b) { return a.Path == b.Path && a.Stamp.Hash == b.Stamp.Hash; }) == false;
+}
+
+bool AssetCooker::Cook(const CookJob& job) const
+{
+    std::filesystem::path source = m_Root / job.Entry.Source;
+    std::filesystem::path destination = m_Root / job.Entry.Cooked;
+    std::error_code error;
+    std::filesystem::create_directories(destination.parent_path(), error);
+    if (error)
+    {
+        APP_ERROR("Failed to create {0}: {1}", destination.parent_path().string(), error.message());
+        return false;
+    }
+
+    APP_INFO("Cooking {0}", job.Entry.Source);
+    bool succeeded = false;
+    switch (job.Entry.Kind)
+    {
+    case EAssetKind::eTexture: succeeded = TextureFile::CookFromImage(source, destination); break;
+    case EAssetKind::eMesh: succeeded = MeshFile::Cook(source, destination, m_VertexFormat, m_TaskScheduler); break;
+    case EAssetKind::eShader: succeeded = Shader::Cook(source, destination); break;
+    default: break;
+    }
+    // a partial output would be picked up by a pack built from the directory
+    if (succeeded == false)
+        std::filesystem::remove(destination, error);
+    return succeeded;
+}
+
+void AssetCooker::RemoveStaleOutputs()
+{
+    std::unordered_set<std::string> sources;
+    for (const auto& job : m_Jobs)
+        sources.insert(PackFile::NormalizePath(job.Entry.Source));
+
+    for (const auto& entry : AssetManifest::Get().GetEntries())
+    {
+        if (sources.contains(PackFile::NormalizePath(entry.Source)))
+            continue;
+        std::error_code error;
+        if (std::filesystem::remove(m_Root / entry.Cooked, error))
+        {
+            APP_INFO("Removed {0}, its source is gone", entry.Cooked);
+            ++m_RemovedCount;
+        }
+    }
+}
+
+std::vector<std::string> AssetCooker::FindDependencies(const AssetManifestEntry& entry) const
+{
+    std::filesystem::path source = m_Root / entry.Source;
+    std::string extension = source.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+    std::vector<std::string> dependencies;
+    auto addDependency = [this, &dependencies](const std::filesystem::path& path)
+    {
+        std::string relative = MakeRelative(path);
+        if (std::find(dependencies.begin(), dependencies.end(), relative) == dependencies.end())
+            dependencies.push_back(std::move(relative));
+    };
+
+    if (extension == ".gltf" || extension == ".glb")
+    {
+        std::string text = ReadText(source);
+        std::string_view json = extension == ".glb" ? GetGlbJson(text) : std::string_view(text);
+        for (const auto& uri : FindGltfUris(json))
+            addDependency(source.parent_path() / uri);
+    }
+    else if (extension == ".obj")
+    {
+        for (const auto& library : FindObjStatements(ReadText(source), "mtllib", false))
+        {
+            std::filesystem::path libraryPath = source.parent_path() / library;
+            addDependency(libraryPath);
+            for (const auto& map : FindObjStatements(ReadText(libraryPath), "map_", true))
+                addDependency(libraryPath.parent_path() / map);
+        }
+    }
+    return dependencies;
+}
+
+std::string AssetCooker::MakeRelative(const std::filesystem::path& path) const
+{
+    std::error_code error;
+    std::filesystem::path relative = std::filesystem::relative(path, m_Root, error);
+    return (error ? path : relative).generic_string();
+}
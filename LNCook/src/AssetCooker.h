@@ -0,0 +1,61 @@
+#pragma once
+#include "Engine/Resources/AssetManifest.h"
+#include "Engine/Graphics/GfxEnums.h"
+
+namespace enki
+{
+class TaskScheduler;
+}
+
+/// <summary>
+/// Cooks the textures, meshes and shaders of an assets directory into its Cooked/ directory and records them in the manifest
+/// read by the runtime loaders. An asset is only cooked again when its content, the content of a file it references
+/// or its cooked format changed since the last run.
+/// </summary>
+class AssetCooker
+{
+public:
+    /// <summary>
+    /// The meshes are cooked with the given vertex format.
+    /// </summary>
+    AssetCooker(std::filesystem::path root, std::shared_ptr<enki::TaskScheduler> taskScheduler,
+        lne::EVertexFormat vertexFormat = lne::EVertexFormat::eFloat);
+
+    /// <summary>
+    /// Stamps every asset and cooks the ones that changed on the task scheduler, then saves the manifest.
+    /// Returns false if an asset failed to cook, the assets that were cooked are kept in the manifest.
+    /// </summary>
+    bool Run(bool force);
+
+    [[nodiscard]] uint32_t GetCookedCount() const { return m_CookedCount; }
+    [[nodiscard]] uint32_t GetUpToDateCount() const { return m_UpToDateCount; }
+    [[nodiscard]] uint32_t GetFailedCount() const { return m_FailedCount; }
+    [[nodiscard]] uint32_t GetRemovedCount() const { return m_RemovedCount; }
+
+private:
+    struct CookJob
+    {
+        lne::AssetManifestEntry Entry;
+        const lne::AssetManifestEntry* Previous{ nullptr };
+        bool IsDirty{ false };
+        bool Succeeded{ true };
+    };
+
+    std::filesystem::path m_Root;
+    std::shared_ptr<enki::TaskScheduler> m_TaskScheduler;
+    lne::EVertexFormat m_VertexFormat;
+    std::vector<CookJob> m_Jobs;
+    uint32_t m_CookedCount{ 0 };
+    uint32_t m_UpToDateCount{ 0 };
+    uint32_t m_FailedCount{ 0 };
+    uint32_t m_RemovedCount{ 0 };
+
+private:
+    void Scan();
+    void Stamp(CookJob& job, bool force) const;
+    bool Cook(const CookJob& job) const;
+    void RemoveStaleOutputs();
+
+    [[nodiscard]] std::vector<std::string> FindDependencies(const lne::AssetManifestEntry& entry) const;
+    [[nodiscard]] std::string MakeRelative(const std::filesystem::path& path) const;
+};
@@ -0,0 +1,67 @@
+#include <enkiTS/src/TaskScheduler.h>
+
+#include "Engine/Core/Utils/Defines.h"
+#include "Engine/Core/Utils/Log.h"
+#include "Engine/Resources/AssetManifest.h"
+#include "Engine/Resources/PackFile.h"
+#include "Engine/Resources/VirtualFileSystem.h"
+
+#include "AssetCooker.h"
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path root = "Assets";
+    std::filesystem::path packPath;
+    bool force = false;
+    lne::EVertexFormat vertexFormat = lne::EVertexFormat::eFloat;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view argument = argv[i];
+        if (argument == "--force")
+            force = true;
+        else if (argument == "--packed-vertices")
+            vertexFormat = lne::EVertexFormat::ePacked;
+        else if (argument == "--pack" && i + 1 < argc)
+            packPath = argv[++i];
+        else if (argument.starts_with("--") == false)
+            root = argument;
+        else
+        {
+            std::cerr << "Usage: LNCook [assets directory] [--force] [--packed-vertices] [--pack <file>]\n";
+            return 1;
+        }
+    }
+
+    lne::Log::Init();
+    if (std::filesystem::is_directory(root) == false)
+    {
+        APP_ERROR("{0} isn't a directory", root.string());
+        return 1;
+    }
+
+    // the sources are always read from disk, a pack would hide the changes made since it was built
+    lne::VirtualFileSystem::Get().Mount(root, {});
+    lne::AssetManifest::Get().Load(root);
+
+    std::shared_ptr<enki::TaskScheduler> taskScheduler(lnnew enki::TaskScheduler());
+    taskScheduler->Initialize();
+
+    auto start = std::chrono::steady_clock::now();
+    AssetCooker cooker(root, taskScheduler, vertexFormat);
+    bool succeeded = cooker.Run(force);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    APP_INFO("{0} cooked, {1} up to date, {2} failed, {3} removed in {4} ms", cooker.GetCookedCount(), cooker.GetUpToDateCount(),
+        cooker.GetFailedCount(), cooker.GetRemovedCount(), duration.count());
+
+    if (succeeded && packPath.empty() == false)
+    {
+        succeeded = lne::PackFile::Build(root, packPath);
+        if (succeeded)
+            APP_INFO("Packed {0} into {1}", root.string(), packPath.string());
+    }
+
+    taskScheduler->WaitforAllAndShutdown();
+    lne::VirtualFileSystem::Get().Unmount();
+    lne::Log::Nuke();
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1 @@
+#include "pch.h"
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+// Standard Library
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <filesystem>
+#include <cstddef>
+#include <atomic>
+
+// Data Structures
+#include <string>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <stack>
+#include <queue>
+#include <array>
+#include <tuple>
+
+// Platform
+#ifdef LNE_PLATFORM_WINDOWS
+#include <Windows.h>
+#endif // LNE_PLATFORM_WINDOWS
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Vulkan
+#include <vulkan/vulkan.hpp>
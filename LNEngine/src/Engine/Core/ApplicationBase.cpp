@@ -14,6 +14,9 @@
 #include "Graphics/Texture.h"
 #include "Graphics/DynamicDescriptorAllocator.h"
 #include "Graphics/ImGui/ImGuiService.h"
+#include "Resources/AssetManifest.h"
+#include "Resources/VirtualFileSystem.h"
+#include "Core/Async/CoroutineScheduler.h"
 
 namespace lne
 {
@@ -43,6 +46,9 @@ ApplicationBase::ApplicationBase(ApplicationSettings&& settings)
     LNE_PROFILE_FUNCTION();
 
     Log::Init();
+    // the loose files stay usable when there is no pack next to the executable
+    VirtualFileSystem::Get().Mount(s_AssetsPath, std::filesystem::current_path() / "Assets.lnpak");
+    AssetManifest::Get().Load(s_AssetsPath);
     m_EventHub.reset(lnnew EventHub());
 
     m_EventHub->RegisterListener<WindowCloseEvent>(this, &ApplicationBase::OnWindowClose);
@@ -52,6 +58,7 @@ ApplicationBase::ApplicationBase(ApplicationSettings&& settings)
 
     m_PinnedTaskRunner.reset(lnnew PinnedTaskRunner(m_TaskScheduler));
     m_TaskScheduler->AddPinnedTask(m_PinnedTaskRunner.get());
+    CoroutineScheduler::Get().Init(m_TaskScheduler);
 
     glfwSetErrorCallback([](int errCode, const char* description)
         {
@@ -112,6 +119,8 @@ void ApplicationBase::Run()
 
         m_Window->BeginFrame();
         m_Renderer->BeginFrame();
+        // the assets acquired by BeginFrame can be used by the coroutines that waited for them
+        CoroutineScheduler::Get().ResumeMainThread();
         
         for (auto layer : m_LayerStack)
             layer->OnUpdate(m_Clock.GetDeltaTime());
@@ -160,6 +169,7 @@ bool ApplicationBase::OnWindowClose(WindowCloseEvent& e)
     LNE_INFO("WindowCloseEvent received");
     m_PinnedTaskRunner->IsFinished = true;
     m_TaskScheduler->WaitforAllAndShutdown();
+    CoroutineScheduler::Get().Nuke();
     m_Window->GetGfxContext()->WaitIdle();
 
     m_Renderer->GetGraphicsCommandBufferManager()->BeginSingleTimeCommands();
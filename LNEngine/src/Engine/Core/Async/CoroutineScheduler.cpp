@@ -0,0 +1,63 @@
+#include "Core/Utils/Log.h"
+#include "Core/Utils/_Defines.h"
+
+#include "CoroutineScheduler.h"
+
+namespace lne
+{
+void CoroutineScheduler::Init(std::shared_ptr<enki::TaskScheduler> scheduler)
+{
+    m_TaskScheduler = scheduler;
+}
+
+void CoroutineScheduler::Nuke()
+{
+    std::lock_guard<std::mutex> lock(m_WorkerTasksMutex);
+    m_WorkerTasks.clear();
+    m_TaskScheduler.reset();
+
+    std::lock_guard<std::mutex> mainThreadLock(m_MainThreadMutex);
+    if (m_MainThreadQueue.empty() == false)
+        LNE_WARN("{0} coroutines were never resumed on the main thread", m_MainThreadQueue.size());
+    m_MainThreadQueue.clear();
+}
+
+void CoroutineScheduler::Schedule(std::coroutine_handle<> handle, EResumeOn resumeOn)
+{
+    if (resumeOn == EResumeOn::eMainThread)
+    {
+        std::lock_guard<std::mutex> lock(m_MainThreadMutex);
+        m_MainThreadQueue.push_back(handle);
+        return;
+    }
+
+    auto scheduler = m_TaskScheduler.lock();
+    LNE_ASSERT(scheduler, "The coroutine scheduler isn't initialized");
+
+    ResumeTask* task = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_WorkerTasksMutex);
+        auto it = std::find_if(m_WorkerTasks.begin(), m_WorkerTasks.end(), [](const auto& task) { return task->GetIsComplete(); });
+        if (it == m_WorkerTasks.end())
+        {
+            m_WorkerTasks.emplace_back(lnnew ResumeTask());
+            it = std::prev(m_WorkerTasks.end());
+        }
+        task = it->get();
+        task->Handle = handle;
+        // taken until it is complete again
+        scheduler->AddTaskSetToPipe(task);
+    }
+}
+
+void CoroutineScheduler::ResumeMainThread()
+{
+    std::vector<std::coroutine_handle<>> handles;
+    {
+        std::lock_guard<std::mutex> lock(m_MainThreadMutex);
+        handles.swap(m_MainThreadQueue);
+    }
+    for (auto handle : handles)
+        handle.resume();
+}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <coroutine>
+
+#include "../vendor/ENKITS/enkiTS/src/TaskScheduler.h"
+
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+enum class EResumeOn : uint8_t
+{
+    // between two frames, after the renderer acquired the assets uploaded during the previous one
+    eMainThread,
+    // on one of the enkiTS task threads, for the CPU work that follows a load
+    eWorker,
+};
+
+/// <summary>
+/// Resumes suspended coroutines on the main thread or on the enkiTS task threads. The awaitables (see AssetAwaitable
+/// and SwitchTo) hand their coroutine to it instead of resuming it on the thread that completed the wait.
+/// </summary>
+class CoroutineScheduler
+{
+public:
+    MOVABLE_ONLY(CoroutineScheduler);
+
+    static CoroutineScheduler& Get()
+    {
+        static CoroutineScheduler instance;
+        return instance;
+    }
+
+    void Init(std::shared_ptr<enki::TaskScheduler> scheduler);
+    /// <summary>
+    /// Call once the task scheduler has been shut down. The coroutines still suspended are never resumed.
+    /// </summary>
+    void Nuke();
+
+    /// <summary>
+    /// Thread safe. Main thread coroutines are resumed by the next ResumeMainThread call.
+    /// </summary>
+    void Schedule(std::coroutine_handle<> handle, EResumeOn resumeOn);
+    /// <summary>
+    /// Resumes the coroutines scheduled on the main thread so far, called once per frame by the application.
+    /// The ones they schedule in turn wait for the next frame.
+    /// </summary>
+    void ResumeMainThread();
+
+private:
+    struct ResumeTask : enki::ITaskSet
+    {
+        std::coroutine_handle<> Handle;
+
+        void ExecuteRange(enki::TaskSetPartition, uint32_t) override { Handle.resume(); }
+    };
+
+    std::weak_ptr<enki::TaskScheduler> m_TaskScheduler;
+    // the scheduler touches a task after running it, they are only reused once complete
+    std::vector<std::unique_ptr<ResumeTask>> m_WorkerTasks;
+    std::mutex m_WorkerTasksMutex;
+    std::vector<std::coroutine_handle<>> m_MainThreadQueue;
+    std::mutex m_MainThreadMutex;
+
+private:
+    CoroutineScheduler() = default;
+};
+
+/// <summary>
+/// co_await SwitchTo{ EResumeOn::eWorker } continues the coroutine on a task thread, eMainThread brings it back between two frames.
+/// </summary>
+struct SwitchTo
+{
+    EResumeOn Target;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const { CoroutineScheduler::Get().Schedule(handle, Target); }
+    void await_resume() const noexcept {}
+};
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <coroutine>
+#include <optional>
+
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+template<typename T>
+class Task;
+
+namespace detail
+{
+// resumes the awaiting coroutine when the task completes, a detached task destroys its own frame instead
+struct TaskFinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+    {
+        auto& promise = handle.promise();
+        if (promise.Continuation)
+            return promise.Continuation;
+        if (promise.IsDetached)
+            handle.destroy();
+        return std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+struct TaskPromiseBase
+{
+    std::coroutine_handle<> Continuation{};
+    bool IsDetached{ false };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    TaskFinalAwaiter final_suspend() const noexcept { return {}; }
+    // the engine is built without exception handling in mind, an exception escaping a coroutine is a bug
+    void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase
+{
+    std::optional<T> Result{};
+
+    Task<T> get_return_object() noexcept;
+    template<typename U>
+    void return_value(U&& value) { Result.emplace(std::forward<U>(value)); }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+};
+}
+
+/// <summary>
+/// Coroutine returning a T. Tasks are lazy: the body only runs once the task is awaited, started or detached.
+/// co_await on a task runs it and resumes the awaiting coroutine on the thread that completes it, without going
+/// through the CoroutineScheduler. A task that is never awaited has to be detached to outlive its owner.
+/// </summary>
+template<typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    MOVABLE_ONLY(Task);
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+    Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, {})) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            m_Handle = std::exchange(other.m_Handle, {});
+        }
+        return *this;
+    }
+    ~Task() { Destroy(); }
+
+    [[nodiscard]] bool IsValid() const { return (bool)m_Handle; }
+    [[nodiscard]] bool IsDone() const { return m_Handle && m_Handle.done(); }
+
+    /// <summary>
+    /// Runs the task until its first suspension. The task keeps owning the frame, it must outlive the coroutine.
+    /// </summary>
+    void Start()
+    {
+        if (m_Handle && m_Handle.done() == false)
+            m_Handle.resume();
+    }
+    /// <summary>
+    /// Starts the task and gives up the ownership of the frame, which is destroyed when the coroutine completes.
+    /// </summary>
+    void Detach()
+    {
+        if (m_Handle == nullptr)
+            return;
+        auto handle = std::exchange(m_Handle, {});
+        handle.promise().IsDetached = true;
+        handle.resume();
+    }
+
+    /// <summary>
+    /// Result of a completed task, check IsDone first.
+    /// </summary>
+    decltype(auto) GetResult()
+    {
+        if constexpr (std::is_void_v<T> == false)
+            return *m_Handle.promise().Result;
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> Handle;
+
+            bool await_ready() const noexcept { return Handle == nullptr || Handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept
+            {
+                Handle.promise().Continuation = awaiting;
+                // symmetric transfer, a chain of tasks completing synchronously doesn't grow the stack
+                return Handle;
+            }
+            auto await_resume() const
+            {
+                if constexpr (std::is_void_v<T> == false)
+                    return std::move(*Handle.promise().Result);
+            }
+        };
+        return Awaiter{ m_Handle };
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_Handle{};
+
+private:
+    void Destroy()
+    {
+        if (m_Handle)
+            m_Handle.destroy();
+        m_Handle = {};
+    }
+};
+
+template<typename T>
+Task<T> detail::TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <span>
+#include <variant>
+
+#include "Task.h"
+
+namespace lne
+{
+// result of a task in WhenAll, the void tasks give an empty value to keep the positions
+template<typename T>
+using WhenAllValue = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+namespace detail
+{
+struct WhenAllCounter
+{
+    // one more than the number of parts, the awaiting coroutine arrives too once every part is started
+    std::atomic<size_t> Remaining;
+    std::coroutine_handle<> Continuation{};
+
+    explicit WhenAllCounter(size_t count) : Remaining(count + 1) {}
+
+    // true for the last one to arrive, which resumes the awaiting coroutine
+    bool Arrive() noexcept { return Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+};
+
+/// <summary>
+/// Awaits one task and stores its result. The part resumes the awaiting coroutine from its final suspension when it
+/// arrives last, so that its frame is never running when the awaiting coroutine destroys it.
+/// </summary>
+class WhenAllPart
+{
+public:
+    struct promise_type
+    {
+        WhenAllCounter* Counter{ nullptr };
+
+        WhenAllPart get_return_object() noexcept { return WhenAllPart(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        auto final_suspend() const noexcept
+        {
+            struct Awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+                {
+                    WhenAllCounter* counter = handle.promise().Counter;
+                    if (counter->Arrive())
+                        return counter->Continuation;
+                    return std::noop_coroutine();
+                }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{};
+        }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    MOVABLE_ONLY(WhenAllPart);
+
+    explicit WhenAllPart(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+    WhenAllPart(WhenAllPart&& other) noexcept : m_Handle(std::exchange(other.m_Handle, {})) {}
+    WhenAllPart& operator=(WhenAllPart&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_Handle)
+                m_Handle.destroy();
+            m_Handle = std::exchange(other.m_Handle, {});
+        }
+        return *this;
+    }
+    ~WhenAllPart()
+    {
+        if (m_Handle)
+            m_Handle.destroy();
+    }
+
+    void Start(WhenAllCounter& counter)
+    {
+        m_Handle.promise().Counter = &counter;
+        m_Handle.resume();
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_Handle{};
+};
+
+template<typename T>
+WhenAllPart MakeWhenAllPart(Task<T> task, std::optional<WhenAllValue<T>>& result)
+{
+    if constexpr (std::is_void_v<T>)
+    {
+        co_await std::move(task);
+        result.emplace();
+    }
+    else
+    {
+        result.emplace(co_await std::move(task));
+    }
+}
+
+struct WhenAllAwaiter
+{
+    WhenAllCounter& Counter;
+    std::span<WhenAllPart> Parts;
+
+    bool await_ready() const noexcept { return Parts.empty(); }
+    bool await_suspend(std::coroutine_handle<> handle) const
+    {
+        Counter.Continuation = handle;
+        for (auto& part : Parts)
+            part.Start(Counter);
+        // stays suspended unless every part already completed on this thread
+        return Counter.Arrive() == false;
+    }
+    void await_resume() const noexcept {}
+};
+}
+
+/// <summary>
+/// co_await WhenAll(LoadA(), LoadB()) runs the tasks concurrently and gives back their results in a tuple once all of them
+/// completed. The awaiting coroutine resumes on the thread that completed the last task.
+/// </summary>
+template<typename... Ts>
+Task<std::tuple<WhenAllValue<Ts>...>> WhenAll(Task<Ts>... tasks)
+{
+    std::tuple<std::optional<WhenAllValue<Ts>>...> results;
+    auto parts = [&]<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<detail::WhenAllPart, sizeof...(Ts)>{ detail::MakeWhenAllPart(std::move(tasks), std::get<I>(results))... };
+    }(std::index_sequence_for<Ts...>{});
+
+    detail::WhenAllCounter counter(sizeof...(Ts));
+    co_await detail::WhenAllAwaiter{ counter, parts };
+
+    co_return std::apply([](auto&... values) { return std::tuple<WhenAllValue<Ts>...>(std::move(*values)...); }, results);
+}
+
+/// <summary>
+/// Same as the variadic WhenAll for a number of tasks only known at runtime, the results keep the order of the tasks.
+/// </summary>
+template<typename T>
+Task<std::vector<WhenAllValue<T>>> WhenAll(std::vector<Task<T>> tasks)
+{
+    std::vector<std::optional<WhenAllValue<T>>> results(tasks.size());
+    std::vector<detail::WhenAllPart> parts;
+    parts.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i)
+        parts.push_back(detail::MakeWhenAllPart(std::move(tasks[i]), results[i]));
+
+    detail::WhenAllCounter counter(parts.size());
+    co_await detail::WhenAllAwaiter{ counter, parts };
+
+    std::vector<WhenAllValue<T>> values;
+    values.reserve(results.size());
+    for (auto& result : results)
+        values.push_back(std::move(*result));
+    co_return values;
+}
+}
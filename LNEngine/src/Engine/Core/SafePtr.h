@@ -28,6 +28,19 @@ public:
     {
         return m_Count.load();
     }
+    /// <summary>
+    /// Captures the object only if it is still referenced somewhere. Used by the caches that keep raw pointers.
+    /// </summary>
+    bool TryCapture() const
+    {
+        uint32_t count = m_Count.load();
+        while (count != 0)
+        {
+            if (m_Count.compare_exchange_weak(count, count + 1))
+                return true;
+        }
+        return false;
+    }
 private:
     mutable std::atomic<uint32_t> m_Count = 0;
 };
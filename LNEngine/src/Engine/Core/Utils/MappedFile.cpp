@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+#include "Log.h"
+
+#if !defined(LNE_PLATFORM_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lne
+{
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::filesystem::path& path, bool readAhead)
+{
+    Close();
+
+#if defined(LNE_PLATFORM_WINDOWS)
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, readAhead ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        LNE_ERROR("Failed to open file for mapping: {0}", path.string());
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(m_File, &size);
+    m_Size = (uint64_t)size.QuadPart;
+    if (m_Size == 0)
+    {
+        LNE_ERROR("Can't map empty file: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping == nullptr)
+    {
+        LNE_ERROR("Failed to create file mapping: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    m_Data = (const uint8_t*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    m_FileDescriptor = open(path.c_str(), O_RDONLY);
+    if (m_FileDescriptor < 0)
+    {
+        LNE_ERROR("Failed to open file for mapping: {0}", path.string());
+        return false;
+    }
+
+    struct stat fileStat{};
+    fstat(m_FileDescriptor, &fileStat);
+    m_Size = (uint64_t)fileStat.st_size;
+    if (m_Size == 0)
+    {
+        LNE_ERROR("Can't map empty file: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+    if (data != MAP_FAILED)
+    {
+        if (readAhead)
+        {
+            // the whole file is read front to back right after mapping
+            madvise(data, m_Size, MADV_SEQUENTIAL);
+            madvise(data, m_Size, MADV_WILLNEED);
+        }
+        else
+        {
+            madvise(data, m_Size, MADV_RANDOM);
+        }
+        m_Data = (const uint8_t*)data;
+    }
+#endif
+
+    if (m_Data == nullptr)
+    {
+        LNE_ERROR("Failed to map file: {0}", path.string());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(LNE_PLATFORM_WINDOWS)
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        CloseHandle(m_Mapping);
+    if (m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+    m_Mapping = nullptr;
+    m_File = INVALID_HANDLE_VALUE;
+#else
+    if (m_Data)
+        munmap((void*)m_Data, m_Size);
+    if (m_FileDescriptor >= 0)
+        close(m_FileDescriptor);
+    m_FileDescriptor = -1;
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+void MappedFile::Prefetch(uint64_t offset, uint64_t size) const
+{
+    if (m_Data == nullptr || offset >= m_Size)
+        return;
+    size = std::min(size, m_Size - offset);
+
+#if defined(LNE_PLATFORM_WINDOWS)
+    WIN32_MEMORY_RANGE_ENTRY range{ (void*)(m_Data + offset), (SIZE_T)size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise needs a page aligned address
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t begin = offset & ~(pageSize - 1);
+    madvise((void*)(m_Data + begin), size + (offset - begin), MADV_WILLNEED);
+#endif
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+/// <summary>
+/// Read-only memory mapping of a whole file. The data stays valid until Close is called or the object is destroyed.
+/// </summary>
+class MappedFile
+{
+public:
+    MOVABLE_ONLY(MappedFile);
+    MappedFile() = default;
+    ~MappedFile();
+
+    /// <summary>
+    /// Maps the whole file. With readAhead the OS is asked to read all of it right away, large archives that are only
+    /// read in parts should pass false and Prefetch the ranges they are about to access instead.
+    /// </summary>
+    [[nodiscard]] bool Open(const std::filesystem::path& path, bool readAhead = true);
+    void Close();
+    /// <summary>
+    /// Starts reading a range of the file in the background so that accessing it doesn't block on page faults.
+    /// </summary>
+    void Prefetch(uint64_t offset, uint64_t size) const;
+
+    [[nodiscard]] bool IsOpen() const { return m_Data != nullptr; }
+    [[nodiscard]] const uint8_t* GetData() const { return m_Data; }
+    [[nodiscard]] uint64_t GetSize() const { return m_Size; }
+
+private:
+    const uint8_t* m_Data{ nullptr };
+    uint64_t m_Size{ 0 };
+#if defined(LNE_PLATFORM_WINDOWS)
+    HANDLE m_File{ INVALID_HANDLE_VALUE };
+    HANDLE m_Mapping{ nullptr };
+#else
+    int m_FileDescriptor{ -1 };
+#endif
+};
+}
@@ -0,0 +1,209 @@
+#include "OffsetAllocator.h"
+#include "_Defines.h"
+#include "Log.h"
+
+#include <bit>
+
+namespace lne
+{
+namespace
+{
+// first set bit at or after the given one
+uint32_t FindFirstSetFrom(uint32_t mask, uint32_t bit)
+{
+    if (bit >= 32)
+        return OffsetAllocator::s_Invalid;
+    uint32_t masked = mask & (0xFFFFFFFFu << bit);
+    return masked == 0 ? OffsetAllocator::s_Invalid : (uint32_t)std::countr_zero(masked);
+}
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t size)
+    : m_Size(size)
+{
+    m_BinHeads.fill(s_Invalid);
+    if (size > 0)
+        InsertFreeNode(0, size);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(uint32_t size)
+{
+    if (size == 0 || size > m_FreeSize)
+        return {};
+
+    // every range of the bin rounded up is large enough, no list has to be walked
+    uint32_t minBin = ToBinRoundUp(size);
+    uint32_t minTopBin = minBin >> s_MantissaBits;
+    uint32_t minLeafBin = minBin & (s_LeafBinCount - 1);
+
+    uint32_t topBin = minTopBin;
+    uint32_t leafBin = s_Invalid;
+    if (m_UsedTopBins & (1u << topBin))
+        leafBin = FindFirstSetFrom(m_UsedLeafBins[topBin], minLeafBin);
+    if (leafBin == s_Invalid)
+    {
+        topBin = FindFirstSetFrom(m_UsedTopBins, minTopBin + 1);
+        if (topBin == s_Invalid)
+            return {};
+        leafBin = (uint32_t)std::countr_zero((uint32_t)m_UsedLeafBins[topBin]);
+    }
+
+    uint32_t nodeIndex = m_BinHeads[(topBin << s_MantissaBits) | leafBin];
+    UnlinkFreeNode(nodeIndex);
+
+    Node& node = m_Nodes[nodeIndex];
+    uint32_t remainder = node.Size - size;
+    node.Size = size;
+    node.IsUsed = true;
+    Allocation allocation{ .Offset = node.Offset, .Node = nodeIndex };
+
+    // the rest goes back in the bins, between the allocation and its next neighbour
+    if (remainder > 0)
+    {
+        uint32_t remainderIndex = InsertFreeNode(allocation.Offset + size, remainder);
+        Node& allocated = m_Nodes[nodeIndex];
+        Node& rest = m_Nodes[remainderIndex];
+        rest.NeighborPrevious = nodeIndex;
+        rest.NeighborNext = allocated.NeighborNext;
+        if (allocated.NeighborNext != s_Invalid)
+            m_Nodes[allocated.NeighborNext].NeighborPrevious = remainderIndex;
+        allocated.NeighborNext = remainderIndex;
+    }
+    return allocation;
+}
+
+void OffsetAllocator::Free(Allocation allocation)
+{
+    if (allocation.IsValid() == false)
+        return;
+    LNE_ASSERT(m_Nodes[allocation.Node].IsUsed, "Range freed twice");
+
+    Node node = m_Nodes[allocation.Node];
+    ReleaseNode(allocation.Node);
+
+    uint32_t offset = node.Offset;
+    uint32_t size = node.Size;
+    uint32_t neighborPrevious = node.NeighborPrevious;
+    uint32_t neighborNext = node.NeighborNext;
+    if (neighborPrevious != s_Invalid && m_Nodes[neighborPrevious].IsUsed == false)
+    {
+        const Node& previous = m_Nodes[neighborPrevious];
+        offset = previous.Offset;
+        size += previous.Size;
+        uint32_t mergedIndex = neighborPrevious;
+        neighborPrevious = previous.NeighborPrevious;
+        UnlinkFreeNode(mergedIndex);
+        ReleaseNode(mergedIndex);
+    }
+    if (neighborNext != s_Invalid && m_Nodes[neighborNext].IsUsed == false)
+    {
+        const Node& next = m_Nodes[neighborNext];
+        size += next.Size;
+        uint32_t mergedIndex = neighborNext;
+        neighborNext = next.NeighborNext;
+        UnlinkFreeNode(mergedIndex);
+        ReleaseNode(mergedIndex);
+    }
+
+    uint32_t freeIndex = InsertFreeNode(offset, size);
+    m_Nodes[freeIndex].NeighborPrevious = neighborPrevious;
+    m_Nodes[freeIndex].NeighborNext = neighborNext;
+    if (neighborPrevious != s_Invalid)
+        m_Nodes[neighborPrevious].NeighborNext = freeIndex;
+    if (neighborNext != s_Invalid)
+        m_Nodes[neighborNext].NeighborPrevious = freeIndex;
+}
+
+uint32_t OffsetAllocator::ToBinRoundUp(uint32_t size)
+{
+    // the sizes under 2^mantissa bits have a bin each
+    if (size < s_LeafBinCount)
+        return size;
+
+    uint32_t highestBit = 31 - (uint32_t)std::countl_zero(size);
+    uint32_t mantissaStart = highestBit - s_MantissaBits;
+    uint32_t exponent = mantissaStart + 1;
+    uint32_t mantissa = (size >> mantissaStart) & (s_LeafBinCount - 1);
+    // a carry out of the mantissa moves to the first bin of the next exponent
+    if (size & ((1u << mantissaStart) - 1))
+        ++mantissa;
+    return (exponent << s_MantissaBits) + mantissa;
+}
+
+uint32_t OffsetAllocator::ToBinRoundDown(uint32_t size)
+{
+    if (size < s_LeafBinCount)
+        return size;
+
+    uint32_t highestBit = 31 - (uint32_t)std::countl_zero(size);
+    uint32_t mantissaStart = highestBit - s_MantissaBits;
+    uint32_t exponent = mantissaStart + 1;
+    uint32_t mantissa = (size >> mantissaStart) & (s_LeafBinCount - 1);
+    return (exponent << s_MantissaBits) | mantissa;
+}
+
+uint32_t OffsetAllocator::InsertFreeNode(uint32_t offset, uint32_t size)
+{
+    // rounded down: a range is only found from the bins it fully covers
+    uint32_t bin = ToBinRoundDown(size);
+    uint32_t topBin = bin >> s_MantissaBits;
+    uint32_t leafBin = bin & (s_LeafBinCount - 1);
+    if (m_BinHeads[bin] == s_Invalid)
+    {
+        m_UsedTopBins |= 1u << topBin;
+        m_UsedLeafBins[topBin] |= (uint8_t)(1u << leafBin);
+    }
+
+    uint32_t nodeIndex = AcquireNode();
+    Node& node = m_Nodes[nodeIndex];
+    node = Node{ .Offset = offset, .Size = size, .BinNext = m_BinHeads[bin] };
+    if (node.BinNext != s_Invalid)
+        m_Nodes[node.BinNext].BinPrevious = nodeIndex;
+    m_BinHeads[bin] = nodeIndex;
+    m_FreeSize += size;
+    return nodeIndex;
+}
+
+void OffsetAllocator::UnlinkFreeNode(uint32_t nodeIndex)
+{
+    Node& node = m_Nodes[nodeIndex];
+    if (node.BinPrevious != s_Invalid)
+        m_Nodes[node.BinPrevious].BinNext = node.BinNext;
+    if (node.BinNext != s_Invalid)
+        m_Nodes[node.BinNext].BinPrevious = node.BinPrevious;
+
+    uint32_t bin = ToBinRoundDown(node.Size);
+    if (m_BinHeads[bin] == nodeIndex)
+    {
+        m_BinHeads[bin] = node.BinNext;
+        if (node.BinNext == s_Invalid)
+        {
+            uint32_t topBin = bin >> s_MantissaBits;
+            m_UsedLeafBins[topBin] &= (uint8_t)~(1u << (bin & (s_LeafBinCount - 1)));
+            if (m_UsedLeafBins[topBin] == 0)
+                m_UsedTopBins &= ~(1u << topBin);
+        }
+    }
+    node.BinPrevious = s_Invalid;
+    node.BinNext = s_Invalid;
+    m_FreeSize -= node.Size;
+}
+
+uint32_t OffsetAllocator::AcquireNode()
+{
+    if (m_FreeNodes.empty())
+    {
+        m_Nodes.emplace_back();
+        return (uint32_t)m_Nodes.size() - 1;
+    }
+    uint32_t nodeIndex = m_FreeNodes.back();
+    m_FreeNodes.pop_back();
+    return nodeIndex;
+}
+
+void OffsetAllocator::ReleaseNode(uint32_t nodeIndex)
+{
+    m_Nodes[nodeIndex].IsUsed = false;
+    m_FreeNodes.push_back(nodeIndex);
+}
+}
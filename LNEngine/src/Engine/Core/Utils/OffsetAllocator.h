@@ -0,0 +1,80 @@
+#pragma once
+
+namespace lne
+{
+/// <summary>
+/// Two level segregated fit allocator of ranges in an abstract space (Masmano et al. 2004), it only hands out offsets:
+/// the memory itself lives elsewhere, a GPU buffer for instance. The free ranges are kept in 256 bins of sizes spaced
+/// like a float with a 3 bit mantissa, allocating and freeing are O(1) with two bitmap searches and the freed range is
+/// merged with its free neighbours. An allocation gets a range at least as large as asked from the first non-empty bin
+/// whose ranges are all large enough. Not thread safe.
+/// </summary>
+class OffsetAllocator
+{
+public:
+    static constexpr uint32_t s_Invalid = 0xFFFFFFFF;
+
+    struct Allocation
+    {
+        uint32_t Offset{ s_Invalid };
+        // handle of the range, to free it
+        uint32_t Node{ s_Invalid };
+
+        [[nodiscard]] bool IsValid() const { return Node != s_Invalid; }
+    };
+
+    explicit OffsetAllocator(uint32_t size);
+
+    /// <summary>
+    /// Returns an invalid allocation when no free range is large enough, even if the total free size is.
+    /// </summary>
+    [[nodiscard]] Allocation Allocate(uint32_t size);
+    void Free(Allocation allocation);
+
+    [[nodiscard]] uint32_t GetSize() const { return m_Size; }
+    [[nodiscard]] uint32_t GetFreeSize() const { return m_FreeSize; }
+    [[nodiscard]] uint32_t GetAllocationSize(Allocation allocation) const { return m_Nodes[allocation.Node].Size; }
+
+private:
+    static constexpr uint32_t s_MantissaBits = 3;
+    static constexpr uint32_t s_LeafBinCount = 1 << s_MantissaBits;
+    static constexpr uint32_t s_TopBinCount = 32;
+    static constexpr uint32_t s_BinCount = s_TopBinCount * s_LeafBinCount;
+
+    struct Node
+    {
+        uint32_t Offset{ 0 };
+        uint32_t Size{ 0 };
+        // free ranges of the same bin
+        uint32_t BinPrevious{ s_Invalid };
+        uint32_t BinNext{ s_Invalid };
+        // ranges next to this one in the space, free or not
+        uint32_t NeighborPrevious{ s_Invalid };
+        uint32_t NeighborNext{ s_Invalid };
+        bool IsUsed{ false };
+    };
+
+    uint32_t m_Size;
+    uint32_t m_FreeSize{ 0 };
+    uint32_t m_UsedTopBins{ 0 };
+    std::array<uint8_t, s_TopBinCount> m_UsedLeafBins{};
+    std::array<uint32_t, s_BinCount> m_BinHeads{};
+    std::vector<Node> m_Nodes{};
+    std::vector<uint32_t> m_FreeNodes{};
+
+private:
+    [[nodiscard]] static uint32_t ToBinRoundUp(uint32_t size);
+    [[nodiscard]] static uint32_t ToBinRoundDown(uint32_t size);
+
+    /// <summary>
+    /// Adds a free range to its bin, returns its node.
+    /// </summary>
+    uint32_t InsertFreeNode(uint32_t offset, uint32_t size);
+    /// <summary>
+    /// Takes a free range out of its bin, the node is kept.
+    /// </summary>
+    void UnlinkFreeNode(uint32_t nodeIndex);
+    [[nodiscard]] uint32_t AcquireNode();
+    void ReleaseNode(uint32_t nodeIndex);
+};
+}
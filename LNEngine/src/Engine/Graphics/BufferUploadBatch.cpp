@@ -0,0 +1,96 @@
+#include "BufferUploadBatch.h"
+#include "GfxContext.h"
+#include "CommandBufferManager.h"
+#include "GeometryArena.h"
+#include "Core/Utils/Log.h"
+
+namespace lne
+{
+namespace
+{
+constexpr uint64_t s_StagingBlockSize = 16 * 1024 * 1024;
+constexpr uint64_t s_StagingAlignment = 256;
+}
+
+BufferUploadBatch::BufferUploadBatch(SafePtr<GfxContext> ctx, CommandBufferManager& commandBufferManager, uint32_t commandBufferIndex)
+    : m_Context(ctx), m_CommandBufferManager(&commandBufferManager), m_CommandBufferIndex(commandBufferIndex)
+{
+}
+
+BufferUploadBatch::~BufferUploadBatch()
+{
+    if (m_Submitted)
+        Wait();
+    FreeStagingBlocks();
+}
+
+SafePtr<GeometryBuffer> BufferUploadBatch::CreateGeometryBuffer(SafePtr<GeometryArena> arena, const void* data, uint64_t size)
+{
+    LNE_ASSERT(m_Submitted == false, "Can't add buffers to a batch that has already been submitted");
+
+    SafePtr<GeometryBuffer> buffer = arena->Allocate(size);
+    if (buffer == false || size == 0)
+        return buffer;
+    // the memory is mappable, a single memcpy and nothing to submit
+    if (buffer->IsHostVisible())
+    {
+        buffer->WriteData(data, size);
+        return buffer;
+    }
+
+    // suballocate from the last block, open a new one when it's full
+    if (m_StagingBlocks.empty() || m_StagingBlocks.back().Offset + size > m_StagingBlocks.back().Allocation.AllocationInfo.size)
+        m_StagingBlocks.push_back({ m_Context->AllocateStagingBuffer(std::max(size, s_StagingBlockSize)), 0 });
+
+    StagingBlock& block = m_StagingBlocks.back();
+    memcpy((uint8_t*)block.Allocation.AllocationInfo.pMappedData + block.Offset, data, size);
+
+    m_PendingCopies.push_back({ buffer, (uint32_t)m_StagingBlocks.size() - 1, block.Offset });
+
+    block.Offset = (block.Offset + size + s_StagingAlignment - 1) & ~(s_StagingAlignment - 1);
+    return buffer;
+}
+
+void BufferUploadBatch::Submit()
+{
+    LNE_ASSERT(m_Submitted == false, "Batch already submitted");
+    m_Submitted = true;
+    if (m_PendingCopies.empty())
+        return;
+
+    // waits for the previous batch that used the command buffer
+    m_CommandBufferManager->StartCommandBuffer(m_CommandBufferIndex);
+    auto& cmdBuffer = m_CommandBufferManager->GetCurrentCommandBuffer();
+    for (const auto& copy : m_PendingCopies)
+        copy.Buffer->RecordCopy(cmdBuffer, m_StagingBlocks[copy.BlockIndex].Allocation, copy.Offset);
+
+    vk::SubmitInfo submitInfo{};
+    m_CommandBufferManager->Submit(submitInfo);
+    m_PendingCopies.clear();
+    m_Recorded = true;
+}
+
+bool BufferUploadBatch::IsComplete()
+{
+    // the fence of a batch with nothing to copy belongs to another one
+    if (m_Submitted == false || (m_Recorded && m_CommandBufferManager->GetFenceStatus(m_CommandBufferIndex) == false))
+        return false;
+    FreeStagingBlocks();
+    return true;
+}
+
+void BufferUploadBatch::Wait()
+{
+    LNE_ASSERT(m_Submitted, "Waiting on a batch that hasn't been submitted");
+    if (m_Recorded)
+        m_CommandBufferManager->WaitForFence(m_CommandBufferIndex);
+    FreeStagingBlocks();
+}
+
+void BufferUploadBatch::FreeStagingBlocks()
+{
+    for (auto& block : m_StagingBlocks)
+        m_Context->FreeBuffer(block.Allocation);
+    m_StagingBlocks.clear();
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+#include "Structs.h"
+
+namespace lne
+{
+/// <summary>
+/// Collects the creation of many geometry ranges and uploads them with a single transfer submission.
+/// The data is copied into a shared staging arena when the buffer is created, so the source can be freed right away.
+/// The buffers can be used once IsComplete returns true or Wait has returned. The host visible ones are written directly and skip the batch.
+/// The command buffer and its fence are borrowed from a transfer CommandBufferManager that outlives the batch.
+/// </summary>
+class BufferUploadBatch
+{
+public:
+    MOVABLE_ONLY(BufferUploadBatch);
+    BufferUploadBatch(SafePtr<class GfxContext> ctx, class CommandBufferManager& commandBufferManager, uint32_t commandBufferIndex);
+    ~BufferUploadBatch();
+
+    /// <summary>
+    /// Allocates a range of the arena, empty when it is out of room.
+    /// </summary>
+    [[nodiscard]] SafePtr<class GeometryBuffer> CreateGeometryBuffer(SafePtr<class GeometryArena> arena, const void* data, uint64_t size);
+
+    /// <summary>
+    /// Records every pending copy in one command buffer and submits it. Nothing can be added to the batch afterwards.
+    /// </summary>
+    void Submit();
+    [[nodiscard]] bool IsComplete();
+    void Wait();
+
+private:
+    struct StagingBlock
+    {
+        BufferAllocation Allocation;
+        uint64_t Offset;
+    };
+
+    struct PendingCopy
+    {
+        SafePtr<class GeometryBuffer> Buffer;
+        uint32_t BlockIndex;
+        uint64_t Offset;
+    };
+
+    SafePtr<class GfxContext> m_Context;
+    class CommandBufferManager* m_CommandBufferManager;
+    uint32_t m_CommandBufferIndex;
+    std::vector<StagingBlock> m_StagingBlocks;
+    std::vector<PendingCopy> m_PendingCopies;
+    bool m_Submitted{ false };
+    bool m_Recorded{ false };
+
+private:
+    void FreeStagingBlocks();
+};
+}
@@ -0,0 +1,230 @@
+#include "ClusterCuller.h"
+#include "GfxContext.h"
+#include "Mesh.h"
+#include "GeometryArena.h"
+#include "Shader.h"
+#include "DynamicDescriptorAllocator.h"
+#include "Core/ApplicationBase.h"
+#include "Core/Utils/Log.h"
+#include "Resources/VirtualFileSystem.h"
+
+namespace lne
+{
+namespace
+{
+// one workgroup per meshlet, spread on Y past the dispatch limit
+constexpr uint32_t s_MaxGroupsX = 65535;
+// the normal cones don't survive a non-uniform scale
+constexpr float s_UniformScaleTolerance = 1e-3f;
+
+// laid out like in the shader, the draw command first: it is read at the offset of the job
+struct CullJob
+{
+    // the shader adds the indices of the visible meshlets to VertexCount
+    vk::DrawIndirectCommand Draw;
+    glm::mat4 Model;
+    std::array<glm::vec4, 6> FrustumPlanes;
+    glm::vec3 EyePosition;
+    uint32_t BaseMeshlet;
+    uint32_t MeshletCount;
+    uint32_t TestCones;
+    uint32_t IndexStride;
+    // first index of the geometry in the index arena, in indices of its stride
+    uint32_t BaseSourceIndex;
+};
+}
+
+ClusterCuller::ClusterCuller(SafePtr<GfxContext> ctx, SafePtr<GeometryArena> indexArena, uint32_t frameCount)
+    : m_Context(ctx), m_IndexArena(indexArena)
+{
+    std::string shaderPath = ApplicationBase::GetAssetsPath() + "Shaders\\ClusterCull.glsl";
+    if (VirtualFileSystem::Get().Exists(shaderPath) == false)
+    {
+        LNE_WARN("Cluster culling shader not found: {0}, the meshes are drawn whole", shaderPath);
+        return;
+    }
+
+    vk::Device device = m_Context->GetDevice();
+    m_Shader = m_Context->CreateShader(shaderPath);
+
+    m_DescriptorSetLayout = m_Context->CreateDescriptorSetLayout({
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+    }, "ClusterCuller");
+
+    vk::PushConstantRange pushConstantRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) };
+    m_PipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo{ {}, m_DescriptorSetLayout, pushConstantRange });
+    m_Context->SetVkObjectName(m_PipelineLayout, "PipelineLayout: ClusterCuller");
+
+    vk::ComputePipelineCreateInfo pipelineCI{
+        {},
+        vk::PipelineShaderStageCreateInfo{ {}, vk::ShaderStageFlagBits::eCompute, m_Shader->GetModules()[ShaderStage::eCompute], "main" },
+        m_PipelineLayout
+    };
+    auto result = device.createComputePipeline(nullptr, pipelineCI);
+    if (result.result != vk::Result::eSuccess)
+    {
+        LNE_ERROR("Failed to create the cluster culling pipeline: {}", vk::to_string(result.result));
+        return;
+    }
+    m_Pipeline = result.value;
+    m_Context->SetVkObjectName(m_Pipeline, "Pipeline: ClusterCuller");
+
+    m_CommandPool = m_Context->CreateCommandPool(m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics));
+    auto commandBuffers = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{ m_CommandPool, vk::CommandBufferLevel::ePrimary, frameCount });
+
+    m_Frames.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        FrameResources& frame = m_Frames[i];
+        frame.CommandBuffer = commandBuffers[i];
+        m_Context->SetVkObjectName(frame.CommandBuffer, std::format("CommandBuffer: ClusterCuller, {}", i));
+
+        vk::BufferCreateInfo jobsCI{
+            {},
+            (vk::DeviceSize)sizeof(CullJob) * s_MaxJobsPerFrame,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+            vk::SharingMode::eExclusive,
+        };
+        VmaAllocationCreateInfo jobsAllocCI{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO,
+        };
+        m_Context->AllocateBuffer(frame.Jobs, jobsCI, jobsAllocCI);
+
+        frame.Indices = m_IndexArena->Allocate((uint64_t)sizeof(uint32_t) * s_MaxIndicesPerFrame);
+
+        frame.DescriptorAllocator = SafePtr<DynamicDescriptorAllocator>(lnnew DynamicDescriptorAllocator(m_Context, {
+            vk::DescriptorPoolSize{ vk::DescriptorType::eStorageBuffer, 4 },
+        }, "ClusterCuller" + std::to_string(i), 1));
+        frame.DescriptorSet = frame.DescriptorAllocator->Allocate(m_DescriptorSetLayout);
+
+        // the meshlets, the source indices and the indices of the frame are three views of the index arena
+        vk::DescriptorBufferInfo indexArenaInfo = m_IndexArena->GetDescriptorInfo();
+        vk::DescriptorBufferInfo jobsInfo{ frame.Jobs.Buffer, 0, VK_WHOLE_SIZE };
+        std::array<vk::WriteDescriptorSet, 4> writes{
+            vk::WriteDescriptorSet{ frame.DescriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &indexArenaInfo },
+            vk::WriteDescriptorSet{ frame.DescriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &indexArenaInfo },
+            vk::WriteDescriptorSet{ frame.DescriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &indexArenaInfo },
+            vk::WriteDescriptorSet{ frame.DescriptorSet, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &jobsInfo },
+        };
+        device.updateDescriptorSets(writes, nullptr);
+    }
+}
+
+ClusterCuller::~ClusterCuller()
+{
+    // the handles are null when the shader wasn't found
+    vk::Device device = m_Context->GetDevice();
+    for (auto& frame : m_Frames)
+    {
+        frame.DescriptorAllocator.Reset();
+        frame.Indices.Reset();
+        m_Context->FreeBuffer(frame.Jobs);
+    }
+    m_Frames.clear();
+    device.destroyCommandPool(m_CommandPool);
+    device.destroyPipeline(m_Pipeline);
+    device.destroyPipelineLayout(m_PipelineLayout);
+    device.destroyDescriptorSetLayout(m_DescriptorSetLayout);
+}
+
+void ClusterCuller::BeginFrame(uint32_t frameIndex)
+{
+    if (IsValid() == false)
+        return;
+
+    m_FrameIndex = frameIndex;
+    FrameResources& frame = m_Frames[m_FrameIndex];
+    frame.JobCount = 0;
+    frame.IndexCount = 0;
+}
+
+void ClusterCuller::SetView(const glm::mat4& viewProj, const glm::vec3& eyePosition)
+{
+    // Gribb and Hartmann, the rows of the matrix combined give the clip planes in world space (depth from 0 to 1)
+    auto row = [&viewProj](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+    m_FrustumPlanes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2),
+    };
+    for (auto& plane : m_FrustumPlanes)
+        plane /= glm::length(glm::vec3(plane));
+    m_EyePosition = eyePosition;
+}
+
+bool ClusterCuller::Cull(const Geometry& geometry, const SubMesh& submesh, const MeshLod& lod, const glm::mat4& model, bool cullBackFaces,
+    ClusterDraw& draw)
+{
+    if (IsValid() == false || geometry.MeshletGPUBuffer == false)
+        return false;
+
+    FrameResources& frame = m_Frames[m_FrameIndex];
+    // the index arena was out of room for the indices of the frame
+    if (frame.Indices == false)
+        return false;
+    // the worst case is kept, every meshlet visible
+    if (frame.JobCount == s_MaxJobsPerFrame || frame.IndexCount + lod.IndexCount > s_MaxIndicesPerFrame)
+        return false;
+
+    if (frame.JobCount == 0)
+    {
+        frame.CommandBuffer.reset();
+        frame.CommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        frame.CommandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+        frame.CommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, frame.DescriptorSet, nullptr);
+    }
+
+    glm::vec3 scale(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+    float maxScale = std::max({ scale.x, scale.y, scale.z });
+    float minScale = std::min({ scale.x, scale.y, scale.z });
+    // a mirroring matrix flips the winding, the cones would point inside
+    bool keepsCones = maxScale - minScale <= maxScale * s_UniformScaleTolerance && glm::determinant(glm::mat3(model)) > 0.0f;
+
+    uint32_t jobIndex = frame.JobCount++;
+    CullJob& job = ((CullJob*)frame.Jobs.AllocationInfo.pMappedData)[jobIndex];
+    job = CullJob{
+        .Draw = vk::DrawIndirectCommand{ 0, 1, (uint32_t)(frame.Indices->GetOffset() / sizeof(uint32_t)) + frame.IndexCount, 0 },
+        .Model = model,
+        .FrustumPlanes = m_FrustumPlanes,
+        .EyePosition = m_EyePosition,
+        .BaseMeshlet = (uint32_t)(geometry.MeshletGPUBuffer->GetOffset() / sizeof(Meshlet)) + lod.BaseMeshlet,
+        .MeshletCount = lod.MeshletCount,
+        .TestCones = cullBackFaces && keepsCones ? 1u : 0u,
+        .IndexStride = submesh.IndexStride,
+        .BaseSourceIndex = (uint32_t)(geometry.IndexGPUBuffer->GetOffset() / submesh.IndexStride),
+    };
+    frame.IndexCount += lod.IndexCount;
+
+    uint32_t groupsX = std::min(lod.MeshletCount, s_MaxGroupsX);
+    uint32_t groupsY = (lod.MeshletCount + groupsX - 1) / groupsX;
+    frame.CommandBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &jobIndex);
+    frame.CommandBuffer.dispatch(groupsX, groupsY, 1);
+
+    draw.IndirectBuffer = frame.Jobs.Buffer;
+    draw.IndirectOffset = (vk::DeviceSize)sizeof(CullJob) * jobIndex;
+    return true;
+}
+
+vk::CommandBuffer ClusterCuller::EndFrame()
+{
+    if (IsValid() == false || m_Frames[m_FrameIndex].JobCount == 0)
+        return nullptr;
+
+    FrameResources& frame = m_Frames[m_FrameIndex];
+    VK_CHECK_C(vmaFlushAllocation(m_Context->GetMemoryAllocator(), frame.Jobs.Allocation, 0, VK_WHOLE_SIZE));
+
+    // the draws of the frame command buffer read the draw commands and the appended indices
+    vk::MemoryBarrier barrier{ vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead };
+    frame.CommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader, vk::DependencyFlags(), barrier, nullptr, nullptr);
+    frame.CommandBuffer.end();
+    return frame.CommandBuffer;
+}
+}
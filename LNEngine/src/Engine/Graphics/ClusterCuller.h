@@ -0,0 +1,83 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+#include "Engine/Graphics/Structs.h"
+
+namespace lne
+{
+/// <summary>
+/// Draw command of a culled submesh: its first vertex points at the indices of the visible meshlets in the index arena,
+/// read in place of the ones of its geometry by a single indirect draw.
+/// </summary>
+struct ClusterDraw
+{
+    vk::Buffer IndirectBuffer;
+    vk::DeviceSize IndirectOffset;
+};
+
+/// <summary>
+/// Culls the meshlets of the submeshes against the frustum and their normal cone in a compute pre-pass. The indices of
+/// the visible meshlets are appended to a per frame range of the index arena, which the vertex pulling pipelines read unchanged.
+/// The dispatches can't be recorded in a render pass: they go to a command buffer submitted just before the one of the frame.
+/// </summary>
+class ClusterCuller
+{
+public:
+    static constexpr uint32_t s_MaxJobsPerFrame = 1024;
+    static constexpr uint32_t s_MaxIndicesPerFrame = 1 << 21;
+
+    ClusterCuller(SafePtr<class GfxContext> ctx, SafePtr<class GeometryArena> indexArena, uint32_t frameCount);
+    ~ClusterCuller();
+    MOVABLE_ONLY(ClusterCuller);
+
+    /// <summary>
+    /// False when the shader couldn't be found, the submeshes are drawn whole.
+    /// </summary>
+    [[nodiscard]] bool IsValid() const { return bool(m_Pipeline); }
+
+    /// <summary>
+    /// Starts reusing the resources of the frame, its previous submission must have completed.
+    /// </summary>
+    void BeginFrame(uint32_t frameIndex);
+    void SetView(const glm::mat4& viewProj, const glm::vec3& eyePosition);
+    /// <summary>
+    /// Records the culling of the meshlets of a level of detail of a submesh. The normal cones are only tested when the
+    /// pipeline culls the back faces, and the model matrix keeps their shape. Returns false when the frame is out of room:
+    /// draw the level whole. The indices of the frame are 32 bit whatever the stride of the submesh.
+    /// </summary>
+    [[nodiscard]] bool Cull(const struct Geometry& geometry, const struct SubMesh& submesh, const struct MeshLod& lod, const glm::mat4& model,
+        bool cullBackFaces, ClusterDraw& draw);
+    /// <summary>
+    /// Closes the pre-pass of the frame, null when nothing was culled.
+    /// </summary>
+    [[nodiscard]] vk::CommandBuffer EndFrame();
+
+private:
+    struct FrameResources
+    {
+        vk::CommandBuffer CommandBuffer;
+        // culling jobs written from the host, the shader appends to their draw command
+        BufferAllocation Jobs;
+        SafePtr<class GeometryBuffer> Indices;
+        SafePtr<class DynamicDescriptorAllocator> DescriptorAllocator;
+        // the buffers of the frame never change, every job reads the meshlets and indices from the index arena
+        vk::DescriptorSet DescriptorSet;
+        uint32_t JobCount{ 0 };
+        uint32_t IndexCount{ 0 };
+    };
+
+    SafePtr<class GfxContext> m_Context;
+    SafePtr<class GeometryArena> m_IndexArena;
+    SafePtr<class Shader> m_Shader;
+    vk::DescriptorSetLayout m_DescriptorSetLayout{};
+    vk::PipelineLayout m_PipelineLayout{};
+    vk::Pipeline m_Pipeline{};
+    vk::CommandPool m_CommandPool{};
+    std::vector<FrameResources> m_Frames{};
+    uint32_t m_FrameIndex{ 0 };
+
+    // world space, the normals point inside
+    std::array<glm::vec4, 6> m_FrustumPlanes{};
+    glm::vec3 m_EyePosition{};
+};
+}
@@ -36,6 +36,11 @@ bool CommandBufferManager::GetFenceStatus(uint32_t index)
     return m_Context->GetDevice().getFenceStatus(m_WaitFences[index]) == vk::Result::eSuccess;
 }
 
+void CommandBufferManager::WaitForFence(uint32_t index)
+{
+    VK_CHECK(m_Context->GetDevice().waitForFences(m_WaitFences[index], VK_TRUE, UINT64_MAX));
+}
+
 void CommandBufferManager::StartCommandBuffer(uint32_t index)
 {
     m_CurrentBufferIndex = index;
@@ -46,14 +51,16 @@ void CommandBufferManager::StartCommandBuffer(uint32_t index)
     m_CommandBuffers[m_CurrentBufferIndex].begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
 }
 
-void CommandBufferManager::Submit(vk::SubmitInfo& submitInfo, uint32_t index)
+void CommandBufferManager::Submit(vk::SubmitInfo& submitInfo, uint32_t index, vk::CommandBuffer prologue)
 {
     if (index == UINT32_MAX)
         index = m_CurrentBufferIndex;
     m_Context->GetDevice().resetFences(m_WaitFences[m_CurrentBufferIndex]);
     m_CommandBuffers[m_CurrentBufferIndex].end();
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentBufferIndex];
+    std::array<vk::CommandBuffer, 2> commandBuffers{ prologue, m_CommandBuffers[m_CurrentBufferIndex] };
+    submitInfo.commandBufferCount = prologue ? 2 : 1;
+    submitInfo.pCommandBuffers = prologue ? commandBuffers.data() : &m_CommandBuffers[m_CurrentBufferIndex];
+    std::lock_guard<std::mutex> lock(m_Context->GetQueueSubmitMutex());
     m_Queue.submit(submitInfo, m_WaitFences[m_CurrentBufferIndex]);
 }
 
@@ -68,7 +75,8 @@ void CommandBufferManager::EndSingleTimeCommands()
 {
     vk::SubmitInfo submitInfo = vk::SubmitInfo{};
     Submit(submitInfo, (uint32_t)m_CommandBuffers.size() - 1);
-    m_Queue.waitIdle();
+    // only wait for this submission, not for everything else on the queue
+    WaitForFence((uint32_t)m_CommandBuffers.size() - 1);
 }
 
 std::vector<vk::CommandBuffer> CommandBufferManager::AllocateCommandBuffers(uint32_t count, std::string_view cbName)
@@ -15,9 +15,13 @@ public:
         return m_CommandBuffers[m_CurrentBufferIndex]; 
     }
     [[nodiscard]] bool GetFenceStatus(uint32_t index);
+    void WaitForFence(uint32_t index);
     void StartCommandBuffer(uint32_t index);
 
-    void Submit(vk::SubmitInfo& submitInfo, uint32_t index = UINT32_MAX);
+    /// <summary>
+    /// The prologue is submitted in the same batch, before the current command buffer: the semaphores and the fence cover both.
+    /// </summary>
+    void Submit(vk::SubmitInfo& submitInfo, uint32_t index = UINT32_MAX, vk::CommandBuffer prologue = nullptr);
 
     vk::CommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands();
@@ -0,0 +1,160 @@
+#include "GeometryArena.h"
+#include "GfxContext.h"
+#include "Core/Utils/_Defines.h"
+#include "Core/Utils/Log.h"
+
+namespace lne
+{
+namespace
+{
+constexpr vk::PipelineStageFlags s_ShaderStageMask =
+    (vk::PipelineStageFlagBits)0 | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader |
+    vk::PipelineStageFlagBits::eComputeShader;
+
+constexpr uint64_t ToUnits(uint64_t size)
+{
+    return (size + GeometryArena::s_Alignment - 1) / GeometryArena::s_Alignment;
+}
+}
+
+GeometryArena::GeometryArena(SafePtr<GfxContext> ctx, uint64_t size, const std::string& name)
+    : m_Context(ctx), m_Name(name), m_Size(ToUnits(size) * s_Alignment), m_Allocator((uint32_t)ToUnits(size))
+{
+    m_Buffer = SafePtr<StorageBuffer>(lnnew StorageBuffer(m_Context, m_Size, vk::SharingMode::eConcurrent));
+    LNE_INFO("Geometry arena {0}: {1} MiB, {2}", m_Name, m_Size >> 20, IsHostVisible() ? "host visible" : "device local");
+}
+
+GeometryArena::~GeometryArena()
+{
+    if (m_Allocator.GetFreeSize() != m_Allocator.GetSize())
+        LNE_WARN("Geometry arena {0} destroyed with {1} bytes still allocated", m_Name, GetUsedSize());
+}
+
+SafePtr<GeometryBuffer> GeometryArena::Allocate(uint64_t size)
+{
+    // a mesh without meshlets or indices, there is nothing to copy or read
+    if (size == 0)
+        return SafePtr<GeometryBuffer>(lnnew GeometryBuffer(SafePtr<GeometryArena>(this), OffsetAllocator::Allocation{}, 0));
+
+    OffsetAllocator::Allocation allocation{};
+    {
+        std::lock_guard lock(m_Mutex);
+        if (ToUnits(size) <= m_Allocator.GetSize())
+            allocation = m_Allocator.Allocate((uint32_t)ToUnits(size));
+    }
+    if (allocation.IsValid() == false)
+    {
+        LNE_ERROR("Geometry arena {0} is out of room for {1} bytes ({2} of {3} MiB used)", m_Name, size, GetUsedSize() >> 20, m_Size >> 20);
+        return {};
+    }
+    return SafePtr<GeometryBuffer>(lnnew GeometryBuffer(SafePtr<GeometryArena>(this), allocation, size));
+}
+
+uint64_t GeometryArena::GetUsedSize()
+{
+    std::lock_guard lock(m_Mutex);
+    return (uint64_t)(m_Allocator.GetSize() - m_Allocator.GetFreeSize()) * s_Alignment;
+}
+
+void GeometryArena::Free(OffsetAllocator::Allocation allocation)
+{
+    std::lock_guard lock(m_Mutex);
+    m_Allocator.Free(allocation);
+}
+
+GeometryBuffer::GeometryBuffer(SafePtr<GeometryArena> arena, OffsetAllocator::Allocation allocation, uint64_t size)
+    : m_Arena(arena), m_Allocation(allocation), m_Offset(allocation.IsValid() ? (uint64_t)allocation.Offset * GeometryArena::s_Alignment : 0),
+    m_Size(size)
+{
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+    if (m_Allocation.IsValid())
+        m_Arena->Free(m_Allocation);
+}
+
+void GeometryBuffer::WriteData(const void* data, uint64_t size, uint64_t offset)
+{
+    LNE_ASSERT(offset + size <= m_Size, "Write out of the range");
+    if (size == 0)
+        return;
+    m_Arena->m_Buffer->WriteData(data, size, m_Offset + offset);
+}
+
+void GeometryBuffer::UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset, const void* data)
+{
+    LNE_ASSERT(stagingOffset + m_Size <= stagingBuffer.AllocationInfo.size, "Range doesn't fit in the staging buffer");
+    if (m_Size == 0)
+        return;
+    memcpy((uint8_t*)stagingBuffer.AllocationInfo.pMappedData + stagingOffset, data, m_Size);
+
+    RecordCopy(cmdBuffer, stagingBuffer, stagingOffset);
+}
+
+void GeometryBuffer::RecordCopy(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset)
+{
+    // Vulkan rejects copies and barriers of 0 bytes
+    if (m_Size == 0)
+        return;
+    vk::BufferCopy copyRegion = vk::BufferCopy{
+        stagingOffset,
+        m_Offset,
+        m_Size
+    };
+    cmdBuffer.copyBuffer(stagingBuffer.Buffer, m_Arena->GetDescriptorInfo().buffer, copyRegion);
+}
+
+void GeometryBuffer::UpdateData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset)
+{
+    if (m_Size == 0)
+        return;
+    vk::Buffer buffer = m_Arena->GetDescriptorInfo().buffer;
+    // the draws of the previous frames may still read the old content
+    vk::BufferMemoryBarrier before{
+        vk::AccessFlagBits::eNone,
+        vk::AccessFlagBits::eTransferWrite,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        buffer,
+        m_Offset,
+        m_Size
+    };
+    cmdBuffer.pipelineBarrier(s_ShaderStageMask, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, before, nullptr);
+
+    vk::BufferCopy copyRegion = vk::BufferCopy{
+        stagingOffset,
+        m_Offset,
+        m_Size
+    };
+    cmdBuffer.copyBuffer(stagingBuffer.Buffer, buffer, copyRegion);
+
+    vk::BufferMemoryBarrier after{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        buffer,
+        m_Offset,
+        m_Size
+    };
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, s_ShaderStageMask, {}, nullptr, after, nullptr);
+}
+
+void GeometryBuffer::AcquireOwnership(vk::CommandBuffer cmdBuffer)
+{
+    if (m_Size == 0)
+        return;
+    // the transfer submission has completed, only the caches of the graphics queue have to see the copy
+    vk::BufferMemoryBarrier acquire{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        m_Arena->GetDescriptorInfo().buffer,
+        m_Offset,
+        m_Size
+    };
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, s_ShaderStageMask, {}, nullptr, acquire, nullptr);
+}
+}
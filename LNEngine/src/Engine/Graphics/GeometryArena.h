@@ -0,0 +1,105 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+#include "Engine/Core/Utils/OffsetAllocator.h"
+#include "StorageBuffer.h"
+
+namespace lne
+{
+/// <summary>
+/// Storage buffer shared by the geometry of every mesh and suballocated with an OffsetAllocator: the device memory
+/// allocations stay a handful whatever the number of meshes, and the vertex pulling shaders reach any of them from the
+/// same descriptor set. The buffer is shared by the graphics and transfer queues so that ranges can be uploaded while the
+/// others are drawn. Thread safe.
+/// </summary>
+class GeometryArena : public RefCountBase
+{
+public:
+    // every range starts at a storage buffer offset alignment, a multiple of the index and meshlet strides
+    static constexpr uint64_t s_Alignment = 256;
+
+    GeometryArena(SafePtr<class GfxContext> ctx, uint64_t size, const std::string& name);
+    ~GeometryArena();
+    MOVABLE_ONLY(GeometryArena);
+
+    /// <summary>
+    /// Returns an empty pointer when the arena is out of room, a size of 0 gives an empty range that takes no room.
+    /// The range is given back when the last reference goes away, release it with Renderer::ReleaseDeferred when the
+    /// frames in flight may still read it.
+    /// </summary>
+    [[nodiscard]] SafePtr<class GeometryBuffer> Allocate(uint64_t size);
+
+    [[nodiscard]] uint64_t GetSize() const { return m_Size; }
+    [[nodiscard]] uint64_t GetUsedSize();
+    [[nodiscard]] bool IsHostVisible() const { return m_Buffer->IsHostVisible(); }
+    /// <summary>
+    /// The whole buffer, as bound to the shaders that address the ranges by their offset.
+    /// </summary>
+    [[nodiscard]] vk::DescriptorBufferInfo GetDescriptorInfo() const { return m_Buffer->GetDescriptorInfo(); }
+
+private:
+    SafePtr<class GfxContext> m_Context;
+    SafePtr<StorageBuffer> m_Buffer;
+    std::string m_Name;
+    uint64_t m_Size;
+    std::mutex m_Mutex;
+    // in units of s_Alignment
+    OffsetAllocator m_Allocator;
+
+    friend class GeometryBuffer;
+private:
+    void Free(OffsetAllocator::Allocation allocation);
+};
+
+/// <summary>
+/// Range of a GeometryArena, filled like a StorageBuffer of its own.
+/// </summary>
+class GeometryBuffer : public RefCountBase
+{
+public:
+    GeometryBuffer(SafePtr<GeometryArena> arena, OffsetAllocator::Allocation allocation, uint64_t size);
+    virtual ~GeometryBuffer();
+
+    [[nodiscard]] uint64_t GetOffset() const { return m_Offset; }
+    [[nodiscard]] uint64_t GetSize() const { return m_Size; }
+    [[nodiscard]] bool IsHostVisible() const { return m_Arena->IsHostVisible(); }
+
+    vk::DescriptorBufferInfo GetDescriptorInfo() const
+    {
+        return vk::DescriptorBufferInfo{
+            m_Arena->GetDescriptorInfo().buffer,
+            m_Offset,
+            m_Size
+        };
+    }
+
+    /// <summary>
+    /// Writes straight into a host visible arena, the submissions that follow see the data without barrier.
+    /// The GPU must not be using the range.
+    /// </summary>
+    void WriteData(const void* data, uint64_t size, uint64_t offset = 0);
+    /// <summary>
+    /// Records the copy from the staging buffer at the given offset on the transfer queue.
+    /// </summary>
+    void UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset, const void* data);
+    /// <summary>
+    /// Same as UploadData for data that is already in the staging buffer.
+    /// </summary>
+    void RecordCopy(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset);
+    /// <summary>
+    /// Records the copy from the staging buffer on the graphics queue, between the draws that read the range.
+    /// </summary>
+    void UpdateData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset);
+    /// <summary>
+    /// Makes the copy of UploadData visible to the shaders of the graphics queue, the arena is shared by the queues:
+    /// there is no ownership to transfer.
+    /// </summary>
+    void AcquireOwnership(vk::CommandBuffer cmdBuffer);
+
+private:
+    SafePtr<GeometryArena> m_Arena;
+    OffsetAllocator::Allocation m_Allocation;
+    uint64_t m_Offset;
+    uint64_t m_Size;
+};
+}
@@ -34,6 +34,18 @@ GfxContext::GfxContext(vk::SurfaceKHR surface)
     m_MemoryProperties = vkbPhysicalDevice.memory_properties;
     m_QueueFamilyProperties = m_PhysicalDevice.getQueueFamilyProperties();
 
+#if defined(VK_EXT_host_image_copy)
+    // the loader writes the decoded textures straight into their image, without staging buffer nor transfer submit
+    VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT,
+        .hostImageCopy = vk::True,
+    };
+    // through the PCIe bus the copy engine is faster than the CPU writing to device memory
+    m_HostImageCopy = IsUnifiedMemory()
+        && vkbPhysicalDevice.enable_extension_if_present(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME)
+        && vkbPhysicalDevice.enable_extension_features_if_present(hostImageCopyFeatures);
+#endif
+
     // Create a logical device
     auto deviceRet = vkb::DeviceBuilder{ vkbPhysicalDevice }.build();
     LNE_ASSERT(deviceRet, "Failed to create device");
@@ -76,6 +88,22 @@ GfxContext::GfxContext(vk::SurfaceKHR surface)
 
     VULKAN_HPP_DEFAULT_DISPATCHER.init(m_Device);
 
+#if defined(VK_EXT_host_image_copy)
+    if (m_HostImageCopy)
+    {
+        // the loaded textures are copied in the layout they are sampled in, no transition is recorded afterwards
+        vk::PhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties{};
+        vk::PhysicalDeviceProperties2 properties2{ {}, &hostImageCopyProperties };
+        m_PhysicalDevice.getProperties2(&properties2);
+        std::vector<vk::ImageLayout> dstLayouts(hostImageCopyProperties.copyDstLayoutCount);
+        hostImageCopyProperties.copySrcLayoutCount = 0;
+        hostImageCopyProperties.pCopyDstLayouts = dstLayouts.data();
+        m_PhysicalDevice.getProperties2(&properties2);
+        m_HostImageCopy = std::find(dstLayouts.begin(), dstLayouts.end(), vk::ImageLayout::eShaderReadOnlyOptimal) != dstLayouts.end();
+    }
+    LNE_INFO("Host image copy: {0}", m_HostImageCopy ? "enabled" : "disabled");
+#endif
+
     SetVkObjectName(m_PhysicalDevice, "PhysicalDevice");
     SetVkObjectName(m_Device, "Device");
     CreateMemoryAllocator();
@@ -310,6 +338,25 @@ vkb::PhysicalDevice GfxContext::VkbSelectPhysicalDevice(const vkb::Instance& ins
     return selectedDevice.value();
 }
 
+bool GfxContext::IsUnifiedMemory() const
+{
+    return m_Properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu || m_Properties.deviceType == vk::PhysicalDeviceType::eCpu;
+}
+
+bool GfxContext::SupportsHostImageCopy(vk::Format format) const
+{
+#if defined(VK_EXT_host_image_copy)
+    if (m_HostImageCopy == false)
+        return false;
+
+    auto properties = m_PhysicalDevice.getFormatProperties2<vk::FormatProperties2, vk::FormatProperties3>(format);
+    return bool(properties.get<vk::FormatProperties3>().optimalTilingFeatures & vk::FormatFeatureFlagBits2::eHostImageTransferEXT);
+#else
+    (void)format;
+    return false;
+#endif
+}
+
 vk::SurfaceCapabilitiesKHR GfxContext::GetSurfaceCapabilities(vk::SurfaceKHR surface) const
 {
     return m_PhysicalDevice.getSurfaceCapabilitiesKHR(surface);
@@ -383,7 +430,8 @@ vk::CommandPool GfxContext::CreateCommandPool(uint32_t queueFamilyIndex, vk::Com
     return cp;
 }
 
-vk::ImageView GfxContext::CreateImageView(vk::Image image, vk::ImageViewType viewType, vk::Format format, uint32_t numMipLevels, uint32_t layers, vk::ImageAspectFlags aspectMask, const std::string& name)
+vk::ImageView GfxContext::CreateImageView(vk::Image image, vk::ImageViewType viewType, vk::Format format, uint32_t numMipLevels, uint32_t layers, vk::ImageAspectFlags aspectMask, const std::string& name,
+    uint32_t baseMipLevel, vk::ImageUsageFlags usage)
 {
     vk::ImageViewCreateInfo createInfo(
         {},
@@ -393,11 +441,15 @@ vk::ImageView GfxContext::CreateImageView(vk::Image image, vk::ImageViewType vie
     );
     createInfo.subresourceRange = vk::ImageSubresourceRange(
         aspectMask,
-        0,
+        baseMipLevel,
         numMipLevels,
         0,
         layers
     );
+    // restricts the usages inherited from the image, for the formats that don't support all of them
+    vk::ImageViewUsageCreateInfo usageCI{ usage };
+    if (usage)
+        createInfo.pNext = &usageCI;
     auto imageView = m_Device.createImageView(createInfo);
     SetVkObjectName(imageView, std::format("ImageView: {}", name));
     return imageView;
@@ -427,6 +479,35 @@ uint32_t GfxContext::RegisterBindlessTexture(Texture* texture)
     return textureIndex;
 }
 
+void GfxContext::UpdateBindlessTexture(uint32_t index, Texture* texture)
+{
+    vk::Sampler sampler = texture->GetSampler();
+    if (sampler == nullptr)
+        sampler = m_DefaultSampler;
+
+    auto imageInfo = vk::DescriptorImageInfo{
+        sampler,
+        texture->GetImageView(),
+        vk::ImageLayout::eShaderReadOnlyOptimal
+    };
+    vk::WriteDescriptorSet descriptorWrite{
+        m_BindlessDescriptorSet,
+        0,
+        index,
+        vk::DescriptorType::eCombinedImageSampler,
+        imageInfo
+    };
+    m_Device.updateDescriptorSets({ descriptorWrite }, nullptr);
+}
+
+void GfxContext::ResetBindlessTexture(uint32_t index)
+{
+    // the default texture is only available once InitDefaultResources has been called
+    if (m_DefaultTexture == nullptr)
+        return;
+    UpdateBindlessTexture(index, m_DefaultTexture);
+}
+
 void GfxContext::FreeBindlessImage(uint32_t index)
 {
     m_FreeBindlessIndices.push(index);
@@ -54,6 +54,15 @@ public:
     [[nodiscard]] const vk::PhysicalDeviceFeatures& GetEnabledFeatures() const { return m_EnabledFeatures; }
     [[nodiscard]] const vk::PhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_MemoryProperties; }
     [[nodiscard]] const std::vector<vk::QueueFamilyProperties>& GetQueueFamilyProperties() const { return m_QueueFamilyProperties; }
+    /// <summary>
+    /// Integrated GPUs and software implementations (lavapipe), the device memory is the system memory.
+    /// </summary>
+    [[nodiscard]] bool IsUnifiedMemory() const;
+    /// <summary>
+    /// VK_EXT_host_image_copy is enabled and worth using: on a unified memory device with ShaderReadOnlyOptimal as a copy destination.
+    /// The images of the format created with eHostTransferEXT can be written from the CPU, see Texture::CopyFromHost.
+    /// </summary>
+    [[nodiscard]] bool SupportsHostImageCopy(vk::Format format) const;
 
     [[nodiscard]] vk::SurfaceCapabilitiesKHR GetSurfaceCapabilities(vk::SurfaceKHR surface) const;
     [[nodiscard]] std::vector<vk::SurfaceFormatKHR> GetSurfaceFormats(vk::SurfaceKHR surface) const;
@@ -65,6 +74,10 @@ public:
     [[nodiscard]] std::string GetQueueFamilyName(EQueueFamilyType type) const;
     [[nodiscard]] uint32_t GetQueueFamilyIndex(EQueueFamilyType type) const;
     [[nodiscard]] vk::Queue GetQueue(EQueueFamilyType type) const;
+    /// <summary>
+    /// Queues can be shared between families and are submitted to from the loader thread, every submit and present locks this.
+    /// </summary>
+    [[nodiscard]] std::mutex& GetQueueSubmitMutex() { return m_QueueSubmitMutex; }
 #pragma endregion
 
 #pragma region CommandBuffers
@@ -77,8 +90,11 @@ public:
 
     [[nodiscard]] vk::ImageView CreateImageView(vk::Image image, vk::ImageViewType viewType,
         vk::Format format, uint32_t numMipLevels = 1,
-        uint32_t layers = 1, vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor, const std::string& name = "");
+        uint32_t layers = 1, vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor, const std::string& name = "",
+        uint32_t baseMipLevel = 0, vk::ImageUsageFlags usage = {});
     [[nodiscard]] uint32_t RegisterBindlessTexture(class Texture* texture);
+    void UpdateBindlessTexture(uint32_t index, class Texture* texture);
+    void ResetBindlessTexture(uint32_t index);
     void FreeBindlessImage(uint32_t index);
 
     [[nodiscard]] vk::Sampler CreateSampler(vk::Filter magFilter = vk::Filter::eLinear, vk::Filter minFilter = vk::Filter::eLinear, 
@@ -138,6 +154,7 @@ private:
     vk::PhysicalDeviceFeatures m_EnabledFeatures;
     vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
     std::vector<vk::QueueFamilyProperties> m_QueueFamilyProperties;
+    bool m_HostImageCopy{ false };
 
     QueueFamilyIndices m_QueueFamilyIndices;
 
@@ -145,6 +162,7 @@ private:
     vk::Queue m_ComputeQueue;
     vk::Queue m_TransferQueue;
     vk::Queue m_PresentQueue;
+    std::mutex m_QueueSubmitMutex;
 
     uint32_t m_CurrentFrameInFlight{ 0 };
     uint32_t m_MaxFramesInFlight{ 2 };
@@ -152,7 +170,7 @@ private:
     std::unique_ptr<class CommandBufferManager> m_TransferCommandBufferManager;
         
     vk::Sampler m_DefaultSampler;
-    class Texture* m_DefaultTexture;
+    class Texture* m_DefaultTexture{ nullptr };
 
     vk::DescriptorPool m_BindlessDescriptorPool;
     vk::DescriptorSetLayout m_BindlessDescriptorSetLayout;
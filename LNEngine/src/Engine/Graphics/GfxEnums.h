@@ -9,4 +9,12 @@ enum class EQueueFamilyType : uint8_t
     Transfer,
     Present
 };
+
+enum class EVertexFormat : uint32_t
+{
+    // Vertex, 32 bytes
+    eFloat,
+    // PackedVertex, 16 bytes, after a VertexDecodeHeader
+    ePacked,
+};
 }
@@ -69,6 +69,13 @@ void Material::SetProperty(std::string_view name, const glm::mat4& value)
 void Material::SetTexture(std::string_view name, SafePtr<Texture> texture)
 {
     SetProperty<uint32_t>(std::string(name), texture->GetBindlessHandle());
+    m_Textures[std::string(name)] = texture;
+}
+
+void Material::RequestTextureResolution(float screenPixels)
+{
+    for (auto& [name, texture] : m_Textures)
+        texture->RequestResolution(screenPixels);
 }
 
 void Material::SetUniformBuffer(uint32_t binding, const void* data, uint32_t size, uint32_t offset)
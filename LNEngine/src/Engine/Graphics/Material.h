@@ -24,11 +24,16 @@ public:
     void SetProperty(std::string_view name, const glm::mat4& value);
     
     void SetTexture(std::string_view name, SafePtr<class Texture> texture);
+    /// <summary>
+    /// Forwards the on-screen size of the object using this material to its streamed textures.
+    /// </summary>
+    void RequestTextureResolution(float screenPixels);
 
 private:
     SafePtr<class GfxPipeline> m_Pipeline;
     std::unordered_map<std::string, UniformElement> m_MaterialConstants;
     std::map<uint32_t, UniformBuffer> m_UniformBuffers;
+    std::unordered_map<std::string, SafePtr<class Texture>> m_Textures;
 
     friend class Renderer;
 
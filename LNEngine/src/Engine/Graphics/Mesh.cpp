@@ -1,7 +1,3 @@
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-#include <assimp/aabb.h>
 #include "Core/SafePtr.h"
 #include "Core/Utils/Log.h"
 #include "Core/ApplicationBase.h"
@@ -11,152 +7,308 @@
 #include "Graphics/Material.h"
 #include "Graphics/Texture.h"
 #include "Graphics/DynamicDescriptorAllocator.h"
+#include "Graphics/GfxContext.h"
+#include "Graphics/BufferUploadBatch.h"
+#include "Resources/MeshFile.h"
+#include "Resources/AssetManifest.h"
+#include "Resources/AssetRegistry.h"
+#include "Resources/AssetAwaitable.h"
+#include "Resources/VirtualFileSystem.h"
 
 #include "Mesh.h"
 
-lne::StaticMesh::StaticMesh(std::filesystem::path path, SafePtr<GfxPipeline> pipeline)
+namespace
+{
+constexpr uint64_t s_GeometryAlignment = 256;
+
+// offset of the indices after the vertices, and of the meshlets after the indices, in the staging buffer
+uint64_t AlignGeometry(uint64_t size)
+{
+    return (size + s_GeometryAlignment - 1) & ~(s_GeometryAlignment - 1);
+}
+
+std::vector<lne::SubMesh> ReadSubMeshes(const lne::MeshFile& file)
+{
+    const lne::MeshFileHeader& header = file.GetHeader();
+    const lne::MeshFileSubMesh* submeshes = file.GetSubMeshes();
+    std::vector<lne::SubMesh> result;
+    result.reserve(header.SubMeshCount);
+    for (uint32_t i = 0; i < header.SubMeshCount; ++i)
+    {
+        const lne::MeshFileSubMesh& submesh = submeshes[i];
+        result.emplace_back(lne::SubMesh{
+            .BaseVertex = submesh.BaseVertex,
+            .VertexCount = submesh.VertexCount,
+            .IndexStride = submesh.IndexStride,
+            .Lods = std::vector<lne::MeshLod>(submesh.Lods, submesh.Lods + submesh.LodCount),
+            .MaterialIndex = submesh.MaterialIndex,
+            .BoundingBox = submesh.BoundingBox,
+            .Name = submesh.Name,
+            .WorldTransform = submesh.WorldTransform
+        });
+    }
+    return result;
+}
+}
+
+lne::StaticMesh::StaticMesh(std::filesystem::path path, SafePtr<GfxPipeline> pipeline, bool loadAsync)
     : m_Path(path), m_Pipeline(pipeline)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices);
+    if (loadAsync)
+        return;
 
-    if (!scene)
+    if (LoadFile() == false)
     {
-        LNE_ERROR("Assimp error: {0}", importer.GetErrorString());
+        m_LoadFailed = true;
         return;
     }
 
-    if (!scene->HasMeshes())
+    auto& renderer = ApplicationBase::GetRenderer();
+    auto uploadBatch = renderer.CreateUploadBatch();
+
+    // the blobs are laid out like the GPU buffers, straight from the mapping to the staging buffer
+    m_Geometry.VertexGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetVertexArena(), m_File->GetVertexData(), m_File->GetHeader().VertexSize);
+    m_Geometry.IndexGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetIndexArena(), m_File->GetIndexData(), m_File->GetHeader().IndexSize);
+    m_Geometry.MeshletGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetIndexArena(), m_File->GetMeshlets(),
+        (uint64_t)m_Geometry.MeshletCount * sizeof(Meshlet));
+    uploadBatch->Submit();
+    uploadBatch->Wait();
+
+    if (m_Geometry.VertexGPUBuffer == false || m_Geometry.IndexGPUBuffer == false || m_Geometry.MeshletGPUBuffer == false)
     {
-        LNE_ERROR("No meshes found in file: {0}", path.string());
+        m_Geometry = Geometry{};
+        m_File.reset();
+        m_LoadFailed = true;
         return;
     }
 
-    uint32_t totalVertexCount = 0;
-    uint32_t totalIndexCount = 0;
+    FinalizeLoad();
+}
 
-    InitSubmeshes(scene);
-    LoadData(scene);
+lne::StaticMesh::~StaticMesh()
+{
+    if (m_AssetKey.empty() == false)
+        AssetRegistry::Get().Remove(m_AssetKey, this);
 }
 
-void lne::StaticMesh::InitSubmeshes(const aiScene* scene)
+bool lne::StaticMesh::LoadFile()
 {
-    m_SubMeshes.reserve(scene->mNumMeshes);
+    std::filesystem::path cookedPath = m_Path;
+    if (MeshFile::IsMeshFile(m_Path) == false)
+        cookedPath = AssetManifest::Get().GetCookedPath(m_Path);
+    // not cooked by LNCook, or changed since
+    if (cookedPath.empty())
+    {
+        // Assimp only runs when the cooked file is missing or older than the source, packed files are cooked with the pack
+        cookedPath = MeshFile::GetCookedPath(m_Path);
+        EVertexFormat vertexFormat = ApplicationBase::GetRenderer().GetVertexFormat();
+        if (VirtualFileSystem::Get().IsPacked(cookedPath) == false
+            && MeshFile::IsUpToDate(m_Path, cookedPath, vertexFormat) == false
+            && MeshFile::Cook(m_Path, cookedPath, vertexFormat, ApplicationBase::GetTaskScheduler()) == false)
+            return false;
+    }
 
-    for (uint32_t i = 0; i < scene->mNumMeshes; ++i)
+    m_File = std::make_unique<MeshFile>();
+    if (m_File->Open(cookedPath) == false)
     {
-        const aiMesh* mesh = scene->mMeshes[i];
-        bool skip = !mesh->HasPositions() || !mesh->HasNormals();
-        SubMesh submesh{
-            .BaseVertex = m_TotalVertexCount,
-            .BaseIndex = m_TotalIndexCount,
-            .VertexCount = skip ? 0 : mesh->mNumVertices,
-            .IndexCount = skip ? 0 : mesh->mNumFaces * 3,
-            .MaterialIndex = mesh->mMaterialIndex,
-            .BoundingBox = AABB{
-                .Min = { mesh->mAABB.mMin.x, mesh->mAABB.mMin.y, mesh->mAABB.mMin.z },
-                .Max = { mesh->mAABB.mMax.x, mesh->mAABB.mMax.y, mesh->mAABB.mMax.z }
-            },
-            .Name = mesh->mName.C_Str()
-        };
-        m_SubMeshes.emplace_back(submesh);
-
-        m_TotalVertexCount += mesh->mNumVertices;
-        m_TotalIndexCount += mesh->mNumFaces * 3;
+        m_File.reset();
+        return false;
     }
 
-    TraverseNodes(scene->mRootNode, glm::mat4(1.0f));
+    const MeshFileHeader& header = m_File->GetHeader();
+    m_SubMeshes = ReadSubMeshes(*m_File);
+    m_Geometry.VertexCount = header.VertexCount;
+    m_Geometry.IndexCount = header.IndexCount;
+    m_Geometry.MeshletCount = header.MeshletCount;
+    m_Geometry.VertexFormat = header.VertexFormat;
+    m_Geometry.VertexDecodeSize = header.VertexDecodeSize;
+    return true;
+}
 
-    m_Vertices.reserve(m_TotalVertexCount);
-    m_Indices.reserve(m_TotalIndexCount);
+void lne::StaticMesh::FinalizeLoad()
+{
+    // materials record their uniform updates on the graphics command buffer, main thread only
+    LoadMaterials(*m_File);
+    m_File.reset();
+    m_IsReady = true;
+    AssetLoadEvents::Get().Signal(this);
 }
 
-void lne::StaticMesh::LoadData(const aiScene* scene)
+void lne::StaticMesh::MarkLoadFailed()
 {
-    for (uint32_t m = 0; m < scene->mNumMeshes; ++m)
-    {
-        const aiMesh* mesh = scene->mMeshes[m];
-        if (!mesh->HasPositions() || !mesh->HasNormals())
-            continue;
+    m_File.reset();
+    m_LoadFailed = true;
+    AssetLoadEvents::Get().Signal(this);
+}
 
-        for (uint32_t v = 0; v < mesh->mNumVertices; ++v)
-        {
-            Vertex vertex;
-            vertex.Position = glm::vec3(m_SubMeshes[m].WorldTransform * glm::vec4(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z, 1.0f));
-            vertex.Normal = { mesh->mNormals[v].x, mesh->mNormals[v].y, mesh->mNormals[v].z };
-            if (mesh->HasTextureCoords(0))
-                vertex.TexCoord = { mesh->mTextureCoords[0][v].x, mesh->mTextureCoords[0][v].y };
+bool lne::StaticMesh::AllocateGeometry()
+{
+    auto& renderer = ApplicationBase::GetRenderer();
+    m_Geometry.VertexGPUBuffer = renderer.GetVertexArena()->Allocate(m_File->GetHeader().VertexSize);
+    m_Geometry.IndexGPUBuffer = renderer.GetIndexArena()->Allocate(m_File->GetHeader().IndexSize);
+    // the meshlets are clusters of the index buffer, they share its arena
+    m_Geometry.MeshletGPUBuffer = renderer.GetIndexArena()->Allocate((uint64_t)m_Geometry.MeshletCount * sizeof(Meshlet));
+    if (m_Geometry.VertexGPUBuffer && m_Geometry.IndexGPUBuffer && m_Geometry.MeshletGPUBuffer)
+        return true;
+
+    m_Geometry.VertexGPUBuffer.Reset();
+    m_Geometry.IndexGPUBuffer.Reset();
+    m_Geometry.MeshletGPUBuffer.Reset();
+    return false;
+}
 
-            m_Vertices.push_back(vertex);
-        }
+uint64_t lne::StaticMesh::GetGeometryUploadSize() const
+{
+    return AlignGeometry(m_Geometry.VertexGPUBuffer->GetSize()) + AlignGeometry(m_Geometry.IndexGPUBuffer->GetSize())
+        + m_Geometry.MeshletGPUBuffer->GetSize();
+}
 
-        for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
-        {
-            LNE_ASSERT(mesh->mFaces[f].mNumIndices == 3, "Face is not a triangle");
+bool lne::StaticMesh::WriteGeometry()
+{
+    if (m_Geometry.VertexGPUBuffer->IsHostVisible() == false || m_Geometry.IndexGPUBuffer->IsHostVisible() == false
+        || m_Geometry.MeshletGPUBuffer->IsHostVisible() == false)
+        return false;
+
+    m_Geometry.VertexGPUBuffer->WriteData(m_File->GetVertexData(), m_Geometry.VertexGPUBuffer->GetSize());
+    m_Geometry.IndexGPUBuffer->WriteData(m_File->GetIndexData(), m_Geometry.IndexGPUBuffer->GetSize());
+    m_Geometry.MeshletGPUBuffer->WriteData(m_File->GetMeshlets(), m_Geometry.MeshletGPUBuffer->GetSize());
+    m_IsGeometryWritten = true;
+    return true;
+}
 
-            const aiFace& face = mesh->mFaces[f];
-            for (uint32_t i = 0; i < face.mNumIndices; ++i)
-                m_Indices.push_back(face.mIndices[i]);
-        }
-    }
+void lne::StaticMesh::UploadGeometry(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer)
+{
+    uint64_t indexOffset = AlignGeometry(m_Geometry.VertexGPUBuffer->GetSize());
+    uint64_t meshletOffset = indexOffset + AlignGeometry(m_Geometry.IndexGPUBuffer->GetSize());
+    m_Geometry.VertexGPUBuffer->UploadData(cmdBuffer, stagingBuffer, 0, m_File->GetVertexData());
+    m_Geometry.IndexGPUBuffer->UploadData(cmdBuffer, stagingBuffer, indexOffset, m_File->GetIndexData());
+    m_Geometry.MeshletGPUBuffer->UploadData(cmdBuffer, stagingBuffer, meshletOffset, m_File->GetMeshlets());
+}
 
-    LNE_ASSERT(m_Vertices.size() == m_TotalVertexCount, "Vertex count mismatch");
-    LNE_ASSERT(m_Indices.size() == m_TotalIndexCount, "Index count mismatch");
+void lne::StaticMesh::AcquireGeometry(vk::CommandBuffer cmdBuffer)
+{
+    if (m_IsGeometryWritten)
+        return;
+    m_Geometry.VertexGPUBuffer->AcquireOwnership(cmdBuffer);
+    m_Geometry.IndexGPUBuffer->AcquireOwnership(cmdBuffer);
+    m_Geometry.MeshletGPUBuffer->AcquireOwnership(cmdBuffer);
+}
 
-    m_Geometry.VertexCount = m_TotalVertexCount;
-    m_Geometry.IndexCount = m_TotalIndexCount;
+bool lne::StaticMesh::PrepareReload(SafePtr<GfxContext> context, StaticMeshReload& reload) const
+{
+    // the change can be in a dependency the cooked file is newer than, the source is cooked again whatever its time
+    std::filesystem::path cookedPath = m_Path;
+    if (MeshFile::IsMeshFile(m_Path) == false)
+    {
+        cookedPath = MeshFile::GetCookedPath(m_Path);
+        if (MeshFile::Cook(m_Path, cookedPath, ApplicationBase::GetRenderer().GetVertexFormat(), ApplicationBase::GetTaskScheduler()) == false)
+        {
+            LNE_ERROR("Failed to reload {0}, the previous geometry is kept", m_Path.string());
+            return false;
+        }
+    }
 
-    auto& renderer = ApplicationBase::GetRenderer();
+    auto file = std::make_shared<MeshFile>();
+    if (file->Open(cookedPath) == false || file->GetHeader().VertexCount == 0 || file->GetHeader().IndexCount == 0)
+    {
+        LNE_ERROR("Failed to reload {0}, the previous geometry is kept", m_Path.string());
+        return false;
+    }
 
-    m_Geometry.VertexGPUBuffer = renderer.CreateGeometryBuffer(m_Vertices.data(), m_Vertices.size() * sizeof(Vertex));
-    m_Geometry.IndexGPUBuffer = renderer.CreateGeometryBuffer(m_Indices.data(), m_Indices.size() * sizeof(uint32_t));
-    
-    LoadMaterials(scene);
+    const MeshFileHeader& header = file->GetHeader();
+    uint64_t vertexSize = header.VertexSize;
+    uint64_t indexOffset = AlignGeometry(vertexSize);
+    uint64_t indexSize = header.IndexSize;
+    uint64_t meshletOffset = indexOffset + AlignGeometry(indexSize);
+    uint64_t meshletSize = (uint64_t)header.MeshletCount * sizeof(Meshlet);
+    reload.Staging = context->AllocateStagingBuffer(meshletOffset + meshletSize);
+    uint8_t* staging = (uint8_t*)reload.Staging.AllocationInfo.pMappedData;
+    memcpy(staging, file->GetVertexData(), vertexSize);
+    memcpy(staging + indexOffset, file->GetIndexData(), indexSize);
+    memcpy(staging + meshletOffset, file->GetMeshlets(), meshletSize);
+    reload.File = std::move(file);
+    return true;
 }
 
-void lne::StaticMesh::LoadMaterials(const aiScene* scene)
+bool lne::StaticMesh::ApplyReload(vk::CommandBuffer cmdBuffer, StaticMeshReload& reload)
 {
     auto& renderer = ApplicationBase::GetRenderer();
-
-    for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
+    const MeshFileHeader& header = reload.File->GetHeader();
+    uint64_t vertexSize = header.VertexSize;
+    uint64_t indexSize = header.IndexSize;
+    uint64_t meshletSize = (uint64_t)header.MeshletCount * sizeof(Meshlet);
+
+    // copied in place when the size is the same, into a new range otherwise: the frames in flight keep reading the old one.
+    // The new ranges are allocated first, the previous geometry is kept whole when the arenas are out of room
+    auto reserve = [](SafePtr<GeometryBuffer>& buffer, SafePtr<GeometryArena> arena, uint64_t size)
     {
-        const aiMaterial* aiMat = scene->mMaterials[i];
-        aiString name;
-        aiMat->Get(AI_MATKEY_NAME, name);
-
-        LNE_INFO("Material: {0}", name.C_Str());
+        return buffer->GetSize() == size ? buffer : arena->Allocate(size);
+    };
+    SafePtr<GeometryBuffer> vertexBuffer = reserve(m_Geometry.VertexGPUBuffer, renderer.GetVertexArena(), vertexSize);
+    SafePtr<GeometryBuffer> indexBuffer = reserve(m_Geometry.IndexGPUBuffer, renderer.GetIndexArena(), indexSize);
+    SafePtr<GeometryBuffer> meshletBuffer = reserve(m_Geometry.MeshletGPUBuffer, renderer.GetIndexArena(), meshletSize);
+    if (vertexBuffer == false || indexBuffer == false || meshletBuffer == false)
+    {
+        LNE_ERROR("Failed to reload {0}, the previous geometry is kept", m_Path.string());
+        return false;
+    }
 
-        SafePtr<Material> material = SafePtr<Material>(lnnew Material(m_Pipeline));
-        m_Materials.push_back(material);
+    auto update = [&](SafePtr<GeometryBuffer>& buffer, SafePtr<GeometryBuffer>& newBuffer, uint64_t stagingOffset)
+    {
+        if ((buffer == newBuffer) == false)
+        {
+            renderer.ReleaseDeferred(SafePtr<RefCountBase>(buffer.GetPtr()));
+            buffer = newBuffer;
+        }
+        buffer->UpdateData(cmdBuffer, reload.Staging, stagingOffset);
+    };
+    update(m_Geometry.VertexGPUBuffer, vertexBuffer, 0);
+    update(m_Geometry.IndexGPUBuffer, indexBuffer, AlignGeometry(vertexSize));
+    update(m_Geometry.MeshletGPUBuffer, meshletBuffer, AlignGeometry(vertexSize) + AlignGeometry(indexSize));
+
+    m_Geometry.VertexCount = header.VertexCount;
+    m_Geometry.IndexCount = header.IndexCount;
+    m_Geometry.MeshletCount = header.MeshletCount;
+    m_Geometry.VertexFormat = header.VertexFormat;
+    m_Geometry.VertexDecodeSize = header.VertexDecodeSize;
+    m_SubMeshes = ReadSubMeshes(*reload.File);
+    LoadMaterials(*reload.File);
+    return true;
+}
 
-        aiString texturePath;
+void lne::StaticMesh::LoadMaterials(const MeshFile& file)
+{
+    auto& renderer = ApplicationBase::GetRenderer();
 
-        aiColor3D aiColor(1.0f);
+    // a reload updates the existing materials, the frames in flight may still use the ones it drops
+    uint32_t materialCount = file.GetHeader().MaterialCount;
+    for (size_t i = materialCount; i < m_Materials.size(); ++i)
+        renderer.ReleaseDeferred(SafePtr<RefCountBase>(m_Materials[i].GetPtr()));
+    if (m_Materials.size() > materialCount)
+        m_Materials.resize(materialCount);
 
-        if (aiMat->Get(AI_MATKEY_COLOR_DIFFUSE, aiColor) == AI_SUCCESS)
-        {
-            glm::vec4 color = { aiColor.r, aiColor.g, aiColor.b, 1.0f };
-            material->SetProperty("uColor", color);
-        }
+    std::vector<SafePtr<Texture>> textures;
+    const MeshFileMaterial* materials = file.GetMaterials();
+    for (uint32_t i = 0; i < materialCount; ++i)
+    {
+        const MeshFileMaterial& fileMaterial = materials[i];
 
-        float roughness, metallic;
-        if (aiMat->Get(AI_MATKEY_REFLECTIVITY, metallic) != AI_SUCCESS)
-            metallic = 0.0f;
-        material->SetProperty("uMetalness", metallic);
+        LNE_INFO("Material: {0}", fileMaterial.Name);
 
-        if (aiMat->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness) != AI_SUCCESS)
-            roughness = 0.4f;
-        material->SetProperty("uRoughness", roughness);
+        if (i == m_Materials.size())
+            m_Materials.push_back(SafePtr<Material>(lnnew Material(m_Pipeline)));
+        SafePtr<Material> material = m_Materials[i];
 
-        bool hasAlbedoTex = aiMat->GetTexture(AI_MATKEY_BASE_COLOR_TEXTURE, &texturePath) == AI_SUCCESS;
+        if (fileMaterial.HasColor)
+            material->SetProperty("uColor", fileMaterial.Color);
 
-        if (!hasAlbedoTex)
-            hasAlbedoTex = aiMat->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS;
+        material->SetProperty("uMetalness", fileMaterial.Metalness);
+        material->SetProperty("uRoughness", fileMaterial.Roughness);
 
-        if (hasAlbedoTex)
+        if (fileMaterial.AlbedoPath[0] != '\0')
         {
-            std::filesystem::path texPath = m_Path.parent_path() / texturePath.C_Str();
-            if (!std::filesystem::exists(texPath))
+            std::filesystem::path texPath = m_Path.parent_path() / fileMaterial.AlbedoPath;
+            if (VirtualFileSystem::Get().Exists(texPath) == false)
             {
                 LNE_WARN("Texture not found: {0}", texPath.string());
             }
@@ -164,23 +316,10 @@ void lne::StaticMesh::LoadMaterials(const aiScene* scene)
             {
                 SafePtr<Texture> texture = renderer.CreateTexture(texPath.string());
                 material->SetTexture("tAlbedo", texture);
-                m_Textures.push_back(texture);
+                textures.push_back(texture);
             }
         }
     }
-}
-
-void lne::StaticMesh::TraverseNodes(const aiNode* node, const glm::mat4& parentTransform)
-{
-    glm::mat4 transform = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
-    glm::mat4 worldTransform = parentTransform * transform;
-
-    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
-    {
-        uint32_t meshIndex = node->mMeshes[i];
-        m_SubMeshes[meshIndex].WorldTransform = worldTransform;
-    }
-
-    for (uint32_t i = 0; i < node->mNumChildren; ++i)
-        TraverseNodes(node->mChildren[i], worldTransform);
+    // swapped once the new ones are referenced, the textures that are still used aren't released and loaded again
+    m_Textures = std::move(textures);
 }
@@ -1,24 +1,53 @@
 #pragma once
-#include "StorageBuffer.h"
+#include "GfxEnums.h"
+#include "GeometryArena.h"
 #include "Structs.h"
 
 namespace lne
 {
+// ranges of the vertex and index arenas of the renderer, the shaders address them from their offset
 struct Geometry
 {
-    SafePtr<StorageBuffer> VertexGPUBuffer;
-    SafePtr<StorageBuffer> IndexGPUBuffer;
+    SafePtr<GeometryBuffer> VertexGPUBuffer;
+    SafePtr<GeometryBuffer> IndexGPUBuffer;
+    // clusters of the index buffer culled on the GPU before drawing, in the index arena, null for the geometry built at runtime
+    SafePtr<GeometryBuffer> MeshletGPUBuffer;
 
     uint32_t VertexCount;
     uint32_t IndexCount;
+    uint32_t MeshletCount{ 0 };
+    // bytes per index of the geometry built at runtime, the submeshes of a StaticMesh have their own
+    uint32_t IndexStride{ sizeof(uint32_t) };
+
+    EVertexFormat VertexFormat{ EVertexFormat::eFloat };
+    // bytes of the decoding header at the start of the vertex buffer, the vertices follow
+    uint32_t VertexDecodeSize{ 0 };
+};
+
+/// <summary>
+/// Level of detail of a submesh: its own range of the index buffer and its own meshlets, over the vertices of the submesh.
+/// </summary>
+struct MeshLod
+{
+    static constexpr uint32_t s_MaxCount = 5;
+
+    // in indices of the stride of the submesh, like the ranges of its meshlets
+    uint32_t BaseIndex;
+    uint32_t IndexCount;
+    uint32_t BaseMeshlet;
+    uint32_t MeshletCount;
+    // how far the simplification moved the surface, relative to the radius of the bounding box of the submesh
+    float Error;
 };
 
 struct SubMesh
 {
     uint32_t BaseVertex;
-    uint32_t BaseIndex;
     uint32_t VertexCount;
-    uint32_t IndexCount;
+    // 2 bytes when the indices, relative to BaseVertex, fit in 16 bits
+    uint32_t IndexStride;
+    // from the full detail one, each level with about half the triangles of the previous one
+    std::vector<MeshLod> Lods;
     uint32_t MaterialIndex;
     AABB BoundingBox;
     std::string Name;
@@ -33,35 +62,137 @@ struct Vertex
     glm::vec2 TexCoord;
 };
 
+/// <summary>
+/// Half the size of a Vertex, decoded by the vertex pulling shaders. The position is quantized to 16 bits in the bounding
+/// box of its submesh, the normal is octahedral encoded on two snorm16 and the texture coordinates are half floats.
+/// </summary>
+struct PackedVertex
+{
+    uint16_t Position[3];
+    // index of the bounds the position is quantized in
+    uint16_t SubMeshIndex;
+    int16_t Normal[2];
+    uint16_t TexCoord[2];
+};
+
+/// <summary>
+/// Box a submesh quantizes its positions in: Position = Min + PackedVertex::Position * Scale.
+/// </summary>
+struct VertexBounds
+{
+    glm::vec3 Min;
+    float Padding0;
+    glm::vec3 Scale;
+    float Padding1;
+};
+
+/// <summary>
+/// Start of the vertex buffer of packed geometry, followed by BoundsCount VertexBounds then by the vertices at
+/// an offset any storage buffer binding can start at. The shaders get the offsets of both in the vertex arena.
+/// </summary>
+struct VertexDecodeHeader
+{
+    // the largest minStorageBufferOffsetAlignment allowed by the specification
+    static constexpr uint32_t s_VertexAlignment = 256;
+
+    EVertexFormat Format;
+    uint32_t BoundsCount;
+    uint32_t Padding[2];
+};
+
+/// <summary>
+/// Cluster of triangles, a contiguous range of the index buffer referencing at most s_MaxVertices vertices.
+/// Laid out like in the cluster culling shader.
+/// </summary>
+struct Meshlet
+{
+    static constexpr uint32_t s_MaxVertices = 64;
+    static constexpr uint32_t s_MaxTriangles = 124;
+
+    // bounding sphere, in the space of the vertices
+    glm::vec3 Center;
+    float Radius;
+    // every triangle faces away from the eye when dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff,
+    // the axis is null when the normals are too spread for the test to ever pass
+    glm::vec3 ConeApex;
+    float ConeCutoff;
+    glm::vec3 ConeAxis;
+    uint32_t BaseIndex;
+    uint32_t IndexCount;
+    uint32_t Padding[3];
+};
+
 class StaticMesh : public RefCountBase
 {
 public:
-    StaticMesh(std::filesystem::path path, SafePtr<class GfxPipeline> pipeline);
+    /// <summary>
+    /// Loads the mesh on the calling thread unless loadAsync is set, in which case the GfxLoader loads it
+    /// and the mesh is only drawn once IsReady returns true.
+    /// </summary>
+    StaticMesh(std::filesystem::path path, SafePtr<class GfxPipeline> pipeline, bool loadAsync = false);
+    ~StaticMesh();
+
+    [[nodiscard]] bool IsReady() const { return m_IsReady.load(); }
+    [[nodiscard]] bool HasLoadFailed() const { return m_LoadFailed.load(); }
 
     std::vector<SubMesh>& GetSubMeshes() { return m_SubMeshes; }
+    const std::vector<SubMesh>& GetSubMeshes() const { return m_SubMeshes; }
     const Geometry& GetGeometry() const { return m_Geometry; }
     SafePtr<class GfxPipeline> GetPipeline() { return m_Pipeline; }
     SafePtr<class Material> GetMaterial(uint32_t index) { return m_Materials[index]; }
+    void SetAssetKey(const std::string& key) { m_AssetKey = key; }
 
 private:
     std::filesystem::path m_Path{};
+    std::string m_AssetKey{};
     std::vector<SubMesh> m_SubMeshes{};
 
     Geometry m_Geometry{};
-    std::vector<Vertex> m_Vertices{};
-    std::vector<uint32_t> m_Indices{};
-    uint32_t m_TotalVertexCount{};
-    uint32_t m_TotalIndexCount{};
 
     // TODO: move to a resource manager
     std::vector<SafePtr<class Material>> m_Materials{};
     SafePtr<class GfxPipeline> m_Pipeline{};
     std::vector<SafePtr<class Texture>> m_Textures{};
+    // file kept mapped until the geometry is uploaded
+    std::unique_ptr<class MeshFile> m_File{};
+    std::atomic<bool> m_IsReady{ false };
+    std::atomic<bool> m_LoadFailed{ false };
+    // written from the host, there is no ownership to acquire
+    bool m_IsGeometryWritten{ false };
+    // the culling pre-pass runs before the acquire and the reload copies of the frame, it skips the mesh for that frame
+    uint64_t m_GeometryUpdateFrame{ 0 };
+
+    friend class GfxLoader;
+    friend class Renderer;
 private:
-    void InitSubmeshes(const struct aiScene* scene);
-    void LoadData(const struct aiScene* scene);
-    void LoadMaterials(const struct aiScene* scene);
-    void TraverseNodes(const struct aiNode* node, const glm::mat4& parentTransform);
+    bool LoadFile();
+    void FinalizeLoad();
+    void MarkLoadFailed();
+    void LoadMaterials(const class MeshFile& file);
+
+    // async path
+    /// <summary>
+    /// False when the arenas are out of room.
+    /// </summary>
+    [[nodiscard]] bool AllocateGeometry();
+    [[nodiscard]] uint64_t GetGeometryUploadSize() const;
+    /// <summary>
+    /// Fills the geometry buffers from the mapped file when both are host visible, in place of UploadGeometry and AcquireGeometry.
+    /// </summary>
+    [[nodiscard]] bool WriteGeometry();
+    void UploadGeometry(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer);
+    void AcquireGeometry(vk::CommandBuffer cmdBuffer);
+
+    // hot reload
+    /// <summary>
+    /// Cooks the source again and fills a staging buffer with the new geometry, on the loader thread.
+    /// </summary>
+    bool PrepareReload(SafePtr<class GfxContext> context, struct StaticMeshReload& reload) const;
+    /// <summary>
+    /// Swaps in the reloaded geometry, submeshes and materials on the main thread, the copies are recorded on the graphics queue.
+    /// False when the arenas are out of room for the new geometry, the mesh is left as it was.
+    /// </summary>
+    bool ApplyReload(vk::CommandBuffer cmdBuffer, struct StaticMeshReload& reload);
 };
 
 }
@@ -197,10 +197,14 @@ vk::PipelineLayout GfxPipeline::CreatePipelineLayout(const std::vector<vk::Descr
     completeLayouts.reserve(layouts.size() + 1);
     completeLayouts.insert(completeLayouts.begin(), layouts.begin(), layouts.end());
     completeLayouts.emplace_back(m_Context->GetBindlessDescriptorSetLayout());
-    auto layout = m_Context->GetDevice().createPipelineLayout(vk::PipelineLayoutCreateInfo{
+    vk::PipelineLayoutCreateInfo layoutInfo{
         {},
         completeLayouts
-    });
+    };
+    const vk::PushConstantRange& pushConstants = m_Shader->GetReflectedData().PushConstants;
+    if (pushConstants.size > 0)
+        layoutInfo.setPushConstantRanges(pushConstants);
+    auto layout = m_Context->GetDevice().createPipelineLayout(layoutInfo);
     m_Context->SetVkObjectName(layout, std::format("PipelineLayout: {}", m_Desc.Name));
     return layout;
 }
@@ -80,6 +80,10 @@ public:
     [[nodiscard]] vk::PipelineLayout CreatePipelineLayout(const std::vector<vk::DescriptorSetLayout>& layouts);
     [[nodiscard]] vk::PipelineLayout GetLayout() const { return m_Layout; }
     [[nodiscard]] std::vector<vk::DescriptorSetLayout> GetDescriptorSetLayouts() const { return m_Shader->GetDescriptorSetLayouts(); }
+    // size 0 when the shader declares no push constants
+    [[nodiscard]] const vk::PushConstantRange& GetPushConstantRange() const { return m_Shader->GetReflectedData().PushConstants; }
+    // the counter clockwise triangles are the front ones, the cluster culling can drop the ones facing away
+    [[nodiscard]] bool CullsBackFaces() const { return m_Desc.CullMode == ECullMode::Back && m_Desc.WindingOrder == EWindingOrder::CounterClockwise; }
 
 private:
     SafePtr<class GfxContext> m_Context;
@@ -0,0 +1,494 @@
+#include "ProceduralMesh.h"
+#include "Renderer.h"
+#include "BufferUploadBatch.h"
+#include "Core/ApplicationBase.h"
+#include "Core/Utils/Log.h"
+#include "Resources/AssetRegistry.h"
+
+#include <charconv>
+
+namespace lne
+{
+namespace
+{
+void ComputeBounds(ProceduralMeshData& data)
+{
+    data.Bounds = AABB{ .Min = glm::vec3(std::numeric_limits<float>::max()), .Max = glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (const Vertex& vertex : data.Vertices)
+    {
+        data.Bounds.Min = glm::min(data.Bounds.Min, vertex.Position);
+        data.Bounds.Max = glm::max(data.Bounds.Max, vertex.Position);
+    }
+}
+
+// shortest text that reads back as the same float, two sizes never share a key
+void AppendParam(std::string& key, float value)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    key += '|';
+    key.append(buffer, result.ptr);
+}
+
+void AppendParam(std::string& key, uint32_t value)
+{
+    key += '|';
+    key += std::to_string(value);
+}
+
+template<typename... Params>
+std::string MakeKey(const char* shape, Params... params)
+{
+    // not a path, nothing on disk can have this name
+    std::string key = std::string("<procedural>/") + shape;
+    (AppendParam(key, params), ...);
+    return key;
+}
+
+// rows of columns + 1 vertices, the last column repeats the first one with u = 1. The bands between the rows are
+// quads, or triangles when the top or bottom row is a single point repeated.
+void WriteGridIndices(uint32_t* indices, uint32_t baseVertex, uint32_t rows, uint32_t columns, bool topIsPoint, bool bottomIsPoint)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i + 1 < rows; ++i)
+    {
+        for (uint32_t j = 0; j < columns; ++j)
+        {
+            uint32_t index[4] = {
+                baseVertex + i * (columns + 1) + j,
+                baseVertex + i * (columns + 1) + (j + 1),
+                baseVertex + (i + 1) * (columns + 1) + (j + 1),
+                baseVertex + (i + 1) * (columns + 1) + j
+            };
+
+            if (i > 0 || topIsPoint == false)
+            {
+                indices[count++] = index[0];
+                indices[count++] = index[1];
+                indices[count++] = index[2];
+            }
+            if (i + 2 < rows || bottomIsPoint == false)
+            {
+                indices[count++] = index[0];
+                indices[count++] = index[2];
+                indices[count++] = index[3];
+            }
+        }
+    }
+}
+
+uint32_t GetGridIndexCount(uint32_t rows, uint32_t columns, bool topIsPoint, bool bottomIsPoint)
+{
+    return 6 * (rows - 1) * columns - (topIsPoint ? 3 * columns : 0) - (bottomIsPoint ? 3 * columns : 0);
+}
+}
+
+ProceduralMesh::ProceduralMesh(const ProceduralMeshData& data)
+    : m_Bounds(data.Bounds)
+{
+    auto& renderer = ApplicationBase::GetRenderer();
+    auto uploadBatch = renderer.CreateUploadBatch();
+
+    m_Geometry.VertexGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetVertexArena(), data.Vertices.data(), data.Vertices.size() * sizeof(Vertex));
+    m_Geometry.VertexCount = (uint32_t)data.Vertices.size();
+    m_Geometry.IndexCount = (uint32_t)data.Indices.size();
+    // half the index memory and fetch bandwidth for the primitives small enough, like the submeshes of the cooked models
+    if (data.Vertices.size() <= (size_t)std::numeric_limits<uint16_t>::max() + 1)
+    {
+        std::vector<uint16_t> indices(data.Indices.size());
+        for (size_t i = 0; i < indices.size(); ++i)
+            indices[i] = (uint16_t)data.Indices[i];
+        m_Geometry.IndexStride = sizeof(uint16_t);
+        m_Geometry.IndexGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetIndexArena(), indices.data(), indices.size() * sizeof(uint16_t));
+    }
+    else
+    {
+        m_Geometry.IndexStride = sizeof(uint32_t);
+        m_Geometry.IndexGPUBuffer = uploadBatch->CreateGeometryBuffer(renderer.GetIndexArena(), data.Indices.data(), data.Indices.size() * sizeof(uint32_t));
+    }
+    uploadBatch->Submit();
+    uploadBatch->Wait();
+
+    if (IsValid() == false)
+        m_Geometry = Geometry{};
+}
+
+ProceduralMesh::~ProceduralMesh()
+{
+    if (m_AssetKey.empty() == false)
+        AssetRegistry::Get().Remove(m_AssetKey, this);
+}
+
+void ProceduralMesh::GeneratePlane(ProceduralMeshData& data, uint32_t subdivisions)
+{
+    subdivisions = std::max(subdivisions, 1u);
+    data.Vertices.resize((size_t)(subdivisions + 1) * (subdivisions + 1));
+    data.Indices.resize((size_t)6 * subdivisions * subdivisions);
+
+    float step = 2.0f / subdivisions;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i <= subdivisions; ++i)
+    {
+        for (uint32_t j = 0; j <= subdivisions; ++j)
+        {
+            data.Vertices[count].Position = { -1.0f + j * step, 0.0f, -1.0f + i * step };
+            data.Vertices[count].Normal = { 0.0f, 1.0f, 0.0f };
+            data.Vertices[count].TexCoord = { (float)j / subdivisions, (float)i / subdivisions };
+            ++count;
+        }
+    }
+
+    // the rows go toward +Z, the quads are wound the other way than the ones of the spheres to face up
+    count = 0;
+    for (uint32_t i = 0; i < subdivisions; ++i)
+    {
+        for (uint32_t j = 0; j < subdivisions; ++j)
+        {
+            uint32_t index[4] = {
+                i * (subdivisions + 1) + j,
+                i * (subdivisions + 1) + (j + 1),
+                (i + 1) * (subdivisions + 1) + (j + 1),
+                (i + 1) * (subdivisions + 1) + j
+            };
+
+            data.Indices[count++] = index[0];
+            data.Indices[count++] = index[3];
+            data.Indices[count++] = index[2];
+
+            data.Indices[count++] = index[0];
+            data.Indices[count++] = index[2];
+            data.Indices[count++] = index[1];
+        }
+    }
+    ComputeBounds(data);
+}
+
+void ProceduralMesh::GenerateCube(ProceduralMeshData& data, uint32_t tesselation)
+{
+    tesselation = std::max(tesselation, 1u);
+    size_t quadCount = (size_t)6 * tesselation * tesselation;
+    data.Vertices.resize(quadCount * 4);
+    data.Indices.resize(quadCount * 6);
+
+    float step = 2.0f / tesselation;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    auto addQuad = [&](glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 normal)
+    {
+        uint32_t startIndex = vertexCount;
+        data.Vertices[vertexCount++] = { p0, normal, { 0.0f, 0.0f } };
+        data.Vertices[vertexCount++] = { p1, normal, { 1.0f, 0.0f } };
+        data.Vertices[vertexCount++] = { p2, normal, { 1.0f, 1.0f } };
+        data.Vertices[vertexCount++] = { p3, normal, { 0.0f, 1.0f } };
+
+        data.Indices[indexCount++] = startIndex + 0;
+        data.Indices[indexCount++] = startIndex + 1;
+        data.Indices[indexCount++] = startIndex + 2;
+        data.Indices[indexCount++] = startIndex + 2;
+        data.Indices[indexCount++] = startIndex + 3;
+        data.Indices[indexCount++] = startIndex + 0;
+    };
+
+    for (uint32_t i = 0; i < tesselation; ++i)
+    {
+        for (uint32_t j = 0; j < tesselation; ++j)
+        {
+            float x0 = -1.0f + i * step;
+            float x1 = x0 + step;
+            float y0 = -1.0f + j * step;
+            float y1 = y0 + step;
+
+            // Front face
+            addQuad({ x0, y0, 1.0f }, { x1, y0, 1.0f }, { x1, y1, 1.0f }, { x0, y1, 1.0f }, { 0.0f, 0.0f, 1.0f });
+            // Back face
+            addQuad({ x1, y0, -1.0f }, { x0, y0, -1.0f }, { x0, y1, -1.0f }, { x1, y1, -1.0f }, { 0.0f, 0.0f, -1.0f });
+            // Left face
+            addQuad({ -1.0f, y0, x0 }, { -1.0f, y0, x1 }, { -1.0f, y1, x1 }, { -1.0f, y1, x0 }, { -1.0f, 0.0f, 0.0f });
+            // Right face
+            addQuad({ 1.0f, y0, x1 }, { 1.0f, y0, x0 }, { 1.0f, y1, x0 }, { 1.0f, y1, x1 }, { 1.0f, 0.0f, 0.0f });
+            // Top face
+            addQuad({ x0, 1.0f, y0 }, { x0, 1.0f, y1 }, { x1, 1.0f, y1 }, { x1, 1.0f, y0 }, { 0.0f, 1.0f, 0.0f });
+            // Bottom face
+            addQuad({ x0, -1.0f, y0 }, { x1, -1.0f, y0 }, { x1, -1.0f, y1 }, { x0, -1.0f, y1 }, { 0.0f, -1.0f, 0.0f });
+        }
+    }
+    ComputeBounds(data);
+}
+
+void ProceduralMesh::GenerateUVSphere(ProceduralMeshData& data, float radius, uint32_t nLatitude, uint32_t nLongitude)
+{
+    if (nLatitude < 1)
+        nLatitude = 1;
+    if (nLongitude < 3)
+        nLongitude = 3;
+
+    uint32_t nVertices = nLatitude * (nLongitude + 1) + (nLongitude * 2);
+    //-1 to nLat because it wouldn't make sense otherwise.
+    uint32_t nIndices = 2 * 3 * nLongitude + 2 * 3 * (nLatitude - 1) * nLongitude;
+
+    std::vector<Vertex>& vertices = data.Vertices;
+    std::vector<uint32_t>& indices = data.Indices;
+    vertices.resize(nVertices);
+    indices.resize(nIndices);
+
+    // here, latitude points should be mapped between -90 and 90 degrees (or -PI/2 to PI/2).
+    // +1 to nLat because it wouldn't make sense otherwise.
+    float latitudeSlope = glm::pi<float>() / (float)(nLatitude + 1);
+    // here, longitude points should be mapped between -180 and 180 degrees (or -PI to PI).
+    float longitudeSlope = (2.f * glm::pi<float>()) / (float)nLongitude;
+
+    uint32_t count = 0;
+    // add north pole
+    for (uint32_t i = 1; i <= nLongitude; ++i)
+    {
+        vertices[count].Position = { 0.0f, radius, 0.0f };
+        vertices[count].TexCoord = { (float)i / ((float)nLongitude + 1.0f), 0.0f };
+        vertices[count].Normal = { 0.0f, 1.0f, 0.0f };
+        ++count;
+    }
+
+    //middle quads
+    for (uint32_t i = 1; i < (nLatitude + 1); ++i)
+    {
+        float pLat = latitudeSlope * (float)i;
+        for (uint32_t j = 0; j < nLongitude + 1; ++j)
+        {
+            float pLon = longitudeSlope * (float)j;
+            glm::vec3 point = { sinf(pLat) * cosf(pLon), cosf(pLat), sinf(pLat) * sinf(pLon) };
+
+            vertices[count].Position = { radius * point.x, radius * point.y, radius * point.z };
+            vertices[count].TexCoord = { (float)j / (float)nLongitude, (float)i / (float)(nLatitude + 1) };
+            vertices[count].Normal = glm::vec3(point);
+
+            ++count;
+        }
+    }
+
+    //add south pole
+    for (uint32_t i = 1; i <= nLongitude; ++i)
+    {
+        vertices[count].Position = { 0.0f, -radius, 0.0f };
+        vertices[count].TexCoord = { (float)i / ((float)nLongitude + 1.0f), 1.0f };
+        vertices[count].Normal = { 0.0f, -1.0f, 0.0f };
+        ++count;
+    }
+
+    count = 0;
+    //north pole indices
+    for (uint32_t i = 0; i < nLongitude; ++i)
+    {
+        indices[count++] = i;
+        indices[count++] = (nLongitude - 1) + i + 2;
+        indices[count++] = (nLongitude - 1) + i + 1;
+    }
+
+    //middle quads
+    WriteGridIndices(indices.data() + count, nLongitude, nLatitude, nLongitude, false, false);
+    count += GetGridIndexCount(nLatitude, nLongitude, false, false);
+
+    //south pole indices
+    const uint32_t southPoleIndex = nVertices - nLongitude;
+    for (uint32_t i = 0; i < nLongitude; ++i)
+    {
+        indices[count++] = southPoleIndex + i;
+        indices[count++] = southPoleIndex - (nLongitude + 1) + i;
+        indices[count++] = southPoleIndex - (nLongitude + 1) + i + 1;
+    }
+    ComputeBounds(data);
+}
+
+void ProceduralMesh::GenerateIcoSphere(ProceduralMeshData& data, float radius, uint32_t subdivisions)
+{
+    subdivisions = std::min(subdivisions, s_MaxIcoSphereSubdivisions);
+
+    // every subdivision splits each triangle in 4 and adds a vertex on each edge: V - E + F = 2 gives the counts
+    uint32_t faceCount = 20u << (2 * subdivisions);
+    data.Vertices.resize(faceCount / 2 + 2);
+    data.Indices.resize((size_t)faceCount * 3);
+
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    const glm::vec3 corners[12] = {
+        { -1.0f, t, 0.0f }, { 1.0f, t, 0.0f }, { -1.0f, -t, 0.0f }, { 1.0f, -t, 0.0f },
+        { 0.0f, -1.0f, t }, { 0.0f, 1.0f, t }, { 0.0f, -1.0f, -t }, { 0.0f, 1.0f, -t },
+        { t, 0.0f, -1.0f }, { t, 0.0f, 1.0f }, { -t, 0.0f, -1.0f }, { -t, 0.0f, 1.0f }
+    };
+    const uint32_t faces[60] = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+        1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+        4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+    };
+
+    uint32_t vertexCount = 0;
+    for (const glm::vec3& corner : corners)
+        data.Vertices[vertexCount++].Position = glm::normalize(corner);
+
+    // the levels are built in the front of the index array and the spare one, the last level ends up in the index array
+    std::vector<uint32_t> spare(subdivisions > 0 ? data.Indices.size() / 4 : 0);
+    uint32_t* source = (subdivisions & 1) ? spare.data() : data.Indices.data();
+    uint32_t* destination = (subdivisions & 1) ? data.Indices.data() : spare.data();
+    std::copy(faces, faces + 60, source);
+
+    // vertex added on an edge, shared by the two triangles of the edge
+    std::unordered_map<uint64_t, uint32_t> midpoints;
+    auto getMidpoint = [&](uint32_t a, uint32_t b)
+    {
+        uint64_t edge = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+        auto [it, isNew] = midpoints.try_emplace(edge, vertexCount);
+        if (isNew)
+            data.Vertices[vertexCount++].Position = glm::normalize(data.Vertices[a].Position + data.Vertices[b].Position);
+        return it->second;
+    };
+
+    for (uint32_t level = 0, levelFaces = 20; level < subdivisions; ++level, levelFaces *= 4)
+    {
+        midpoints.clear();
+        midpoints.reserve((size_t)levelFaces * 3 / 2);
+        for (uint32_t f = 0; f < levelFaces; ++f)
+        {
+            uint32_t a = source[f * 3 + 0];
+            uint32_t b = source[f * 3 + 1];
+            uint32_t c = source[f * 3 + 2];
+            uint32_t ab = getMidpoint(a, b);
+            uint32_t bc = getMidpoint(b, c);
+            uint32_t ca = getMidpoint(c, a);
+
+            uint32_t* out = destination + f * 12;
+            out[0] = a;  out[1] = ab;  out[2] = ca;
+            out[3] = b;  out[4] = bc;  out[5] = ab;
+            out[6] = c;  out[7] = ca;  out[8] = bc;
+            out[9] = ab; out[10] = bc; out[11] = ca;
+        }
+        std::swap(source, destination);
+    }
+
+    for (Vertex& vertex : data.Vertices)
+    {
+        glm::vec3 normal = vertex.Position;
+        vertex.Normal = normal;
+        vertex.Position = normal * radius;
+        vertex.TexCoord = { std::atan2(normal.z, normal.x) / (2.0f * glm::pi<float>()) + 0.5f, std::acos(glm::clamp(normal.y, -1.0f, 1.0f)) / glm::pi<float>() };
+    }
+    ComputeBounds(data);
+}
+
+void ProceduralMesh::GenerateCylinder(ProceduralMeshData& data, float radius, float height, uint32_t segments)
+{
+    segments = std::max(segments, 3u);
+    // the side, then each cap: its center and its own ring with the normal of the cap
+    data.Vertices.resize((size_t)2 * (segments + 1) + (size_t)2 * (segments + 2));
+    data.Indices.resize((size_t)12 * segments);
+
+    float halfHeight = height * 0.5f;
+    float segmentSlope = (2.0f * glm::pi<float>()) / (float)segments;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        for (uint32_t j = 0; j <= segments; ++j)
+        {
+            glm::vec3 direction = { cosf(segmentSlope * j), 0.0f, sinf(segmentSlope * j) };
+            data.Vertices[count++] = { direction * radius + glm::vec3(0.0f, i == 0 ? halfHeight : -halfHeight, 0.0f), direction, { (float)j / segments, (float)i } };
+        }
+    }
+    WriteGridIndices(data.Indices.data(), 0, 2, segments, false, false);
+
+    uint32_t indexCount = 6 * segments;
+    for (float side : { 1.0f, -1.0f })
+    {
+        uint32_t center = count;
+        glm::vec3 normal = { 0.0f, side, 0.0f };
+        data.Vertices[count++] = { normal * halfHeight, normal, { 0.5f, 0.5f } };
+        for (uint32_t j = 0; j <= segments; ++j)
+        {
+            glm::vec2 direction = { cosf(segmentSlope * j), sinf(segmentSlope * j) };
+            data.Vertices[count++] = { glm::vec3(direction.x * radius, side * halfHeight, direction.y * radius), normal, direction * 0.5f + 0.5f };
+        }
+        for (uint32_t j = 0; j < segments; ++j)
+        {
+            // wound like the poles of the UV sphere
+            data.Indices[indexCount++] = center;
+            data.Indices[indexCount++] = center + 1 + (side > 0.0f ? j + 1 : j);
+            data.Indices[indexCount++] = center + 1 + (side > 0.0f ? j : j + 1);
+        }
+    }
+    ComputeBounds(data);
+}
+
+void ProceduralMesh::GenerateCapsule(ProceduralMeshData& data, float radius, float height, uint32_t segments, uint32_t rings)
+{
+    segments = std::max(segments, 3u);
+    rings = std::max(rings, 1u);
+    height = std::max(height, 2.0f * radius);
+
+    // each half sphere goes from its pole to the equator, the band between the two equators is the cylinder
+    uint32_t rows = 2 * (rings + 1);
+    data.Vertices.resize((size_t)rows * (segments + 1));
+    data.Indices.resize(GetGridIndexCount(rows, segments, true, true));
+
+    float centerOffset = height * 0.5f - radius;
+    float ringSlope = glm::half_pi<float>() / (float)rings;
+    float segmentSlope = (2.0f * glm::pi<float>()) / (float)segments;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < rows; ++i)
+    {
+        bool isTop = i <= rings;
+        float latitude = ringSlope * (float)(isTop ? i : i - 1);
+        glm::vec3 center = { 0.0f, isTop ? centerOffset : -centerOffset, 0.0f };
+        for (uint32_t j = 0; j <= segments; ++j)
+        {
+            float longitude = segmentSlope * (float)j;
+            glm::vec3 normal = { sinf(latitude) * cosf(longitude), cosf(latitude), sinf(latitude) * sinf(longitude) };
+            glm::vec3 position = center + normal * radius;
+            data.Vertices[count++] = { position, normal, { (float)j / segments, 0.5f - position.y / height } };
+        }
+    }
+    WriteGridIndices(data.Indices.data(), 0, rows, segments, true, true);
+    ComputeBounds(data);
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreatePlane(uint32_t subdivisions)
+{
+    return GetOrCreate(MakeKey("plane", subdivisions), [=](ProceduralMeshData& data) { GeneratePlane(data, subdivisions); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreateCube(uint32_t tesselation)
+{
+    return GetOrCreate(MakeKey("cube", tesselation), [=](ProceduralMeshData& data) { GenerateCube(data, tesselation); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreateUVSphere(float radius, uint32_t nLatitude, uint32_t nLongitude)
+{
+    return GetOrCreate(MakeKey("uvsphere", radius, nLatitude, nLongitude), [=](ProceduralMeshData& data) { GenerateUVSphere(data, radius, nLatitude, nLongitude); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreateIcoSphere(float radius, uint32_t subdivisions)
+{
+    return GetOrCreate(MakeKey("icosphere", radius, subdivisions), [=](ProceduralMeshData& data) { GenerateIcoSphere(data, radius, subdivisions); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreateCylinder(float radius, float height, uint32_t segments)
+{
+    return GetOrCreate(MakeKey("cylinder", radius, height, segments), [=](ProceduralMeshData& data) { GenerateCylinder(data, radius, height, segments); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::CreateCapsule(float radius, float height, uint32_t segments, uint32_t rings)
+{
+    return GetOrCreate(MakeKey("capsule", radius, height, segments, rings), [=](ProceduralMeshData& data) { GenerateCapsule(data, radius, height, segments, rings); });
+}
+
+SafePtr<ProceduralMesh> ProceduralMesh::GetOrCreate(const std::string& key, const std::function<void(ProceduralMeshData&)>& generate)
+{
+    return AssetRegistry::Get().GetOrCreate<ProceduralMesh>(key, [&]()
+    {
+        ProceduralMeshData data{};
+        generate(data);
+        SafePtr<ProceduralMesh> mesh = SafePtr<ProceduralMesh>(lnnew ProceduralMesh(data));
+        if (mesh->IsValid() == false)
+        {
+            LNE_ERROR("Failed to upload the procedural mesh {0}", key);
+            return SafePtr<ProceduralMesh>();
+        }
+        return mesh;
+    });
+}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+#include "Mesh.h"
+
+namespace lne
+{
+/// <summary>
+/// Output of the generators, sized once from the parameters before being filled. The faces are counter clockwise seen
+/// from outside, around the origin with the Y axis up.
+/// </summary>
+struct ProceduralMeshData
+{
+    std::vector<Vertex> Vertices{};
+    std::vector<uint32_t> Indices{};
+    AABB Bounds{};
+};
+
+/// <summary>
+/// Geometry generated from a few parameters and uploaded to the vertex and index arenas of the renderer. The Create
+/// functions return the mesh already created with the same parameters while something still references it, so the
+/// same primitive drawn many times is generated and uploaded once. The Generate functions only build the data.
+/// </summary>
+class ProceduralMesh : public RefCountBase
+{
+public:
+    static constexpr uint32_t s_MaxIcoSphereSubdivisions = 7;
+
+    /// <summary>
+    /// Uploads the data and waits for it, IsValid returns false if the arenas are out of room.
+    /// </summary>
+    ProceduralMesh(const ProceduralMeshData& data);
+    ~ProceduralMesh();
+    MOVABLE_ONLY(ProceduralMesh);
+
+    /// <summary>
+    /// Square of side 2 in the XZ plane facing up, split in subdivisions quads along each side.
+    /// </summary>
+    static void GeneratePlane(ProceduralMeshData& data, uint32_t subdivisions = 1);
+    /// <summary>
+    /// Cube of side 2, each face split in tesselation quads along each side with their own texture coordinates.
+    /// </summary>
+    static void GenerateCube(ProceduralMeshData& data, uint32_t tesselation = 1);
+    static void GenerateUVSphere(ProceduralMeshData& data, float radius = 1.0f, uint32_t nLatitude = 32, uint32_t nLongitude = 32);
+    /// <summary>
+    /// Subdivided icosahedron, 20 * 4^subdivisions triangles of about the same size. The texture coordinates are the
+    /// spherical ones and wrap across the seam.
+    /// </summary>
+    static void GenerateIcoSphere(ProceduralMeshData& data, float radius = 1.0f, uint32_t subdivisions = 3);
+    /// <summary>
+    /// Cylinder along the Y axis, closed by flat caps.
+    /// </summary>
+    static void GenerateCylinder(ProceduralMeshData& data, float radius = 1.0f, float height = 2.0f, uint32_t segments = 32);
+    /// <summary>
+    /// Cylinder along the Y axis closed by half spheres, height includes them and is at least twice the radius.
+    /// Rings is the number of latitudes of each half sphere.
+    /// </summary>
+    static void GenerateCapsule(ProceduralMeshData& data, float radius = 0.5f, float height = 2.0f, uint32_t segments = 32, uint32_t rings = 8);
+
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreatePlane(uint32_t subdivisions = 1);
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreateCube(uint32_t tesselation = 1);
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreateUVSphere(float radius = 1.0f, uint32_t nLatitude = 32, uint32_t nLongitude = 32);
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreateIcoSphere(float radius = 1.0f, uint32_t subdivisions = 3);
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreateCylinder(float radius = 1.0f, float height = 2.0f, uint32_t segments = 32);
+    [[nodiscard]] static SafePtr<ProceduralMesh> CreateCapsule(float radius = 0.5f, float height = 2.0f, uint32_t segments = 32, uint32_t rings = 8);
+
+    [[nodiscard]] bool IsValid() const { return m_Geometry.VertexGPUBuffer && m_Geometry.IndexGPUBuffer; }
+    [[nodiscard]] Geometry& GetGeometry() { return m_Geometry; }
+    [[nodiscard]] const AABB& GetBounds() const { return m_Bounds; }
+    void SetAssetKey(const std::string& key) { m_AssetKey = key; }
+
+private:
+    Geometry m_Geometry{};
+    AABB m_Bounds{};
+    std::string m_AssetKey{};
+
+private:
+    [[nodiscard]] static SafePtr<ProceduralMesh> GetOrCreate(const std::string& key, const std::function<void(ProceduralMeshData&)>& generate);
+};
+}
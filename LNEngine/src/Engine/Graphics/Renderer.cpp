@@ -10,44 +10,102 @@
 #include "Core/Utils/Defines.h"
 #include "DynamicDescriptorAllocator.h"
 #include "Mesh.h"
-#include "StorageBuffer.h"
+#include "GeometryArena.h"
+#include "BufferUploadBatch.h"
+#include "ClusterCuller.h"
 #include "Scene/Components.h"
 #include "Material.h"
 #include "Resources/GfxLoader.h"
-#include "Mesh.h"
+#include "Resources/AssetRegistry.h"
 
 // TODO: move this to a resource manager
 #include <stb/stb_image.h>
 
 namespace lne
 {
+namespace
+{
+// the coarsest level whose error projects under this many pixels is drawn
+constexpr float s_LodErrorPixels = 1.0f;
+// a level is kept until its error leaves this margin around the threshold
+constexpr float s_LodHysteresis = 0.25f;
+// an object that wasn't drawn for this many frames starts again from the full detail
+constexpr uint64_t s_LodSelectionLifetime = 120;
+
+// the arenas are bound whole, they can't exceed the largest storage buffer binding
+constexpr uint64_t s_VertexArenaSize = 256ull << 20;
+constexpr uint64_t s_IndexArenaSize = 128ull << 20;
+// upload batches in flight before the next one waits for the oldest
+constexpr uint32_t s_UploadBatchCount = 4;
+
+void PushDrawConstants(vk::CommandBuffer cmdBuffer, const GfxPipeline& pipeline, const DrawConstants& constants)
+{
+    // the shaders that don't pull vertices don't declare them
+    const vk::PushConstantRange& range = pipeline.GetPushConstantRange();
+    if (range.size >= sizeof(DrawConstants))
+        cmdBuffer.pushConstants(pipeline.GetLayout(), range.stageFlags, 0, sizeof(DrawConstants), &constants);
+}
+}
+
 void Renderer::Init(std::unique_ptr<Window>& window, std::shared_ptr<enki::TaskScheduler> taskScheduler)
 {
     m_Context = window->GetGfxContext();
     m_Swapchain = window->GetSwapchain();
     m_GraphicsCommandBufferManager = std::make_unique<CommandBufferManager>(m_Context.GetPtr(), m_Swapchain->GetImageCount(), EQueueFamilyType::Graphics);
+    m_UploadCommandBufferManager = std::make_unique<CommandBufferManager>(m_Context.GetPtr(), s_UploadBatchCount, EQueueFamilyType::Transfer);
     m_TaskScheduler = taskScheduler;
     m_GfxLoader = lnnew GfxLoader();
     m_GfxLoader->Init(this, m_Context, m_TaskScheduler);
+    uint64_t maxStorageBufferRange = m_Context->GetProperties().limits.maxStorageBufferRange;
+    m_VertexArena = SafePtr<GeometryArena>(lnnew GeometryArena(m_Context, std::min(s_VertexArenaSize, maxStorageBufferRange), "Vertices"));
+    m_IndexArena = SafePtr<GeometryArena>(lnnew GeometryArena(m_Context, std::min(s_IndexArenaSize, maxStorageBufferRange), "Indices"));
+    m_ClusterCuller = std::make_unique<ClusterCuller>(m_Context, m_IndexArena, m_Swapchain->GetImageCount());
     m_TexturesToUpdate.reserve(128);
     for (uint32_t i = 0; i < m_Swapchain->GetImageCount(); i++)
     {
         InitFrameData(i);
     }
+
+    // bound in place of the decoding header of packed vertices
+    VertexDecodeHeader floatVertexDecode{ .Format = EVertexFormat::eFloat };
+    m_FloatVertexDecode = CreateGeometryBuffer(m_VertexArena, &floatVertexDecode, sizeof(VertexDecodeHeader));
 }
 
 void Renderer::Nuke()
 {
     m_Context->WaitIdle();
     m_GfxLoader->Nuke();
+    m_ClusterCuller.reset();
+    m_FloatVertexDecode.Reset();
+    for (auto& reload : m_TextureReloads)
+        m_Context->FreeBuffer(reload.Staging);
+    for (auto& reload : m_StaticMeshReloads)
+        m_Context->FreeBuffer(reload.Staging);
+    m_TextureReloads.clear();
+    m_StaticMeshReloads.clear();
+    for (auto& [imageView, frame] : m_DeferredImageViews)
+        m_Context->GetDevice().destroyImageView(imageView);
+    for (auto& [image, frame] : m_DeferredImages)
+        m_Context->FreeImage(image);
+    for (auto& [buffer, frame] : m_DeferredBuffers)
+        m_Context->FreeBuffer(buffer);
+    m_DeferredImageViews.clear();
+    m_DeferredImages.clear();
+    m_DeferredBuffers.clear();
+    m_DeferredReleases.clear();
     for (auto& frameData : m_FrameData)
     {
         frameData.GlobalUniforms.Destroy();
+        frameData.GeometryDescriptorSets.clear();
         frameData.DescriptorAllocator.Reset();
         m_Context->GetDevice().destroyDescriptorSetLayout(frameData.DescriptorSetLayout);
     }
     m_FrameData.clear();
+    // the ranges still held by the meshes keep them alive
+    m_VertexArena.Reset();
+    m_IndexArena.Reset();
     m_GraphicsCommandBufferManager.reset();
+    m_UploadCommandBufferManager.reset();
     m_Context.Reset();
     m_Swapchain.Reset();
     m_GfxLoader.Reset();
@@ -60,8 +118,14 @@ void Renderer::BeginFrame()
     auto currentImage = m_Swapchain->GetCurrentImage();
     currentImage->TransitionLayout(m_GraphicsCommandBufferManager->GetCurrentCommandBuffer(), vk::ImageLayout::eGeneral);
     auto& cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
+    m_ClusterCuller->BeginFrame(imageIndex);
 
+    ++m_FrameCount;
+    std::erase_if(m_LodSelections, [&](const auto& entry) { return entry.second.LastFrame + s_LodSelectionLifetime < m_FrameCount; });
+    DestroyDeferredResources();
     UpdateTextures();
+    UpdateStaticMeshes();
+    ApplyReloads();
 
     auto viewport = m_Swapchain->GetViewport();
     cmdBuffer.setScissor(0, viewport.GetScissor());
@@ -71,6 +135,7 @@ void Renderer::BeginFrame()
     cmdBuffer.setViewport(0, vp);
 
     m_FrameData[imageIndex].DescriptorAllocator->Clear();
+    m_FrameData[imageIndex].GeometryDescriptorSets.clear();
 
     m_FrameData[imageIndex].DescriptorSet = m_FrameData[imageIndex].DescriptorAllocator->Allocate(m_FrameData[imageIndex].DescriptorSetLayout);
 
@@ -100,7 +165,8 @@ void Renderer::EndFrame()
 
     vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
     vk::SubmitInfo submitInfo = m_Swapchain->GetSubmitInfo(waitStages);
-    m_GraphicsCommandBufferManager->Submit(submitInfo);
+    // the culling dispatches run before the draws that read their results
+    m_GraphicsCommandBufferManager->Submit(submitInfo, UINT32_MAX, m_ClusterCuller->EndFrame());
 }
 
 void Renderer::BeginScene(const TransformComponent& cameraTransform, const CameraComponent& camera, const glm::vec3& sunDirection)
@@ -116,6 +182,11 @@ void Renderer::BeginScene(const TransformComponent& cameraTransform, const Camer
     };
 
     m_FrameData[imageIndex].GlobalUniforms.CopyData(cmdBuffer, uniforms);
+
+    m_ClusterCuller->SetView(uniforms.ViewProj, cameraTransform.Position);
+
+    m_CameraPosition = cameraTransform.Position;
+    m_ProjectionScale = std::abs(camera.Proj[1][1]) * 0.5f * m_Swapchain->GetViewport().GetViewport().height;
 }
 
 void Renderer::BeginRenderPass(const Framebuffer& framebuffer) const
@@ -129,47 +200,32 @@ void Renderer::EndRenderPass(const Framebuffer& framebuffer) const
 }
 
 void Renderer::Draw(SafePtr<Material> material, struct Geometry& geometry, TransformComponent& objTransform)
+{
+    Draw(material, geometry, objTransform.GetModelMatrix(), objTransform.UniformBuffers);
+}
+
+void Renderer::Draw(SafePtr<StaticMesh> mesh, TransformComponent& objTransform)
+{
+    Draw(mesh, objTransform.GetModelMatrix(), objTransform.UniformBuffers);
+}
+
+void Renderer::Draw(SafePtr<Material> material, struct Geometry& geometry, const glm::mat4& model, SafePtr<UniformBufferManager> uniformBuffers)
 {
     auto pipeline = material->GetPipeline();
     auto& cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
     pipeline->Bind(cmdBuffer);
-    
-    // Create & update geometry descriptor set
-    auto geometryDescSetLayout = pipeline->GetDescriptorSetLayouts()[1];
-    vk::DescriptorSet geometryDescSet = m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorAllocator->Allocate(geometryDescSetLayout);
-
-    auto vertexInfo = geometry.VertexGPUBuffer->GetDescriptorInfo();
-    auto indexInfo = geometry.IndexGPUBuffer->GetDescriptorInfo();
-    std::vector<vk::WriteDescriptorSet> writeGeoDescriptorSets;
-    writeGeoDescriptorSets.emplace_back(vk::WriteDescriptorSet{
-        geometryDescSet,
-        0,
-        0,
-        1,
-        vk::DescriptorType::eStorageBuffer,
-        nullptr,
-        &vertexInfo,
-        nullptr
-    });
-    writeGeoDescriptorSets.emplace_back(vk::WriteDescriptorSet{
-        geometryDescSet,
-        1,
-        0,
-        1,
-        vk::DescriptorType::eStorageBuffer,
-        nullptr,
-        &indexInfo,
-        nullptr
-    });
 
-    m_Context->GetDevice().updateDescriptorSets(writeGeoDescriptorSets, nullptr);
+    // no bounds for raw geometry, stream everything
+    material->RequestTextureResolution(std::numeric_limits<float>::max());
+    
+    vk::DescriptorSet geometryDescSet = GetGeometryDescriptorSet(*pipeline);
 
     // Create & update object descriptor set
-    objTransform.UniformBuffers->CopyData(cmdBuffer, objTransform.GetModelMatrix());
+    uniformBuffers->CopyData(cmdBuffer, model);
     auto objDescSetLayout = pipeline->GetDescriptorSetLayouts()[2];
     vk::DescriptorSet objDescSet = m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorAllocator->Allocate(objDescSetLayout);
 
-    auto objInfo = objTransform.UniformBuffers->GetCurrentBuffer().GetDescriptorInfo();
+    auto objInfo = uniformBuffers->GetCurrentBuffer().GetDescriptorInfo();
     vk::WriteDescriptorSet writeObjDescriptorSet = vk::WriteDescriptorSet{
         objDescSet,
         0,
@@ -203,58 +259,57 @@ void Renderer::Draw(SafePtr<Material> material, struct Geometry& geometry, Trans
     m_Context->GetDevice().updateDescriptorSets(matWriteDescriptorSets, nullptr);
 
     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->GetLayout(), 0, { m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorSet, geometryDescSet, objDescSet, matDescSet, m_Context->GetBindlessDescriptorSet() }, {});
-    cmdBuffer.draw(geometry.IndexCount, 1, 0, 0);
+    PushDrawConstants(cmdBuffer, *pipeline, GetDrawConstants(geometry, 0, geometry.IndexStride));
+    cmdBuffer.draw(geometry.IndexCount, 1, (uint32_t)(geometry.IndexGPUBuffer->GetOffset() / geometry.IndexStride), 0);
 }
 
-void Renderer::Draw(SafePtr<StaticMesh> mesh, TransformComponent& objTransform)
+void Renderer::Draw(SafePtr<StaticMesh> mesh, const glm::mat4& model, SafePtr<UniformBufferManager> uniformBuffers)
 {
+    if (mesh->IsReady() == false)
+    {
+        // the bounds aren't known before the file is parsed, the closest meshes are loaded first
+        float distance = glm::length(glm::vec3(model[3]) - m_CameraPosition);
+        m_GfxLoader->SetPriority(mesh.GetPtr(), 1.0f / (1.0f + distance));
+        return;
+    }
+
     auto& cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
     auto pipeline = mesh->GetPipeline();
     auto& geometry = mesh->GetGeometry();
     pipeline->Bind(cmdBuffer);
 
     auto& submeshes = mesh->GetSubMeshes();
-    for (const auto& submesh : submeshes)
+    // a reload can change the submeshes, the levels then start again from the full detail
+    LodSelection& lodSelection = m_LodSelections[uniformBuffers.GetPtr()];
+    if (lodSelection.Mesh != mesh.GetPtr() || lodSelection.Levels.size() != submeshes.size())
+        lodSelection = LodSelection{ .Mesh = mesh.GetPtr(), .Levels = std::vector<uint32_t>(submeshes.size(), 0) };
+    lodSelection.LastFrame = m_FrameCount;
+
+    // the same for every submesh
+    uniformBuffers->CopyData(cmdBuffer, model);
+    auto objInfo = uniformBuffers->GetCurrentBuffer().GetDescriptorInfo();
+
+    for (size_t s = 0; s < submeshes.size(); ++s)
     {
+        const SubMesh& submesh = submeshes[s];
         auto material = mesh->GetMaterial(submesh.MaterialIndex);
+        float screenSize = ComputeScreenSize(submesh.BoundingBox, model * submesh.WorldTransform);
+        material->RequestTextureResolution(screenSize);
 
+        lodSelection.Levels[s] = SelectLod(submesh.Lods, screenSize, lodSelection.Levels[s]);
+        const MeshLod& lod = submesh.Lods[lodSelection.Levels[s]];
 
-        // Create & update geometry descriptor set
-        auto geometryDescSetLayout = pipeline->GetDescriptorSetLayouts()[1];
-        vk::DescriptorSet geometryDescSet = m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorAllocator->Allocate(geometryDescSetLayout);
+        // the visible meshlets are appended to the index buffer of the frame, the level is drawn whole when it is full
+        ClusterDraw clusterDraw{};
+        bool isCulled = m_ClusterCulling && lod.MeshletCount > 0 && mesh->m_GeometryUpdateFrame != m_FrameCount
+            && m_ClusterCuller->Cull(geometry, submesh, lod, model, pipeline->CullsBackFaces(), clusterDraw);
 
-        auto vertexInfo = geometry.VertexGPUBuffer->GetDescriptorInfo();
-        auto indexInfo = geometry.IndexGPUBuffer->GetDescriptorInfo();
-        std::vector<vk::WriteDescriptorSet> writeGeoDescriptorSets;
-        writeGeoDescriptorSets.emplace_back(vk::WriteDescriptorSet{
-            geometryDescSet,
-            0,
-            0,
-            1,
-            vk::DescriptorType::eStorageBuffer,
-            nullptr,
-            &vertexInfo,
-            nullptr
-            });
-        writeGeoDescriptorSets.emplace_back(vk::WriteDescriptorSet{
-            geometryDescSet,
-            1,
-            0,
-            1,
-            vk::DescriptorType::eStorageBuffer,
-            nullptr,
-            &indexInfo,
-            nullptr
-            });
-
-        m_Context->GetDevice().updateDescriptorSets(writeGeoDescriptorSets, nullptr);
+        vk::DescriptorSet geometryDescSet = GetGeometryDescriptorSet(*pipeline);
 
         // Create & update object descriptor set
-        objTransform.UniformBuffers->CopyData(cmdBuffer, objTransform.GetModelMatrix());
         auto objDescSetLayout = pipeline->GetDescriptorSetLayouts()[2];
         vk::DescriptorSet objDescSet = m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorAllocator->Allocate(objDescSetLayout);
 
-        auto objInfo = objTransform.UniformBuffers->GetCurrentBuffer().GetDescriptorInfo();
         vk::WriteDescriptorSet writeObjDescriptorSet = vk::WriteDescriptorSet{
             objDescSet,
             0,
@@ -288,7 +343,13 @@ void Renderer::Draw(SafePtr<StaticMesh> mesh, TransformComponent& objTransform)
         m_Context->GetDevice().updateDescriptorSets(matWriteDescriptorSets, nullptr);
 
         cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->GetLayout(), 0, { m_FrameData[m_Swapchain->GetCurrentFrameIndex()].DescriptorSet, geometryDescSet, objDescSet, matDescSet, m_Context->GetBindlessDescriptorSet() }, {});
-        cmdBuffer.draw(submesh.IndexCount, 1, submesh.BaseIndex, 0);
+        // the culled indices are widened to 32 bits, their draw command starts at their range of the index arena
+        PushDrawConstants(cmdBuffer, *pipeline,
+            GetDrawConstants(geometry, submesh.BaseVertex, isCulled ? (uint32_t)sizeof(uint32_t) : submesh.IndexStride));
+        if (isCulled)
+            cmdBuffer.drawIndirect(clusterDraw.IndirectBuffer, clusterDraw.IndirectOffset, 1, sizeof(vk::DrawIndirectCommand));
+        else
+            cmdBuffer.draw(lod.IndexCount, 1, (uint32_t)(geometry.IndexGPUBuffer->GetOffset() / submesh.IndexStride) + lod.BaseIndex, 0);
     }
 }
 
@@ -299,21 +360,83 @@ SafePtr<GfxPipeline> Renderer::CreateGraphicsPipeline(const GraphicsPipelineDesc
     return pipeline;
 }
 
-SafePtr<class StorageBuffer> Renderer::CreateGeometryBuffer(const void* data, size_t size)
+SafePtr<GeometryBuffer> Renderer::CreateGeometryBuffer(SafePtr<GeometryArena> arena, const void* data, size_t size)
 {
-    SafePtr<StorageBuffer> buffer;
-    buffer.Reset(lnnew StorageBuffer(m_Context, (uint64_t)size, data));
+    BufferUploadBatch batch(m_Context, *m_UploadCommandBufferManager, m_UploadBatchIndex++ % s_UploadBatchCount);
+    SafePtr<GeometryBuffer> buffer = batch.CreateGeometryBuffer(arena, data, (uint64_t)size);
+    batch.Submit();
+    batch.Wait();
     return buffer;
 }
 
-SafePtr<Texture> Renderer::CreateTexture(const std::string& fullPath)
+std::unique_ptr<BufferUploadBatch> Renderer::CreateUploadBatch()
+{
+    return std::make_unique<BufferUploadBatch>(m_Context, *m_UploadCommandBufferManager, m_UploadBatchIndex++ % s_UploadBatchCount);
+}
+
+SafePtr<Texture> Renderer::CreateTexture(const std::string& fullPath, float priority)
+{
+    return m_GfxLoader->CreateTexture(fullPath, priority);
+}
+
+SafePtr<Texture> Renderer::CreateCubemapTexture(const std::vector<std::string>& faces, float priority)
+{
+    return m_GfxLoader->CreateCubemap(faces, priority);
+}
+
+SafePtr<StaticMesh> Renderer::CreateStaticMesh(const std::filesystem::path& path, SafePtr<GfxPipeline> pipeline)
+{
+    // materials are built for the pipeline, the same model with another pipeline is another asset
+    std::string key = AssetRegistry::MakeKey(path, std::to_string((uintptr_t)pipeline.GetPtr()));
+    SafePtr<StaticMesh> mesh = AssetRegistry::Get().GetOrCreate<StaticMesh>(key, [&]()
+    {
+        return SafePtr<StaticMesh>(lnnew StaticMesh(path, pipeline));
+    });
+    m_GfxLoader->Watch(key, ResourceTypes::eStaticMesh, { path.string() });
+    return mesh;
+}
+
+SafePtr<StaticMesh> Renderer::CreateStaticMeshAsync(const std::filesystem::path& path, SafePtr<GfxPipeline> pipeline, float priority)
+{
+    std::string key = AssetRegistry::MakeKey(path, std::to_string((uintptr_t)pipeline.GetPtr()));
+    SafePtr<StaticMesh> staticMesh = AssetRegistry::Get().GetOrCreate<StaticMesh>(key, [&]()
+    {
+        SafePtr<StaticMesh> mesh = SafePtr<StaticMesh>(lnnew StaticMesh(path, pipeline, true));
+        m_GfxLoader->LoadStaticMesh(mesh, priority);
+        return mesh;
+    });
+    m_GfxLoader->Watch(key, ResourceTypes::eStaticMesh, { path.string() });
+    return staticMesh;
+}
+
+AssetAwaitable<Texture> Renderer::LoadTexture(const std::string& fullPath, float priority, EResumeOn resumeOn)
+{
+    return AssetAwaitable<Texture>(CreateTexture(fullPath, priority), resumeOn);
+}
+
+AssetAwaitable<Texture> Renderer::LoadCubemapTexture(const std::vector<std::string>& faces, float priority, EResumeOn resumeOn)
+{
+    return AssetAwaitable<Texture>(CreateCubemapTexture(faces, priority), resumeOn);
+}
+
+AssetAwaitable<StaticMesh> Renderer::LoadStaticMesh(const std::filesystem::path& path, SafePtr<GfxPipeline> pipeline, float priority, EResumeOn resumeOn)
+{
+    return AssetAwaitable<StaticMesh>(CreateStaticMeshAsync(path, pipeline, priority), resumeOn);
+}
+
+void Renderer::SetLoadPriority(const RefCountBase* asset, float priority)
 {
-    return m_GfxLoader->CreateTexture(fullPath);
+    m_GfxLoader->SetPriority(asset, priority);
 }
 
-SafePtr<Texture> Renderer::CreateCubemapTexture(const std::vector<std::string>& faces)
+void Renderer::SetMipGeneration(EMipGeneration mode)
 {
-    return m_GfxLoader->CreateCubemap(faces);
+    m_GfxLoader->SetMipGeneration(mode);
+}
+
+void Renderer::SetHotReload(bool enabled)
+{
+    m_GfxLoader->SetHotReload(enabled);
 }
 
 SafePtr<UniformBufferManager> Renderer::RegisterObject()
@@ -326,7 +449,51 @@ SafePtr<UniformBufferManager> Renderer::RegisterObject()
 void Renderer::AddTextureToUpdate(SafePtr<class Texture> texture)
 {
     std::lock_guard<std::mutex> lock(m_TexturesToUpdateMutex);
-    m_TexturesToUpdate.push_back(texture);
+    m_TexturesToUpdate.push_back({ texture });
+}
+
+void Renderer::AddTextureToUpdate(SafePtr<class Texture> texture, uint32_t baseMip, uint32_t mipCount)
+{
+    std::lock_guard<std::mutex> lock(m_TexturesToUpdateMutex);
+    m_TexturesToUpdate.push_back({ texture, baseMip, mipCount });
+}
+
+void Renderer::AddStaticMeshToUpdate(SafePtr<StaticMesh> mesh)
+{
+    std::lock_guard<std::mutex> lock(m_StaticMeshesToUpdateMutex);
+    m_StaticMeshesToUpdate.push_back(mesh);
+}
+
+void Renderer::AddTextureReload(TextureReload reload)
+{
+    std::lock_guard<std::mutex> lock(m_ReloadsMutex);
+    m_TextureReloads.push_back(std::move(reload));
+}
+
+void Renderer::AddStaticMeshReload(StaticMeshReload reload)
+{
+    std::lock_guard<std::mutex> lock(m_ReloadsMutex);
+    m_StaticMeshReloads.push_back(std::move(reload));
+}
+
+void Renderer::DestroyImageViewDeferred(vk::ImageView imageView)
+{
+    m_DeferredImageViews.emplace_back(imageView, m_FrameCount);
+}
+
+void Renderer::DestroyImageDeferred(ImageAllocation image)
+{
+    m_DeferredImages.emplace_back(image, m_FrameCount);
+}
+
+void Renderer::DestroyBufferDeferred(BufferAllocation buffer)
+{
+    m_DeferredBuffers.emplace_back(buffer, m_FrameCount);
+}
+
+void Renderer::ReleaseDeferred(SafePtr<RefCountBase> object)
+{
+    m_DeferredReleases.emplace_back(std::move(object), m_FrameCount);
 }
 
 void Renderer::InitFrameData(uint32_t index)
@@ -357,21 +524,169 @@ void Renderer::UpdateTextures()
         return;
 
     auto cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
-    for (auto& texture : m_TexturesToUpdate)
+    uint32_t transferFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer);
+    uint32_t graphicsFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics);
+    for (auto& [texture, baseMip, mipCount] : m_TexturesToUpdate)
     {
-        texture->TransitionLayout(cmdBuffer, vk::ImageLayout::eTransferDstOptimal,
-                m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer), m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics));
-
-        if (texture->ShouldGenerateMips() == false)
+        if (texture->IsStreamed())
         {
-            texture->TransitionLayout(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+            // only the streamed range was released, the other mips are either in use or not loaded yet
+            texture->TransitionLayoutMips(cmdBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal,
+                baseMip, mipCount, transferFamily, graphicsFamily);
+            texture->TransitionLayoutMips(cmdBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                baseMip, mipCount);
+            texture->SetResidentMip(baseMip);
             continue;
         }
 
-        texture->GenerateMipmaps(cmdBuffer);
+        // textures whose mips were built on the compute queue are released in ShaderReadOnlyOptimal,
+        // the ones copied from the host are already there and owned by no queue
+        if (texture->GetReleasingQueue() != EQueueFamilyType::Graphics)
+            texture->TransitionLayout(cmdBuffer, texture->GetLayout(),
+                m_Context->GetQueueFamilyIndex(texture->GetReleasingQueue()), graphicsFamily);
 
-        texture->TransitionLayout(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+        if (texture->ShouldGenerateMips())
+            texture->GenerateMipmaps(cmdBuffer);
+
+        if (texture->GetLayout() != vk::ImageLayout::eShaderReadOnlyOptimal)
+            texture->TransitionLayout(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+        if (texture->IsResident() == false)
+            texture->SetResidentMip(0);
     }
     m_TexturesToUpdate.clear();
 }
+
+void Renderer::UpdateStaticMeshes()
+{
+    std::lock_guard<std::mutex> lock(m_StaticMeshesToUpdateMutex);
+    if (m_StaticMeshesToUpdate.empty())
+        return;
+
+    auto cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
+    for (auto& mesh : m_StaticMeshesToUpdate)
+    {
+        mesh->AcquireGeometry(cmdBuffer);
+        mesh->m_GeometryUpdateFrame = m_FrameCount;
+        mesh->FinalizeLoad();
+    }
+    m_StaticMeshesToUpdate.clear();
+}
+
+void Renderer::ApplyReloads()
+{
+    std::lock_guard<std::mutex> lock(m_ReloadsMutex);
+    if (m_TextureReloads.empty() && m_StaticMeshReloads.empty())
+        return;
+
+    // recorded before the draws of the frame, the staging buffers are freed once it has completed
+    auto cmdBuffer = m_GraphicsCommandBufferManager->GetCurrentCommandBuffer();
+    for (auto& reload : m_TextureReloads)
+    {
+        reload.Texture->Reload(cmdBuffer, reload.Staging, reload.Width, reload.Height, reload.MipCount, reload.Format);
+        DestroyBufferDeferred(reload.Staging);
+        LNE_INFO("Reloaded {0}", reload.Texture->GetName());
+    }
+    for (auto& reload : m_StaticMeshReloads)
+    {
+        if (reload.Mesh->ApplyReload(cmdBuffer, reload))
+        {
+            reload.Mesh->m_GeometryUpdateFrame = m_FrameCount;
+            LNE_INFO("Reloaded {0}", reload.Mesh->m_Path.string());
+        }
+        DestroyBufferDeferred(reload.Staging);
+    }
+    m_TextureReloads.clear();
+    m_StaticMeshReloads.clear();
+}
+
+void Renderer::DestroyDeferredResources()
+{
+    // a resource retired during frame N can be referenced by every frame in flight up to N
+    uint64_t framesInFlight = m_Swapchain->GetImageCount();
+    auto isInUse = [&](uint64_t frame) { return m_FrameCount - frame <= framesInFlight; };
+    std::erase_if(m_DeferredImageViews, [&](const auto& deferred)
+    {
+        if (isInUse(deferred.second))
+            return false;
+        m_Context->GetDevice().destroyImageView(deferred.first);
+        return true;
+    });
+    std::erase_if(m_DeferredImages, [&](auto& deferred)
+    {
+        if (isInUse(deferred.second))
+            return false;
+        m_Context->FreeImage(deferred.first);
+        return true;
+    });
+    std::erase_if(m_DeferredBuffers, [&](auto& deferred)
+    {
+        if (isInUse(deferred.second))
+            return false;
+        m_Context->FreeBuffer(deferred.first);
+        return true;
+    });
+    std::erase_if(m_DeferredReleases, [&](const auto& deferred) { return isInUse(deferred.second) == false; });
+}
+
+float Renderer::ComputeScreenSize(const AABB& bounds, const glm::mat4& transform) const
+{
+    glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.Min + bounds.Max) * 0.5f, 1.0f));
+    glm::vec3 extents = (bounds.Max - bounds.Min) * 0.5f;
+    float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+    float radius = glm::length(extents) * scale;
+
+    // a submesh without a box has an unknown size, it keeps the full detail of its levels and textures
+    float distance = glm::length(center - m_CameraPosition);
+    if (radius <= 0.0f || distance <= radius)
+        return std::numeric_limits<float>::max();
+
+    // diameter of the bounding sphere projected on the viewport
+    return 2.0f * radius * m_ProjectionScale / distance;
+}
+
+vk::DescriptorSet Renderer::GetGeometryDescriptorSet(const GfxPipeline& pipeline)
+{
+    FrameData& frameData = m_FrameData[m_Swapchain->GetCurrentFrameIndex()];
+    vk::DescriptorSetLayout layout = pipeline.GetDescriptorSetLayouts()[1];
+    auto it = frameData.GeometryDescriptorSets.find(layout);
+    if (it != frameData.GeometryDescriptorSets.end())
+        return it->second;
+
+    vk::DescriptorSet geometryDescSet = frameData.DescriptorAllocator->Allocate(layout);
+    vk::DescriptorBufferInfo vertexInfo = m_VertexArena->GetDescriptorInfo();
+    vk::DescriptorBufferInfo indexInfo = m_IndexArena->GetDescriptorInfo();
+    std::array<vk::WriteDescriptorSet, 2> writeGeoDescriptorSets{
+        vk::WriteDescriptorSet{ geometryDescSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &vertexInfo },
+        vk::WriteDescriptorSet{ geometryDescSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &indexInfo },
+    };
+    m_Context->GetDevice().updateDescriptorSets(writeGeoDescriptorSets, nullptr);
+
+    frameData.GeometryDescriptorSets.emplace(layout, geometryDescSet);
+    return geometryDescSet;
+}
+
+DrawConstants Renderer::GetDrawConstants(const Geometry& geometry, uint32_t baseVertex, uint32_t indexStride) const
+{
+    uint64_t vertexOffset = geometry.VertexGPUBuffer->GetOffset();
+    // packed vertices follow their decoding header in the same range, the others share a header for float vertices
+    uint64_t decodeOffset = geometry.VertexDecodeSize > 0 ? vertexOffset : m_FloatVertexDecode->GetOffset();
+    return DrawConstants{
+        .DecodeOffset = (uint32_t)(decodeOffset / sizeof(uint32_t)),
+        .VertexOffset = (uint32_t)((vertexOffset + geometry.VertexDecodeSize) / sizeof(uint32_t)),
+        .BaseVertex = baseVertex,
+        .IndexStride = indexStride
+    };
+}
+
+uint32_t Renderer::SelectLod(const std::vector<MeshLod>& lods, float screenSize, uint32_t currentLevel) const
+{
+    // the errors are relative to the radius of the submesh, the screen size is its projected diameter
+    auto getErrorPixels = [&](uint32_t level) { return lods[level].Error * screenSize * 0.5f; };
+    uint32_t level = std::min(currentLevel, (uint32_t)lods.size() - 1);
+    while (level > 0 && getErrorPixels(level) > s_LodErrorPixels * (1.0f + s_LodHysteresis))
+        --level;
+    while (level + 1 < (uint32_t)lods.size() && getErrorPixels(level + 1) < s_LodErrorPixels * (1.0f - s_LodHysteresis))
+        ++level;
+    return level;
+}
 }
@@ -2,6 +2,7 @@
 #include "GfxEnums.h"
 #include "Engine/Core/SafePtr.h"
 #include "Engine/Resources/GfxLoader.h"
+#include "Engine/Resources/AssetAwaitable.h"
 #include "UniformBuffer.h"
 
 namespace enki
@@ -20,11 +21,24 @@ struct GlobalUniforms
     glm::vec3 SunDirection;
 };
 
+// laid out like in the vertex pulling shaders
+struct DrawConstants
+{
+    // in words of the vertex arena: the decoding header of the geometry and its first vertex
+    uint32_t DecodeOffset;
+    uint32_t VertexOffset;
+    uint32_t BaseVertex;
+    // 2 when the indices are 16 bit pairs in the words of the index arena
+    uint32_t IndexStride;
+};
+
 struct FrameData {
     UniformBuffer GlobalUniforms;
     SafePtr<class DynamicDescriptorAllocator> DescriptorAllocator;
     vk::DescriptorSet DescriptorSet;
     vk::DescriptorSetLayout DescriptorSetLayout;
+    // the arenas bound once per geometry set layout, whatever the number of draws
+    std::unordered_map<VkDescriptorSetLayout, vk::DescriptorSet> GeometryDescriptorSets{};
 
     FrameData(UniformBuffer&& globalUniforms, SafePtr<class DynamicDescriptorAllocator> descriptorAllocator, 
         vk::DescriptorSetLayout descriptorSetLayout)
@@ -35,6 +49,22 @@ struct FrameData {
     }
 };
 
+struct TextureUpdate
+{
+    SafePtr<class Texture> Texture;
+    // range of mips released by the transfer queue, only used for streamed textures
+    uint32_t BaseMip{ 0 };
+    uint32_t MipCount{ 0 };
+};
+
+// levels of detail of the submeshes of a static mesh when an object last drew it
+struct LodSelection
+{
+    const class StaticMesh* Mesh{ nullptr };
+    std::vector<uint32_t> Levels{};
+    uint64_t LastFrame{ 0 };
+};
+
 class Renderer
 {
 public:
@@ -56,29 +86,148 @@ public:
 
     void Draw(SafePtr<class Material> pipeline, struct Geometry& geometry, struct TransformComponent& objTransform);
     void Draw(SafePtr<class StaticMesh> mesh, struct TransformComponent& objTransform);
+    /// <summary>
+    /// Same as the TransformComponent overloads with a model matrix already built, like the world matrices of a TransformStore.
+    /// </summary>
+    void Draw(SafePtr<class Material> pipeline, struct Geometry& geometry, const glm::mat4& model, SafePtr<class UniformBufferManager> uniformBuffers);
+    void Draw(SafePtr<class StaticMesh> mesh, const glm::mat4& model, SafePtr<class UniformBufferManager> uniformBuffers);
 
     // TODO: move to a resource manager
     [[nodiscard]] SafePtr<class GfxPipeline> CreateGraphicsPipeline(const struct GraphicsPipelineDesc& createInfo);
-    [[nodiscard]] SafePtr<class StorageBuffer> CreateGeometryBuffer(const void* data, size_t size);
-    [[nodiscard]] SafePtr<class Texture> CreateTexture(const std::string& fullPath);
-    [[nodiscard]] SafePtr<class Texture> CreateCubemapTexture(const std::vector<std::string>& faces);
+    /// <summary>
+    /// Uploads a single range of the vertex or index arena and waits for it. Prefer CreateUploadBatch when creating several buffers.
+    /// </summary>
+    [[nodiscard]] SafePtr<class GeometryBuffer> CreateGeometryBuffer(SafePtr<class GeometryArena> arena, const void* data, size_t size);
+    /// <summary>
+    /// Main thread only, the batches take turns on the command buffers of the renderer's transfer command buffer manager.
+    /// </summary>
+    [[nodiscard]] std::unique_ptr<class BufferUploadBatch> CreateUploadBatch();
+    /// <summary>
+    /// Every vertex buffer, and every index and meshlet buffer, is a range of one of these. The shaders see the whole
+    /// arenas through a single descriptor set and get the ranges of a draw from its push constants.
+    /// </summary>
+    [[nodiscard]] SafePtr<class GeometryArena> GetVertexArena() { return m_VertexArena; }
+    [[nodiscard]] SafePtr<class GeometryArena> GetIndexArena() { return m_IndexArena; }
+    /// <summary>
+    /// Pending loads are processed by priority, higher first. See SetLoadPriority to change it afterwards.
+    /// </summary>
+    [[nodiscard]] SafePtr<class Texture> CreateTexture(const std::string& fullPath, float priority = 0.0f);
+    [[nodiscard]] SafePtr<class Texture> CreateCubemapTexture(const std::vector<std::string>& faces, float priority = 0.0f);
+    /// <summary>
+    /// Returns the mesh already loaded from this path with this pipeline if there is one.
+    /// </summary>
+    [[nodiscard]] SafePtr<class StaticMesh> CreateStaticMesh(const std::filesystem::path& path, SafePtr<class GfxPipeline> pipeline);
+    /// <summary>
+    /// Returns immediately, the mesh is parsed and uploaded by the GfxLoader and skipped by Draw until it is ready.
+    /// </summary>
+    [[nodiscard]] SafePtr<class StaticMesh> CreateStaticMeshAsync(const std::filesystem::path& path, SafePtr<class GfxPipeline> pipeline, float priority = 0.0f);
+    /// <summary>
+    /// Same as CreateTexture, CreateCubemapTexture and CreateStaticMeshAsync for coroutines:
+    /// co_await renderer.LoadTexture(path) continues on the given thread once the asset can be drawn,
+    /// with an empty SafePtr if it failed to load. Combine them with WhenAll to wait for several assets.
+    /// </summary>
+    [[nodiscard]] AssetAwaitable<class Texture> LoadTexture(const std::string& fullPath, float priority = 0.0f, EResumeOn resumeOn = EResumeOn::eMainThread);
+    [[nodiscard]] AssetAwaitable<class Texture> LoadCubemapTexture(const std::vector<std::string>& faces, float priority = 0.0f, EResumeOn resumeOn = EResumeOn::eMainThread);
+    [[nodiscard]] AssetAwaitable<class StaticMesh> LoadStaticMesh(const std::filesystem::path& path, SafePtr<class GfxPipeline> pipeline, float priority = 0.0f,
+        EResumeOn resumeOn = EResumeOn::eMainThread);
+    /// <summary>
+    /// Re-prioritizes the pending loads of a texture or a mesh. Draw already does it for the meshes that aren't ready.
+    /// </summary>
+    void SetLoadPriority(const RefCountBase* asset, float priority);
+    /// <summary>
+    /// Selects where the mips of the decoded textures are built: blits on the graphics queue, the loader threads,
+    /// or a single dispatch on the async compute queue.
+    /// </summary>
+    void SetMipGeneration(EMipGeneration mode);
+    /// <summary>
+    /// Culls the meshlets of the static meshes against the frustum and their normal cone on the GPU before drawing them,
+    /// the visible triangles are drawn with one indirect draw per submesh.
+    /// </summary>
+    void SetClusterCulling(bool enabled) { m_ClusterCulling = enabled; }
+    /// <summary>
+    /// Vertex format the meshes cooked at runtime are written with, the ones cooked in another format are cooked again.
+    /// Packed vertices take half the memory and fetch bandwidth, the shaders decode both. Set it before creating the meshes.
+    /// </summary>
+    void SetVertexFormat(EVertexFormat format) { m_VertexFormat = format; }
+    [[nodiscard]] EVertexFormat GetVertexFormat() const { return m_VertexFormat; }
+    /// <summary>
+    /// Watches the files of the textures and meshes created from then on and reloads them in place when they change on disk,
+    /// the materials keep referencing them as they are. Meant for development: the files are polled by the loader thread.
+    /// </summary>
+    void SetHotReload(bool enabled);
 
     [[nodiscard]] SafePtr<class UniformBufferManager> RegisterObject();
     [[nodiscard]] void AddTextureToUpdate(SafePtr<class Texture> texture);
+    void AddTextureToUpdate(SafePtr<class Texture> texture, uint32_t baseMip, uint32_t mipCount);
+    void AddStaticMeshToUpdate(SafePtr<class StaticMesh> mesh);
+    void AddTextureReload(TextureReload reload);
+    void AddStaticMeshReload(StaticMeshReload reload);
+    /// <summary>
+    /// Destroys the image view once every frame in flight that could reference it has completed.
+    /// </summary>
+    void DestroyImageViewDeferred(vk::ImageView imageView);
+    void DestroyImageDeferred(ImageAllocation image);
+    void DestroyBufferDeferred(BufferAllocation buffer);
+    /// <summary>
+    /// Keeps a reference to the object until every frame in flight that could use it has completed.
+    /// </summary>
+    void ReleaseDeferred(SafePtr<RefCountBase> object);
 
 private:
     SafePtr<class GfxContext> m_Context;
     SafePtr<class Swapchain> m_Swapchain;
     SafePtr<class GfxLoader> m_GfxLoader;
     std::shared_ptr<class enki::TaskScheduler> m_TaskScheduler;
-    std::vector<SafePtr<class Texture>> m_TexturesToUpdate{};
+    std::unique_ptr<class ClusterCuller> m_ClusterCuller;
+    bool m_ClusterCulling{ false };
+    // read by the loader threads
+    std::atomic<EVertexFormat> m_VertexFormat{ EVertexFormat::eFloat };
+    SafePtr<class GeometryArena> m_VertexArena;
+    SafePtr<class GeometryArena> m_IndexArena;
+    SafePtr<class GeometryBuffer> m_FloatVertexDecode;
+    // keyed by the uniform buffers of the objects
+    std::unordered_map<const class UniformBufferManager*, LodSelection> m_LodSelections{};
+    std::vector<TextureUpdate> m_TexturesToUpdate{};
     std::mutex m_TexturesToUpdateMutex{};
+    std::vector<SafePtr<class StaticMesh>> m_StaticMeshesToUpdate{};
+    std::mutex m_StaticMeshesToUpdateMutex{};
+    std::vector<TextureReload> m_TextureReloads{};
+    std::vector<StaticMeshReload> m_StaticMeshReloads{};
+    std::mutex m_ReloadsMutex{};
+    std::vector<std::pair<vk::ImageView, uint64_t>> m_DeferredImageViews{};
+    std::vector<std::pair<ImageAllocation, uint64_t>> m_DeferredImages{};
+    std::vector<std::pair<BufferAllocation, uint64_t>> m_DeferredBuffers{};
+    std::vector<std::pair<SafePtr<RefCountBase>, uint64_t>> m_DeferredReleases{};
+    uint64_t m_FrameCount{ 0 };
+
+    // used to estimate the on-screen size of the objects for texture streaming
+    glm::vec3 m_CameraPosition{};
+    float m_ProjectionScale{ 1.0f };
 
     // TODO: move to a command buffer manager to the context (maybe)
     std::unique_ptr<class CommandBufferManager> m_GraphicsCommandBufferManager;
+    std::unique_ptr<class CommandBufferManager> m_UploadCommandBufferManager;
+    uint32_t m_UploadBatchIndex{ 0 };
     std::vector<FrameData> m_FrameData;
 private:
     void InitFrameData(uint32_t index);
     void UpdateTextures();
+    void UpdateStaticMeshes();
+    void ApplyReloads();
+    void DestroyDeferredResources();
+    [[nodiscard]] float ComputeScreenSize(const struct AABB& bounds, const glm::mat4& transform) const;
+    /// <summary>
+    /// Vertex arena and index arena for the geometry set of the pipeline, written once per frame.
+    /// </summary>
+    [[nodiscard]] vk::DescriptorSet GetGeometryDescriptorSet(const class GfxPipeline& pipeline);
+    /// <summary>
+    /// Where the vertex pulling shaders find the vertices of the geometry and their decoding header.
+    /// </summary>
+    [[nodiscard]] DrawConstants GetDrawConstants(const struct Geometry& geometry, uint32_t baseVertex, uint32_t indexStride) const;
+    /// <summary>
+    /// Coarsest level whose error projects under a pixel, starting from the current one. A level is only left once its
+    /// error is clearly on the other side of the threshold, so that a submesh at the boundary doesn't pop every frame.
+    /// </summary>
+    [[nodiscard]] uint32_t SelectLod(const std::vector<struct MeshLod>& lods, float screenSize, uint32_t currentLevel) const;
 };
 }
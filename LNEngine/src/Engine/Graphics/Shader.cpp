@@ -9,6 +9,9 @@
 #include "Core/Utils/_Defines.h"
 #include "Core/ApplicationBase.h"
 #include "Graphics/Texture.h"
+#include "Resources/AssetManifest.h"
+#include "Resources/AsyncFileReader.h"
+#include "Resources/VirtualFileSystem.h"
 
 namespace lne
 {
@@ -132,19 +135,31 @@ UniformElementType::Enum SpirvTypeToUniformElementType(spirv_cross::SPIRType typ
     }
 }
 
+// .lnspv layout: this header, then for each stage its ShaderStage::Enum, its word count and its words
+struct CookedShaderHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t StageCount;
+    uint32_t Reserved;
+};
+
 #pragma endregion
 
 Shader::Shader(SafePtr<class GfxContext> ctx, std::string_view filePath)
     : m_Context(ctx), m_FilePath(filePath)
 {
-    auto[shaderCode, shaderHeader] = ReadFile(m_FilePath); 
-
-
     uint32_t offset = (uint32_t)m_FilePath.find_last_of("\\/") + 1;
     uint32_t count = (uint32_t)m_FilePath.find_last_of(".") - offset;
     m_Name = m_FilePath.substr(offset, count);
 
-    m_SpirvCode = CompileToSpirv(shaderCode, shaderHeader);
+    std::filesystem::path cookedPath = AssetManifest::Get().GetCookedPath(m_FilePath);
+    if (cookedPath.empty() || ReadCooked(cookedPath, m_SpirvCode) == false)
+    {
+        auto[shaderCode, shaderHeader] = ReadFile(m_FilePath);
+        if (CompileToSpirv(m_FilePath, shaderCode, shaderHeader, m_SpirvCode) == false)
+            LNE_ASSERT(false, "Failed to compile shader");
+    }
     ReflectOnSpirv(m_SpirvCode);
     m_Modules = CreateModules(m_SpirvCode);
     CreateDescriptorSetLayouts();
@@ -174,19 +189,20 @@ std::string Shader::ShaderStageToExtension(ShaderStage::Enum stage)
 
 std::tuple<std::string, Shader::Header> Shader::ReadFile(std::string_view filePath)
 {
-    std::ifstream shaderSourceFile{ std::string(filePath) };
-    if (!shaderSourceFile.is_open())
+    auto shaderSourceFile = VirtualFileSystem::Get().Read(filePath);
+    if (shaderSourceFile->Wait() == false)
     {
         LNE_ERROR("Failed to open shader file: {}", filePath);
         LNE_ASSERT(false, "Failed to open shader file");
     }
 
-    std::string headerSource;
-    std::getline(shaderSourceFile, headerSource);
+    std::string_view source((const char*)shaderSourceFile->GetData(), (size_t)shaderSourceFile->GetSize());
+    size_t headerEnd = std::min(source.find('\n'), source.size());
+    std::string headerSource(source.substr(0, headerEnd));
 
     auto header = ParseHeader(headerSource);
 
-    return { { std::istreambuf_iterator<char>{shaderSourceFile}, {} }, header };
+    return { std::string(source.substr(std::min(headerEnd + 1, source.size()))), header };
 }
 
 Shader::Header Shader::ParseHeader(std::string& headerSource)
@@ -234,6 +250,10 @@ Shader::Header Shader::ParseHeader(std::string& headerSource)
             {
                 header[ShaderStage::eFragment] = ShaderHeaderInfo{ getEntryPoint(index, headerSource) };
             }
+            else if (headerSource.substr(index, 2) == "Cp")
+            {
+                header[ShaderStage::eCompute] = ShaderHeaderInfo{ getEntryPoint(index, headerSource) };
+            }
             else
             {
                 LNE_ASSERT(false, "Ill-formed header with some non-conformed tokens");
@@ -249,15 +269,86 @@ Shader::Header Shader::ParseHeader(std::string& headerSource)
     return header;
 }
 
-std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> Shader::CompileToSpirv(const std::string& sourceCode, Shader::Header header)
+bool Shader::Cook(const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    if (VirtualFileSystem::Get().Exists(source) == false)
+    {
+        LNE_ERROR("Failed to open shader file: {0}", source.string());
+        return false;
+    }
+
+    auto[shaderCode, shaderHeader] = ReadFile(source.string());
+    SpirvCode spirvCode;
+    if (CompileToSpirv(source.string(), shaderCode, shaderHeader, spirvCode) == false)
+        return false;
+
+    std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        LNE_ERROR("Failed to create shader file: {0}", destination.string());
+        return false;
+    }
+
+    CookedShaderHeader header{ s_CookedMagic, s_CookedVersion, (uint32_t)spirvCode.size(), 0 };
+    file.write((const char*)&header, sizeof(header));
+    for (auto& [stage, code] : spirvCode)
+    {
+        uint32_t stageInfo[2] = { (uint32_t)stage, (uint32_t)code.size() };
+        file.write((const char*)stageInfo, sizeof(stageInfo));
+        file.write((const char*)code.data(), (std::streamsize)(code.size() * sizeof(uint32_t)));
+    }
+    return (bool)file;
+}
+
+bool Shader::ReadCooked(const std::filesystem::path& path, SpirvCode& spirvCode)
+{
+    auto cookedFile = VirtualFileSystem::Get().Read(path);
+    if (cookedFile->Wait() == false)
+        return false;
+
+    const uint8_t* data = cookedFile->GetData();
+    uint64_t size = cookedFile->GetSize();
+    CookedShaderHeader header{};
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.Magic != s_CookedMagic || header.Version != s_CookedVersion)
+    {
+        LNE_WARN("{0} was cooked with another version, the shader is compiled from its source", path.string());
+        return false;
+    }
+
+    uint64_t offset = sizeof(header);
+    SpirvCode code;
+    for (uint32_t i = 0; i < header.StageCount; ++i)
+    {
+        uint32_t stageInfo[2];
+        if (offset + sizeof(stageInfo) > size)
+            return false;
+        memcpy(stageInfo, data + offset, sizeof(stageInfo));
+        offset += sizeof(stageInfo);
+        uint64_t codeSize = (uint64_t)stageInfo[1] * sizeof(uint32_t);
+        if (stageInfo[0] > ShaderStage::eCompute || offset + codeSize > size)
+            return false;
+
+        auto& words = code[(ShaderStage::Enum)stageInfo[0]];
+        words.resize(stageInfo[1]);
+        memcpy(words.data(), data + offset, codeSize);
+        offset += codeSize;
+    }
+    spirvCode = std::move(code);
+    return true;
+}
+
+bool Shader::CompileToSpirv(std::string_view filePath, const std::string& sourceCode, const Shader::Header& header, SpirvCode& spirvCode)
 {
+    std::string fileName(filePath);
     shaderc::Compiler compiler;
     shaderc::CompileOptions options;
     options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
     constexpr bool optimize = false;
     options.SetOptimizationLevel(optimize ? shaderc_optimization_level_performance : shaderc_optimization_level_zero);
     options.SetWarningsAsErrors();
-    std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> spirvCode;
     std::vector<shaderc::CompileOptions> optionsForShaders(header.size(), options);
     uint32_t optionsIndex = 0;
 
@@ -271,7 +362,7 @@ std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> Shader::CompileToSp
             sourceCode.c_str(),
             sourceCode.size(),
             shaderKind,
-            m_FilePath.c_str(),
+            fileName.c_str(),
             headerInfo.EntryPoint.c_str(),
             options
         );
@@ -279,13 +370,13 @@ std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> Shader::CompileToSp
         if (result.GetCompilationStatus() != shaderc_compilation_status_success)
         {
             LNE_ERROR("Failed to compile shader: {}", result.GetErrorMessage());
-            LNE_ASSERT(false, "Failed to compile shader");
+            return false;
         }
         spirvCode[stage] = { result.begin(), result.end() };
         optionsForShaders.pop_back();
     }
 
-    return spirvCode;
+    return true;
 }
 
 void Shader::ReflectOnSpirv(std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> spirvCode)
@@ -370,6 +461,17 @@ void Shader::ReflectOnSpirv(std::unordered_map<ShaderStage::Enum, std::vector<ui
 
             LNE_INFO("    Name: {}, Set: {}, Binding: {}, Size: {}", res.name, set, binding, bufferSize);
         }
+
+        for (const auto& res : resources.push_constant_buffers)
+        {
+            spirv_cross::SPIRType type = compiler.get_type(res.base_type_id);
+            uint32_t size = (uint32_t)compiler.get_declared_struct_size(type);
+
+            vk::PushConstantRange& pushConstants = m_ReflectedData.PushConstants;
+            pushConstants.stageFlags = pushConstants.stageFlags | ShaderStageToVk(stage);
+            pushConstants.size = std::max(pushConstants.size, size);
+            LNE_INFO("    Push constants: {}, Size: {}", res.name, size);
+        }
     }
 }
 
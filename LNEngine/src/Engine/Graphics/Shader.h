@@ -10,6 +10,8 @@ struct ReflectedData
 {
     std::map<uint32_t, DescriptorSet> DescriptorSets;
     std::unordered_map<std::string, UniformElement> UniformElements;
+    // one block shared by the stages that declare it, empty when none does
+    vk::PushConstantRange PushConstants{};
 };
 
 class Shader : public RefCountBase
@@ -19,7 +21,15 @@ class Shader : public RefCountBase
         std::string EntryPoint;
     };
     using Header = std::unordered_map<ShaderStage::Enum, ShaderHeaderInfo>;
+    using SpirvCode = std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>>;
 public:
+    static constexpr std::string_view s_CookedExtension = ".lnspv";
+    static constexpr uint32_t s_CookedMagic = 0x50534E4C; // "LNSP"
+    static constexpr uint32_t s_CookedVersion = 1;
+
+    /// <summary>
+    /// Loads the SPIR-V cooked by LNCook when the asset manifest has an up to date one, compiles the GLSL source otherwise.
+    /// </summary>
     Shader(SafePtr<class GfxContext> ctx, std::string_view filePath);
     [[nodiscard]] std::unordered_map<ShaderStage::Enum, vk::ShaderModule> GetModules() const { return m_Modules; }
     [[nodiscard]] uint32_t GetStageCount() const { return (uint32_t)m_Modules.size(); }
@@ -27,20 +37,26 @@ public:
     [[nodiscard]] const ReflectedData& GetReflectedData() const { return m_ReflectedData; }
     virtual ~Shader();
 
+    /// <summary>
+    /// Compiles every stage of a GLSL source and writes their SPIR-V to a .lnspv file.
+    /// </summary>
+    static bool Cook(const std::filesystem::path& source, const std::filesystem::path& destination);
+
 private:
     SafePtr<class GfxContext> m_Context;
     std::string m_FilePath;
     std::string m_Name;
-    std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> m_SpirvCode{};
+    SpirvCode m_SpirvCode{};
     std::unordered_map<ShaderStage::Enum, vk::ShaderModule> m_Modules{};
     std::vector<vk::DescriptorSetLayout> m_DescriptorSetLayouts{};
     ReflectedData m_ReflectedData{};
 
 private:
     std::string ShaderStageToExtension(ShaderStage::Enum stage);
-    std::tuple<std::string, Shader::Header> ReadFile(std::string_view filePath);
-    Shader::Header ParseHeader(std::string& headerSource);
-    std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> CompileToSpirv(const std::string& sourceCode, Shader::Header header);
+    static std::tuple<std::string, Shader::Header> ReadFile(std::string_view filePath);
+    static Shader::Header ParseHeader(std::string& headerSource);
+    static bool CompileToSpirv(std::string_view filePath, const std::string& sourceCode, const Shader::Header& header, SpirvCode& spirvCode);
+    static bool ReadCooked(const std::filesystem::path& path, SpirvCode& spirvCode);
     void ReflectOnSpirv(std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> spirvCode);
     std::unordered_map<ShaderStage::Enum, vk::ShaderModule> CreateModules(std::unordered_map<ShaderStage::Enum, std::vector<uint32_t>> spirvCode);
     void CreateDescriptorSetLayouts();
@@ -0,0 +1,244 @@
+#include "SinglePassDownsampler.h"
+#include "GfxContext.h"
+#include "Texture.h"
+#include "Shader.h"
+#include "DynamicDescriptorAllocator.h"
+#include "Core/ApplicationBase.h"
+#include "Core/Utils/Log.h"
+#include "Resources/VirtualFileSystem.h"
+
+#include <bit>
+
+namespace lne
+{
+namespace
+{
+// mips written by the shader, mip 0 excluded
+constexpr uint32_t s_StoredMips = SinglePassDownsampler::s_MaxMipLevels - 1;
+// index of mip 6 in the storage views, the last workgroup reads it back
+constexpr uint32_t s_Mip6Index = 5;
+// minStorageBufferOffsetAlignment is at most 256
+constexpr uint32_t s_CounterStride = 256;
+// a 64x64 tile of mip 0 per workgroup
+constexpr uint32_t s_TileSize = 64;
+
+struct DownsampleConstants
+{
+    glm::vec2 InvInputSize;
+    uint32_t MipCount;
+    uint32_t WorkGroupCount;
+    uint32_t IsSrgb;
+};
+}
+
+SinglePassDownsampler::SinglePassDownsampler(SafePtr<GfxContext> ctx)
+    : m_Context(ctx)
+{
+    std::string shaderPath = ApplicationBase::GetAssetsPath() + "Shaders\\SinglePassDownsample.glsl";
+    if (VirtualFileSystem::Get().Exists(shaderPath) == false)
+    {
+        LNE_WARN("Single pass downsample shader not found: {0}, the mips are blitted on the graphics queue", shaderPath);
+        return;
+    }
+
+    vk::Device device = m_Context->GetDevice();
+    m_Shader = m_Context->CreateShader(shaderPath);
+
+    m_DescriptorSetLayout = m_Context->CreateDescriptorSetLayout({
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, s_StoredMips, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+    }, "SinglePassDownsampler");
+
+    vk::PushConstantRange pushConstantRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(DownsampleConstants) };
+    m_PipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo{ {}, m_DescriptorSetLayout, pushConstantRange });
+    m_Context->SetVkObjectName(m_PipelineLayout, "PipelineLayout: SinglePassDownsampler");
+
+    vk::ComputePipelineCreateInfo pipelineCI{
+        {},
+        vk::PipelineShaderStageCreateInfo{ {}, vk::ShaderStageFlagBits::eCompute, m_Shader->GetModules()[ShaderStage::eCompute], "main" },
+        m_PipelineLayout
+    };
+    auto result = device.createComputePipeline(nullptr, pipelineCI);
+    if (result.result != vk::Result::eSuccess)
+    {
+        LNE_ERROR("Failed to create the single pass downsample pipeline: {}", vk::to_string(result.result));
+        return;
+    }
+    m_Pipeline = result.value;
+    m_Context->SetVkObjectName(m_Pipeline, "Pipeline: SinglePassDownsampler");
+
+    m_Sampler = m_Context->CreateSampler(vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+        vk::SamplerAddressMode::eClampToEdge, 1.0f, false, vk::CompareOp::eAlways, vk::BorderColor::eFloatOpaqueWhite,
+        vk::SamplerReductionMode::eWeightedAverage, "SinglePassDownsampler");
+
+    // the shader resets the counter of a layer once its last workgroup is done, they only need to start at 0
+    vk::BufferCreateInfo bufferCI{
+        {},
+        (vk::DeviceSize)s_CounterStride * s_MaxBatchSize,
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::SharingMode::eExclusive,
+    };
+    VmaAllocationCreateInfo allocCI{
+        .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO,
+    };
+    m_Context->AllocateBuffer(m_Counters, bufferCI, allocCI);
+    memset(m_Counters.AllocationInfo.pMappedData, 0, bufferCI.size);
+    // the memory picked for sequential writes isn't always host coherent
+    VK_CHECK_C(vmaFlushAllocation(m_Context->GetMemoryAllocator(), m_Counters.Allocation, 0, VK_WHOLE_SIZE));
+
+    m_DescriptorAllocator = SafePtr<DynamicDescriptorAllocator>(lnnew DynamicDescriptorAllocator(m_Context, {
+        vk::DescriptorPoolSize{ vk::DescriptorType::eCombinedImageSampler, 1 },
+        vk::DescriptorPoolSize{ vk::DescriptorType::eStorageImage, s_StoredMips + 1 },
+        vk::DescriptorPoolSize{ vk::DescriptorType::eStorageBuffer, 1 },
+    }, "SinglePassDownsampler", s_MaxBatchSize));
+}
+
+SinglePassDownsampler::~SinglePassDownsampler()
+{
+    ReleaseRecorded();
+    m_DescriptorAllocator.Reset();
+
+    // the handles are null when the shader wasn't found
+    vk::Device device = m_Context->GetDevice();
+    m_Context->FreeBuffer(m_Counters);
+    device.destroySampler(m_Sampler);
+    device.destroyPipeline(m_Pipeline);
+    device.destroyPipelineLayout(m_PipelineLayout);
+    device.destroyDescriptorSetLayout(m_DescriptorSetLayout);
+}
+
+bool SinglePassDownsampler::CanGenerate(const Texture& texture) const
+{
+    return IsValid()
+        && texture.HasStorageMips()
+        && texture.ShouldGenerateMips()
+        && texture.GetMipLevels() <= s_MaxMipLevels
+        && texture.GetNumLayers() <= 6
+        && std::max(texture.GetDimensions().width, texture.GetDimensions().height) <= s_MaxExtent
+        // the shader averages 2^n texel footprints of mip 0, the rounded down levels of the other sizes would drift
+        // from the blit chain
+        && std::has_single_bit(texture.GetDimensions().width) && std::has_single_bit(texture.GetDimensions().height)
+        && (texture.GetFormat() == vk::Format::eR8G8B8A8Srgb || texture.GetFormat() == vk::Format::eR8G8B8A8Unorm);
+}
+
+void SinglePassDownsampler::Record(vk::CommandBuffer cmdBuffer, const std::vector<SafePtr<Texture>>& textures)
+{
+    LNE_ASSERT(textures.size() <= s_MaxBatchSize, "Too many textures for the counters of a batch");
+    LNE_ASSERT(m_RecordedViews.empty(), "The previous batch wasn't released");
+
+    uint32_t transferFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer);
+    uint32_t computeFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Compute);
+    uint32_t graphicsFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics);
+    vk::Device device = m_Context->GetDevice();
+
+    auto mipRange = [](const Texture& texture, uint32_t baseMip, uint32_t mipCount)
+    {
+        return vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, baseMip, mipCount, 0, texture.m_NumLayers };
+    };
+
+    // the transfer queue released every mip in TransferDstOptimal, mip 0 is sampled and the others are written
+    std::vector<vk::ImageMemoryBarrier> acquires;
+    std::vector<vk::ImageMemoryBarrier> transitions;
+    for (const auto& texture : textures)
+    {
+        vk::Image image = texture->m_Allocation.Image;
+        acquires.emplace_back(vk::AccessFlagBits::eNone, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal,
+            transferFamily, computeFamily, image, mipRange(*texture, 0, texture->m_MipLevels));
+        transitions.emplace_back(vk::AccessFlagBits::eNone, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, mipRange(*texture, 0, 1));
+        transitions.emplace_back(vk::AccessFlagBits::eNone, vk::AccessFlagBits::eShaderWrite,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, mipRange(*texture, 1, texture->m_MipLevels - 1));
+    }
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), nullptr, nullptr, acquires);
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), nullptr, nullptr, transitions);
+
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    for (uint32_t i = 0; i < (uint32_t)textures.size(); ++i)
+    {
+        Texture& texture = *textures[i];
+        vk::Image image = texture.m_Allocation.Image;
+        uint32_t width = texture.m_Extents.width;
+        uint32_t height = texture.m_Extents.height;
+
+        // sRGB images can't be storage images, the mips are written through UNORM views of the mutable format image
+        vk::ImageView srcView = m_Context->CreateImageView(image, vk::ImageViewType::e2DArray, texture.m_Format,
+            1, texture.m_NumLayers, vk::ImageAspectFlagBits::eColor, texture.m_Name, 0, vk::ImageUsageFlagBits::eSampled);
+        m_RecordedViews.push_back(srcView);
+
+        std::array<vk::DescriptorImageInfo, s_StoredMips> dstInfos{};
+        for (uint32_t mip = 1; mip < texture.m_MipLevels; ++mip)
+        {
+            vk::ImageView view = m_Context->CreateImageView(image, vk::ImageViewType::e2DArray, vk::Format::eR8G8B8A8Unorm,
+                1, texture.m_NumLayers, vk::ImageAspectFlagBits::eColor, texture.m_Name, mip, vk::ImageUsageFlagBits::eStorage);
+            m_RecordedViews.push_back(view);
+            dstInfos[mip - 1] = vk::DescriptorImageInfo{ nullptr, view, vk::ImageLayout::eGeneral };
+        }
+        // the shader never stores past the mip count, the unused slots only have to be valid
+        for (uint32_t slot = texture.m_MipLevels - 1; slot < s_StoredMips; ++slot)
+            dstInfos[slot] = dstInfos[texture.m_MipLevels - 2];
+
+        vk::DescriptorImageInfo srcInfo{ m_Sampler, srcView, vk::ImageLayout::eShaderReadOnlyOptimal };
+        vk::DescriptorBufferInfo counterInfo{ m_Counters.Buffer, (vk::DeviceSize)s_CounterStride * i, sizeof(uint32_t) * 6 };
+        vk::DescriptorSet set = m_DescriptorAllocator->Allocate(m_DescriptorSetLayout);
+        std::array<vk::WriteDescriptorSet, 4> writes{
+            vk::WriteDescriptorSet{ set, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &srcInfo },
+            vk::WriteDescriptorSet{ set, 1, 0, s_StoredMips, vk::DescriptorType::eStorageImage, dstInfos.data() },
+            vk::WriteDescriptorSet{ set, 2, 0, 1, vk::DescriptorType::eStorageImage, &dstInfos[s_Mip6Index] },
+            vk::WriteDescriptorSet{ set, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &counterInfo },
+        };
+        device.updateDescriptorSets(writes, nullptr);
+
+        uint32_t groupsX = (width + s_TileSize - 1) / s_TileSize;
+        uint32_t groupsY = (height + s_TileSize - 1) / s_TileSize;
+        DownsampleConstants constants{
+            .InvInputSize = glm::vec2(1.0f / width, 1.0f / height),
+            .MipCount = texture.m_MipLevels - 1,
+            .WorkGroupCount = groupsX * groupsY,
+            .IsSrgb = texture.m_Format == vk::Format::eR8G8B8A8Srgb ? 1u : 0u,
+        };
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, set, nullptr);
+        cmdBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+        cmdBuffer.dispatch(groupsX, groupsY, texture.m_NumLayers);
+    }
+
+    // every mip ends up sampled, they are released together to the graphics queue
+    std::vector<vk::ImageMemoryBarrier> readOnly;
+    std::vector<vk::ImageMemoryBarrier> releases;
+    for (const auto& texture : textures)
+    {
+        vk::Image image = texture->m_Allocation.Image;
+        readOnly.emplace_back(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eNone,
+            vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, mipRange(*texture, 1, texture->m_MipLevels - 1));
+        releases.emplace_back(vk::AccessFlagBits::eNone, vk::AccessFlagBits::eNone,
+            vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            computeFamily, graphicsFamily, image, mipRange(*texture, 0, texture->m_MipLevels));
+
+        texture->m_Layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        texture->m_GenerateMips = false;
+        texture->m_ReleasingQueue = EQueueFamilyType::Compute;
+    }
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+        vk::DependencyFlags(), nullptr, nullptr, readOnly);
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+        vk::DependencyFlags(), nullptr, nullptr, releases);
+}
+
+void SinglePassDownsampler::ReleaseRecorded()
+{
+    vk::Device device = m_Context->GetDevice();
+    for (auto view : m_RecordedViews)
+        device.destroyImageView(view);
+    m_RecordedViews.clear();
+    if (m_DescriptorAllocator)
+        m_DescriptorAllocator->Clear();
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+#include "Engine/Graphics/Structs.h"
+
+namespace lne
+{
+/// <summary>
+/// Builds every mip of a power of two texture in a single compute dispatch (up to 12 mips, 4096 texels wide), cubemap faces included.
+/// Recorded on the async compute queue between the transfer upload and the renderer acquire, it replaces the blit and
+/// the two barriers per mip of Texture::GenerateMipmaps with one set of barriers per batch of textures.
+/// </summary>
+class SinglePassDownsampler
+{
+public:
+    static constexpr uint32_t s_MaxMipLevels = 13;
+    static constexpr uint32_t s_MaxExtent = 4096;
+    static constexpr uint32_t s_MaxBatchSize = 16;
+
+    explicit SinglePassDownsampler(SafePtr<class GfxContext> ctx);
+    ~SinglePassDownsampler();
+    MOVABLE_ONLY(SinglePassDownsampler);
+
+    /// <summary>
+    /// False when the shader couldn't be found, the textures keep their blits.
+    /// </summary>
+    [[nodiscard]] bool IsValid() const { return bool(m_Pipeline); }
+    [[nodiscard]] bool CanGenerate(const class Texture& texture) const;
+
+    /// <summary>
+    /// Records on a compute queue command buffer: the acquire of the textures released by the transfer queue,
+    /// one dispatch per texture and the release of all their mips to the graphics queue in ShaderReadOnlyOptimal.
+    /// </summary>
+    void Record(vk::CommandBuffer cmdBuffer, const std::vector<SafePtr<class Texture>>& textures);
+    /// <summary>
+    /// Destroys the views and descriptor sets of the last batch, its command buffer must have completed.
+    /// </summary>
+    void ReleaseRecorded();
+
+private:
+    SafePtr<class GfxContext> m_Context;
+    SafePtr<class Shader> m_Shader;
+    SafePtr<class DynamicDescriptorAllocator> m_DescriptorAllocator;
+    vk::DescriptorSetLayout m_DescriptorSetLayout{};
+    vk::PipelineLayout m_PipelineLayout{};
+    vk::Pipeline m_Pipeline{};
+    vk::Sampler m_Sampler{};
+    // one slot of workgroup counters per texture of a batch, the dispatches of a batch can overlap
+    BufferAllocation m_Counters{};
+    std::vector<vk::ImageView> m_RecordedViews{};
+};
+}
@@ -6,47 +6,160 @@
 #include "CommandBufferManager.h"
 #include "DynamicDescriptorAllocator.h"
 #include "Texture.h"
+#include "Core/Utils/Log.h"
 
 namespace lne
 {
-StorageBuffer::StorageBuffer(SafePtr<class GfxContext> ctx, uint64_t size, const void* data)
-    : m_Context(ctx), m_Size(size)
+namespace
 {
-    vk::BufferCreateInfo bufferCI{
-        {},
-        size,
-        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
-        vk::SharingMode::eExclusive,
-    };
+constexpr vk::PipelineStageFlags s_ShaderStageMask =
+    (vk::PipelineStageFlagBits)0 | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader |
+    vk::PipelineStageFlagBits::eComputeShader;
+}
 
-    VmaAllocationCreateInfo allocCI{
-        .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-        .usage = VMA_MEMORY_USAGE_AUTO,
-        .priority = 1.0f,
-    };
+StorageBuffer::StorageBuffer(SafePtr<class GfxContext> ctx, uint64_t size, vk::SharingMode sharingMode)
+    : m_Context(ctx), m_Size(size), m_SharingMode(sharingMode)
+{
+    Allocate();
+}
 
-    m_Context->AllocateBuffer(m_Allocation, bufferCI, allocCI);
+StorageBuffer::~StorageBuffer()
+{
+    m_Context->FreeBuffer(m_Allocation);
+}
 
-    BufferAllocation stagingAllocation = m_Context->AllocateStagingBuffer(size);
+void StorageBuffer::WriteData(const void* data, uint64_t size, uint64_t offset)
+{
+    LNE_ASSERT(IsHostVisible(), "The buffer isn't host visible, upload it through a staging buffer");
+    LNE_ASSERT(offset + size <= m_Size, "Write out of the buffer");
+    // flushes the non coherent memory
+    VK_CHECK_C(vmaCopyMemoryToAllocation(m_Context->GetMemoryAllocator(), data, m_Allocation.Allocation, offset, size));
+}
 
-    memcpy(stagingAllocation.AllocationInfo.pMappedData, data, size);
+void StorageBuffer::UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset, const void* data)
+{
+    LNE_ASSERT(stagingOffset + m_Size <= stagingBuffer.AllocationInfo.size, "Buffer doesn't fit in the staging buffer");
+    memcpy((uint8_t*)stagingBuffer.AllocationInfo.pMappedData + stagingOffset, data, m_Size);
 
-    auto cmdBuffer = m_Context->GetTransferCommandBufferManager().BeginSingleTimeCommands();
+    RecordCopy(cmdBuffer, stagingBuffer, stagingOffset);
+}
 
+void StorageBuffer::RecordCopy(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset)
+{
     vk::BufferCopy copyRegion = vk::BufferCopy{
+        stagingOffset,
         0,
+        m_Size
+    };
+    cmdBuffer.copyBuffer(stagingBuffer.Buffer, m_Allocation.Buffer, copyRegion);
+
+    uint32_t transferFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer);
+    uint32_t graphicsFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics);
+    if (transferFamily == graphicsFamily || m_SharingMode == vk::SharingMode::eConcurrent)
+        return;
+
+    vk::BufferMemoryBarrier release{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eNone,
+        transferFamily,
+        graphicsFamily,
+        m_Allocation.Buffer,
         0,
-        size
+        m_Size
     };
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, release, nullptr);
+}
 
-    cmdBuffer.copyBuffer(stagingAllocation.Buffer, m_Allocation.Buffer, copyRegion);
+void StorageBuffer::UpdateData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset)
+{
+    // the draws of the previous frames may still read the old content
+    vk::BufferMemoryBarrier before{
+        vk::AccessFlagBits::eNone,
+        vk::AccessFlagBits::eTransferWrite,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        m_Allocation.Buffer,
+        0,
+        m_Size
+    };
+    cmdBuffer.pipelineBarrier(s_ShaderStageMask, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, before, nullptr);
 
-    m_Context->GetTransferCommandBufferManager().EndSingleTimeCommands();
-    m_Context->FreeBuffer(stagingAllocation);
+    vk::BufferCopy copyRegion = vk::BufferCopy{
+        stagingOffset,
+        0,
+        m_Size
+    };
+    cmdBuffer.copyBuffer(stagingBuffer.Buffer, m_Allocation.Buffer, copyRegion);
+
+    vk::BufferMemoryBarrier after{
+        vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        m_Allocation.Buffer,
+        0,
+        m_Size
+    };
+    cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, s_ShaderStageMask, {}, nullptr, after, nullptr);
 }
 
-StorageBuffer::~StorageBuffer()
+void StorageBuffer::AcquireOwnership(vk::CommandBuffer cmdBuffer)
 {
-    m_Context->FreeBuffer(m_Allocation);
+    uint32_t transferFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer);
+    uint32_t graphicsFamily = m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics);
+
+    vk::BufferMemoryBarrier acquire{
+        vk::AccessFlagBits::eNone,
+        vk::AccessFlagBits::eShaderRead,
+        transferFamily,
+        graphicsFamily,
+        m_Allocation.Buffer,
+        0,
+        m_Size
+    };
+    vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
+    // same family, no ownership transfer but the copy still has to be made visible
+    if (transferFamily == graphicsFamily)
+    {
+        acquire.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        acquire.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        acquire.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        srcStage = vk::PipelineStageFlagBits::eTransfer;
+    }
+    cmdBuffer.pipelineBarrier(srcStage, s_ShaderStageMask, {}, nullptr, acquire, nullptr);
+}
+
+void StorageBuffer::Allocate()
+{
+    std::array<uint32_t, 2> queueFamilies = {
+        m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics),
+        m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer)
+    };
+    // concurrent sharing needs two distinct families
+    if (queueFamilies[0] == queueFamilies[1])
+        m_SharingMode = vk::SharingMode::eExclusive;
+
+    vk::BufferCreateInfo bufferCI{
+        {},
+        m_Size,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        m_SharingMode,
+    };
+    if (m_SharingMode == vk::SharingMode::eConcurrent)
+    {
+        bufferCI.queueFamilyIndexCount = (uint32_t)queueFamilies.size();
+        bufferCI.pQueueFamilyIndices = queueFamilies.data();
+    }
+
+    // same placement as UniformBuffer: host visible where the GPU reads it as fast, device local behind a staging copy otherwise
+    VmaAllocationCreateInfo allocCI{
+        .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT
+            | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+            | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .priority = 1.0f,
+    };
+
+    m_Context->AllocateBuffer(m_Allocation, bufferCI, allocCI);
 }
 }
@@ -7,9 +7,18 @@ namespace lne
 class StorageBuffer : public RefCountBase
 {
 public:
-    StorageBuffer(SafePtr<class GfxContext> ctx, uint64_t size, const void* data);
+    /// <summary>
+    /// Allocates the buffer without filling it. The data is uploaded later on the transfer queue with UploadData or RecordCopy.
+    /// An exclusive buffer has to be acquired on the graphics queue after the upload, a concurrent one only needs the transfer to be complete.
+    /// The buffer is placed in host visible memory when VMA finds it is as fast for the GPU (unified memory, ReBAR, lavapipe),
+    /// it can then be filled with WriteData instead.
+    /// </summary>
+    StorageBuffer(SafePtr<class GfxContext> ctx, uint64_t size, vk::SharingMode sharingMode = vk::SharingMode::eExclusive);
     virtual ~StorageBuffer();
 
+    [[nodiscard]] uint64_t GetSize() const { return m_Size; }
+    [[nodiscard]] bool IsHostVisible() const { return bool(m_Allocation.MemoryFlags & vk::MemoryPropertyFlagBits::eHostVisible); }
+
     vk::DescriptorBufferInfo GetDescriptorInfo() const
     {
         return vk::DescriptorBufferInfo{
@@ -19,10 +28,37 @@ public:
         };
     }
 
+    /// <summary>
+    /// Writes straight into a host visible buffer, the submissions that follow see the data without barrier nor ownership transfer.
+    /// The GPU must not be using the buffer.
+    /// </summary>
+    void WriteData(const void* data, uint64_t size, uint64_t offset = 0);
+    /// <summary>
+    /// Records the copy from the staging buffer at the given offset and releases the buffer to the graphics queue.
+    /// </summary>
+    void UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset, const void* data);
+    /// <summary>
+    /// Same as UploadData for data that is already in the staging buffer.
+    /// </summary>
+    void RecordCopy(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset);
+    /// <summary>
+    /// Records the copy from the staging buffer on the graphics queue, between the draws that read the buffer: the previous
+    /// reads are waited for and the following ones see the new content. Used to update a buffer that is already in use.
+    /// </summary>
+    void UpdateData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint64_t stagingOffset);
+    /// <summary>
+    /// Acquires the buffer released by UploadData on the graphics queue.
+    /// </summary>
+    void AcquireOwnership(vk::CommandBuffer cmdBuffer);
+
 private:
     SafePtr<class GfxContext> m_Context;
     BufferAllocation m_Allocation;
     uint64_t m_Size;
     vk::MemoryPropertyFlags m_MemoryFlags;
+    vk::SharingMode m_SharingMode;
+
+private:
+    void Allocate();
 };
 }
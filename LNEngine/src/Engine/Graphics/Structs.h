@@ -43,6 +43,12 @@ struct ImageAllocation
     VmaAllocationInfo AllocationInfo;
 };
 
+struct TextureMipRegion
+{
+    uint32_t MipLevel;
+    uint64_t BufferOffset;
+};
+
 struct AABB
 {
     glm::vec3 Min;
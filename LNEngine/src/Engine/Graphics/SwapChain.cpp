@@ -84,7 +84,10 @@ bool Swapchain::Present()
 
     try
     {
-        result = presentQueue.presentKHR(presentInfo);
+        {
+            std::lock_guard<std::mutex> lock(m_Context->GetQueueSubmitMutex());
+            result = presentQueue.presentKHR(presentInfo);
+        }
         m_FrameIndex = (m_FrameIndex + 1) % m_ColorAttachments.size();
         // TODO: this is a temporary solution, m_CurrentFrameIndex should be current frame in flight not just the current frame index
         m_Context->m_CurrentFrameInFlight = (m_Context->m_CurrentFrameInFlight + 1) % m_Context->m_MaxFramesInFlight;
@@ -6,6 +6,9 @@
 #include "Core/ApplicationBase.h"
 #include "Renderer.h"
 #include "DynamicDescriptorAllocator.h"
+#include "Resources/AssetRegistry.h"
+#include "Resources/AssetAwaitable.h"
+#include "Resources/MipGenerator.h"
 
 namespace lne
 {
@@ -30,13 +33,22 @@ SafePtr<Texture> Texture::CreateDepthTexture(SafePtr<class GfxContext> ctx, uint
     return SafePtr<Texture>(new Texture(ctx, imageInfo, name));
 }
 
-SafePtr<Texture> Texture::CreateColorTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips, const std::string& name)
+SafePtr<Texture> Texture::CreateColorTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips, const std::string& name,
+    bool storageMips, bool hostCopy)
 {
     vk::ImageUsageFlags flags = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    vk::ImageCreateFlags createFlags{};
     if (generateMips)
         flags |= vk::ImageUsageFlagBits::eTransferSrc;
+    if (generateMips && storageMips)
+    {
+        flags |= vk::ImageUsageFlagBits::eStorage;
+        createFlags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+    }
+    if (hostCopy)
+        flags |= vk::ImageUsageFlagBits::eHostTransferEXT;
     vk::ImageCreateInfo imageInfo(
-        vk::ImageCreateFlags(),
+        createFlags,
         vk::ImageType::e2D,
         vk::Format::eR8G8B8A8Srgb,
         vk::Extent3D(width, height, 1),
@@ -53,13 +65,22 @@ SafePtr<Texture> Texture::CreateColorTexture2D(SafePtr<class GfxContext> ctx, ui
     return SafePtr<Texture>(lnnew Texture(ctx, imageInfo, name));
 }
 
-SafePtr<Texture> Texture::CreateCubemapTexture(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips, const std::string& name)
+SafePtr<Texture> Texture::CreateCubemapTexture(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips, const std::string& name,
+    bool storageMips, bool hostCopy)
 {
     vk::ImageUsageFlags flags = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    vk::ImageCreateFlags createFlags{};
     if (generateMips)
         flags |= vk::ImageUsageFlagBits::eTransferSrc;
+    if (generateMips && storageMips)
+    {
+        flags |= vk::ImageUsageFlagBits::eStorage;
+        createFlags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+    }
+    if (hostCopy)
+        flags |= vk::ImageUsageFlagBits::eHostTransferEXT;
     vk::ImageCreateInfo imageInfo = vk::ImageCreateInfo{
-        vk::ImageCreateFlagBits::eCubeCompatible,
+        createFlags | vk::ImageCreateFlagBits::eCubeCompatible,
         vk::ImageType::e2D,
         vk::Format::eR8G8B8A8Srgb,
         vk::Extent3D(width, height, 1),
@@ -76,6 +97,31 @@ SafePtr<Texture> Texture::CreateCubemapTexture(SafePtr<class GfxContext> ctx, ui
     return SafePtr<Texture>(lnnew Texture(ctx, imageInfo, name));
 }
 
+SafePtr<Texture> Texture::CreateStreamedTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format, const std::string& name)
+{
+    vk::ImageCreateInfo imageInfo(
+        vk::ImageCreateFlags(),
+        vk::ImageType::e2D,
+        format,
+        vk::Extent3D(width, height, 1),
+        std::min(mipLevels, GetMaxMipLevels(width, height)),
+        1,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+        vk::SharingMode::eExclusive,
+        0,
+        nullptr,
+        vk::ImageLayout::eUndefined
+    );
+    SafePtr<Texture> texture = SafePtr<Texture>(lnnew Texture(ctx, imageInfo, name));
+    // mips come from the file, nothing to generate
+    texture->m_GenerateMips = false;
+    texture->m_IsStreamed = true;
+    texture->MarkNonResident();
+    return texture;
+}
+
 Texture::Texture(SafePtr<class GfxContext> ctx, vk::Image image, vk::Format format, vk::Extent3D extents, uint32_t numlayers, const std::string& name)
     : m_Context{ ctx }
     , m_Format{ format }
@@ -108,6 +154,12 @@ Texture::Texture(SafePtr<class GfxContext> ctx, vk::ImageCreateInfo imageCI, con
 {
     if (m_MipLevels > 1)
         m_GenerateMips = true;
+    if ((imageCI.usage & vk::ImageUsageFlagBits::eStorage) && (imageCI.flags & vk::ImageCreateFlagBits::eExtendedUsage))
+    {
+        m_HasStorageMips = true;
+        m_ViewUsage = imageCI.usage & ~vk::ImageUsageFlags(vk::ImageUsageFlagBits::eStorage);
+    }
+    m_HasHostCopy = bool(imageCI.usage & vk::ImageUsageFlagBits::eHostTransferEXT);
     vk::Device device = m_Context->GetDevice();
     VmaAllocator allocator = m_Context->GetMemoryAllocator();
 
@@ -124,20 +176,24 @@ Texture::Texture(SafePtr<class GfxContext> ctx, vk::ImageCreateInfo imageCI, con
         IsDepth() ? vk::ImageAspectFlagBits::eDepth
         : (IsStencil() ? vk::ImageAspectFlagBits::eStencil : vk::ImageAspectFlagBits::eColor);
 
-    vk::ImageViewType viewType = vk::ImageViewType::e2D;
     if (m_ImageType == vk::ImageType::e3D)
-        viewType = vk::ImageViewType::e3D;
+        m_ViewType = vk::ImageViewType::e3D;
     else if (bool(imageCI.flags & vk::ImageCreateFlagBits::eCubeCompatible) == true)
-        viewType = vk::ImageViewType::eCube;
-    m_ImageView = m_Context->CreateImageView(m_Allocation.Image, viewType, m_Format,
-        imageCI.mipLevels, m_NumLayers, aspectMask, std::format("ImageView: {}", name));
+        m_ViewType = vk::ImageViewType::eCube;
+    m_ImageView = m_Context->CreateImageView(m_Allocation.Image, m_ViewType, m_Format,
+        imageCI.mipLevels, m_NumLayers, aspectMask, std::format("ImageView: {}", name), 0, m_ViewUsage);
 
     if (IsDepth() == false && IsStencil() == false)
         m_BindlessHandle = m_Context->RegisterBindlessTexture(this);
+
+    m_RequestedMip = m_MipLevels - 1;
 }
 
 Texture::~Texture()
 {
+    if (m_AssetKey.empty() == false)
+        AssetRegistry::Get().Remove(m_AssetKey, this);
+
     vk::Device device = m_Context->GetDevice();
     device.destroyImageView(m_ImageView);
     if (m_OwnsImage)
@@ -353,7 +409,7 @@ void Texture::UploadData(const void* data)
     TransitionLayout(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
 }
 
-void Texture::UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data)
+void Texture::UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data, EQueueFamilyType dstQueue)
 {
     uint32_t bytesPerPixel = FormatToBytesPerPixel(m_Format);
 
@@ -389,9 +445,259 @@ void Texture::UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBu
     cmdBuffer.copyBufferToImage(stagingBuffer.Buffer, m_Allocation.Image, vk::ImageLayout::eTransferDstOptimal, regions);
 
     TransitionLayout(cmdBuffer, vk::ImageLayout::eTransferDstOptimal,
+        m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer), m_Context->GetQueueFamilyIndex(dstQueue));
+    m_ReleasingQueue = EQueueFamilyType::Transfer;
+}
+
+void Texture::UploadMips(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data, uint64_t size,
+    const std::vector<TextureMipRegion>& regions)
+{
+    LNE_ASSERT(regions.empty() == false, "No mip to upload");
+    LNE_ASSERT(size <= stagingBuffer.AllocationInfo.size, "Mip range doesn't fit in the staging buffer");
+
+    memcpy(stagingBuffer.AllocationInfo.pMappedData, data, size);
+
+    uint32_t baseMip = m_MipLevels;
+    uint32_t lastMip = 0;
+    std::vector<vk::BufferImageCopy> copies;
+    copies.reserve(regions.size());
+    for (const auto& region : regions)
+    {
+        baseMip = std::min(baseMip, region.MipLevel);
+        lastMip = std::max(lastMip, region.MipLevel);
+        copies.emplace_back(vk::BufferImageCopy{
+            region.BufferOffset,
+            0,
+            0,
+            vk::ImageSubresourceLayers
+            {
+                vk::ImageAspectFlagBits::eColor,
+                region.MipLevel,
+                0,
+                m_NumLayers
+            },
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(std::max(1u, m_Extents.width >> region.MipLevel), std::max(1u, m_Extents.height >> region.MipLevel), 1)
+        });
+    }
+    uint32_t mipCount = lastMip - baseMip + 1;
+
+    TransitionLayoutMips(cmdBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, baseMip, mipCount);
+
+    cmdBuffer.copyBufferToImage(stagingBuffer.Buffer, m_Allocation.Image, vk::ImageLayout::eTransferDstOptimal, copies);
+
+    TransitionLayoutMips(cmdBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal, baseMip, mipCount,
         m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer), m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics));
 }
 
+void Texture::UploadMipChain(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data, uint64_t size)
+{
+    LNE_ASSERT(size <= stagingBuffer.AllocationInfo.size, "Mip chain doesn't fit in the staging buffer");
+    LNE_ASSERT(FormatToBytesPerPixel(m_Format) == 4, "Mip chains are only built for RGBA8 textures");
+
+    memcpy(stagingBuffer.AllocationInfo.pMappedData, data, size);
+
+    TransitionLayout(cmdBuffer, vk::ImageLayout::eTransferDstOptimal);
+    CopyMipChain(cmdBuffer, stagingBuffer);
+    TransitionLayout(cmdBuffer, vk::ImageLayout::eTransferDstOptimal,
+        m_Context->GetQueueFamilyIndex(EQueueFamilyType::Transfer), m_Context->GetQueueFamilyIndex(EQueueFamilyType::Graphics));
+    m_ReleasingQueue = EQueueFamilyType::Transfer;
+
+    // the renderer only acquires the mips, no blit on the graphics queue
+    m_GenerateMips = false;
+}
+
+void Texture::CopyFromHost(const void* data, uint64_t size, uint32_t mipCount)
+{
+    LNE_ASSERT(m_HasHostCopy, "The texture wasn't created for host copies");
+    LNE_ASSERT(mipCount > 0 && mipCount <= m_MipLevels, "Mip count out of range");
+    LNE_ASSERT(size >= MipGenerator::GetChainSize(m_Extents.width, m_Extents.height, mipCount, m_NumLayers), "The chain is missing mips");
+
+    vk::Device device = m_Context->GetDevice();
+    vk::ImageSubresourceRange range{ vk::ImageAspectFlagBits::eColor, 0, m_MipLevels, 0, m_NumLayers };
+    device.transitionImageLayoutEXT(vk::HostImageLayoutTransitionInfoEXT{
+        m_Allocation.Image,
+        vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        range
+    });
+
+    std::vector<vk::MemoryToImageCopyEXT> copies;
+    copies.reserve(mipCount);
+    for (uint32_t mip = 0; mip < mipCount; ++mip)
+    {
+        copies.emplace_back(vk::MemoryToImageCopyEXT{
+            (const uint8_t*)data + MipGenerator::GetMipOffset(m_Extents.width, m_Extents.height, mip, m_NumLayers),
+            0,
+            0,
+            vk::ImageSubresourceLayers
+            {
+                vk::ImageAspectFlagBits::eColor,
+                mip,
+                0,
+                m_NumLayers
+            },
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(std::max(1u, m_Extents.width >> mip), std::max(1u, m_Extents.height >> mip), 1)
+        });
+    }
+    device.copyMemoryToImageEXT(vk::CopyMemoryToImageInfoEXT{
+        {},
+        m_Allocation.Image,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        copies
+    });
+
+    m_Layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    // the host writes are visible to the next submits, there is no queue to acquire the image from
+    m_ReleasingQueue = EQueueFamilyType::Graphics;
+    m_GenerateMips = false;
+}
+
+void Texture::Reload(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format)
+{
+    LNE_ASSERT(m_OwnsImage, "Only the textures that own their image can be reloaded");
+
+    // the mips of a streamed texture are in several layouts, it is replaced as a whole
+    bool inPlace = m_IsStreamed == false && m_Extents.width == width && m_Extents.height == height && m_MipLevels == mipLevels && m_Format == format
+        && (m_Layout == vk::ImageLayout::eUndefined || m_Layout == vk::ImageLayout::eShaderReadOnlyOptimal);
+    if (inPlace == false)
+    {
+        // frames in flight may still sample the old image through the old view
+        auto& renderer = ApplicationBase::GetRenderer();
+        renderer.DestroyImageViewDeferred(m_ImageView);
+        renderer.DestroyImageDeferred(m_Allocation);
+
+        vk::ImageCreateInfo imageCI(
+            m_ViewType == vk::ImageViewType::eCube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags(),
+            vk::ImageType::e2D,
+            format,
+            vk::Extent3D(width, height, 1),
+            mipLevels,
+            m_NumLayers,
+            vk::SampleCountFlagBits::e1,
+            vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+            vk::SharingMode::eExclusive,
+            0,
+            nullptr,
+            vk::ImageLayout::eUndefined
+        );
+        VmaAllocationCreateInfo allocInfo{
+            .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .priority = 1.0f,
+        };
+        m_Context->AllocateImage(m_Allocation, imageCI, allocInfo);
+        m_Context->SetVkObjectName(m_Allocation.Image, std::format("Image: {}", m_Name));
+
+        m_Format = format;
+        m_Extents = imageCI.extent;
+        m_MipLevels = mipLevels;
+        m_Layout = vk::ImageLayout::eUndefined;
+        m_HasStorageMips = false;
+        m_HasHostCopy = false;
+        m_ViewUsage = {};
+        m_ImageView = m_Context->CreateImageView(m_Allocation.Image, m_ViewType, m_Format,
+            m_MipLevels, m_NumLayers, vk::ImageAspectFlagBits::eColor, std::format("ImageView: {}", m_Name), 0, m_ViewUsage);
+        m_ViewBaseMip = 0;
+        m_IsStreamed = false;
+    }
+
+    // on the graphics queue, the barriers order the copy after the draws of the previous frames
+    TransitionLayout(cmdBuffer, vk::ImageLayout::eTransferDstOptimal);
+    CopyMipChain(cmdBuffer, stagingBuffer);
+    TransitionLayout(cmdBuffer, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    m_GenerateMips = false;
+    bool wasResident = IsResident();
+    m_ResidentMip = 0;
+    m_RequestedMip = m_MipLevels - 1;
+    m_LoadFailed = false;
+    // same slot, the materials that reference the texture don't change
+    m_Context->UpdateBindlessTexture(m_BindlessHandle, this);
+    if (wasResident == false)
+        AssetLoadEvents::Get().Signal(this);
+}
+
+void Texture::CopyMipChain(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer)
+{
+    std::vector<vk::BufferImageCopy> copies;
+    copies.reserve(m_MipLevels);
+    for (uint32_t mip = 0; mip < m_MipLevels; ++mip)
+    {
+        copies.emplace_back(vk::BufferImageCopy{
+            MipGenerator::GetMipOffset(m_Extents.width, m_Extents.height, mip, m_NumLayers),
+            0,
+            0,
+            vk::ImageSubresourceLayers
+            {
+                vk::ImageAspectFlagBits::eColor,
+                mip,
+                0,
+                m_NumLayers
+            },
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(std::max(1u, m_Extents.width >> mip), std::max(1u, m_Extents.height >> mip), 1)
+        });
+    }
+
+    cmdBuffer.copyBufferToImage(stagingBuffer.Buffer, m_Allocation.Image, vk::ImageLayout::eTransferDstOptimal, copies);
+}
+
+void Texture::MarkNonResident()
+{
+    m_ResidentMip = m_MipLevels;
+    m_Context->ResetBindlessTexture(m_BindlessHandle);
+}
+
+void Texture::SetResidentMip(uint32_t mip)
+{
+    LNE_ASSERT(mip < m_MipLevels, "Mip level out of range");
+    if (mip > m_ResidentMip)
+        return;
+
+    if (mip != m_ViewBaseMip)
+    {
+        // frames in flight may still sample through the old view
+        ApplicationBase::GetRenderer().DestroyImageViewDeferred(m_ImageView);
+        m_ImageView = m_Context->CreateImageView(m_Allocation.Image, m_ViewType, m_Format,
+            m_MipLevels - mip, m_NumLayers, vk::ImageAspectFlagBits::eColor, m_Name, mip, m_ViewUsage);
+        m_ViewBaseMip = mip;
+    }
+
+    bool wasResident = IsResident();
+    m_ResidentMip = mip;
+    m_Context->UpdateBindlessTexture(m_BindlessHandle, this);
+    // the coroutines waiting for the texture only resume on the first mips
+    if (wasResident == false)
+        AssetLoadEvents::Get().Signal(this);
+}
+
+void Texture::MarkLoadFailed()
+{
+    if (IsResident())
+        return;
+
+    m_LoadFailed = true;
+    AssetLoadEvents::Get().Signal(this);
+}
+
+void Texture::RequestResolution(float screenPixels)
+{
+    if (m_IsStreamed == false)
+        return;
+
+    float texels = (float)std::max(m_Extents.width, m_Extents.height);
+    float ratio = texels / std::max(screenPixels, 1.0f);
+    uint32_t mip = ratio <= 1.0f ? 0 : std::min((uint32_t)std::floor(std::log2(ratio)), m_MipLevels - 1);
+
+    uint32_t current = m_RequestedMip.load();
+    while (mip < current && m_RequestedMip.compare_exchange_weak(current, mip) == false)
+    {
+    }
+}
+
 constexpr uint32_t Texture::FormatToBytesPerPixel(vk::Format format)
 {
     switch (format)
@@ -2,6 +2,7 @@
 #include "../vendor/VMA/vk_mem_alloc.h"
 #include "Engine/Core/SafePtr.h"
 #include "Engine/Graphics/Structs.h"
+#include "Engine/Graphics/GfxEnums.h"
 
 namespace lne
 {
@@ -9,8 +10,21 @@ class Texture : public RefCountBase
 {
 public:
     static SafePtr<Texture> CreateDepthTexture(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, const std::string& name = "");
-    static SafePtr<Texture> CreateColorTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips = true, const std::string& name = "");
-    static SafePtr<Texture> CreateCubemapTexture(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips = true, const std::string& name = "");
+    /// <summary>
+    /// With storageMips the mips can also be written through UNORM storage views (see SinglePassDownsampler),
+    /// the sampled views keep the sRGB format and leave the storage usage out.
+    /// With hostCopy the content can be written from the CPU with CopyFromHost, see GfxContext::SupportsHostImageCopy.
+    /// </summary>
+    static SafePtr<Texture> CreateColorTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips = true, const std::string& name = "",
+        bool storageMips = false, bool hostCopy = false);
+    static SafePtr<Texture> CreateCubemapTexture(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, bool generateMips = true, const std::string& name = "",
+        bool storageMips = false, bool hostCopy = false);
+    /// <summary>
+    /// Creates a 2D texture whose mips are uploaded one range at a time by the loader.
+    /// The texture starts non-resident and its bindless slot points to the default texture until the first mips arrive.
+    /// </summary>
+    static SafePtr<Texture> CreateStreamedTexture2D(SafePtr<class GfxContext> ctx, uint32_t width, uint32_t height, uint32_t mipLevels,
+        vk::Format format = vk::Format::eR8G8B8A8Srgb, const std::string& name = "");
     static constexpr uint32_t GetMaxMipLevels(uint32_t width, uint32_t height)
     {
         uint32_t mipLevels = 1;
@@ -38,9 +52,21 @@ public:
     [[nodiscard]] uint32_t GetNumLayers() const { return m_NumLayers; }
     [[nodiscard]] uint32_t GetMipLevels() const { return m_MipLevels; }
     [[nodiscard]] bool ShouldGenerateMips() const { return m_GenerateMips; }
+    [[nodiscard]] bool HasStorageMips() const { return m_HasStorageMips; }
+    [[nodiscard]] bool HasHostCopy() const { return m_HasHostCopy; }
+    /// <summary>
+    /// Queue the texture was last released from, the renderer acquires it from this family.
+    /// </summary>
+    [[nodiscard]] EQueueFamilyType GetReleasingQueue() const { return m_ReleasingQueue; }
     [[nodiscard]] vk::Sampler GetSampler() const { return m_Sampler; }
     [[nodiscard]] uint32_t GetBindlessHandle() const { return m_BindlessHandle; }
     [[nodiscard]] const std::string& GetName() const { return m_Name; }
+    [[nodiscard]] bool IsStreamed() const { return m_IsStreamed; }
+    [[nodiscard]] bool IsResident() const { return m_ResidentMip < m_MipLevels; }
+    [[nodiscard]] uint32_t GetResidentMip() const { return m_ResidentMip.load(); }
+    [[nodiscard]] uint32_t GetRequestedMip() const { return m_RequestedMip.load(); }
+    [[nodiscard]] bool HasLoadFailed() const { return m_LoadFailed.load(); }
+    void SetAssetKey(const std::string& key) { m_AssetKey = key; }
 
     [[nodiscard]] bool IsDepth();
     [[nodiscard]] bool IsStencil();
@@ -72,7 +98,50 @@ public:
     void GenerateMipmaps(vk::CommandBuffer cmdBuffer);
 
     void UploadData(const void* data);
-    void UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data);
+    void UploadData(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data,
+        EQueueFamilyType dstQueue = EQueueFamilyType::Graphics);
+    /// <summary>
+    /// Records the copy of a range of mips from the staging buffer and releases them to the graphics queue.
+    /// The mips stay in TransferDstOptimal until the renderer acquires them.
+    /// </summary>
+    void UploadMips(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data, uint64_t size,
+        const std::vector<TextureMipRegion>& regions);
+
+    /// <summary>
+    /// Records the copy of a full mip chain built on the CPU (see MipGenerator) with a single copyBufferToImage and releases
+    /// every mip to the graphics queue. The texture has nothing left to generate afterwards.
+    /// </summary>
+    void UploadMipChain(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, const void* data, uint64_t size);
+    /// <summary>
+    /// Writes the first mipCount mips of a chain laid out as by MipGenerator straight into the image with VK_EXT_host_image_copy,
+    /// on the calling thread. The image ends in ShaderReadOnlyOptimal, owned by no queue: the renderer only has to mark it resident.
+    /// The texture must not be in use by the GPU, and have been created with hostCopy.
+    /// </summary>
+    void CopyFromHost(const void* data, uint64_t size, uint32_t mipCount);
+    /// <summary>
+    /// Replaces the content with the mip chain in the staging buffer (see MipGenerator) on the graphics queue. The image is only
+    /// reallocated when the dimensions, mip count or format changed, the bindless handle stays the same either way.
+    /// </summary>
+    void Reload(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer, uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format);
+
+    /// <summary>
+    /// Points the bindless slot to the default texture until SetResidentMip is called.
+    /// </summary>
+    void MarkNonResident();
+    /// <summary>
+    /// Clamps the image view to [mip, mipLevels) and updates the bindless slot in place.
+    /// Only ever refines: a mip coarser than the current resident one is ignored.
+    /// </summary>
+    void SetResidentMip(uint32_t mip);
+    /// <summary>
+    /// Called by the loader when the texture can't be loaded, it keeps sampling the default texture.
+    /// Ignored once the texture is resident, a failed refinement leaves the coarser mips in place.
+    /// </summary>
+    void MarkLoadFailed();
+    /// <summary>
+    /// Records the finest mip needed to cover the given on-screen size. The loader streams finer mips toward it.
+    /// </summary>
+    void RequestResolution(float screenPixels);
 
 private:
     SafePtr<class GfxContext> m_Context;
@@ -83,15 +152,35 @@ private:
     vk::Format m_Format{};
     vk::Extent3D m_Extents{};
     vk::ImageType m_ImageType{ vk::ImageType::e2D };
+    vk::ImageViewType m_ViewType{ vk::ImageViewType::e2D };
     vk::ImageTiling m_Tiling{ vk::ImageTiling::eOptimal };
     vk::ImageLayout m_Layout{ vk::ImageLayout::eUndefined };
     uint32_t m_NumLayers{ 1 };
     uint32_t m_MipLevels{ 1 };
     bool m_GenerateMips{ false };
+    bool m_HasStorageMips{ false };
+    bool m_HasHostCopy{ false };
+    // usage of the sampled views, the storage usage isn't supported by the sRGB formats
+    vk::ImageUsageFlags m_ViewUsage{};
+    EQueueFamilyType m_ReleasingQueue{ EQueueFamilyType::Transfer };
     std::string m_Name{};
     bool m_OwnsImage{ true };
+    std::string m_AssetKey{};
+
+    // streaming
+    bool m_IsStreamed{ false };
+    uint32_t m_ViewBaseMip{ 0 };
+    std::atomic<uint32_t> m_ResidentMip{ 0 };
+    std::atomic<uint32_t> m_RequestedMip{ 0 };
+    std::atomic<bool> m_LoadFailed{ false };
+
+    friend class SinglePassDownsampler;
 
 private:
     constexpr uint32_t FormatToBytesPerPixel(vk::Format format);
+    /// <summary>
+    /// Records the copy of every mip from a chain at the start of the staging buffer, the image is in TransferDstOptimal.
+    /// </summary>
+    void CopyMipChain(vk::CommandBuffer cmdBuffer, BufferAllocation stagingBuffer);
 };
 }
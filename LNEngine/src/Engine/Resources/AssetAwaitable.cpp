@@ -0,0 +1,50 @@
+#include "Graphics/Texture.h"
+#include "Graphics/Mesh.h"
+
+#include "AssetAwaitable.h"
+
+namespace lne
+{
+bool IsAssetLoaded(const Texture& texture)
+{
+    return texture.IsResident();
+}
+
+bool IsAssetSettled(const Texture& texture)
+{
+    return texture.IsResident() || texture.HasLoadFailed();
+}
+
+bool IsAssetLoaded(const StaticMesh& mesh)
+{
+    return mesh.IsReady();
+}
+
+bool IsAssetSettled(const StaticMesh& mesh)
+{
+    return mesh.IsReady() || mesh.HasLoadFailed();
+}
+
+bool AssetLoadEvents::Wait(const RefCountBase* asset, const std::function<bool()>& isSettled, std::coroutine_handle<> handle, EResumeOn resumeOn)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (isSettled())
+        return false;
+    m_Waiters.emplace(asset, Waiter{ handle, resumeOn });
+    return true;
+}
+
+void AssetLoadEvents::Signal(const RefCountBase* asset)
+{
+    std::vector<Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto [begin, end] = m_Waiters.equal_range(asset);
+        for (auto it = begin; it != end; ++it)
+            waiters.push_back(it->second);
+        m_Waiters.erase(begin, end);
+    }
+    for (const auto& waiter : waiters)
+        CoroutineScheduler::Get().Schedule(waiter.Handle, waiter.ResumeOn);
+}
+}
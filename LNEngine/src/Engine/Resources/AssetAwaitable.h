@@ -0,0 +1,85 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Async/CoroutineScheduler.h"
+
+namespace lne
+{
+// implemented for Texture and StaticMesh, an asset is settled once it either loaded or failed to
+bool IsAssetLoaded(const class Texture& texture);
+bool IsAssetSettled(const class Texture& texture);
+bool IsAssetLoaded(const class StaticMesh& mesh);
+bool IsAssetSettled(const class StaticMesh& mesh);
+
+/// <summary>
+/// Coroutines waiting for assets to load. The assets signal it once they become usable or their load failed,
+/// the waiting coroutines are then handed to the CoroutineScheduler. Thread safe.
+/// </summary>
+class AssetLoadEvents
+{
+public:
+    MOVABLE_ONLY(AssetLoadEvents);
+
+    static AssetLoadEvents& Get()
+    {
+        static AssetLoadEvents instance;
+        return instance;
+    }
+
+    /// <summary>
+    /// Registers the coroutine unless isSettled already returns true, checked under the same lock as Signal.
+    /// Returns false when the coroutine wasn't registered and should continue right away.
+    /// </summary>
+    bool Wait(const RefCountBase* asset, const std::function<bool()>& isSettled, std::coroutine_handle<> handle, EResumeOn resumeOn);
+    /// <summary>
+    /// Schedules the coroutines waiting for the asset, called after its state changed.
+    /// </summary>
+    void Signal(const RefCountBase* asset);
+
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> Handle;
+        EResumeOn ResumeOn;
+    };
+
+    std::unordered_multimap<const RefCountBase*, Waiter> m_Waiters;
+    std::mutex m_Mutex;
+
+private:
+    AssetLoadEvents() = default;
+};
+
+/// <summary>
+/// Returned by the Renderer Load functions. co_await gives back the asset once it can be drawn, or an empty SafePtr
+/// when it failed to load, and continues on the thread asked for. An asset that is already loaded continues at once on
+/// the awaiting thread. GetAsset gives the asset right away to callers that aren't coroutines.
+/// </summary>
+template<typename T>
+class [[nodiscard]] AssetAwaitable
+{
+public:
+    AssetAwaitable(SafePtr<T> asset, EResumeOn resumeOn)
+        : m_Asset(asset), m_ResumeOn(resumeOn)
+    {
+    }
+
+    [[nodiscard]] SafePtr<T> GetAsset() const { return m_Asset; }
+
+    bool await_ready() { return !m_Asset || IsAssetSettled(*m_Asset); }
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        // the awaitable lives in the suspended frame, the asset can't be released while it is waited for
+        return AssetLoadEvents::Get().Wait(m_Asset.GetPtr(), [this]() { return IsAssetSettled(*m_Asset); }, handle, m_ResumeOn);
+    }
+    SafePtr<T> await_resume()
+    {
+        if (m_Asset && IsAssetLoaded(*m_Asset))
+            return m_Asset;
+        return SafePtr<T>();
+    }
+
+private:
+    SafePtr<T> m_Asset;
+    EResumeOn m_ResumeOn;
+};
+}
@@ -0,0 +1,305 @@
+#include "Core/Utils/Log.h"
+#include "Core/Utils/MappedFile.h"
+
+#include <charconv>
+
+#include "AsyncFileReader.h"
+#include "PackFile.h"
+#include "VirtualFileSystem.h"
+#include "AssetManifest.h"
+
+namespace lne
+{
+namespace
+{
+// first line of the file, followed by one line per asset and one line per dependency starting with a tab:
+// kind  version  source  cooked  hash  size  time
+//     path  hash  size  time
+constexpr std::string_view s_Header = "LNManifest";
+
+std::vector<std::string_view> Split(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    size_t begin = 0;
+    while (begin <= line.size())
+    {
+        size_t end = std::min(line.find('\t', begin), line.size());
+        fields.push_back(line.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return fields;
+}
+
+template<typename T>
+bool ParseNumber(std::string_view field, T& value, int base = 10)
+{
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value, base);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+bool ParseStamp(const std::vector<std::string_view>& fields, size_t first, AssetStamp& stamp)
+{
+    return ParseNumber(fields[first], stamp.Hash, 16)
+        && ParseNumber(fields[first + 1], stamp.Size)
+        && ParseNumber(fields[first + 2], stamp.WriteTime);
+}
+
+std::string FormatStamp(const AssetStamp& stamp)
+{
+    return std::format("{:016x}\t{}\t{}", stamp.Hash, stamp.Size, stamp.WriteTime);
+}
+
+bool ParseKind(std::string_view name, EAssetKind& kind)
+{
+    for (EAssetKind candidate : { EAssetKind::eTexture, EAssetKind::eMesh, EAssetKind::eShader })
+    {
+        if (AssetManifest::KindToString(candidate) == name)
+        {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+bool AssetManifest::Load(const std::filesystem::path& root)
+{
+    // the asset paths are built with backslashes, which aren't separators on Linux
+    std::string generic = root.generic_string();
+    std::replace(generic.begin(), generic.end(), '\\', '/');
+    m_Root = generic;
+    m_Entries.clear();
+    m_Lookup.clear();
+
+    std::filesystem::path path = m_Root / s_CookedDirectory / s_FileName;
+    auto& vfs = VirtualFileSystem::Get();
+    if (vfs.Exists(path) == false)
+    {
+        LNE_INFO("No asset manifest at {0}, assets are processed from their sources", path.string());
+        return false;
+    }
+
+    SafePtr<FileRead> file = vfs.Read(path);
+    if (file->Wait() == false)
+    {
+        LNE_ERROR("Failed to read the asset manifest: {0}", path.string());
+        return false;
+    }
+
+    std::string_view text((const char*)file->GetData(), (size_t)file->GetSize());
+    std::vector<AssetManifestEntry> entries;
+    uint32_t lineNumber = 0;
+    while (text.empty() == false)
+    {
+        size_t end = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        if (line.empty() == false && line.back() == '\r')
+            line.remove_suffix(1);
+        if (lineNumber++ == 0)
+        {
+            uint32_t version = 0;
+            if (line.starts_with(s_Header) == false || ParseNumber(line.substr(std::min(s_Header.size() + 1, line.size())), version) == false
+                || version != s_Version)
+            {
+                LNE_WARN("Asset manifest {0} has an incompatible version, cook the assets again", path.string());
+                return false;
+            }
+            continue;
+        }
+        if (line.empty())
+            continue;
+
+        bool isDependency = line.front() == '\t';
+        std::vector<std::string_view> fields = Split(isDependency ? line.substr(1) : line);
+        bool isValid = false;
+        if (isDependency && fields.size() == 4 && entries.empty() == false)
+        {
+            AssetDependency dependency{ std::string(fields[0]) };
+            isValid = ParseStamp(fields, 1, dependency.Stamp);
+            entries.back().Dependencies.push_back(std::move(dependency));
+        }
+        else if (isDependency == false && fields.size() == 7)
+        {
+            AssetManifestEntry entry{};
+            isValid = ParseKind(fields[0], entry.Kind) && ParseNumber(fields[1], entry.Version) && ParseStamp(fields, 4, entry.SourceStamp);
+            entry.Source = fields[2];
+            entry.Cooked = fields[3];
+            entries.push_back(std::move(entry));
+        }
+        if (isValid == false)
+        {
+            LNE_ERROR("Ill-formed asset manifest {0} at line {1}", path.string(), lineNumber);
+            return false;
+        }
+    }
+
+    SetEntries(std::move(entries));
+    LNE_INFO("Loaded the asset manifest {0}: {1} cooked assets", path.string(), m_Entries.size());
+    return true;
+}
+
+bool AssetManifest::Save() const
+{
+    std::filesystem::path directory = m_Root / s_CookedDirectory;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // written next to the previous one and swapped, an interrupted cook leaves the old manifest intact
+    std::filesystem::path path = directory / s_FileName;
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            LNE_ERROR("Failed to write the asset manifest: {0}", temporary.string());
+            return false;
+        }
+
+        file << s_Header << ' ' << s_Version << '\n';
+        for (const auto& entry : m_Entries)
+        {
+            file << std::format("{}\t{}\t{}\t{}\t{}\n", KindToString(entry.Kind), entry.Version, entry.Source, entry.Cooked,
+                FormatStamp(entry.SourceStamp));
+            for (const auto& dependency : entry.Dependencies)
+                file << std::format("\t{}\t{}\n", dependency.Path, FormatStamp(dependency.Stamp));
+        }
+        if (!file)
+            return false;
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        LNE_ERROR("Failed to replace the asset manifest {0}: {1}", path.string(), error.message());
+        return false;
+    }
+    return true;
+}
+
+const AssetManifestEntry* AssetManifest::Find(const std::filesystem::path& source) const
+{
+    auto it = m_Lookup.find(MakeKey(source));
+    return it == m_Lookup.end() ? nullptr : &m_Entries[it->second];
+}
+
+void AssetManifest::SetEntries(std::vector<AssetManifestEntry> entries)
+{
+    m_Entries = std::move(entries);
+    m_Lookup.clear();
+    for (size_t i = 0; i < m_Entries.size(); ++i)
+        m_Lookup[PackFile::NormalizePath(m_Entries[i].Source)] = i;
+}
+
+std::filesystem::path AssetManifest::GetCookedPath(const std::filesystem::path& source) const
+{
+    const AssetManifestEntry* entry = Find(source);
+    if (entry == nullptr)
+        return {};
+
+    auto& vfs = VirtualFileSystem::Get();
+    std::filesystem::path cooked = m_Root / entry->Cooked;
+    // the pack is built from the cooked files as they are
+    if (vfs.IsPacked(cooked))
+        return cooked;
+    if (vfs.Exists(cooked) == false)
+        return {};
+
+    bool isCurrent = IsCurrent(entry->Source, entry->SourceStamp)
+        && std::all_of(entry->Dependencies.begin(), entry->Dependencies.end(),
+            [this](const AssetDependency& dependency) { return IsCurrent(dependency.Path, dependency.Stamp); });
+    if (isCurrent == false)
+    {
+        LNE_INFO("{0} changed since it was cooked, it is processed from its source", entry->Source);
+        return {};
+    }
+    return cooked;
+}
+
+bool AssetManifest::StampFile(const std::filesystem::path& path, AssetStamp& stamp, const AssetStamp* previous)
+{
+    std::error_code error;
+    stamp.Size = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+    stamp.WriteTime = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error)
+        return false;
+
+    if (previous && previous->Size == stamp.Size && previous->WriteTime == stamp.WriteTime)
+    {
+        stamp.Hash = previous->Hash;
+        return true;
+    }
+
+    if (stamp.Size == 0)
+    {
+        stamp.Hash = Hash(nullptr, 0);
+        return true;
+    }
+    MappedFile file;
+    if (file.Open(path) == false)
+        return false;
+    stamp.Hash = Hash(file.GetData(), file.GetSize());
+    return true;
+}
+
+uint64_t AssetManifest::Hash(const uint8_t* data, uint64_t size)
+{
+    // multiply-xorshift over 8 byte words, a few GB/s: the files are only hashed when their write time changed
+    constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+    auto mix = [](uint64_t value)
+    {
+        value ^= value >> 32;
+        value *= 0xD6E8FEB86659FD93ull;
+        return value ^ (value >> 32);
+    };
+
+    uint64_t hash = size * prime;
+    uint64_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + offset, sizeof(word));
+        hash = mix(hash ^ word) + prime;
+    }
+    uint64_t tail = 0;
+    if (offset < size)
+        memcpy(&tail, data + offset, size - offset);
+    return mix(hash ^ tail);
+}
+
+std::string_view AssetManifest::KindToString(EAssetKind kind)
+{
+    switch (kind)
+    {
+    case EAssetKind::eTexture: return "texture";
+    case EAssetKind::eMesh: return "mesh";
+    case EAssetKind::eShader: return "shader";
+    default: return "unknown";
+    }
+}
+
+std::string AssetManifest::MakeKey(const std::filesystem::path& source) const
+{
+    // runtime paths are absolute under the mounted root, the cooker passes them relative to it
+    std::string relative = VirtualFileSystem::Get().GetRelativePath(source);
+    return relative.empty() ? PackFile::NormalizePath(source.generic_string()) : relative;
+}
+
+bool AssetManifest::IsCurrent(const std::string& path, const AssetStamp& stamp) const
+{
+    std::error_code error;
+    std::filesystem::path file = m_Root / path;
+    if (std::filesystem::exists(file, error) == false)
+        return true;
+
+    uint64_t size = std::filesystem::file_size(file, error);
+    if (error)
+        return false;
+    auto writeTime = std::filesystem::last_write_time(file, error);
+    return !error && size == stamp.Size && (int64_t)writeTime.time_since_epoch().count() == stamp.WriteTime;
+}
+}
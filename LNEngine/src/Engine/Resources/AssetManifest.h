@@ -0,0 +1,99 @@
+#pragma once
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+enum class EAssetKind : uint8_t
+{
+    eTexture,
+    eMesh,
+    eShader,
+};
+
+/// <summary>
+/// Identifies the content of a file. The size and write time are compared first, the hash only settles the files they differ on.
+/// </summary>
+struct AssetStamp
+{
+    uint64_t Hash{};
+    uint64_t Size{};
+    int64_t WriteTime{};
+};
+
+struct AssetDependency
+{
+    // relative to the assets root
+    std::string Path;
+    AssetStamp Stamp;
+};
+
+struct AssetManifestEntry
+{
+    EAssetKind Kind{};
+    // version of the cooked format, the asset is cooked again when it changes
+    uint32_t Version{};
+    // relative to the assets root
+    std::string Source;
+    std::string Cooked;
+    AssetStamp SourceStamp;
+    // files read by the cook besides the source: glTF buffers and images, OBJ material libraries...
+    std::vector<AssetDependency> Dependencies;
+};
+
+/// <summary>
+/// Lists the assets cooked by LNCook under Cooked/ in the assets directory, with the stamps of the files they were cooked from.
+/// The loaders ask it for the cooked file of a source and process the source themselves when there is none or it is stale.
+/// Load it at startup with the root the file system is mounted on, the lookups aren't synchronized with it.
+/// </summary>
+class AssetManifest
+{
+public:
+    static constexpr std::string_view s_CookedDirectory = "Cooked";
+    static constexpr std::string_view s_FileName = "Manifest.lnman";
+    static constexpr uint32_t s_Version = 1;
+
+    MOVABLE_ONLY(AssetManifest);
+    AssetManifest() = default;
+
+    static AssetManifest& Get()
+    {
+        static AssetManifest instance;
+        return instance;
+    }
+
+    /// <summary>
+    /// Reads the manifest of the assets root from the pack or the loose files. Returns false if there is none,
+    /// the root is kept so that a new manifest can be saved there.
+    /// </summary>
+    bool Load(const std::filesystem::path& root);
+    bool Save() const;
+
+    [[nodiscard]] const AssetManifestEntry* Find(const std::filesystem::path& source) const;
+    [[nodiscard]] const std::vector<AssetManifestEntry>& GetEntries() const { return m_Entries; }
+    void SetEntries(std::vector<AssetManifestEntry> entries);
+    [[nodiscard]] const std::filesystem::path& GetRoot() const { return m_Root; }
+
+    /// <summary>
+    /// Returns the cooked file of the source if the source and its dependencies didn't change since it was cooked, an empty path otherwise.
+    /// Only the sizes and write times are compared. Packed cooked files, and sources that aren't on disk (shipped cooked only), are trusted.
+    /// </summary>
+    [[nodiscard]] std::filesystem::path GetCookedPath(const std::filesystem::path& source) const;
+
+    /// <summary>
+    /// Stamps a file on disk. The hash of the previous stamp is reused when the size and write time didn't change.
+    /// </summary>
+    [[nodiscard]] static bool StampFile(const std::filesystem::path& path, AssetStamp& stamp, const AssetStamp* previous = nullptr);
+    [[nodiscard]] static uint64_t Hash(const uint8_t* data, uint64_t size);
+    [[nodiscard]] static std::string_view KindToString(EAssetKind kind);
+
+private:
+    std::filesystem::path m_Root;
+    std::vector<AssetManifestEntry> m_Entries;
+    // normalized source path to index in m_Entries
+    std::unordered_map<std::string, size_t> m_Lookup;
+
+private:
+    [[nodiscard]] std::string MakeKey(const std::filesystem::path& source) const;
+    [[nodiscard]] bool IsCurrent(const std::string& path, const AssetStamp& stamp) const;
+};
+}
@@ -0,0 +1,35 @@
+#include "AssetRegistry.h"
+
+namespace lne
+{
+std::string AssetRegistry::MakeKey(const std::filesystem::path& path, std::string_view params)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    std::string key = (error ? path.lexically_normal() : canonical).generic_string();
+#if defined(LNE_PLATFORM_WINDOWS)
+    // paths are case insensitive on Windows
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+    if (params.empty() == false)
+    {
+        key += '|';
+        key += params;
+    }
+    return key;
+}
+
+bool AssetRegistry::Contains(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Assets.contains(key);
+}
+
+void AssetRegistry::Remove(const std::string& key, const RefCountBase* asset)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Assets.find(key);
+    if (it != m_Assets.end() && it->second == asset)
+        m_Assets.erase(it);
+}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <condition_variable>
+
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+/// <summary>
+/// Cache of the loaded assets keyed by canonical path and load parameters.
+/// The registry doesn't own the assets: it hands out the existing SafePtr while something still references them
+/// and the assets remove themselves from it when their last reference drops.
+/// </summary>
+class AssetRegistry
+{
+public:
+    MOVABLE_ONLY(AssetRegistry);
+
+    static AssetRegistry& Get()
+    {
+        static AssetRegistry instance;
+        return instance;
+    }
+
+    [[nodiscard]] static std::string MakeKey(const std::filesystem::path& path, std::string_view params = "");
+
+    /// <summary>
+    /// Returns the asset registered under the key or creates it with the given function.
+    /// Concurrent requests for a key that is being created wait for it instead of creating it a second time.
+    /// If the function throws, the exception is passed on and the waiting requests try to create the asset themselves.
+    /// The asset type needs a SetAssetKey(const std::string&) method and has to call Remove in its destructor.
+    /// </summary>
+    template<typename T>
+    SafePtr<T> GetOrCreate(const std::string& key, const std::function<SafePtr<T>()>& create)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (true)
+            {
+                auto it = m_Assets.find(key);
+                if (it == m_Assets.end())
+                    break;
+                // another thread is creating it
+                if (it->second == nullptr)
+                {
+                    m_InFlightCondition.wait(lock);
+                    continue;
+                }
+                // the asset is being destroyed, it will be replaced
+                if (it->second->TryCapture() == false)
+                    break;
+
+                T* asset = static_cast<T*>(it->second);
+                SafePtr<T> result(asset);
+                asset->Release();
+                return result;
+            }
+            m_Assets[key] = nullptr;
+        }
+
+        SafePtr<T> asset;
+        try
+        {
+            asset = create();
+        }
+        catch (...)
+        {
+            // the requests waiting for the placeholder would block forever, the next one creates the asset again
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Assets.erase(key);
+            }
+            m_InFlightCondition.notify_all();
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (asset)
+            {
+                asset->SetAssetKey(key);
+                m_Assets[key] = asset.GetPtr();
+            }
+            else
+            {
+                m_Assets.erase(key);
+            }
+        }
+        m_InFlightCondition.notify_all();
+        return asset;
+    }
+
+    /// <summary>
+    /// Returns the asset registered under the key, or an empty pointer if there is none or it is being created or destroyed.
+    /// </summary>
+    template<typename T>
+    SafePtr<T> Find(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Assets.find(key);
+        if (it == m_Assets.end() || it->second == nullptr || it->second->TryCapture() == false)
+            return SafePtr<T>();
+
+        T* asset = static_cast<T*>(it->second);
+        SafePtr<T> result(asset);
+        asset->Release();
+        return result;
+    }
+    [[nodiscard]] bool Contains(const std::string& key);
+
+    /// <summary>
+    /// Called by the assets when they are destroyed. Does nothing if the key has already been taken by a new asset.
+    /// </summary>
+    void Remove(const std::string& key, const RefCountBase* asset);
+
+private:
+    std::unordered_map<std::string, RefCountBase*> m_Assets;
+    std::mutex m_Mutex;
+    std::condition_variable m_InFlightCondition;
+
+private:
+    AssetRegistry() = default;
+};
+}
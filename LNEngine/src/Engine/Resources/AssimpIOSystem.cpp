@@ -0,0 +1,98 @@
+#include "Core/Utils/Log.h"
+
+#include "AsyncFileReader.h"
+#include "VirtualFileSystem.h"
+#include "AssimpIOSystem.h"
+
+namespace lne
+{
+FileReadIOStream::FileReadIOStream(SafePtr<FileRead> read)
+    : m_Read(std::move(read))
+{
+}
+
+size_t FileReadIOStream::Read(void* buffer, size_t size, size_t count)
+{
+    if (size == 0 || count == 0)
+        return 0;
+
+    // only whole elements are read, like fread
+    size_t available = (size_t)m_Read->GetSize() - m_Position;
+    size_t elements = std::min(count, available / size);
+    memcpy(buffer, m_Read->GetData() + m_Position, elements * size);
+    m_Position += elements * size;
+    return elements;
+}
+
+aiReturn FileReadIOStream::Seek(size_t offset, aiOrigin origin)
+{
+    size_t size = (size_t)m_Read->GetSize();
+    size_t position{};
+    switch (origin)
+    {
+    case aiOrigin_SET:
+        position = offset;
+        break;
+    case aiOrigin_CUR:
+        position = m_Position + offset;
+        break;
+    case aiOrigin_END:
+        // the offset is negative, wrapped in a size_t
+        position = size + offset;
+        break;
+    default:
+        return aiReturn_FAILURE;
+    }
+
+    if (position > size)
+        return aiReturn_FAILURE;
+    m_Position = position;
+    return aiReturn_SUCCESS;
+}
+
+size_t FileReadIOStream::FileSize() const
+{
+    return (size_t)m_Read->GetSize();
+}
+
+void AssimpIOSystem::Prefetch(const std::filesystem::path& file)
+{
+    m_PrefetchedReads.emplace(file.lexically_normal().string(), VirtualFileSystem::Get().Read(file));
+}
+
+bool AssimpIOSystem::Exists(const char* file) const
+{
+    return VirtualFileSystem::Get().Exists(file);
+}
+
+Assimp::IOStream* AssimpIOSystem::Open(const char* file, const char* mode)
+{
+    if (strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+'))
+    {
+        LNE_ERROR("Assimp tried to open {0} for writing, only reads are supported", file);
+        return nullptr;
+    }
+
+    SafePtr<FileRead> read;
+    auto it = m_PrefetchedReads.find(std::filesystem::path(file).lexically_normal().string());
+    if (it != m_PrefetchedReads.end())
+    {
+        read = std::move(it->second);
+        m_PrefetchedReads.erase(it);
+    }
+    else
+    {
+        read = VirtualFileSystem::Get().Read(file);
+    }
+
+    // Assimp parses synchronously, it needs the whole file now
+    if (read->Wait() == false)
+        return nullptr;
+    return lnnew FileReadIOStream(std::move(read));
+}
+
+void AssimpIOSystem::Close(Assimp::IOStream* file)
+{
+    delete file;
+}
+}
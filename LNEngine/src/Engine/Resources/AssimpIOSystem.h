@@ -0,0 +1,49 @@
+#pragma once
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include "Engine/Core/SafePtr.h"
+
+namespace lne
+{
+/// <summary>
+/// Read-only stream over a whole file fetched by the AsyncFileReader.
+/// </summary>
+class FileReadIOStream : public Assimp::IOStream
+{
+public:
+    explicit FileReadIOStream(SafePtr<class FileRead> read);
+
+    size_t Read(void* buffer, size_t size, size_t count) override;
+    size_t Write(const void* buffer, size_t size, size_t count) override { return 0; }
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t Tell() const override { return m_Position; }
+    size_t FileSize() const override;
+    void Flush() override {}
+
+private:
+    SafePtr<class FileRead> m_Read;
+    size_t m_Position{ 0 };
+};
+
+/// <summary>
+/// Routes the files opened by Assimp (the model and the buffers it references) through the AsyncFileReader
+/// instead of Assimp's own fopen/fread, so they are read into the reader pooled buffers and parsed from memory.
+/// </summary>
+class AssimpIOSystem : public Assimp::IOSystem
+{
+public:
+    /// <summary>
+    /// Issues the read of a file Assimp is going to open, so that several files are read at the same time.
+    /// </summary>
+    void Prefetch(const std::filesystem::path& file);
+
+    bool Exists(const char* file) const override;
+    char getOsSeparator() const override { return (char)std::filesystem::path::preferred_separator; }
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override;
+    void Close(Assimp::IOStream* file) override;
+
+private:
+    std::unordered_map<std::string, SafePtr<class FileRead>> m_PrefetchedReads;
+};
+}
@@ -0,0 +1,486 @@
+#include "Core/Utils/Log.h"
+
+#include "AsyncFileReader.h"
+
+#if defined(LNE_PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+#define LNE_HAS_IO_URING
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#endif
+
+namespace lne
+{
+#if defined(LNE_HAS_IO_URING)
+/// <summary>
+/// Submission and completion rings shared with the kernel. Only the raw syscalls are used, there is no liburing dependency.
+/// </summary>
+struct IoUring
+{
+    int FileDescriptor{ -1 };
+    void* SubmissionRing{ nullptr };
+    size_t SubmissionRingSize{ 0 };
+    void* CompletionRing{ nullptr };
+    size_t CompletionRingSize{ 0 };
+    io_uring_sqe* SubmissionEntries{ nullptr };
+    size_t SubmissionEntriesSize{ 0 };
+
+    uint32_t* SubmissionHead{ nullptr };
+    uint32_t* SubmissionTail{ nullptr };
+    uint32_t SubmissionMask{ 0 };
+    uint32_t SubmissionEntryCount{ 0 };
+    uint32_t* SubmissionArray{ nullptr };
+
+    uint32_t* CompletionHead{ nullptr };
+    uint32_t* CompletionTail{ nullptr };
+    uint32_t CompletionMask{ 0 };
+    io_uring_cqe* CompletionEntries{ nullptr };
+};
+
+namespace
+{
+int IoUringSetup(uint32_t entries, io_uring_params& params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, &params);
+}
+
+int IoUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+// reads larger than this are split, the length of a read entry is 32 bits
+constexpr uint64_t s_MaxReadChunk = 1ull << 30;
+}
+#else
+struct IoUring
+{
+};
+#endif
+
+FileRead::FileRead(const std::filesystem::path& path, uint64_t offset, uint64_t size)
+    : m_Path(path), m_Offset(offset), m_Size(size)
+{
+}
+
+FileRead::~FileRead()
+{
+    if (m_Buffer && m_BufferCapacity != 0)
+        AsyncFileReader::Get().ReleaseBuffer(m_Buffer, m_BufferCapacity);
+}
+
+bool FileRead::Wait() const
+{
+    uint32_t status = m_Status.load(std::memory_order_acquire);
+    while (status == (uint32_t)EFileReadStatus::ePending)
+    {
+        m_Status.wait(status, std::memory_order_acquire);
+        status = m_Status.load(std::memory_order_acquire);
+    }
+    return status == (uint32_t)EFileReadStatus::eSucceeded;
+}
+
+void FileRead::Complete(EFileReadStatus status)
+{
+#if defined(LNE_HAS_IO_URING)
+    if (m_FileDescriptor >= 0)
+    {
+        close(m_FileDescriptor);
+        m_FileDescriptor = -1;
+    }
+#endif
+    if (status == EFileReadStatus::eFailed)
+        LNE_ERROR("Failed to read {0} bytes at offset {1} from {2}", m_Size, m_Offset, m_Path.string());
+
+    m_Status.store((uint32_t)status, std::memory_order_release);
+    m_Status.notify_all();
+}
+
+AsyncFileReader::AsyncFileReader()
+{
+    if (InitIoUring(64))
+    {
+        LNE_INFO("Asset file reads go through io_uring");
+        return;
+    }
+    StartReaderThreads();
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsShuttingDown = true;
+    }
+    m_QueuedReadsCondition.notify_all();
+    for (auto& thread : m_ReaderThreads)
+        thread.join();
+
+    ShutdownIoUring();
+
+    for (auto& read : m_QueuedReads)
+        read->Complete(EFileReadStatus::eFailed);
+    m_QueuedReads.clear();
+
+    for (auto& buffers : m_FreeBuffers)
+    {
+        for (uint8_t* buffer : buffers)
+            delete[] buffer;
+    }
+}
+
+SafePtr<FileRead> AsyncFileReader::Read(const std::filesystem::path& path, uint64_t offset, uint64_t size)
+{
+    SafePtr<FileRead> read(lnnew FileRead(path, offset, size));
+
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(path, error);
+    if (error || offset > fileSize || (size != 0 && offset + size > fileSize))
+    {
+        read->Complete(EFileReadStatus::eFailed);
+        return read;
+    }
+    if (size == 0)
+        read->m_Size = fileSize - offset;
+    if (read->m_Size == 0)
+    {
+        read->Complete(EFileReadStatus::eSucceeded);
+        return read;
+    }
+
+    read->m_Buffer = AcquireBuffer(read->m_Size, read->m_BufferCapacity);
+
+#if defined(LNE_HAS_IO_URING)
+    if (m_Ring)
+    {
+        read->m_FileDescriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (read->m_FileDescriptor < 0)
+        {
+            read->Complete(EFileReadStatus::eFailed);
+            return read;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_InFlightReads.emplace(read.GetPtr(), read);
+        // the ring is full, the completion thread submits it once entries are reaped
+        if (SubmitIoUring(read.GetPtr()) == false)
+            m_QueuedReads.push_back(read);
+        return read;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_QueuedReads.push_back(read);
+    }
+    m_QueuedReadsCondition.notify_one();
+    return read;
+}
+
+SafePtr<FileRead> AsyncFileReader::Wrap(const std::filesystem::path& path, const uint8_t* data, uint64_t size)
+{
+    SafePtr<FileRead> read(lnnew FileRead(path, 0, size));
+    read->m_Buffer = (uint8_t*)data;
+    read->m_BytesRead = size;
+    read->Complete(EFileReadStatus::eSucceeded);
+    return read;
+}
+
+SafePtr<FileRead> AsyncFileReader::Produce(const std::filesystem::path& path, uint64_t size, const std::function<bool(uint8_t*)>& fill)
+{
+    SafePtr<FileRead> read(lnnew FileRead(path, 0, size));
+    if (size != 0)
+        read->m_Buffer = AcquireBuffer(size, read->m_BufferCapacity);
+    bool succeeded = fill(read->m_Buffer);
+    read->m_BytesRead = succeeded ? size : 0;
+    read->Complete(succeeded ? EFileReadStatus::eSucceeded : EFileReadStatus::eFailed);
+    return read;
+}
+
+uint8_t* AsyncFileReader::AcquireBuffer(uint64_t size, uint64_t& capacity)
+{
+    uint32_t sizeClass = s_MinBufferClass;
+    while (sizeClass < 63 && (1ull << sizeClass) < size)
+        ++sizeClass;
+
+    // too large to be pooled
+    if (sizeClass >= s_MinBufferClass + s_BufferClassCount)
+    {
+        capacity = size;
+        return lnnew uint8_t[size];
+    }
+
+    capacity = 1ull << sizeClass;
+    {
+        std::lock_guard<std::mutex> lock(m_BufferMutex);
+        auto& buffers = m_FreeBuffers[sizeClass - s_MinBufferClass];
+        if (buffers.empty() == false)
+        {
+            uint8_t* buffer = buffers.back();
+            buffers.pop_back();
+            m_PooledBytes -= capacity;
+            return buffer;
+        }
+    }
+    return lnnew uint8_t[capacity];
+}
+
+void AsyncFileReader::ReleaseBuffer(uint8_t* buffer, uint64_t capacity)
+{
+    uint32_t sizeClass = (uint32_t)std::countr_zero(capacity);
+    bool isPooledSize = std::has_single_bit(capacity) && sizeClass >= s_MinBufferClass && sizeClass < s_MinBufferClass + s_BufferClassCount;
+    {
+        std::lock_guard<std::mutex> lock(m_BufferMutex);
+        if (isPooledSize && m_PooledBytes + capacity <= s_MaxPooledBytes)
+        {
+            m_FreeBuffers[sizeClass - s_MinBufferClass].push_back(buffer);
+            m_PooledBytes += capacity;
+            return;
+        }
+    }
+    delete[] buffer;
+}
+
+void AsyncFileReader::StartReaderThreads()
+{
+    m_ReaderThreads.reserve(s_FallbackThreadCount);
+    for (uint32_t i = 0; i < s_FallbackThreadCount; ++i)
+        m_ReaderThreads.emplace_back(&AsyncFileReader::ReaderThreadLoop, this);
+}
+
+void AsyncFileReader::ReaderThreadLoop()
+{
+    while (true)
+    {
+        SafePtr<FileRead> read;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueuedReadsCondition.wait(lock, [this]() { return m_IsShuttingDown || m_QueuedReads.empty() == false; });
+            if (m_IsShuttingDown)
+                return;
+            read = std::move(m_QueuedReads.front());
+            m_QueuedReads.pop_front();
+        }
+        ReadBlocking(*read);
+    }
+}
+
+void AsyncFileReader::ReadBlocking(FileRead& read)
+{
+    std::ifstream file(read.m_Path, std::ios::binary);
+    if (!file.is_open())
+    {
+        read.Complete(EFileReadStatus::eFailed);
+        return;
+    }
+
+    file.seekg((std::streamoff)read.m_Offset);
+    file.read((char*)read.m_Buffer, (std::streamsize)read.m_Size);
+    read.m_BytesRead = (uint64_t)file.gcount();
+    read.Complete(read.m_BytesRead == read.m_Size ? EFileReadStatus::eSucceeded : EFileReadStatus::eFailed);
+}
+
+#if defined(LNE_HAS_IO_URING)
+bool AsyncFileReader::InitIoUring(uint32_t queueDepth)
+{
+    io_uring_params params{};
+    int fd = IoUringSetup(queueDepth, params);
+    if (fd < 0)
+    {
+        LNE_WARN("io_uring isn't available (error {0}), falling back to reader threads", errno);
+        return false;
+    }
+    // IORING_OP_READ came with the same kernel version (5.6)
+    if ((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+    {
+        LNE_WARN("io_uring is too old for plain reads, falling back to reader threads");
+        close(fd);
+        return false;
+    }
+
+    auto ring = std::make_unique<IoUring>();
+    ring->FileDescriptor = fd;
+    ring->SubmissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->CompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping)
+        ring->SubmissionRingSize = ring->CompletionRingSize = std::max(ring->SubmissionRingSize, ring->CompletionRingSize);
+
+    ring->SubmissionRing = mmap(nullptr, ring->SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->CompletionRing = singleMapping ? ring->SubmissionRing :
+        mmap(nullptr, ring->CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->SubmissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->SubmissionEntries = (io_uring_sqe*)mmap(nullptr, ring->SubmissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (ring->SubmissionRing == MAP_FAILED || ring->CompletionRing == MAP_FAILED || ring->SubmissionEntries == MAP_FAILED)
+    {
+        LNE_WARN("Failed to map the io_uring rings, falling back to reader threads");
+        if (ring->SubmissionRing != MAP_FAILED)
+            munmap(ring->SubmissionRing, ring->SubmissionRingSize);
+        if (singleMapping == false && ring->CompletionRing != MAP_FAILED)
+            munmap(ring->CompletionRing, ring->CompletionRingSize);
+        if (ring->SubmissionEntries != MAP_FAILED)
+            munmap(ring->SubmissionEntries, ring->SubmissionEntriesSize);
+        close(fd);
+        return false;
+    }
+
+    uint8_t* sq = (uint8_t*)ring->SubmissionRing;
+    ring->SubmissionHead = (uint32_t*)(sq + params.sq_off.head);
+    ring->SubmissionTail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->SubmissionMask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->SubmissionEntryCount = *(uint32_t*)(sq + params.sq_off.ring_entries);
+    ring->SubmissionArray = (uint32_t*)(sq + params.sq_off.array);
+
+    uint8_t* cq = (uint8_t*)ring->CompletionRing;
+    ring->CompletionHead = (uint32_t*)(cq + params.cq_off.head);
+    ring->CompletionTail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->CompletionMask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->CompletionEntries = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    m_Ring = ring.release();
+    m_CompletionThread = std::thread(&AsyncFileReader::ReapCompletions, this);
+    return true;
+}
+
+void AsyncFileReader::ShutdownIoUring()
+{
+    if (m_Ring == nullptr)
+        return;
+
+    // a read without a FileRead wakes the completion thread up
+    while (true)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (SubmitIoUring(nullptr))
+            break;
+    }
+    m_CompletionThread.join();
+
+    for (auto& [ptr, read] : m_InFlightReads)
+    {
+        if (read->IsDone() == false)
+            read->Complete(EFileReadStatus::eFailed);
+    }
+    m_InFlightReads.clear();
+
+    munmap(m_Ring->SubmissionEntries, m_Ring->SubmissionEntriesSize);
+    if (m_Ring->CompletionRing != m_Ring->SubmissionRing)
+        munmap(m_Ring->CompletionRing, m_Ring->CompletionRingSize);
+    munmap(m_Ring->SubmissionRing, m_Ring->SubmissionRingSize);
+    close(m_Ring->FileDescriptor);
+    delete m_Ring;
+    m_Ring = nullptr;
+}
+
+bool AsyncFileReader::SubmitIoUring(FileRead* read)
+{
+    // m_Mutex is held, this is the only producer
+    uint32_t tail = *m_Ring->SubmissionTail;
+    uint32_t head = std::atomic_ref<uint32_t>(*m_Ring->SubmissionHead).load(std::memory_order_acquire);
+    if (tail - head >= m_Ring->SubmissionEntryCount)
+        return false;
+
+    uint32_t index = tail & m_Ring->SubmissionMask;
+    io_uring_sqe& entry = m_Ring->SubmissionEntries[index];
+    memset(&entry, 0, sizeof(io_uring_sqe));
+    if (read)
+    {
+        entry.opcode = IORING_OP_READ;
+        entry.fd = read->m_FileDescriptor;
+        entry.off = read->m_Offset + read->m_BytesRead;
+        entry.addr = (uint64_t)(uintptr_t)(read->m_Buffer + read->m_BytesRead);
+        entry.len = (uint32_t)std::min(read->m_Size - read->m_BytesRead, s_MaxReadChunk);
+    }
+    else
+    {
+        entry.opcode = IORING_OP_NOP;
+    }
+    entry.user_data = (uint64_t)(uintptr_t)read;
+    m_Ring->SubmissionArray[index] = index;
+    std::atomic_ref<uint32_t>(*m_Ring->SubmissionTail).store(tail + 1, std::memory_order_release);
+
+    int result = IoUringEnter(m_Ring->FileDescriptor, 1, 0, 0);
+    if (result < 0)
+        LNE_ERROR("io_uring_enter failed to submit a read (error {0})", errno);
+    return true;
+}
+
+void AsyncFileReader::ReapCompletions()
+{
+    while (true)
+    {
+        if (IoUringEnter(m_Ring->FileDescriptor, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+        {
+            LNE_ERROR("io_uring_enter failed to wait for completions (error {0})", errno);
+            return;
+        }
+
+        std::vector<SafePtr<FileRead>> completed;
+        bool isShuttingDown = false;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            uint32_t head = *m_Ring->CompletionHead;
+            uint32_t tail = std::atomic_ref<uint32_t>(*m_Ring->CompletionTail).load(std::memory_order_acquire);
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe& entry = m_Ring->CompletionEntries[head & m_Ring->CompletionMask];
+                FileRead* read = (FileRead*)(uintptr_t)entry.user_data;
+                if (read == nullptr)
+                {
+                    isShuttingDown = true;
+                    continue;
+                }
+
+                if (entry.res > 0)
+                {
+                    read->m_BytesRead += (uint64_t)entry.res;
+                    // short read, queue the rest
+                    if (read->m_BytesRead < read->m_Size)
+                    {
+                        m_QueuedReads.push_back(m_InFlightReads.at(read));
+                        continue;
+                    }
+                }
+
+                auto it = m_InFlightReads.find(read);
+                completed.push_back(std::move(it->second));
+                m_InFlightReads.erase(it);
+            }
+            std::atomic_ref<uint32_t>(*m_Ring->CompletionHead).store(head, std::memory_order_release);
+
+            while (m_QueuedReads.empty() == false && SubmitIoUring(m_QueuedReads.front().GetPtr()))
+                m_QueuedReads.pop_front();
+        }
+
+        // completed outside of the lock, a waiting thread can issue new reads right away
+        for (auto& read : completed)
+            read->Complete(read->m_BytesRead == read->m_Size ? EFileReadStatus::eSucceeded : EFileReadStatus::eFailed);
+
+        if (isShuttingDown)
+            return;
+    }
+}
+#else
+bool AsyncFileReader::InitIoUring(uint32_t queueDepth)
+{
+    return false;
+}
+
+void AsyncFileReader::ShutdownIoUring()
+{
+}
+
+bool AsyncFileReader::SubmitIoUring(FileRead* read)
+{
+    return false;
+}
+
+void AsyncFileReader::ReapCompletions()
+{
+}
+#endif
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <condition_variable>
+#include <thread>
+
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+enum class EFileReadStatus : uint32_t
+{
+    ePending,
+    eSucceeded,
+    eFailed,
+};
+
+/// <summary>
+/// A read issued through the AsyncFileReader. The data is valid once IsDone returns true and stays valid while the object lives,
+/// its buffer goes back to the reader pool when the last reference drops.
+/// </summary>
+class FileRead : public RefCountBase
+{
+public:
+    MOVABLE_ONLY(FileRead);
+    ~FileRead();
+
+    [[nodiscard]] bool IsDone() const { return GetStatus() != EFileReadStatus::ePending; }
+    [[nodiscard]] bool Succeeded() const { return GetStatus() == EFileReadStatus::eSucceeded; }
+    [[nodiscard]] EFileReadStatus GetStatus() const { return (EFileReadStatus)m_Status.load(std::memory_order_acquire); }
+    /// <summary>
+    /// Blocks until the read is done. Returns true if it succeeded.
+    /// </summary>
+    bool Wait() const;
+
+    [[nodiscard]] const uint8_t* GetData() const { return m_Buffer; }
+    [[nodiscard]] uint64_t GetSize() const { return m_Size; }
+    [[nodiscard]] const std::filesystem::path& GetPath() const { return m_Path; }
+
+private:
+    friend class AsyncFileReader;
+    FileRead(const std::filesystem::path& path, uint64_t offset, uint64_t size);
+
+    void Complete(EFileReadStatus status);
+
+private:
+    std::filesystem::path m_Path;
+    uint64_t m_Offset;
+    uint64_t m_Size;
+    uint64_t m_BytesRead{ 0 };
+    uint8_t* m_Buffer{ nullptr };
+    // 0 when the buffer isn't owned
+    uint64_t m_BufferCapacity{ 0 };
+#if defined(LNE_PLATFORM_LINUX)
+    int m_FileDescriptor{ -1 };
+#endif
+    mutable std::atomic<uint32_t> m_Status{ (uint32_t)EFileReadStatus::ePending };
+};
+
+/// <summary>
+/// Reads whole files or ranges into pooled buffers without blocking the caller, so that several files can be in flight
+/// while the loader thread decodes the ones that are done.
+/// On Linux the reads are submitted to an io_uring and reaped by a completion thread. When io_uring isn't available
+/// (Windows, old kernels, sandboxes that block the syscalls) a small pool of blocking reader threads is used instead.
+/// The reader threads are its own: blocking the task scheduler workers on disk would starve the other tasks.
+/// </summary>
+class AsyncFileReader
+{
+public:
+    MOVABLE_ONLY(AsyncFileReader);
+
+    static AsyncFileReader& Get()
+    {
+        static AsyncFileReader instance;
+        return instance;
+    }
+
+    /// <summary>
+    /// Issues a read of [offset, offset + size). A size of 0 reads until the end of the file.
+    /// Never returns null, failures to open the file are reported by the returned read.
+    /// </summary>
+    [[nodiscard]] SafePtr<FileRead> Read(const std::filesystem::path& path, uint64_t offset = 0, uint64_t size = 0);
+    /// <summary>
+    /// Returns a completed read over memory the caller keeps alive, such as an uncompressed entry of a mapped archive.
+    /// </summary>
+    [[nodiscard]] SafePtr<FileRead> Wrap(const std::filesystem::path& path, const uint8_t* data, uint64_t size);
+    /// <summary>
+    /// Returns a read whose pooled buffer of the given size is filled by the function, on the calling thread.
+    /// Used for data that doesn't come straight from a file, like decompressed archive entries.
+    /// </summary>
+    [[nodiscard]] SafePtr<FileRead> Produce(const std::filesystem::path& path, uint64_t size, const std::function<bool(uint8_t*)>& fill);
+
+    [[nodiscard]] bool UsesIoUring() const { return m_Ring != nullptr; }
+
+private:
+    // buffers are pooled by power of two size classes from 64KB
+    static constexpr uint32_t s_MinBufferClass = 16;
+    static constexpr uint32_t s_BufferClassCount = 16;
+    // above this the released buffers are freed instead of being kept for the next reads
+    static constexpr uint64_t s_MaxPooledBytes = 256ull * 1024 * 1024;
+    static constexpr uint32_t s_FallbackThreadCount = 4;
+
+    std::array<std::vector<uint8_t*>, s_BufferClassCount> m_FreeBuffers{};
+    uint64_t m_PooledBytes{ 0 };
+    std::mutex m_BufferMutex;
+
+    // io_uring backend, see AsyncFileReader.cpp
+    struct IoUring* m_Ring{ nullptr };
+    std::thread m_CompletionThread;
+    // reads owned by the ring until their completion is reaped
+    std::unordered_map<FileRead*, SafePtr<FileRead>> m_InFlightReads;
+
+    // fallback backend
+    std::vector<std::thread> m_ReaderThreads;
+    std::deque<SafePtr<FileRead>> m_QueuedReads;
+    std::condition_variable m_QueuedReadsCondition;
+
+    std::mutex m_Mutex;
+    bool m_IsShuttingDown{ false };
+
+private:
+    AsyncFileReader();
+    ~AsyncFileReader();
+
+    friend class FileRead;
+    uint8_t* AcquireBuffer(uint64_t size, uint64_t& capacity);
+    void ReleaseBuffer(uint8_t* buffer, uint64_t capacity);
+
+    bool InitIoUring(uint32_t queueDepth);
+    void ShutdownIoUring();
+    bool SubmitIoUring(FileRead* read);
+    void ReapCompletions();
+
+    void StartReaderThreads();
+    void ReaderThreadLoop();
+    static void ReadBlocking(FileRead& read);
+};
+}
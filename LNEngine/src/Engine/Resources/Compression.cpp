@@ -0,0 +1,207 @@
+#include "Compression.h"
+
+namespace lne::LZ4
+{
+namespace
+{
+constexpr size_t s_MinMatch = 4;
+// the last 5 bytes are always literals and the last match starts at least 12 bytes before the end
+constexpr size_t s_LastLiterals = 5;
+constexpr size_t s_MatchFindLimit = 12;
+constexpr size_t s_MaxOffset = 65535;
+constexpr uint32_t s_HashLog = 16;
+
+uint32_t Read32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(uint32_t));
+    return value;
+}
+
+uint32_t Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - s_HashLog);
+}
+
+// writes the 255 continuation bytes of a length that didn't fit in its token nibble
+bool WriteLength(size_t length, uint8_t* dst, size_t& op, size_t dstCapacity)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (op >= dstCapacity)
+            return false;
+        dst[op++] = 255;
+    }
+    if (op >= dstCapacity)
+        return false;
+    dst[op++] = (uint8_t)length;
+    return true;
+}
+
+bool WriteSequence(const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, uint8_t* dst, size_t& op, size_t dstCapacity)
+{
+    if (op >= dstCapacity)
+        return false;
+
+    size_t tokenPos = op++;
+    uint8_t token = (uint8_t)(std::min<size_t>(literalCount, 15) << 4);
+    if (literalCount >= 15 && WriteLength(literalCount - 15, dst, op, dstCapacity) == false)
+        return false;
+
+    if (op + literalCount > dstCapacity)
+        return false;
+    memcpy(dst + op, literals, literalCount);
+    op += literalCount;
+
+    // the last sequence only has literals
+    if (matchLength != 0)
+    {
+        if (op + 2 > dstCapacity)
+            return false;
+        dst[op++] = (uint8_t)(offset & 0xFF);
+        dst[op++] = (uint8_t)(offset >> 8);
+
+        size_t length = matchLength - s_MinMatch;
+        token |= (uint8_t)std::min<size_t>(length, 15);
+        if (length >= 15 && WriteLength(length - 15, dst, op, dstCapacity) == false)
+            return false;
+    }
+
+    dst[tokenPos] = token;
+    return true;
+}
+
+bool ReadLength(const uint8_t* src, size_t srcSize, size_t& ip, size_t& length)
+{
+    uint8_t value;
+    do
+    {
+        if (ip >= srcSize)
+            return false;
+        value = src[ip++];
+        length += value;
+    } while (value == 255);
+    return true;
+}
+}
+
+size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+    size_t op = 0;
+    size_t anchor = 0;
+
+    if (srcSize > s_MatchFindLimit)
+    {
+        std::vector<uint32_t> table(1u << s_HashLog, 0);
+        size_t matchLimit = srcSize - s_LastLiterals;
+        size_t ip = 0;
+
+        while (ip + s_MatchFindLimit <= srcSize)
+        {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t hash = Hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t)ip;
+
+            if (candidate >= ip || ip - candidate > s_MaxOffset || Read32(src + candidate) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            size_t matchLength = s_MinMatch;
+            while (ip + matchLength < matchLimit && src[candidate + matchLength] == src[ip + matchLength])
+                ++matchLength;
+
+            if (WriteSequence(src + anchor, ip - anchor, ip - candidate, matchLength, dst, op, dstCapacity) == false)
+                return 0;
+
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    if (WriteSequence(src + anchor, srcSize - anchor, 0, 0, dst, op, dstCapacity) == false)
+        return 0;
+    return op;
+}
+
+namespace
+{
+// with prefix, stops once dst is full instead of failing on the sequences that don't fit
+bool DecodeBlock(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize, bool prefix)
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < srcSize)
+    {
+        uint8_t token = src[ip++];
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && ReadLength(src, srcSize, ip, literalCount) == false)
+            return false;
+        if (literalCount > srcSize - ip)
+            return false;
+        if (literalCount > dstSize - op)
+        {
+            if (prefix == false)
+                return false;
+            memcpy(dst + op, src + ip, dstSize - op);
+            return true;
+        }
+        memcpy(dst + op, src + ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        // the last sequence ends after its literals
+        if (ip == srcSize || (prefix && op == dstSize))
+            break;
+
+        if (srcSize - ip < 2)
+            return false;
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && ReadLength(src, srcSize, ip, matchLength) == false)
+            return false;
+        matchLength += s_MinMatch;
+        if (matchLength > dstSize - op)
+        {
+            if (prefix == false)
+                return false;
+            matchLength = dstSize - op;
+        }
+
+        // the match can overlap the bytes it produces, copy forward
+        const uint8_t* match = dst + op - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(dst + op, match, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+                dst[op + i] = match[i];
+        }
+        op += matchLength;
+        if (prefix && op == dstSize)
+            break;
+    }
+    return op == dstSize;
+}
+}
+
+bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    return DecodeBlock(src, srcSize, dst, dstSize, false);
+}
+
+bool DecompressPrefix(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    return DecodeBlock(src, srcSize, dst, dstSize, true);
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace lne
+{
+enum class ECompression : uint32_t
+{
+    eNone,
+    eLZ4,
+    // reserved, the engine doesn't ship a zstd codec yet
+    eZstd,
+};
+
+/// <summary>
+/// LZ4 block format codec (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+/// The compressor is a single pass greedy one, it favors a simple implementation over ratio; the decoder is the part that runs at load time.
+/// </summary>
+namespace LZ4
+{
+[[nodiscard]] constexpr size_t GetCompressBound(size_t size) { return size + size / 255 + 16; }
+
+/// <summary>
+/// Returns the compressed size, 0 if it doesn't fit in dstCapacity.
+/// </summary>
+size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+/// <summary>
+/// Decodes a block whose decompressed size is known. Fails on malformed input instead of reading or writing out of bounds.
+/// </summary>
+[[nodiscard]] bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+/// <summary>
+/// Decodes only the first dstSize bytes of a block, the sequences past them aren't read.
+/// </summary>
+[[nodiscard]] bool DecompressPrefix(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
+}
@@ -0,0 +1,84 @@
+#include "FileWatcher.h"
+
+namespace lne
+{
+FileWatcher::FileWatcher(std::chrono::milliseconds interval)
+    : m_Interval(interval)
+{
+}
+
+void FileWatcher::Watch(const std::string& key, const std::vector<std::filesystem::path>& files, uint32_t tag)
+{
+    WatchedGroup group;
+    group.Tag = tag;
+    for (const auto& path : files)
+    {
+        FileState state{ path };
+        // packed or missing, there is nothing on disk to watch
+        if (UpdateState(state))
+            group.Files.push_back(std::move(state));
+    }
+    if (group.Files.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Groups.try_emplace(key, std::move(group));
+}
+
+void FileWatcher::Unwatch(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Groups.erase(key);
+}
+
+std::vector<FileWatcher::Change> FileWatcher::Poll(const std::function<bool(const std::string&)>& isAlive)
+{
+    std::vector<Change> changes;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_LastPoll < m_Interval)
+        return changes;
+    m_LastPoll = now;
+
+    std::erase_if(m_Groups, [&](const auto& group) { return isAlive(group.first) == false; });
+    for (auto& [key, group] : m_Groups)
+    {
+        bool changed = false;
+        for (auto& file : group.Files)
+            changed |= UpdateState(file);
+
+        // still being written, wait for it to settle
+        if (changed)
+        {
+            group.IsChanging = true;
+            continue;
+        }
+        if (group.IsChanging)
+        {
+            group.IsChanging = false;
+            Change change{ key, group.Tag };
+            for (const auto& file : group.Files)
+                change.Files.push_back(file.Path);
+            changes.push_back(std::move(change));
+        }
+    }
+    return changes;
+}
+
+bool FileWatcher::UpdateState(FileState& state)
+{
+    std::error_code error;
+    auto writeTime = std::filesystem::last_write_time(state.Path, error);
+    // deleted, or replaced at this very moment: keep the previous stamp until it is back
+    if (error)
+        return false;
+    uint64_t size = std::filesystem::file_size(state.Path, error);
+    if (error)
+        return false;
+
+    bool changed = writeTime != state.WriteTime || size != state.Size;
+    state.WriteTime = writeTime;
+    state.Size = size;
+    return changed;
+}
+}
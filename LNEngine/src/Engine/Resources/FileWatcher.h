@@ -0,0 +1,64 @@
+#pragma once
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+/// <summary>
+/// Watches groups of files on disk, each group identified by a key and tagged with a caller supplied value.
+/// The write times and sizes are polled rather than relying on OS notifications: it behaves the same on every platform
+/// and with editors that save to a temporary file and rename it. A change is only reported once the files stopped changing
+/// for a whole interval, so that a file is never read while it is still being written. Thread safe.
+/// </summary>
+class FileWatcher
+{
+public:
+    struct Change
+    {
+        std::string Key;
+        uint32_t Tag;
+        std::vector<std::filesystem::path> Files;
+    };
+
+    MOVABLE_ONLY(FileWatcher);
+    explicit FileWatcher(std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+
+    /// <summary>
+    /// Starts watching the files under the key. Does nothing if the key is already watched, files that don't exist on disk are skipped.
+    /// </summary>
+    void Watch(const std::string& key, const std::vector<std::filesystem::path>& files, uint32_t tag = 0);
+    void Unwatch(const std::string& key);
+
+    /// <summary>
+    /// Returns the groups with a file that changed since the previous poll. Returns nothing until the interval has elapsed.
+    /// The groups whose key isAlive rejects are dropped without being polled.
+    /// </summary>
+    [[nodiscard]] std::vector<Change> Poll(const std::function<bool(const std::string&)>& isAlive);
+
+private:
+    struct FileState
+    {
+        std::filesystem::path Path;
+        std::filesystem::file_time_type WriteTime{};
+        uint64_t Size{};
+    };
+
+    struct WatchedGroup
+    {
+        std::vector<FileState> Files;
+        uint32_t Tag{};
+        // a change was seen by the previous poll, it is reported if the files are the same at the next one
+        bool IsChanging{ false };
+    };
+
+    std::unordered_map<std::string, WatchedGroup> m_Groups;
+    std::mutex m_Mutex;
+    std::chrono::milliseconds m_Interval;
+    std::chrono::steady_clock::time_point m_LastPoll{};
+
+private:
+    /// <summary>
+    /// Reads the current stamp of the file, returns true if it differs from the stored one.
+    /// </summary>
+    static bool UpdateState(FileState& state);
+};
+}
@@ -1,6 +1,5 @@
 #include <enkiTS/src/TaskScheduler.h>
 #include <stb/stb_image.h>
-#include <assimp/Importer.hpp>
 
 #include "Core/Utils/Log.h"
 #include "Graphics/Texture.h"
@@ -9,16 +8,80 @@
 #include "Graphics/CommandBufferManager.h"
 #include "Graphics/Renderer.h"
 #include "Graphics/DynamicDescriptorAllocator.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/SinglePassDownsampler.h"
 
+#include "TextureFile.h"
+#include "AssetManifest.h"
+#include "AssetRegistry.h"
+#include "AsyncFileReader.h"
+#include "VirtualFileSystem.h"
+#include "MipGenerator.h"
 #include "GfxLoader.h"
 
 namespace lne
 {
+namespace
+{
+constexpr uint64_t s_StagingBufferSize = 64 * 1024 * 1024;
+// mips up to this size are loaded with the texture, the finer ones are streamed on demand
+constexpr uint32_t s_MipTailSize = 128;
+// loads whose file reads are in flight at the same time
+constexpr uint32_t s_MaxPendingLoads = 16;
+// mips smaller than this are downsampled on the loader thread alone
+constexpr uint64_t s_MinParallelMipTexels = 64 * 1024;
+// reloads are waited for by whoever edited the file, they go before the streaming requests
+constexpr float s_ReloadPriority = std::numeric_limits<float>::max();
+// bytes of a compressed packed image decoded to read its header, a JPEG can have larger metadata before its frame header
+constexpr uint64_t s_ImageHeaderSize = 64 * 1024;
+
+// reads the image header from the pack or from the loose file, on the main thread: only the first bytes are read
+bool GetImageInfo(const std::string& path, int& width, int& height, int& channels)
+{
+    auto& vfs = VirtualFileSystem::Get();
+    if (vfs.IsPacked(path) == false)
+        return stbi_info(path.c_str(), &width, &height, &channels) != 0;
+
+    // used in place, stb only touches the pages of the header
+    uint64_t size = 0;
+    if (const uint8_t* data = vfs.Map(path, size))
+        return stbi_info_from_memory(data, (int)size, &width, &height, &channels) != 0;
+
+    uint64_t fileSize = vfs.GetFileSize(path);
+    SafePtr<FileRead> file = vfs.Read(path, 0, std::min(fileSize, s_ImageHeaderSize));
+    if (file->Wait() && stbi_info_from_memory(file->GetData(), (int)file->GetSize(), &width, &height, &channels) != 0)
+        return true;
+    if (fileSize <= s_ImageHeaderSize)
+        return false;
+
+    file = vfs.Read(path);
+    return file->Wait() && stbi_info_from_memory(file->GetData(), (int)file->GetSize(), &width, &height, &channels) != 0;
+}
+
+template<typename Request>
+const RefCountBase* GetRequestAsset(const Request& request)
+{
+    if (request.Mesh)
+        return request.Mesh.GetPtr();
+    return request.Texture.GetPtr();
+}
+
+template<typename Request>
+bool IsOrphaned(const Request& request)
+{
+    // the request holds one reference, streamed textures are also held by m_StreamedTextures
+    uint32_t loaderReferences = request.Type == ResourceTypes::eTextureMips ? 2 : 1;
+    return GetRequestAsset(request)->GetCount() <= loaderReferences;
+}
+}
+
 namespace ResourceTypes
 {
-const char* enumValues[2] = {
+const char* enumValues[4] = {
     "Texture",
     "Cubemap",
+    "TextureMips",
+    "StaticMesh",
 };
 
 const char** s_Enum = enumValues;
@@ -34,19 +97,19 @@ void GfxLoaderTask::Execute()
         Loader->Update();
 }
 
+// defined here for the unique_ptr of the forward declared classes
+GfxLoader::~GfxLoader() = default;
+
 void GfxLoader::Init(Renderer* renderer, SafePtr<class GfxContext> context, std::shared_ptr<enki::TaskScheduler> scheduler)
 {
     m_Renderer = renderer;
     m_GraphicsContext = context;
     m_TaskScheduler = scheduler;
 
-    m_LoadRequests.reserve(32);
-    m_GPUUploadRequests.reserve(32);
-
     // allocate common staging buffer of 64MB
     vk::BufferCreateInfo bufferCI{
         {},
-        64 * 1024 * 1024,
+        s_StagingBufferSize,
         vk::BufferUsageFlagBits::eTransferSrc,
         vk::SharingMode::eExclusive,
     };
@@ -59,6 +122,9 @@ void GfxLoader::Init(Renderer* renderer, SafePtr<class GfxContext> context, std:
 
     m_GraphicsContext->AllocateBuffer(m_StagingBuffer, bufferCI, allocCI);
 
+    m_Downsampler.reset(lnnew SinglePassDownsampler(m_GraphicsContext));
+    m_ComputeCommandBufferManager.reset(lnnew CommandBufferManager(m_GraphicsContext.GetPtr(), 1, EQueueFamilyType::Compute));
+
     vk::SemaphoreCreateInfo semaphoreCI{};
     m_TransferSemaphore = m_GraphicsContext->GetDevice().createSemaphore(semaphoreCI);
 
@@ -71,51 +137,136 @@ void GfxLoader::Nuke()
 {
     m_GraphicsContext->FreeBuffer(m_StagingBuffer);
     m_GraphicsContext->GetDevice().destroySemaphore(m_TransferSemaphore);
-    m_LoadRequests.clear();
-    m_GPUUploadRequests.clear();
+    m_ComputeCommandBufferManager->WaitForFence(0);
+    m_ComputeMipsToGenerate.clear();
+    m_ComputeMipsInFlight.clear();
+    m_ComputeCommandBufferManager.reset();
+    m_Downsampler.reset();
+    m_LoadRequests.Clear();
+    m_GPUUploadRequests.Clear();
+    m_ReadyUploads.clear();
+    m_PendingLoads.clear();
+    m_StreamedTextures.clear();
+    for (auto& reload : m_PendingTextureReloads)
+        m_GraphicsContext->FreeBuffer(reload.Staging);
+    m_PendingTextureReloads.clear();
 }
 
 void GfxLoader::Update()
 {
-    if (m_ReadyTexture)
-    {
-        m_Renderer->AddTextureToUpdate(m_ReadyTexture);
-        m_ReadyTexture.Reset();
-    }
+    FlushReadyUploads();
+    FlushComputeMips();
+    FlushTextureReloads();
+    UpdateStreaming();
+    PollHotReload();
 
     ProcessLoadRequests();
     ProcessUploadRequests();
 }
 
-SafePtr<Texture> GfxLoader::CreateTexture(std::string_view fullPath)
+SafePtr<Texture> GfxLoader::CreateTexture(std::string_view fullPath, float priority)
+{
+    std::string key = AssetRegistry::MakeKey(fullPath, "Texture2D");
+    SafePtr<Texture> texture = AssetRegistry::Get().GetOrCreate<Texture>(key, [&]()
+    {
+        if (TextureFile::IsTextureFile(fullPath))
+            return CreateStreamedTexture(fullPath, priority);
+        std::filesystem::path cookedPath = AssetManifest::Get().GetCookedPath(fullPath);
+        if (cookedPath.empty() == false)
+            return CreateStreamedTexture(cookedPath, priority);
+        return CreateTexture2D(fullPath, priority);
+    });
+    // a cooked file has no source to decode again
+    if (texture && TextureFile::IsTextureFile(fullPath) == false)
+        Watch(key, ResourceTypes::eTexture, { std::string(fullPath) });
+    return texture;
+}
+
+SafePtr<Texture> GfxLoader::CreateTexture2D(std::string_view fullPath, float priority)
 {
     int texWidth, texHeight, texChannels;
-    if (stbi_info(fullPath.data(), &texWidth, &texHeight, &texChannels) == 0)
+    if (GetImageInfo(std::string(fullPath), texWidth, texHeight, texChannels) == false)
     {
         LNE_ERROR("Failed to load texture: {0}", fullPath);
         return SafePtr<Texture>();
     }
-    stbi_info(fullPath.data(), &texWidth, &texHeight, &texChannels);
 
     std::filesystem::path fsFullPath = fullPath;
     // TODO: change mipmap gen to true when I'll implement the mipmap gen on the renderer side
-    SafePtr<Texture> texture = Texture::CreateColorTexture2D(m_GraphicsContext, texWidth, texHeight, true, std::format("Texture: {}", fsFullPath.filename().string()));
+    bool hostCopy = m_GraphicsContext->SupportsHostImageCopy(vk::Format::eR8G8B8A8Srgb);
+    SafePtr<Texture> texture = Texture::CreateColorTexture2D(m_GraphicsContext, texWidth, texHeight, true, std::format("Texture: {}", fsFullPath.filename().string()),
+        hostCopy == false && m_MipGeneration == EMipGeneration::eGpuCompute && m_Downsampler->IsValid(), hostCopy);
+    // sample the default texture until the upload is done
+    texture->MarkNonResident();
 
     LoadRequest request;
     request.Type = ResourceTypes::eTexture;
     request.IsFile = true;
     request.Path.push_back(fullPath.data());
     request.Texture = texture;
+    request.Priority = priority;
+    PushLoadRequest(request);
+
+    return texture;
+}
+
+SafePtr<Texture> GfxLoader::CreateStreamedTexture(const std::filesystem::path& fullPath, float priority)
+{
+    TextureFileHeader header{};
+    std::vector<TextureFileMip> mips;
+    if (TextureFile::ReadHeader(fullPath, header, mips) == false)
+        return SafePtr<Texture>();
+
+    SafePtr<Texture> texture = Texture::CreateStreamedTexture2D(m_GraphicsContext, header.Width, header.Height, header.MipCount,
+        (vk::Format)header.Format, std::format("Texture: {}", fullPath.filename().string()));
+
+    uint32_t mipLevels = texture->GetMipLevels();
+    uint32_t tailMip = 0;
+    while (tailMip < mipLevels - 1 && std::max(mips[tailMip].Width, mips[tailMip].Height) > s_MipTailSize)
+        ++tailMip;
+
+    LoadRequest request;
+    request.Type = ResourceTypes::eTextureMips;
+    request.IsFile = true;
+    request.Path.push_back(fullPath.string());
+    request.Texture = texture;
+    request.FirstMip = tailMip;
+    request.MipCount = mipLevels - tailMip;
+    request.Priority = priority;
 
+    // registered first, the request would be dropped as orphaned otherwise
     {
-        std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
-        m_LoadRequests.push_back(request);
+        std::lock_guard<std::mutex> lock(m_StreamedTexturesMutex);
+        m_StreamedTextures.push_back({ texture, fullPath.string(), tailMip, priority });
     }
+    PushLoadRequest(request);
 
     return texture;
 }
 
-SafePtr<Texture> GfxLoader::CreateCubemap(std::vector<std::string> faces)
+void GfxLoader::LoadStaticMesh(SafePtr<StaticMesh> mesh, float priority)
+{
+    LoadRequest request;
+    request.Type = ResourceTypes::eStaticMesh;
+    request.IsFile = true;
+    request.Mesh = mesh;
+    request.Priority = priority;
+    PushLoadRequest(request);
+}
+
+void GfxLoader::SetPriority(const RefCountBase* asset, float priority)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
+        m_LoadRequests.SetPriority(asset, priority);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
+        m_GPUUploadRequests.SetPriority(asset, priority);
+    }
+}
+
+SafePtr<Texture> GfxLoader::CreateCubemap(std::vector<std::string> faces, float priority)
 {
     if (faces.size() != 6)
     {
@@ -123,19 +274,55 @@ SafePtr<Texture> GfxLoader::CreateCubemap(std::vector<std::string> faces)
         return SafePtr<Texture>();
     }
 
+    std::string key;
+    for (const auto& face : faces)
+        key += AssetRegistry::MakeKey(face) + ';';
+    key += "Cubemap";
+
+    SafePtr<Texture> texture = AssetRegistry::Get().GetOrCreate<Texture>(key, [&]() { return CreateCubemapTexture(faces, priority); });
+    if (texture)
+        Watch(key, ResourceTypes::eCubemap, faces);
+    return texture;
+}
+
+void GfxLoader::Watch(const std::string& key, ResourceTypes::Enum type, const std::vector<std::string>& paths)
+{
+    if (m_HotReload == false)
+        return;
+
+    auto& manifest = AssetManifest::Get();
+    std::vector<std::filesystem::path> files;
+    for (const auto& path : paths)
+    {
+        files.emplace_back(path);
+        if (type != ResourceTypes::eStaticMesh)
+            continue;
+        // the files the last cook read besides the source
+        if (const AssetManifestEntry* entry = manifest.Find(path))
+        {
+            for (const auto& dependency : entry->Dependencies)
+                files.push_back(manifest.GetRoot() / dependency.Path);
+        }
+    }
+    m_FileWatcher.Watch(key, files, type);
+}
+
+SafePtr<Texture> GfxLoader::CreateCubemapTexture(std::vector<std::string> faces, float priority)
+{
+
     int texWidth{}, texHeight{}, texChannels{};
     bool first = true;
 
     for (const auto& face : faces)
     {
-        if (std::filesystem::exists(face) == false)
+        if (VirtualFileSystem::Get().Exists(face) == false)
         {
             LNE_ERROR("Cubemap face not found: {0}", face);
             return SafePtr<Texture>();
         }
         int width, height, channels;
 
-        if (stbi_info(face.c_str(), &width, &height, &channels) == 0)
+        if (GetImageInfo(face, width, height, channels) == false)
         {
             LNE_ERROR("Failed to get info from cubemap face: {0}. The file format isn't supported", face);
             return SafePtr<Texture>();
@@ -158,19 +345,20 @@ SafePtr<Texture> GfxLoader::CreateCubemap(std::vector<std::string> faces)
     texChannels = 4;
 
     std::filesystem::path fsFullPath = faces[0];
+    bool hostCopy = m_GraphicsContext->SupportsHostImageCopy(vk::Format::eR8G8B8A8Srgb);
     SafePtr<Texture> texture = Texture::CreateCubemapTexture(m_GraphicsContext, texWidth, texHeight, true,
-        std::format("Texture: {}", fsFullPath.parent_path().filename().string()));
+        std::format("Texture: {}", fsFullPath.parent_path().filename().string()),
+        hostCopy == false && m_MipGeneration == EMipGeneration::eGpuCompute && m_Downsampler->IsValid(), hostCopy);
+    // sample the default texture until the upload is done, the coroutines awaiting it wait for it too
+    texture->MarkNonResident();
 
     LoadRequest request;
     request.Type = ResourceTypes::eCubemap;
     request.IsFile = true;
     request.Path = std::move(faces);
     request.Texture = texture;
-
-    {
-        std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
-        m_LoadRequests.push_back(request);
-    }
+    request.Priority = priority;
+    PushLoadRequest(request);
 
     return texture;
 }
@@ -180,31 +368,31 @@ void GfxLoader::ProcessUploadRequests()
     auto& cbManager = m_GraphicsContext->GetTransferCommandBufferManager();
     auto device = m_GraphicsContext->GetDevice();
 
-    if (m_GPUUploadRequests.empty())
-        return;
     if (cbManager.GetFenceStatus(0) == false)
         return;
 
-    cbManager.StartCommandBuffer(0);
-
     UploadRequest request;
-    {
-        std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
-        request = m_GPUUploadRequests.back();
-        m_GPUUploadRequests.pop_back();
-    }
+    if (PopUploadRequest(request) == false)
+        return;
+
+    cbManager.StartCommandBuffer(0);
 
     switch (request.Type)
     {
     case ResourceTypes::eTexture:
+    case ResourceTypes::eCubemap:
     {
         UploadTexture(request);
-        m_ReadyTexture = request.Texture;
         break;
     }
-    case ResourceTypes::eCubemap:
+    case ResourceTypes::eTextureMips:
     {
-        UploadTexture(request);
+        UploadTextureMips(request);
+        break;
+    }
+    case ResourceTypes::eStaticMesh:
+    {
+        UploadStaticMesh(request);
         break;
     }
     default:
@@ -216,79 +404,215 @@ void GfxLoader::ProcessUploadRequests()
     submitInfo.pWaitDstStageMask = &waitDst;
     submitInfo.pWaitSemaphores = &m_TransferSemaphore;
     cbManager.Submit(submitInfo);
+
+    request.Data = nullptr;
+    m_ReadyUploads.push_back(std::move(request));
 }
 
 void GfxLoader::ProcessLoadRequests()
 {
-    if (m_LoadRequests.empty())
-        return;
-
+    // several loads are kept in flight so that decoding the ones that are read overlaps with the I/O of the others
     LoadRequest request;
+    while (m_PendingLoads.size() < s_MaxPendingLoads && PopLoadRequest(request))
+        StartLoad(request);
+
+    for (size_t i = 0; i < m_PendingLoads.size();)
     {
-        std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
-        request = m_LoadRequests.back();
-        m_LoadRequests.pop_back();
+        auto& reads = m_PendingLoads[i].Reads;
+        if (std::any_of(reads.begin(), reads.end(), [](const SafePtr<FileRead>& read) { return read->IsDone() == false; }))
+        {
+            ++i;
+            continue;
+        }
+
+        PendingLoad load = std::move(m_PendingLoads[i]);
+        m_PendingLoads.erase(m_PendingLoads.begin() + i);
+
+        if (load.Request.IsReload)
+        {
+            if (load.Request.Type == ResourceTypes::eStaticMesh)
+                ReloadStaticMesh(load.Request);
+            else
+                ReloadTexture(load);
+            continue;
+        }
+
+        switch (load.Request.Type)
+        {
+        case ResourceTypes::eTexture:
+        {
+            LoadTexture(load);
+            break;
+        }
+        case ResourceTypes::eCubemap:
+        {
+            LoadCubemap(load);
+            break;
+        }
+        case ResourceTypes::eTextureMips:
+        {
+            LoadTextureMips(load);
+            break;
+        }
+        case ResourceTypes::eStaticMesh:
+        {
+            LoadStaticMeshData(load.Request);
+            break;
+        }
+        default:
+            LNE_ERROR("Doesn't support type {0} yet.", ResourceTypes::ToString(load.Request.Type));
+            break;
+        }
     }
+}
 
+void GfxLoader::StartLoad(LoadRequest& request)
+{
+    PendingLoad load;
     switch (request.Type)
     {
     case ResourceTypes::eTexture:
+    case ResourceTypes::eCubemap:
     {
-        LoadTexture(request);
+        for (const auto& path : request.Path)
+            load.Reads.push_back(VirtualFileSystem::Get().Read(path));
         break;
     }
-    case ResourceTypes::eCubemap:
+    case ResourceTypes::eTextureMips:
     {
-        LoadCubemap(request);
+        uint64_t offset{}, size{};
+        if (TextureFile::GetMipRange(request.Path[0], request.FirstMip, request.MipCount, load.MipRegions, offset, size) == false)
+        {
+            request.Texture->MarkLoadFailed();
+            return;
+        }
+        if (size > s_StagingBufferSize)
+        {
+            LNE_ERROR("Mips [{0}, {1}) of {2} don't fit in the staging buffer", request.FirstMip, request.FirstMip + request.MipCount, request.Path[0]);
+            request.Texture->MarkLoadFailed();
+            return;
+        }
+        load.Reads.push_back(VirtualFileSystem::Get().Read(request.Path[0], offset, size));
         break;
     }
     default:
-        LNE_ERROR("Doesn't support type {0} yet.", ResourceTypes::ToString(request.Type));
+        // meshes are memory mapped, there is nothing to read ahead
         break;
     }
+    load.Request = std::move(request);
+    m_PendingLoads.push_back(std::move(load));
 }
 
-void GfxLoader::LoadTexture(LoadRequest& request)
+void GfxLoader::PushLoadRequest(const LoadRequest& request)
 {
-    auto& path = request.Path[0];
-    int texWidth, texHeight, texChannels;
-    Assimp::Importer importer;
-    uint8_t* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
+    m_LoadRequests.Push(request, request.Priority, GetRequestAsset(request));
+}
+
+void GfxLoader::PushUploadRequest(const UploadRequest& request)
+{
+    std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
+    m_GPUUploadRequests.Push(request, request.Priority, GetRequestAsset(request));
+}
+
+bool GfxLoader::PopLoadRequest(LoadRequest& request)
+{
+    std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
+    while (m_LoadRequests.Pop(request))
+    {
+        if (IsOrphaned(request) == false)
+            return true;
+
+        LNE_TRACE("Dropping {0} load request, the asset isn't used anymore", ResourceTypes::ToString(request.Type));
+    }
+    return false;
+}
+
+bool GfxLoader::PopUploadRequest(UploadRequest& request)
+{
+    std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
+    while (m_GPUUploadRequests.Pop(request))
+    {
+        if (IsOrphaned(request) == false)
+            return true;
+
+        LNE_TRACE("Dropping {0} upload request, the asset isn't used anymore", ResourceTypes::ToString(request.Type));
+        FreeUploadData(request);
+    }
+    return false;
+}
+
+void GfxLoader::LoadTexture(PendingLoad& load)
+{
+    auto& request = load.Request;
+    auto& file = load.Reads[0];
+    if (file->Succeeded() == false)
+    {
+        request.Texture->MarkLoadFailed();
+        return;
+    }
 
+    int texWidth, texHeight, texChannels;
+    uint8_t* pixels = stbi_load_from_memory(file->GetData(), (int)file->GetSize(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     if (!pixels)
-        LNE_ERROR("Failed to load texture image: {0}", path);
+    {
+        LNE_ERROR("Failed to load texture image: {0}", request.Path[0]);
+        request.Texture->MarkLoadFailed();
+        return;
+    }
 
     UploadRequest gpuRequest;
     gpuRequest.Type = request.Type;
     gpuRequest.Texture = request.Texture;
     gpuRequest.Data = pixels;
     gpuRequest.Size = texWidth * texHeight * 4;
+    gpuRequest.Priority = request.Priority;
 
+    uint32_t mipCount = GetLoaderMipCount(*request.Texture);
+    if (mipCount > 1)
     {
-        std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
-        m_GPUUploadRequests.push_back(gpuRequest);
+        uint64_t chainSize = MipGenerator::GetChainSize(texWidth, texHeight, mipCount);
+        uint8_t* chain = lnnew uint8_t[chainSize];
+        memcpy(chain, pixels, gpuRequest.Size);
+        stbi_image_free(pixels);
+        GenerateMips(chain, texWidth, texHeight, 1, mipCount, request.Texture->GetFormat() == vk::Format::eR8G8B8A8Srgb);
+
+        gpuRequest.Data = chain;
+        gpuRequest.Size = (uint32_t)chainSize;
+        gpuRequest.MipCount = mipCount;
     }
+    if (request.Texture->HasHostCopy())
+        CopyTextureFromHost(gpuRequest);
+    else
+        PushUploadRequest(gpuRequest);
 }
 
-void GfxLoader::LoadCubemap(LoadRequest& request)
+void GfxLoader::LoadCubemap(PendingLoad& load)
 {
-    auto& facesPaths = request.Path;
+    auto& request = load.Request;
+    uint8_t* allPixels = nullptr;
     int texWidth{}, texHeight{}, texChannels{};
-    stbi_info(facesPaths[0].c_str(), &texWidth, &texHeight, &texChannels);
-
-    uint8_t* allPixels = lnnew uint8_t[texWidth * texHeight * 4 * 6];
+    uint32_t mipCount = GetLoaderMipCount(*request.Texture);
 
     for (uint32_t i = 0; i < 6; ++i)
     {
-        uint8_t* pixels = stbi_load(facesPaths[i].c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        auto& file = load.Reads[i];
+        uint8_t* pixels = file->Succeeded() ?
+            stbi_load_from_memory(file->GetData(), (int)file->GetSize(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha) : nullptr;
         if (!pixels)
         {
             LNE_ERROR("Failed to load cubemap face: {0}", request.Path[i]);
             delete[] allPixels;
+            request.Texture->MarkLoadFailed();
             return;
         }
-        memcpy(allPixels + (texWidth * texHeight * texChannels * i), pixels, texWidth * texHeight * texChannels);
+        // the faces have been checked to have the same dimensions when the texture was created
+        if (allPixels == nullptr)
+            allPixels = lnnew uint8_t[MipGenerator::GetChainSize(texWidth, texHeight, std::max(mipCount, 1u), 6)];
+        memcpy(allPixels + (texWidth * texHeight * 4 * i), pixels, texWidth * texHeight * 4);
         stbi_image_free(pixels);
+        // the encoded face isn't needed anymore, give its buffer back to the pool
+        file.Reset();
     }
 
     UploadRequest gpuRequest;
@@ -296,11 +620,247 @@ void GfxLoader::LoadCubemap(LoadRequest& request)
     gpuRequest.Texture = request.Texture;
     gpuRequest.Data = allPixels;
     gpuRequest.Size = texWidth * texHeight * 4 * 6;
+    gpuRequest.Priority = request.Priority;
+    if (mipCount > 1)
+    {
+        GenerateMips(allPixels, texWidth, texHeight, 6, mipCount, request.Texture->GetFormat() == vk::Format::eR8G8B8A8Srgb);
+        gpuRequest.Size = (uint32_t)MipGenerator::GetChainSize(texWidth, texHeight, mipCount, 6);
+        gpuRequest.MipCount = mipCount;
+    }
+    if (request.Texture->HasHostCopy())
+        CopyTextureFromHost(gpuRequest);
+    else
+        PushUploadRequest(gpuRequest);
+}
+
+void GfxLoader::LoadTextureMips(PendingLoad& load)
+{
+    auto& request = load.Request;
+    auto& file = load.Reads[0];
+    if (file->Succeeded() == false)
+    {
+        request.Texture->MarkLoadFailed();
+        return;
+    }
 
+    // the mips are stored as they are uploaded, the read buffer goes straight to the staging buffer
+    UploadRequest gpuRequest;
+    gpuRequest.Type = request.Type;
+    gpuRequest.Texture = request.Texture;
+    gpuRequest.FirstMip = request.FirstMip;
+    gpuRequest.MipCount = request.MipCount;
+    gpuRequest.Priority = request.Priority;
+    gpuRequest.MipRegions = std::move(load.MipRegions);
+    gpuRequest.Data = (void*)file->GetData();
+    gpuRequest.Size = (uint32_t)file->GetSize();
+    gpuRequest.File = file;
+    PushUploadRequest(gpuRequest);
+}
+
+void GfxLoader::LoadStaticMeshData(LoadRequest& request)
+{
+    auto& mesh = request.Mesh;
+    if (mesh->LoadFile() == false)
+    {
+        mesh->MarkLoadFailed();
+        return;
+    }
+
+    if (mesh->AllocateGeometry() == false)
+    {
+        mesh->MarkLoadFailed();
+        return;
+    }
+    // unified memory and ReBAR, the mapped file is copied straight into the buffers
+    if (mesh->WriteGeometry())
+    {
+        m_Renderer->AddStaticMeshToUpdate(mesh);
+        return;
+    }
+
+    uint64_t size = mesh->GetGeometryUploadSize();
+    if (size > s_StagingBufferSize)
+    {
+        LNE_ERROR("Geometry of {0} doesn't fit in the staging buffer", mesh->m_Path.string());
+        mesh->MarkLoadFailed();
+        return;
+    }
+
+    UploadRequest gpuRequest;
+    gpuRequest.Type = request.Type;
+    gpuRequest.Mesh = mesh;
+    gpuRequest.Size = (uint32_t)size;
+    gpuRequest.Priority = request.Priority;
+    PushUploadRequest(gpuRequest);
+}
+
+void GfxLoader::ReloadTexture(PendingLoad& load)
+{
+    auto& request = load.Request;
+    Texture* texture = request.Texture.GetPtr();
+    uint32_t layerCount = (uint32_t)load.Reads.size();
+    if (layerCount != texture->GetNumLayers())
+    {
+        LNE_ERROR("Can't reload {0}, some of its files aren't on disk", texture->GetName());
+        return;
+    }
+
+    // decoded from the source whatever the texture was loaded from, the mips are always built here
+    uint32_t width{}, height{}, mipCount{};
+    std::vector<uint8_t> chain;
+    for (uint32_t layer = 0; layer < layerCount; ++layer)
+    {
+        auto& file = load.Reads[layer];
+        int texWidth{}, texHeight{}, texChannels{};
+        uint8_t* pixels = file->Succeeded() ?
+            stbi_load_from_memory(file->GetData(), (int)file->GetSize(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha) : nullptr;
+        if (!pixels)
+        {
+            LNE_ERROR("Failed to reload {0}, the previous content is kept", request.Path[layer]);
+            return;
+        }
+        if (layer == 0)
+        {
+            width = texWidth;
+            height = texHeight;
+            mipCount = texture->GetMipLevels() > 1 ? Texture::GetMaxMipLevels(width, height) : 1;
+            chain.resize(MipGenerator::GetChainSize(width, height, mipCount, layerCount));
+        }
+        else if ((uint32_t)texWidth != width || (uint32_t)texHeight != height)
+        {
+            LNE_ERROR("Failed to reload {0}, the cubemap faces have different dimensions", texture->GetName());
+            stbi_image_free(pixels);
+            return;
+        }
+        memcpy(chain.data() + (size_t)width * height * 4 * layer, pixels, (size_t)width * height * 4);
+        stbi_image_free(pixels);
+        file.Reset();
+    }
+
+    vk::Format format = texture->GetFormat() == vk::Format::eR8G8B8A8Unorm ? vk::Format::eR8G8B8A8Unorm : vk::Format::eR8G8B8A8Srgb;
+    GenerateMips(chain.data(), width, height, layerCount, mipCount, format == vk::Format::eR8G8B8A8Srgb);
+
+    TextureReload reload{ request.Texture };
+    reload.Staging = m_GraphicsContext->AllocateStagingBuffer(chain.size());
+    memcpy(reload.Staging.AllocationInfo.pMappedData, chain.data(), chain.size());
+    reload.Width = width;
+    reload.Height = height;
+    reload.MipCount = mipCount;
+    reload.Format = format;
+
+    // the reload replaces every mip, what is still queued for the old content would overwrite it
+    CancelTextureLoads(texture);
+    m_PendingTextureReloads.push_back(std::move(reload));
+}
+
+void GfxLoader::ReloadStaticMesh(LoadRequest& request)
+{
+    StaticMeshReload reload{ request.Mesh };
+    if (request.Mesh->PrepareReload(m_GraphicsContext, reload) == false)
+        return;
+    m_Renderer->AddStaticMeshReload(std::move(reload));
+}
+
+void GfxLoader::CancelTextureLoads(const Texture* texture)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_StreamedTexturesMutex);
+        std::erase_if(m_StreamedTextures, [texture](const StreamedTexture& streamed) { return streamed.Texture.GetPtr() == texture; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_LoadRequestsMutex);
+        m_LoadRequests.Extract(texture);
+    }
+    std::vector<UploadRequest> uploads;
     {
         std::lock_guard<std::mutex> lock(m_UploadRequestsMutex);
-        m_GPUUploadRequests.push_back(gpuRequest);
+        uploads = m_GPUUploadRequests.Extract(texture);
+    }
+    for (auto& upload : uploads)
+        FreeUploadData(upload);
+    std::erase_if(m_PendingLoads, [texture](const PendingLoad& load) { return load.Request.Texture.GetPtr() == texture; });
+}
+
+bool GfxLoader::IsTextureInFlight(const Texture* texture) const
+{
+    auto isTexture = [texture](const SafePtr<Texture>& other) { return other.GetPtr() == texture; };
+    return std::any_of(m_ReadyUploads.begin(), m_ReadyUploads.end(), [&](const UploadRequest& upload) { return isTexture(upload.Texture); })
+        || std::any_of(m_ComputeMipsToGenerate.begin(), m_ComputeMipsToGenerate.end(), isTexture)
+        || std::any_of(m_ComputeMipsInFlight.begin(), m_ComputeMipsInFlight.end(), isTexture);
+}
+
+uint32_t GfxLoader::GetLoaderMipCount(const Texture& texture) const
+{
+    // nothing is recorded on the GPU for the textures copied from the host, their whole chain is built here
+    if (texture.HasHostCopy())
+        return texture.GetMipLevels();
+
+    EMipGeneration mode = m_MipGeneration;
+    if ((mode != EMipGeneration::eCpuBox && mode != EMipGeneration::eCpuKaiser) || texture.ShouldGenerateMips() == false)
+        return 0;
+
+    vk::Extent3D extents = texture.GetDimensions();
+    if (MipGenerator::GetChainSize(extents.width, extents.height, texture.GetMipLevels(), texture.GetNumLayers()) > s_StagingBufferSize)
+    {
+        LNE_WARN("Mip chain of {0} doesn't fit in the staging buffer, its mips are blitted on the GPU", texture.GetName());
+        return 0;
     }
+    return texture.GetMipLevels();
+}
+
+void GfxLoader::GenerateMips(uint8_t* chain, uint32_t width, uint32_t height, uint32_t layerCount, uint32_t mipCount, bool isSrgb)
+{
+    EMipFilter filter = m_MipGeneration == EMipGeneration::eCpuKaiser ? EMipFilter::eKaiser : EMipFilter::eBox;
+    auto scheduler = m_TaskScheduler.lock();
+
+    // each mip is read from the previous one, the rows of a mip are independent
+    for (uint32_t mip = 1; mip < mipCount; ++mip)
+    {
+        uint32_t srcWidth = std::max(1u, width >> (mip - 1));
+        uint32_t srcHeight = std::max(1u, height >> (mip - 1));
+        uint32_t dstWidth = std::max(1u, width >> mip);
+        uint32_t dstHeight = std::max(1u, height >> mip);
+        const uint8_t* src = chain + MipGenerator::GetMipOffset(width, height, mip - 1, layerCount);
+        uint8_t* dst = chain + MipGenerator::GetMipOffset(width, height, mip, layerCount);
+        uint32_t rowCount = dstHeight * layerCount;
+
+        // the rows of every layer are numbered one after the other, a range can span several layers
+        auto downsample = [&](uint32_t begin, uint32_t end)
+        {
+            while (begin < end)
+            {
+                uint32_t layer = begin / dstHeight;
+                uint32_t row = begin % dstHeight;
+                uint32_t rowEnd = std::min(row + (end - begin), dstHeight);
+                MipGenerator::Downsample(src + (size_t)layer * srcWidth * srcHeight * 4, srcWidth, srcHeight,
+                    dst + (size_t)layer * dstWidth * dstHeight * 4, dstWidth, dstHeight, row, rowEnd, filter, isSrgb);
+                begin += rowEnd - row;
+            }
+        };
+
+        if (scheduler == nullptr || (uint64_t)dstWidth * rowCount < s_MinParallelMipTexels)
+        {
+            downsample(0, rowCount);
+            continue;
+        }
+
+        enki::TaskSet task(rowCount, [&](enki::TaskSetPartition range, uint32_t) { downsample(range.start, range.end); });
+        // the wide filter reuses the source rows of the previous destination row within a range
+        task.m_MinRange = 16;
+        scheduler->AddTaskSetToPipe(&task);
+        scheduler->WaitforTask(&task);
+    }
+}
+
+void GfxLoader::FreeUploadData(UploadRequest& request)
+{
+    if (request.File)
+        request.File.Reset();
+    else if (request.Type == ResourceTypes::eTexture && request.MipCount == 0)
+        stbi_image_free(request.Data);
+    else
+        delete[] (uint8_t*)request.Data;
+    request.Data = nullptr;
 }
 
 void GfxLoader::UploadTexture(UploadRequest& request)
@@ -308,10 +868,177 @@ void GfxLoader::UploadTexture(UploadRequest& request)
     auto& cbManager = m_GraphicsContext->GetTransferCommandBufferManager();
     auto& cmdBuffer = cbManager.GetCurrentCommandBuffer();
 
-    request.Texture->UploadData(cmdBuffer, m_StagingBuffer, request.Data);
-    if (request.Type == ResourceTypes::eTexture)
-        stbi_image_free(request.Data);
+    if (request.MipCount > 1)
+    {
+        request.Texture->UploadMipChain(cmdBuffer, m_StagingBuffer, request.Data, request.Size);
+    }
     else
-        delete[] request.Data;
+    {
+        request.ComputeMips = m_Downsampler->CanGenerate(*request.Texture);
+        request.Texture->UploadData(cmdBuffer, m_StagingBuffer, request.Data,
+            request.ComputeMips ? EQueueFamilyType::Compute : EQueueFamilyType::Graphics);
+    }
+    FreeUploadData(request);
+}
+
+void GfxLoader::CopyTextureFromHost(UploadRequest& request)
+{
+    request.Texture->CopyFromHost(request.Data, request.Size, std::max(request.MipCount, 1u));
+    FreeUploadData(request);
+    // already in its final layout, the renderer only points the bindless slot to it
+    m_Renderer->AddTextureToUpdate(request.Texture);
+}
+
+void GfxLoader::UploadTextureMips(UploadRequest& request)
+{
+    auto& cbManager = m_GraphicsContext->GetTransferCommandBufferManager();
+    auto& cmdBuffer = cbManager.GetCurrentCommandBuffer();
+
+    request.Texture->UploadMips(cmdBuffer, m_StagingBuffer, request.Data, request.Size, request.MipRegions);
+    FreeUploadData(request);
+}
+
+void GfxLoader::UploadStaticMesh(UploadRequest& request)
+{
+    auto& cbManager = m_GraphicsContext->GetTransferCommandBufferManager();
+    auto& cmdBuffer = cbManager.GetCurrentCommandBuffer();
+
+    request.Mesh->UploadGeometry(cmdBuffer, m_StagingBuffer);
+}
+
+void GfxLoader::FlushReadyUploads()
+{
+    if (m_ReadyUploads.empty())
+        return;
+    // the renderer acquires the images on the graphics queue, the release has to be executed first
+    if (m_GraphicsContext->GetTransferCommandBufferManager().GetFenceStatus(0) == false)
+        return;
+
+    for (auto& upload : m_ReadyUploads)
+    {
+        if (upload.Type == ResourceTypes::eStaticMesh)
+            m_Renderer->AddStaticMeshToUpdate(upload.Mesh);
+        else if (upload.Type == ResourceTypes::eTextureMips)
+            m_Renderer->AddTextureToUpdate(upload.Texture, upload.FirstMip, upload.MipCount);
+        else if (upload.ComputeMips)
+            m_ComputeMipsToGenerate.push_back(upload.Texture);
+        else
+            m_Renderer->AddTextureToUpdate(upload.Texture);
+    }
+    m_ReadyUploads.clear();
+}
+
+void GfxLoader::FlushComputeMips()
+{
+    auto& cbManager = *m_ComputeCommandBufferManager;
+    if (cbManager.GetFenceStatus(0) == false)
+        return;
+
+    // the renderer acquires the mips on the graphics queue, the release has been executed
+    if (m_ComputeMipsInFlight.empty() == false)
+    {
+        m_Downsampler->ReleaseRecorded();
+        for (auto& texture : m_ComputeMipsInFlight)
+            m_Renderer->AddTextureToUpdate(texture);
+        m_ComputeMipsInFlight.clear();
+    }
+    if (m_ComputeMipsToGenerate.empty())
+        return;
+
+    size_t count = std::min(m_ComputeMipsToGenerate.size(), (size_t)SinglePassDownsampler::s_MaxBatchSize);
+    m_ComputeMipsInFlight.assign(m_ComputeMipsToGenerate.begin(), m_ComputeMipsToGenerate.begin() + count);
+    m_ComputeMipsToGenerate.erase(m_ComputeMipsToGenerate.begin(), m_ComputeMipsToGenerate.begin() + count);
+
+    cbManager.StartCommandBuffer(0);
+    m_Downsampler->Record(cbManager.GetCurrentCommandBuffer(), m_ComputeMipsInFlight);
+    vk::SubmitInfo submitInfo{};
+    cbManager.Submit(submitInfo);
+}
+
+void GfxLoader::UpdateStreaming()
+{
+    std::lock_guard<std::mutex> lock(m_StreamedTexturesMutex);
+    // the loader holds the last reference
+    std::erase_if(m_StreamedTextures, [](const StreamedTexture& streamed) { return streamed.Texture->GetCount() == 1; });
+
+    for (auto& streamed : m_StreamedTextures)
+    {
+        // the further the texture is from the resolution it is drawn at, the sooner its next mip is needed
+        uint32_t requestedMip = streamed.Texture->GetRequestedMip();
+        float priority = (float)streamed.PendingMip - (float)requestedMip;
+
+        // one mip in flight at a time per texture
+        if (streamed.Texture->GetResidentMip() > streamed.PendingMip)
+        {
+            if (priority != streamed.Priority)
+            {
+                streamed.Priority = priority;
+                SetPriority(streamed.Texture.GetPtr(), priority);
+            }
+            continue;
+        }
+        if (streamed.PendingMip == 0 || requestedMip >= streamed.PendingMip)
+            continue;
+
+        LoadRequest request;
+        request.Type = ResourceTypes::eTextureMips;
+        request.IsFile = true;
+        request.Path.push_back(streamed.Path);
+        request.Texture = streamed.Texture;
+        request.FirstMip = --streamed.PendingMip;
+        request.MipCount = 1;
+        request.Priority = streamed.Priority = priority;
+        PushLoadRequest(request);
+    }
+}
+
+void GfxLoader::PollHotReload()
+{
+    if (m_HotReload == false)
+        return;
+
+    auto& registry = AssetRegistry::Get();
+    auto changes = m_FileWatcher.Poll([&registry](const std::string& key) { return registry.Contains(key); });
+    for (auto& change : changes)
+    {
+        LoadRequest request;
+        request.Type = (ResourceTypes::Enum)change.Tag;
+        request.IsFile = true;
+        request.IsReload = true;
+        request.Priority = s_ReloadPriority;
+        if (request.Type == ResourceTypes::eStaticMesh)
+        {
+            request.Mesh = registry.Find<StaticMesh>(change.Key);
+            // a mesh that is still loading reads the new files anyway
+            if (!request.Mesh || request.Mesh->IsReady() == false)
+                continue;
+        }
+        else
+        {
+            request.Texture = registry.Find<Texture>(change.Key);
+            if (!request.Texture)
+                continue;
+            for (const auto& file : change.Files)
+                request.Path.push_back(file.string());
+        }
+
+        LNE_INFO("{0} changed on disk, reloading it", change.Files[0].string());
+        PushLoadRequest(request);
+    }
+}
+
+void GfxLoader::FlushTextureReloads()
+{
+    // the renderer applies the reload after the uploads it already received, the ones still in flight have to reach it first
+    for (size_t i = 0; i < m_PendingTextureReloads.size();)
+    {
+        if (IsTextureInFlight(m_PendingTextureReloads[i].Texture.GetPtr()))
+        {
+            ++i;
+            continue;
+        }
+        m_Renderer->AddTextureReload(std::move(m_PendingTextureReloads[i]));
+        m_PendingTextureReloads.erase(m_PendingTextureReloads.begin() + i);
+    }
 }
 }
@@ -4,6 +4,8 @@
 #include "Engine/Core/SafePtr.h"
 #include "Engine/Graphics/Structs.h"
 #include "Engine/Core/Utils/Defines.h"
+#include "Engine/Resources/RequestQueue.h"
+#include "Engine/Resources/FileWatcher.h"
 
 namespace enki
 {
@@ -18,25 +20,52 @@ enum Enum : uint8_t
 {
     eTexture,
     eCubemap,
+    eTextureMips,
+    eStaticMesh,
 };
 
 enum Mask
 {
     mTexture = 1 << 0,
     mCubemap = 1 << 1,
+    mTextureMips = 1 << 2,
+    mStaticMesh = 1 << 3,
 };
 
 extern const char** s_Enum;
 std::string_view ToString(Enum type);
 }
 
+enum class EMipGeneration : uint8_t
+{
+    // blits on the graphics queue when the renderer acquires the texture
+    eGpuBlit,
+    // built by the loader, uploaded with the texture
+    eCpuBox,
+    eCpuKaiser,
+    // one dispatch on the async compute queue between the upload and the renderer acquire
+    eGpuCompute,
+};
+
 struct UploadRequest
 {
     ResourceTypes::Enum Type;
     SafePtr<class Texture> Texture;
     SafePtr<class StorageBuffer> Buffer;
+    SafePtr<class StaticMesh> Mesh;
     uint32_t Size;
     void* Data;
+    float Priority{ 0.0f };
+    // owns Data when it is uploaded straight from the file read
+    SafePtr<class FileRead> File{};
+
+    // eTextureMips only
+    std::vector<TextureMipRegion> MipRegions{};
+    uint32_t FirstMip{ 0 };
+    // eTextureMips, or eTexture and eCubemap when Data holds the full mip chain built on the CPU
+    uint32_t MipCount{ 0 };
+    // eTexture and eCubemap: released to the compute queue, their mips are generated there
+    bool ComputeMips{ false };
 };
 
 struct LoadRequest
@@ -44,9 +73,68 @@ struct LoadRequest
     ResourceTypes::Enum Type{};
     SafePtr<class Texture> Texture{};
     SafePtr<class StorageBuffer> Buffer;
+    SafePtr<class StaticMesh> Mesh{};
     std::vector<std::string> Path{};
     void* Data{};
     bool IsFile{ true };
+    // higher is loaded first
+    float Priority{ 0.0f };
+
+    // eTextureMips only
+    uint32_t FirstMip{ 0 };
+    uint32_t MipCount{ 0 };
+
+    // the files of a loaded asset changed, its content is replaced in place
+    bool IsReload{ false };
+};
+
+/// <summary>
+/// Load request whose files are being read, it is decoded once every read is done.
+/// </summary>
+struct PendingLoad
+{
+    LoadRequest Request;
+    std::vector<SafePtr<class FileRead>> Reads;
+
+    // eTextureMips only
+    std::vector<TextureMipRegion> MipRegions{};
+};
+
+struct StreamedTexture
+{
+    SafePtr<class Texture> Texture;
+    std::string Path;
+    // finest mip already queued for loading
+    uint32_t PendingMip;
+    // priority of the pending mip request
+    float Priority;
+};
+
+/// <summary>
+/// Texture decoded again after its files changed. The renderer copies the chain into the texture on the graphics queue,
+/// in place when the dimensions and format are the same, into a new image behind the same bindless handle otherwise.
+/// </summary>
+struct TextureReload
+{
+    SafePtr<class Texture> Texture;
+    // full mip chain laid out by MipGenerator, owned by the reload
+    BufferAllocation Staging{};
+    uint32_t Width{};
+    uint32_t Height{};
+    uint32_t MipCount{};
+    vk::Format Format{};
+};
+
+/// <summary>
+/// Mesh file read again after its files changed, the renderer swaps its geometry and submeshes between two frames.
+/// </summary>
+struct StaticMeshReload
+{
+    SafePtr<class StaticMesh> Mesh;
+    // kept mapped for the submeshes and materials
+    std::shared_ptr<class MeshFile> File;
+    // vertices, indices then meshlets, laid out like the initial upload
+    BufferAllocation Staging{};
 };
 
 class GfxLoaderTask : public enki::IPinnedTask
@@ -70,15 +158,41 @@ class GfxLoader : public RefCountBase
 public:
     MOVABLE_ONLY(GfxLoader);
     GfxLoader() = default;
-    ~GfxLoader() = default;
+    ~GfxLoader();
 
     void Init(class Renderer* renderer, SafePtr<class GfxContext> context, std::shared_ptr<class enki::TaskScheduler> scheduler);
     void Nuke();
 
     void Update();
 
-    SafePtr<class Texture> CreateTexture(std::string_view fullPath);
-    SafePtr<class Texture> CreateCubemap(std::vector<std::string> faces);
+    /// <summary>
+    /// The priority orders the pending requests, higher first. Screen coverage or inverse distance are good candidates.
+    /// </summary>
+    SafePtr<class Texture> CreateTexture(std::string_view fullPath, float priority = 0.0f);
+    SafePtr<class Texture> CreateCubemap(std::vector<std::string> faces, float priority = 0.0f);
+    /// <summary>
+    /// Parses the mesh file on the loader thread and uploads its geometry on the transfer queue.
+    /// The renderer finalizes the mesh once the upload is done.
+    /// </summary>
+    void LoadStaticMesh(SafePtr<class StaticMesh> mesh, float priority = 0.0f);
+    /// <summary>
+    /// Changes the priority of the pending load and upload requests of the asset. Does nothing if none is pending.
+    /// </summary>
+    void SetPriority(const RefCountBase* asset, float priority);
+    /// <summary>
+    /// Applies to the textures decoded from then on. Chains that don't fit in the staging buffer are still blitted on the GPU,
+    /// as are the textures created before eGpuCompute was selected or too large for the single pass downsampler.
+    /// </summary>
+    void SetMipGeneration(EMipGeneration mode) { m_MipGeneration = mode; }
+    /// <summary>
+    /// Applies to the assets created from then on: their files on disk are watched and the assets are reloaded in place when they change.
+    /// </summary>
+    void SetHotReload(bool enabled) { m_HotReload = enabled; }
+    /// <summary>
+    /// Watches the files of an asset registered under the key when hot reload is enabled. The dependencies the asset manifest
+    /// lists for a mesh (glTF buffers and images, OBJ material libraries) are watched along with it.
+    /// </summary>
+    void Watch(const std::string& key, ResourceTypes::Enum type, const std::vector<std::string>& paths);
 
 private:
     class Renderer* m_Renderer;
@@ -86,22 +200,96 @@ private:
     std::weak_ptr<enki::TaskScheduler> m_TaskScheduler;
     std::unique_ptr<GfxLoaderTask> m_GfxLoaderTask;
 
-    std::vector<UploadRequest> m_GPUUploadRequests;
+    RequestQueue<UploadRequest> m_GPUUploadRequests;
     std::mutex m_UploadRequestsMutex;
-    std::vector<LoadRequest> m_LoadRequests;
+    RequestQueue<LoadRequest> m_LoadRequests;
     std::mutex m_LoadRequestsMutex;
     vk::Semaphore m_TransferSemaphore;
     
     BufferAllocation m_StagingBuffer;
 
-    SafePtr<class Texture> m_ReadyTexture;
+    // uploads submitted on the transfer queue, handed to the renderer once the transfer fence is signaled
+    std::vector<UploadRequest> m_ReadyUploads;
+    // loads waiting for their file reads, only touched by the loader thread
+    std::vector<PendingLoad> m_PendingLoads;
+
+    std::vector<StreamedTexture> m_StreamedTextures;
+    std::mutex m_StreamedTexturesMutex;
+
+    std::atomic<EMipGeneration> m_MipGeneration{ EMipGeneration::eGpuBlit };
+
+    std::unique_ptr<class SinglePassDownsampler> m_Downsampler;
+    std::unique_ptr<class CommandBufferManager> m_ComputeCommandBufferManager;
+    // textures uploaded and released to the compute queue, waiting for their mips
+    std::vector<SafePtr<class Texture>> m_ComputeMipsToGenerate;
+    // handed to the renderer once the compute fence is signaled
+    std::vector<SafePtr<class Texture>> m_ComputeMipsInFlight;
+
+    std::atomic<bool> m_HotReload{ false };
+    FileWatcher m_FileWatcher;
+    // decoded, waiting for the uploads of the texture that are still in flight
+    std::vector<TextureReload> m_PendingTextureReloads;
 
 private:
+    SafePtr<class Texture> CreateTexture2D(std::string_view fullPath, float priority);
+    SafePtr<class Texture> CreateCubemapTexture(std::vector<std::string> faces, float priority);
+    SafePtr<class Texture> CreateStreamedTexture(const std::filesystem::path& fullPath, float priority);
+    void UpdateStreaming();
+    void FlushReadyUploads();
+    /// <summary>
+    /// Hands the textures whose mips are done to the renderer and submits the next batch on the compute queue.
+    /// </summary>
+    void FlushComputeMips();
+    /// <summary>
+    /// Queues a reload for the watched assets whose files changed.
+    /// </summary>
+    void PollHotReload();
+    void FlushTextureReloads();
+
     void ProcessUploadRequests();
     void ProcessLoadRequests();
+    void PushLoadRequest(const LoadRequest& request);
+    void PushUploadRequest(const UploadRequest& request);
+    /// <summary>
+    /// Pops the next request, dropping the ones whose asset isn't referenced outside of the loader anymore.
+    /// </summary>
+    bool PopLoadRequest(LoadRequest& request);
+    bool PopUploadRequest(UploadRequest& request);
+
+    void FreeUploadData(UploadRequest& request);
 
-    void LoadTexture(LoadRequest& request);
-    void LoadCubemap(LoadRequest& request);
+    /// <summary>
+    /// Issues the file reads of the request, it is decoded by ProcessLoadRequests once they are done.
+    /// </summary>
+    void StartLoad(LoadRequest& request);
+    void LoadTexture(PendingLoad& load);
+    void LoadCubemap(PendingLoad& load);
+    void LoadTextureMips(PendingLoad& load);
+    void LoadStaticMeshData(LoadRequest& request);
+    void ReloadTexture(PendingLoad& load);
+    void ReloadStaticMesh(LoadRequest& request);
+    /// <summary>
+    /// Drops the pending loads and uploads of a texture that is being reloaded, and stops streaming it.
+    /// </summary>
+    void CancelTextureLoads(const class Texture* texture);
+    /// <summary>
+    /// True while an upload or a mip generation submitted for the texture hasn't been handed to the renderer.
+    /// </summary>
+    bool IsTextureInFlight(const class Texture* texture) const;
+    /// <summary>
+    /// Number of mips the loader builds for the texture, 0 when they are left to the GPU.
+    /// </summary>
+    uint32_t GetLoaderMipCount(const class Texture& texture) const;
+    /// <summary>
+    /// Fills the mips [1, mipCount) of a chain whose first mip is written, each mip split in rows between the task threads.
+    /// </summary>
+    void GenerateMips(uint8_t* chain, uint32_t width, uint32_t height, uint32_t layerCount, uint32_t mipCount, bool isSrgb);
     void UploadTexture(UploadRequest& request);
+    /// <summary>
+    /// Writes a decoded texture into its image from the loader thread, in place of UploadTexture on the devices that support it.
+    /// </summary>
+    void CopyTextureFromHost(UploadRequest& request);
+    void UploadTextureMips(UploadRequest& request);
+    void UploadStaticMesh(UploadRequest& request);
 };
 }
@@ -0,0 +1,620 @@
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/aabb.h>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <enkiTS/src/TaskScheduler.h>
+
+#include "Core/Utils/Log.h"
+
+#include "VirtualFileSystem.h"
+#include "AssimpIOSystem.h"
+#include "MeshOptimizer.h"
+#include "MeshFile.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#define LNE_MESH_SSE
+#endif
+
+namespace lne
+{
+namespace
+{
+// each level of detail aims for this fraction of the triangles of the previous one
+constexpr float s_LodReduction = 0.5f;
+// a level that keeps more than this fraction isn't worth its memory, the simplification is stuck
+constexpr float s_MinLodGain = 0.85f;
+constexpr uint32_t s_MinLodTriangles = 32;
+// relative to the radius of the submesh, the renderer only picks such a coarse level when the submesh covers a few pixels
+constexpr float s_MaxLodError = 0.1f;
+// below this many vertices a model is baked on the calling thread
+constexpr uint32_t s_MinParallelBakeVertices = 1 << 16;
+constexpr uint32_t s_BakeRange = 1 << 14;
+
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "The vertices are baked from single precision Assimp vectors");
+
+// a submesh cooked on its own, its ranges start at zero until it is appended to the others
+struct CookedSubMesh
+{
+    MeshFileSubMesh SubMesh;
+    std::vector<uint8_t> IndexData;
+    std::vector<Meshlet> Meshlets;
+    uint32_t IndexCount{ 0 };
+};
+
+constexpr uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+template<size_t N>
+void CopyName(char(&dst)[N], const char* src)
+{
+    strncpy(dst, src, N - 1);
+    dst[N - 1] = '\0';
+}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f)
+        return glm::vec2(0.0f);
+
+    glm::vec3 n = normal / length;
+    glm::vec2 encoded(n.x, n.y);
+    // the lower half of the octahedron is folded over the upper one
+    if (n.z < 0.0f)
+    {
+        glm::vec2 sign(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+    }
+    return encoded;
+}
+
+int16_t PackSnorm16(float value)
+{
+    return (int16_t)std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+// the decoding header and the bounds of every submesh, then the vertices of each quantized in the bounds of their submesh
+std::vector<uint8_t> PackVertices(const std::vector<Vertex>& vertices, const std::vector<MeshFileSubMesh>& submeshes, uint32_t& decodeSize)
+{
+    decodeSize = (uint32_t)AlignOffset(sizeof(VertexDecodeHeader) + submeshes.size() * sizeof(VertexBounds), VertexDecodeHeader::s_VertexAlignment);
+    std::vector<uint8_t> result(decodeSize + vertices.size() * sizeof(PackedVertex));
+    *(VertexDecodeHeader*)result.data() = VertexDecodeHeader{ .Format = EVertexFormat::ePacked, .BoundsCount = (uint32_t)submeshes.size() };
+    VertexBounds* bounds = (VertexBounds*)(result.data() + sizeof(VertexDecodeHeader));
+    PackedVertex* packed = (PackedVertex*)(result.data() + decodeSize);
+
+    constexpr float maxQuantized = (float)std::numeric_limits<uint16_t>::max();
+    for (uint32_t s = 0; s < (uint32_t)submeshes.size(); ++s)
+    {
+        const MeshFileSubMesh& submesh = submeshes[s];
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        for (uint32_t v = submesh.BaseVertex; v < submesh.BaseVertex + submesh.VertexCount; ++v)
+        {
+            min = glm::min(min, vertices[v].Position);
+            max = glm::max(max, vertices[v].Position);
+        }
+        if (submesh.VertexCount == 0)
+            continue;
+
+        bounds[s] = VertexBounds{ .Min = min, .Scale = (max - min) / maxQuantized };
+        // a flat box has a null scale on one axis, every position is at its minimum there
+        glm::vec3 inverseScale = glm::vec3(maxQuantized) / glm::max(max - min, glm::vec3(std::numeric_limits<float>::min()));
+        for (uint32_t v = submesh.BaseVertex; v < submesh.BaseVertex + submesh.VertexCount; ++v)
+        {
+            const Vertex& vertex = vertices[v];
+            glm::vec3 position = glm::clamp(glm::round((vertex.Position - min) * inverseScale), glm::vec3(0.0f), glm::vec3(maxQuantized));
+            glm::vec2 normal = EncodeOctahedral(vertex.Normal);
+            uint32_t texCoord = glm::packHalf2x16(vertex.TexCoord);
+            packed[v] = PackedVertex{
+                .Position = { (uint16_t)position.x, (uint16_t)position.y, (uint16_t)position.z },
+                .SubMeshIndex = (uint16_t)s,
+                .Normal = { PackSnorm16(normal.x), PackSnorm16(normal.y) },
+                .TexCoord = { (uint16_t)(texCoord & 0xFFFF), (uint16_t)(texCoord >> 16) }
+            };
+        }
+    }
+    return result;
+}
+
+// positions by the world transform, normals by its inverse transpose so that they stay perpendicular to the surface
+// under a non-uniform scale. Writes count vertices of the mesh from first.
+void BakeVertices(const aiMesh* mesh, const glm::mat4& transform, uint32_t first, uint32_t count, Vertex* vertices)
+{
+    glm::mat3 normalTransform = glm::inverseTranspose(glm::mat3(transform));
+    const aiVector3D* positions = mesh->mVertices + first;
+    const aiVector3D* normals = mesh->mNormals + first;
+    const aiVector3D* texCoords = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0] + first : nullptr;
+
+    uint32_t v = 0;
+#ifdef LNE_MESH_SSE
+    // 4 vertices per iteration, one per lane: the components are gathered, transformed, then scattered back
+    __m128 positionColumns[4][3];
+    __m128 normalColumns[3][3];
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t r = 0; r < 3; ++r)
+        {
+            positionColumns[c][r] = _mm_set1_ps(transform[c][r]);
+            if (c < 3)
+                normalColumns[c][r] = _mm_set1_ps(normalTransform[c][r]);
+        }
+    }
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minLengthSquared = _mm_set1_ps(std::numeric_limits<float>::min());
+    for (; v + 4 <= count; v += 4)
+    {
+        const float* p = &positions[v].x;
+        const float* n = &normals[v].x;
+        __m128 px = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+        __m128 py = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+        __m128 pz = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+        __m128 nx = _mm_setr_ps(n[0], n[3], n[6], n[9]);
+        __m128 ny = _mm_setr_ps(n[1], n[4], n[7], n[10]);
+        __m128 nz = _mm_setr_ps(n[2], n[5], n[8], n[11]);
+
+        alignas(16) float baked[6][4];
+        for (uint32_t r = 0; r < 3; ++r)
+        {
+            __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, positionColumns[0][r]), _mm_mul_ps(py, positionColumns[1][r])),
+                _mm_add_ps(_mm_mul_ps(pz, positionColumns[2][r]), positionColumns[3][r]));
+            _mm_store_ps(baked[r], position);
+        }
+        __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, normalColumns[0][0]), _mm_mul_ps(ny, normalColumns[1][0])), _mm_mul_ps(nz, normalColumns[2][0]));
+        __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, normalColumns[0][1]), _mm_mul_ps(ny, normalColumns[1][1])), _mm_mul_ps(nz, normalColumns[2][1]));
+        __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, normalColumns[0][2]), _mm_mul_ps(ny, normalColumns[1][2])), _mm_mul_ps(nz, normalColumns[2][2]));
+        // a null normal stays null
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+        __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(lengthSquared, minLengthSquared)));
+        _mm_store_ps(baked[3], _mm_mul_ps(tx, inverseLength));
+        _mm_store_ps(baked[4], _mm_mul_ps(ty, inverseLength));
+        _mm_store_ps(baked[5], _mm_mul_ps(tz, inverseLength));
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            Vertex& vertex = vertices[v + i];
+            vertex.Position = { baked[0][i], baked[1][i], baked[2][i] };
+            vertex.Normal = { baked[3][i], baked[4][i], baked[5][i] };
+            vertex.TexCoord = texCoords ? glm::vec2(texCoords[v + i].x, texCoords[v + i].y) : glm::vec2(0.0f);
+        }
+    }
+#endif
+    for (; v < count; ++v)
+    {
+        Vertex& vertex = vertices[v];
+        vertex.Position = glm::vec3(transform * glm::vec4(positions[v].x, positions[v].y, positions[v].z, 1.0f));
+        glm::vec3 normal = normalTransform * glm::vec3(normals[v].x, normals[v].y, normals[v].z);
+        float length = glm::length(normal);
+        vertex.Normal = length > 0.0f ? normal / length : normal;
+        vertex.TexCoord = texCoords ? glm::vec2(texCoords[v].x, texCoords[v].y) : glm::vec2(0.0f);
+    }
+}
+
+// in the space of the source mesh, the renderer places it with the world transform of the submesh. Assimp only fills
+// aiMesh::mAABB with aiProcess_GenBoundingBoxes, which would walk every mesh again on the importer thread
+AABB ComputeBounds(const aiMesh* mesh)
+{
+    if (mesh->mNumVertices == 0)
+        return AABB{};
+
+    AABB bounds{ .Min = glm::vec3(std::numeric_limits<float>::max()), .Max = glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (uint32_t v = 0; v < mesh->mNumVertices; ++v)
+    {
+        glm::vec3 position(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z);
+        bounds.Min = glm::min(bounds.Min, position);
+        bounds.Max = glm::max(bounds.Max, position);
+    }
+    return bounds;
+}
+
+// optimizes the baked vertices of the submesh in place, builds its levels of detail and their meshlets
+void CookSubMesh(const aiMesh* mesh, const glm::mat4& transform, Vertex* meshVertices, CookedSubMesh& cooked)
+{
+    bool skip = !mesh->HasPositions() || !mesh->HasNormals();
+
+    MeshFileSubMesh submesh{
+        .BaseVertex = 0,
+        .VertexCount = skip ? 0 : mesh->mNumVertices,
+        .IndexStride = sizeof(uint32_t),
+        .LodCount = 1,
+        .MaterialIndex = mesh->mMaterialIndex,
+        .BoundingBox = skip ? AABB{} : ComputeBounds(mesh),
+        .WorldTransform = transform,
+        .Lods = { MeshLod{} }
+    };
+    CopyName(submesh.Name, mesh->mName.C_Str());
+
+    if (skip)
+    {
+        cooked.SubMesh = submesh;
+        return;
+    }
+
+    std::vector<uint32_t> meshIndices;
+    std::vector<uint32_t> lodIndices;
+    meshIndices.reserve((size_t)mesh->mNumFaces * 3);
+    for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+    {
+        LNE_ASSERT(mesh->mFaces[f].mNumIndices == 3, "Face is not a triangle");
+
+        const aiFace& face = mesh->mFaces[f];
+        for (uint32_t i = 0; i < face.mNumIndices; ++i)
+            meshIndices.push_back(face.mIndices[i]);
+    }
+
+    float acmrBefore = MeshOptimizer::ComputeACMR(meshIndices.data(), meshIndices.size(), submesh.VertexCount);
+    MeshOptimizer::OptimizeVertexCache(meshIndices.data(), meshIndices.size(), submesh.VertexCount);
+    MeshOptimizer::OptimizeOverdraw(meshIndices.data(), meshIndices.size(), meshVertices, submesh.VertexCount);
+    submesh.VertexCount = MeshOptimizer::OptimizeVertexFetch(meshVertices, meshIndices.data(), meshIndices.size(), submesh.VertexCount);
+    float acmrAfter = MeshOptimizer::ComputeACMR(meshIndices.data(), meshIndices.size(), submesh.VertexCount);
+
+    // the indices are relative to the base vertex, every level of a submesh shares its vertices and so its stride
+    if (submesh.VertexCount <= (uint32_t)std::numeric_limits<uint16_t>::max() + 1)
+        submesh.IndexStride = sizeof(uint16_t);
+
+    std::vector<uint8_t>& indexData = cooked.IndexData;
+    std::vector<Meshlet>& meshlets = cooked.Meshlets;
+    auto appendLod = [&](MeshLod& lod, const std::vector<uint32_t>& levelIndices)
+    {
+        // the shaders read the index buffer as 32 bit words
+        size_t offset = AlignOffset(indexData.size(), sizeof(uint32_t));
+        indexData.resize(offset + levelIndices.size() * submesh.IndexStride);
+        if (submesh.IndexStride == sizeof(uint16_t))
+            std::transform(levelIndices.begin(), levelIndices.end(), (uint16_t*)(indexData.data() + offset), [](uint32_t index) { return (uint16_t)index; });
+        else
+            memcpy(indexData.data() + offset, levelIndices.data(), levelIndices.size() * sizeof(uint32_t));
+
+        lod.BaseIndex = (uint32_t)(offset / submesh.IndexStride);
+        lod.IndexCount = (uint32_t)levelIndices.size();
+        lod.BaseMeshlet = (uint32_t)meshlets.size();
+        MeshOptimizer::BuildMeshlets(levelIndices.data(), levelIndices.size(), meshVertices, submesh.VertexCount, lod.BaseIndex, meshlets);
+        lod.MeshletCount = (uint32_t)meshlets.size() - lod.BaseMeshlet;
+        cooked.IndexCount += lod.IndexCount;
+    };
+    appendLod(submesh.Lods[0], meshIndices);
+
+    // the errors are relative to the radius the renderer projects, the half diagonal of the box in the space of the model
+    glm::mat3 scaleTransform(submesh.WorldTransform);
+    float scale = std::max({ glm::length(scaleTransform[0]), glm::length(scaleTransform[1]), glm::length(scaleTransform[2]) });
+    float radius = glm::length(submesh.BoundingBox.Max - submesh.BoundingBox.Min) * 0.5f * scale;
+    if (radius <= 0.0f)
+        LNE_WARN("Submesh {0} has an empty bounding box, it only keeps its full detail level", submesh.Name);
+    while (radius > 0.0f && submesh.LodCount < MeshLod::s_MaxCount)
+    {
+        const MeshLod& previous = submesh.Lods[submesh.LodCount - 1];
+        size_t targetIndexCount = (size_t)(previous.IndexCount * s_LodReduction) / 3 * 3;
+        if (targetIndexCount < s_MinLodTriangles * 3)
+            break;
+
+        // always from the full detail level, the quadrics then measure the whole distance to the original surface
+        float error = MeshOptimizer::Simplify(meshIndices.data(), meshIndices.size(), meshVertices, submesh.VertexCount,
+            targetIndexCount, s_MaxLodError * radius, lodIndices);
+        // stuck on the locked vertices or at the error limit
+        if (lodIndices.size() > previous.IndexCount * s_MinLodGain)
+            break;
+
+        MeshOptimizer::OptimizeVertexCache(lodIndices.data(), lodIndices.size(), submesh.VertexCount);
+        MeshLod& lod = submesh.Lods[submesh.LodCount++];
+        appendLod(lod, lodIndices);
+        lod.Error = error / radius;
+    }
+    LNE_INFO("Submesh {0}: ACMR {1:.3f} -> {2:.3f}, {3} levels of detail down to {4} triangles, {5} bit indices", submesh.Name,
+        acmrBefore, acmrAfter, submesh.LodCount, submesh.Lods[submesh.LodCount - 1].IndexCount / 3, submesh.IndexStride * 8);
+    cooked.SubMesh = submesh;
+}
+
+void TraverseNodes(const aiNode* node, const glm::mat4& parentTransform, std::vector<glm::mat4>& meshTransforms)
+{
+    glm::mat4 transform = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+    glm::mat4 worldTransform = parentTransform * transform;
+
+    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+        meshTransforms[node->mMeshes[i]] = worldTransform;
+
+    for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        TraverseNodes(node->mChildren[i], worldTransform, meshTransforms);
+}
+
+MeshFileMaterial ExtractMaterial(const aiMaterial* aiMat)
+{
+    MeshFileMaterial material{};
+
+    aiString name;
+    aiMat->Get(AI_MATKEY_NAME, name);
+    CopyName(material.Name, name.C_Str());
+
+    aiColor3D aiColor(1.0f);
+    material.HasColor = aiMat->Get(AI_MATKEY_COLOR_DIFFUSE, aiColor) == AI_SUCCESS;
+    material.Color = { aiColor.r, aiColor.g, aiColor.b, 1.0f };
+
+    if (aiMat->Get(AI_MATKEY_REFLECTIVITY, material.Metalness) != AI_SUCCESS)
+        material.Metalness = 0.0f;
+    if (aiMat->Get(AI_MATKEY_ROUGHNESS_FACTOR, material.Roughness) != AI_SUCCESS)
+        material.Roughness = 0.4f;
+
+    aiString texturePath;
+    bool hasAlbedoTex = aiMat->GetTexture(AI_MATKEY_BASE_COLOR_TEXTURE, &texturePath) == AI_SUCCESS;
+    if (!hasAlbedoTex)
+        hasAlbedoTex = aiMat->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS;
+    if (hasAlbedoTex)
+        CopyName(material.AlbedoPath, texturePath.C_Str());
+
+    return material;
+}
+}
+
+bool MeshFile::Cook(const std::filesystem::path& source, const std::filesystem::path& destination, EVertexFormat vertexFormat,
+    std::shared_ptr<enki::TaskScheduler> scheduler)
+{
+    AssimpIOSystem* ioSystem = lnnew AssimpIOSystem();
+    ioSystem->Prefetch(source);
+    // glTF keeps its buffers next to the model, read them while the json is parsed
+    if (source.extension() == ".gltf")
+    {
+        std::error_code error;
+        std::string stem = source.stem().string();
+        for (const auto& entry : std::filesystem::directory_iterator(source.parent_path(), error))
+        {
+            if (entry.path().extension() == ".bin" && entry.path().stem().string().starts_with(stem))
+                ioSystem->Prefetch(entry.path());
+        }
+    }
+
+    Assimp::Importer importer;
+    // the importer owns the IO system
+    importer.SetIOHandler(ioSystem);
+    const aiScene* scene = importer.ReadFile(source.string(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices);
+
+    if (!scene)
+    {
+        LNE_ERROR("Assimp error: {0}", importer.GetErrorString());
+        return false;
+    }
+
+    if (!scene->HasMeshes())
+    {
+        LNE_ERROR("No meshes found in file: {0}", source.string());
+        return false;
+    }
+
+    std::vector<glm::mat4> meshTransforms(scene->mNumMeshes, glm::mat4(1.0f));
+    TraverseNodes(scene->mRootNode, glm::mat4(1.0f), meshTransforms);
+
+    // every usable mesh is baked in its own slice of the vertices, optimized in place then moved down to its base vertex
+    std::vector<uint32_t> sourceBaseVertices(scene->mNumMeshes);
+    std::vector<uint32_t> sourceVertexCounts(scene->mNumMeshes);
+    uint32_t sourceVertexCount = 0;
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m)
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        sourceBaseVertices[m] = sourceVertexCount;
+        sourceVertexCounts[m] = mesh->HasPositions() && mesh->HasNormals() ? mesh->mNumVertices : 0;
+        sourceVertexCount += sourceVertexCounts[m];
+    }
+    std::vector<Vertex> vertices(sourceVertexCount);
+
+    // the ranges of vertices are spread across the meshes, a mesh of millions of vertices is split as well
+    auto bakeRange = [&](uint32_t begin, uint32_t end)
+    {
+        uint32_t m = (uint32_t)(std::upper_bound(sourceBaseVertices.begin(), sourceBaseVertices.end(), begin) - sourceBaseVertices.begin()) - 1;
+        while (begin < end)
+        {
+            uint32_t meshEnd = sourceBaseVertices[m] + sourceVertexCounts[m];
+            if (meshEnd <= begin)
+            {
+                ++m;
+                continue;
+            }
+            uint32_t rangeEnd = std::min(end, meshEnd);
+            BakeVertices(scene->mMeshes[m], meshTransforms[m], begin - sourceBaseVertices[m], rangeEnd - begin, vertices.data() + begin);
+            begin = rangeEnd;
+        }
+    };
+    std::vector<CookedSubMesh> cookedSubMeshes(scene->mNumMeshes);
+    auto cookRange = [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t m = begin; m < end; ++m)
+            CookSubMesh(scene->mMeshes[m], meshTransforms[m], vertices.data() + sourceBaseVertices[m], cookedSubMeshes[m]);
+    };
+
+    if (scheduler == nullptr || sourceVertexCount < s_MinParallelBakeVertices)
+    {
+        bakeRange(0, sourceVertexCount);
+        cookRange(0, scene->mNumMeshes);
+    }
+    else
+    {
+        enki::TaskSet bakeTask(sourceVertexCount, [&](enki::TaskSetPartition range, uint32_t) { bakeRange(range.start, range.end); });
+        bakeTask.m_MinRange = s_BakeRange;
+        scheduler->AddTaskSetToPipe(&bakeTask);
+        scheduler->WaitforTask(&bakeTask);
+
+        // the submeshes are independent, one per range since their sizes can differ by orders of magnitude
+        enki::TaskSet cookTask(scene->mNumMeshes, [&](enki::TaskSetPartition range, uint32_t) { cookRange(range.start, range.end); });
+        cookTask.m_MinRange = 1;
+        scheduler->AddTaskSetToPipe(&cookTask);
+        scheduler->WaitforTask(&cookTask);
+    }
+
+    std::vector<MeshFileSubMesh> submeshes;
+    // 16 and 32 bit ranges, each level starts 4 byte aligned
+    std::vector<uint8_t> indexData;
+    uint32_t indexCount = 0;
+    std::vector<Meshlet> meshlets;
+    uint32_t vertexCount = 0;
+    submeshes.reserve(scene->mNumMeshes);
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m)
+    {
+        CookedSubMesh& cooked = cookedSubMeshes[m];
+        MeshFileSubMesh& submesh = cooked.SubMesh;
+
+        // the optimized vertices only ever move down, towards the start of the array
+        submesh.BaseVertex = vertexCount;
+        memmove(vertices.data() + vertexCount, vertices.data() + sourceBaseVertices[m], submesh.VertexCount * sizeof(Vertex));
+        vertexCount += submesh.VertexCount;
+
+        // the ranges of the submesh are aligned like its levels, its 16 bit indices still start on a word
+        size_t indexOffset = AlignOffset(indexData.size(), sizeof(uint32_t));
+        uint32_t baseIndex = (uint32_t)(indexOffset / submesh.IndexStride);
+        for (uint32_t l = 0; l < submesh.LodCount; ++l)
+        {
+            submesh.Lods[l].BaseIndex += baseIndex;
+            submesh.Lods[l].BaseMeshlet += (uint32_t)meshlets.size();
+        }
+        for (Meshlet& meshlet : cooked.Meshlets)
+            meshlet.BaseIndex += baseIndex;
+
+        indexData.resize(indexOffset);
+        indexData.insert(indexData.end(), cooked.IndexData.begin(), cooked.IndexData.end());
+        meshlets.insert(meshlets.end(), cooked.Meshlets.begin(), cooked.Meshlets.end());
+        indexCount += cooked.IndexCount;
+        submeshes.push_back(submesh);
+    }
+    vertices.resize(vertexCount);
+
+    std::vector<MeshFileMaterial> materials;
+    materials.reserve(scene->mNumMaterials);
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
+        materials.push_back(ExtractMaterial(scene->mMaterials[i]));
+
+    // the vertices are optimized and simplified at full precision, they are only packed in the file
+    if (vertexFormat == EVertexFormat::ePacked && submeshes.size() > (size_t)std::numeric_limits<uint16_t>::max() + 1)
+    {
+        LNE_WARN("{0} has too many submeshes to index their bounds, its vertices aren't packed", source.filename().string());
+        vertexFormat = EVertexFormat::eFloat;
+    }
+    std::vector<uint8_t> packedVertices;
+    uint32_t vertexDecodeSize = 0;
+    if (vertexFormat == EVertexFormat::ePacked)
+        packedVertices = PackVertices(vertices, submeshes, vertexDecodeSize);
+    const void* vertexData = vertexFormat == EVertexFormat::ePacked ? (const void*)packedVertices.data() : (const void*)vertices.data();
+    uint64_t vertexSize = vertexFormat == EVertexFormat::ePacked ? packedVertices.size() : vertices.size() * sizeof(Vertex);
+
+    MeshFileHeader header{};
+    header.VertexCount = (uint32_t)vertices.size();
+    header.IndexCount = indexCount;
+    header.SubMeshCount = (uint32_t)submeshes.size();
+    header.MaterialCount = (uint32_t)materials.size();
+    header.MeshletCount = (uint32_t)meshlets.size();
+    header.VertexStride = vertexFormat == EVertexFormat::ePacked ? sizeof(PackedVertex) : sizeof(Vertex);
+    header.VertexFormat = vertexFormat;
+    header.VertexDecodeSize = vertexDecodeSize;
+    header.VertexSize = vertexSize;
+    header.IndexSize = indexData.size();
+    header.SubMeshOffset = AlignOffset(sizeof(MeshFileHeader), 16);
+    header.MaterialOffset = AlignOffset(header.SubMeshOffset + submeshes.size() * sizeof(MeshFileSubMesh), 16);
+    header.VertexOffset = AlignOffset(header.MaterialOffset + materials.size() * sizeof(MeshFileMaterial), 16);
+    header.IndexOffset = AlignOffset(header.VertexOffset + vertexSize, 16);
+    header.MeshletOffset = AlignOffset(header.IndexOffset + header.IndexSize, 16);
+
+    std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        LNE_ERROR("Failed to create mesh file: {0}", destination.string());
+        return false;
+    }
+
+    auto writeAt = [&file](uint64_t offset, const void* data, uint64_t size)
+    {
+        static constexpr char padding[16]{};
+        file.write(padding, (std::streamsize)(offset - (uint64_t)file.tellp()));
+        file.write((const char*)data, (std::streamsize)size);
+    };
+    writeAt(0, &header, sizeof(MeshFileHeader));
+    writeAt(header.SubMeshOffset, submeshes.data(), submeshes.size() * sizeof(MeshFileSubMesh));
+    writeAt(header.MaterialOffset, materials.data(), materials.size() * sizeof(MeshFileMaterial));
+    writeAt(header.VertexOffset, vertexData, vertexSize);
+    writeAt(header.IndexOffset, indexData.data(), header.IndexSize);
+    writeAt(header.MeshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+    LNE_INFO("Cooked mesh {0}: {1} vertices ({2} bytes each), {3} indices ({4} bytes), {5} meshlets, {6} submeshes", source.filename().string(),
+        header.VertexCount, header.VertexStride, header.IndexCount, header.IndexSize, header.MeshletCount, header.SubMeshCount);
+    return (bool)file;
+}
+
+std::filesystem::path MeshFile::GetCookedPath(const std::filesystem::path& source)
+{
+    std::filesystem::path cooked = source;
+    return cooked.replace_extension(s_Extension);
+}
+
+bool MeshFile::IsUpToDate(const std::filesystem::path& source, const std::filesystem::path& cooked, EVertexFormat vertexFormat)
+{
+    std::error_code error;
+    auto cookedTime = std::filesystem::last_write_time(cooked, error);
+    if (error)
+        return false;
+
+    // files cooked by an older version are cooked again, even if they are newer than their source
+    MeshFileHeader header{};
+    std::ifstream file(cooked, std::ios::binary);
+    if (file.read((char*)&header, sizeof(MeshFileHeader)).good() == false || header.Version != MeshFileHeader::s_Version
+        || header.VertexFormat != vertexFormat)
+        return false;
+
+    auto sourceTime = std::filesystem::last_write_time(source, error);
+    // a cooked file without its source is still usable
+    return error || cookedTime >= sourceTime;
+}
+
+bool MeshFile::Open(const std::filesystem::path& path)
+{
+    auto& vfs = VirtualFileSystem::Get();
+    if ((m_Data = vfs.Map(path, m_Size)) == nullptr)
+    {
+        if (vfs.IsPacked(path))
+        {
+            m_Read = vfs.Read(path);
+            if (m_Read->Wait() == false)
+                return false;
+            m_Data = m_Read->GetData();
+            m_Size = m_Read->GetSize();
+        }
+        else
+        {
+            if (m_File.Open(path) == false)
+                return false;
+            m_Data = m_File.GetData();
+            m_Size = m_File.GetSize();
+        }
+    }
+
+    if (m_Size < sizeof(MeshFileHeader) || GetHeader().Magic != MeshFileHeader::s_Magic)
+    {
+        LNE_ERROR("Not a mesh file: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    const MeshFileHeader& header = GetHeader();
+    uint32_t vertexStride = header.VertexFormat == EVertexFormat::ePacked ? sizeof(PackedVertex) : sizeof(Vertex);
+    if (header.Version != MeshFileHeader::s_Version || header.VertexStride != vertexStride)
+    {
+        LNE_ERROR("Mesh file was cooked with an incompatible version, recook it: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    if (header.VertexOffset + header.VertexSize > m_Size
+        || header.IndexOffset + header.IndexSize > m_Size
+        || header.MeshletOffset + (uint64_t)header.MeshletCount * sizeof(Meshlet) > m_Size)
+    {
+        LNE_ERROR("Truncated mesh file: {0}", path.string());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::Close()
+{
+    m_File.Close();
+    m_Read.Reset();
+    m_Data = nullptr;
+    m_Size = 0;
+}
+}
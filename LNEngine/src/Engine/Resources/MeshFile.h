@@ -0,0 +1,121 @@
+#pragma once
+#include "Engine/Core/Utils/MappedFile.h"
+#include "Engine/Resources/AsyncFileReader.h"
+#include "Engine/Graphics/Mesh.h"
+
+namespace enki
+{
+class TaskScheduler;
+}
+
+namespace lne
+{
+/// <summary>
+/// Header of a cooked mesh file (.lnmesh).
+/// Every block is laid out exactly like its runtime counterpart so that the file can be memory mapped
+/// and the vertex and index blobs handed to the staging buffer as they are.
+/// </summary>
+struct MeshFileHeader
+{
+    static constexpr uint32_t s_Magic = 0x534D4E4C; // "LNMS"
+    // 2: triangles and vertices reordered by the MeshOptimizer
+    // 3: meshlets
+    // 4: levels of detail
+    // 5: optional packed vertices
+    // 6: 16 bit indices
+    // 7: normals transformed by the inverse transpose of the world transform
+    static constexpr uint32_t s_Version = 7;
+
+    uint32_t Magic{ s_Magic };
+    uint32_t Version{ s_Version };
+    uint32_t VertexCount{};
+    uint32_t IndexCount{};
+    uint32_t SubMeshCount{};
+    uint32_t MaterialCount{};
+    uint32_t MeshletCount{};
+    uint32_t VertexStride{ sizeof(Vertex) };
+    EVertexFormat VertexFormat{ EVertexFormat::eFloat };
+    // the vertex block starts with the decoding header of packed vertices, it is uploaded whole
+    uint32_t VertexDecodeSize{};
+    uint64_t VertexSize{};
+    // the index block mixes the 16 and 32 bit indices of the submeshes
+    uint64_t IndexSize{};
+
+    uint64_t SubMeshOffset{};
+    uint64_t MaterialOffset{};
+    uint64_t VertexOffset{};
+    uint64_t IndexOffset{};
+    uint64_t MeshletOffset{};
+};
+
+struct MeshFileSubMesh
+{
+    uint32_t BaseVertex;
+    uint32_t VertexCount;
+    uint32_t IndexStride;
+    uint32_t LodCount;
+    uint32_t MaterialIndex;
+    AABB BoundingBox;
+    glm::mat4 WorldTransform;
+    char Name[64];
+    MeshLod Lods[MeshLod::s_MaxCount];
+};
+
+struct MeshFileMaterial
+{
+    char Name[64];
+    glm::vec4 Color;
+    float Metalness;
+    float Roughness;
+    uint32_t HasColor;
+    // relative to the source model, empty if the material has no albedo texture
+    char AlbedoPath[260];
+};
+
+class MeshFile
+{
+public:
+    static constexpr std::string_view s_Extension = ".lnmesh";
+
+    /// <summary>
+    /// Imports a model with Assimp and writes it as a .lnmesh file. This is the only place where Assimp runs.
+    /// The vertices are baked and the submeshes optimized in parallel on the scheduler when there is one.
+    /// </summary>
+    static bool Cook(const std::filesystem::path& source, const std::filesystem::path& destination,
+        EVertexFormat vertexFormat = EVertexFormat::eFloat, std::shared_ptr<enki::TaskScheduler> scheduler = nullptr);
+
+    [[nodiscard]] static std::filesystem::path GetCookedPath(const std::filesystem::path& source);
+    [[nodiscard]] static bool IsMeshFile(const std::filesystem::path& path) { return path.extension() == s_Extension; }
+    /// <summary>
+    /// False when the source changed since, or the cooked file has another version or vertex format.
+    /// </summary>
+    [[nodiscard]] static bool IsUpToDate(const std::filesystem::path& source, const std::filesystem::path& cooked,
+        EVertexFormat vertexFormat = EVertexFormat::eFloat);
+
+public:
+    /// <summary>
+    /// Maps the file and validates its header. The pointers returned by the getters stay valid as long as this object lives.
+    /// Packed files are used in place from the mounted archive, or decompressed if they were stored compressed.
+    /// </summary>
+    [[nodiscard]] bool Open(const std::filesystem::path& path);
+
+    [[nodiscard]] const MeshFileHeader& GetHeader() const { return *(const MeshFileHeader*)m_Data; }
+    [[nodiscard]] const MeshFileSubMesh* GetSubMeshes() const { return (const MeshFileSubMesh*)(m_Data + GetHeader().SubMeshOffset); }
+    [[nodiscard]] const MeshFileMaterial* GetMaterials() const { return (const MeshFileMaterial*)(m_Data + GetHeader().MaterialOffset); }
+    // Vertex or PackedVertex after their decoding header, GetHeader().VertexSize bytes
+    [[nodiscard]] const uint8_t* GetVertexData() const { return m_Data + GetHeader().VertexOffset; }
+    // uint16_t or uint32_t per submesh, GetHeader().IndexSize bytes
+    [[nodiscard]] const uint8_t* GetIndexData() const { return m_Data + GetHeader().IndexOffset; }
+    [[nodiscard]] const Meshlet* GetMeshlets() const { return (const Meshlet*)(m_Data + GetHeader().MeshletOffset); }
+
+private:
+    // loose files are mapped, compressed packed ones are read
+    MappedFile m_File;
+    SafePtr<FileRead> m_Read;
+    const uint8_t* m_Data{ nullptr };
+    uint64_t m_Size{ 0 };
+
+private:
+    void Close();
+};
+}
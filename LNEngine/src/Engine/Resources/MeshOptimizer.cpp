@@ -0,0 +1,664 @@
+#include <numeric>
+
+#include "Graphics/Mesh.h"
+
+#include "MeshOptimizer.h"
+
+namespace lne
+{
+namespace
+{
+constexpr uint32_t s_InvalidIndex = ~0u;
+
+// Forsyth's parameters, the LRU cache he simulates is larger than the FIFO the hardware uses
+constexpr uint32_t s_ForsythCacheSize = 32;
+constexpr float s_CacheDecayPower = 1.5f;
+constexpr float s_LastTriangleScore = 0.75f;
+constexpr float s_ValenceBoostScale = 2.0f;
+constexpr float s_ValenceBoostPower = 0.5f;
+constexpr uint32_t s_MaxTabulatedValence = 32;
+
+struct ForsythTables
+{
+    std::array<float, s_ForsythCacheSize> Cache{};
+    std::array<float, s_MaxTabulatedValence + 1> Valence{};
+
+    ForsythTables()
+    {
+        for (uint32_t i = 0; i < s_ForsythCacheSize; ++i)
+        {
+            // the vertices of the last triangle get a fixed score, not to favor one of its edges over the others
+            if (i < 3)
+                Cache[i] = s_LastTriangleScore;
+            else
+                Cache[i] = std::pow(1.0f - (float)(i - 3) / (float)(s_ForsythCacheSize - 3), s_CacheDecayPower);
+        }
+        Valence[0] = 0.0f;
+        for (uint32_t i = 1; i <= s_MaxTabulatedValence; ++i)
+            Valence[i] = s_ValenceBoostScale * std::pow((float)i, -s_ValenceBoostPower);
+    }
+
+    float GetScore(int32_t cachePosition, uint32_t liveTriangles) const
+    {
+        // no triangle left to draw with it, never picked again
+        if (liveTriangles == 0)
+            return -1.0f;
+
+        float score = cachePosition >= 0 ? Cache[cachePosition] : 0.0f;
+        // the vertices with few triangles left are finished first, they would be loaded again later otherwise
+        score += liveTriangles <= s_MaxTabulatedValence ? Valence[liveTriangles]
+            : s_ValenceBoostScale * std::pow((float)liveTriangles, -s_ValenceBoostPower);
+        return score;
+    }
+};
+
+// FIFO post-transform cache, a vertex is cached while fewer than cacheSize misses happened since it was loaded
+struct FifoCache
+{
+    std::vector<uint32_t> Timestamps;
+    uint32_t Timestamp;
+    uint32_t Size;
+
+    FifoCache(uint32_t vertexCount, uint32_t size)
+        : Timestamps(vertexCount, 0), Timestamp(size + 1), Size(size)
+    {
+    }
+
+    uint32_t Access(uint32_t vertex)
+    {
+        if (Timestamp - Timestamps[vertex] > Size)
+        {
+            Timestamps[vertex] = Timestamp++;
+            return 1;
+        }
+        return 0;
+    }
+
+    uint32_t AccessTriangle(const uint32_t* triangle) { return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]); }
+
+    void Flush() { Timestamp += Size + 1; }
+};
+
+// below this the cone is too wide, the cluster faces away from almost no viewpoint
+constexpr float s_MinConeDot = 0.1f;
+
+void ComputeMeshletBounds(Meshlet& meshlet, const uint32_t* indices, const Vertex* vertices)
+{
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.IndexCount; ++i)
+    {
+        min = glm::min(min, vertices[indices[i]].Position);
+        max = glm::max(max, vertices[indices[i]].Position);
+    }
+    meshlet.Center = (min + max) * 0.5f;
+    meshlet.Radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.IndexCount; ++i)
+        meshlet.Radius = std::max(meshlet.Radius, glm::distance(meshlet.Center, vertices[indices[i]].Position));
+
+    std::array<glm::vec3, Meshlet::s_MaxTriangles> normals;
+    uint32_t normalCount = 0;
+    glm::vec3 normalSum(0.0f);
+    for (uint32_t i = 0; i < meshlet.IndexCount; i += 3)
+    {
+        const glm::vec3& p0 = vertices[indices[i]].Position;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+        float length = glm::length(normal);
+        // degenerate triangles are never rasterized
+        if (length == 0.0f)
+            continue;
+        normals[normalCount++] = normal / length;
+        normalSum += normal / length;
+    }
+
+    meshlet.ConeApex = meshlet.Center;
+    meshlet.ConeAxis = glm::vec3(0.0f);
+    meshlet.ConeCutoff = 1.0f;
+    float axisLength = glm::length(normalSum);
+    if (normalCount == 0 || axisLength == 0.0f)
+        return;
+
+    glm::vec3 axis = normalSum / axisLength;
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < normalCount; ++i)
+        minDot = std::min(minDot, glm::dot(normals[i], axis));
+    if (minDot <= s_MinConeDot)
+        return;
+
+    // the apex is moved back along the axis until it is behind the plane of every triangle
+    float maxDistance = 0.0f;
+    for (uint32_t i = 0, n = 0; i < meshlet.IndexCount; i += 3)
+    {
+        const glm::vec3& p0 = vertices[indices[i]].Position;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+        if (glm::length(normal) == 0.0f)
+            continue;
+        maxDistance = std::max(maxDistance, glm::dot(meshlet.Center - p0, normals[n]) / glm::dot(axis, normals[n]));
+        ++n;
+    }
+    meshlet.ConeApex = meshlet.Center - axis * maxDistance;
+    meshlet.ConeAxis = axis;
+    // the eye is behind every triangle when it is outside the normal cone widened by 90 degrees: sin of its half angle
+    meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// sum of the squared distances to a set of planes, weighted by the area of their triangles
+struct Quadric
+{
+    // symmetric matrix A, vector b and scalar c of x^T A x + 2 b^T x + c
+    double A00{ 0.0 }, A01{ 0.0 }, A02{ 0.0 }, A11{ 0.0 }, A12{ 0.0 }, A22{ 0.0 };
+    double B0{ 0.0 }, B1{ 0.0 }, B2{ 0.0 };
+    double C{ 0.0 };
+    double Weight{ 0.0 };
+
+    void AddPlane(const glm::dvec3& normal, double distance, double weight)
+    {
+        A00 += weight * normal.x * normal.x;
+        A01 += weight * normal.x * normal.y;
+        A02 += weight * normal.x * normal.z;
+        A11 += weight * normal.y * normal.y;
+        A12 += weight * normal.y * normal.z;
+        A22 += weight * normal.z * normal.z;
+        B0 += weight * normal.x * distance;
+        B1 += weight * normal.y * distance;
+        B2 += weight * normal.z * distance;
+        C += weight * distance * distance;
+        Weight += weight;
+    }
+
+    void Add(const Quadric& other)
+    {
+        A00 += other.A00; A01 += other.A01; A02 += other.A02;
+        A11 += other.A11; A12 += other.A12; A22 += other.A22;
+        B0 += other.B0; B1 += other.B1; B2 += other.B2;
+        C += other.C;
+        Weight += other.Weight;
+    }
+
+    // mean squared distance of the point to the planes
+    [[nodiscard]] double Evaluate(const glm::vec3& point) const
+    {
+        if (Weight == 0.0)
+            return 0.0;
+
+        double x = point.x, y = point.y, z = point.z;
+        double error = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z)
+            + 2.0 * (B0 * x + B1 * y + B2 * z) + C;
+        return std::max(error, 0.0) / Weight;
+    }
+};
+
+// cosine of the largest turn of a triangle normal allowed by a collapse, about 75 degrees
+constexpr float s_MaxNormalTurnCos = 0.25f;
+
+struct EdgeCollapse
+{
+    uint32_t From;
+    uint32_t To;
+    double Cost;
+};
+}
+
+float MeshOptimizer::ComputeACMR(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    if (indexCount < 3)
+        return 0.0f;
+
+    FifoCache cache(vertexCount, cacheSize);
+    uint64_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+        misses += cache.Access(indices[i]);
+    return (float)misses / (float)(indexCount / 3);
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+    static const ForsythTables s_Tables;
+
+    uint32_t triangleCount = (uint32_t)(indexCount / 3);
+    if (triangleCount == 0)
+        return;
+
+    // triangles of every vertex, the first LiveTriangles of its range are the ones not drawn yet
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+        ++liveTriangles[indices[i]];
+    std::vector<uint32_t> adjacencyOffsets(vertexCount, 0);
+    for (uint32_t v = 1; v < vertexCount; ++v)
+        adjacencyOffsets[v] = adjacencyOffsets[v - 1] + liveTriangles[v - 1];
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets);
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+                adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        vertexScores[v] = s_Tables.GetScore(-1, liveTriangles[v]);
+
+    auto getTriangleScore = [&](uint32_t t)
+    {
+        const uint32_t* triangle = indices + t * 3;
+        return vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+    };
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    uint32_t bestTriangle = 0;
+    float bestScore = getTriangleScore(0);
+    for (uint32_t t = 1; t < triangleCount; ++t)
+    {
+        float score = getTriangleScore(t);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+    // 3 more entries than the simulated size: the vertices pushed out by a triangle are scored once more before leaving
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(s_ForsythCacheSize + 3);
+    nextCache.reserve(s_ForsythCacheSize + 3);
+    uint32_t inputCursor = 0;
+
+    for (uint32_t emitted = 0; emitted < triangleCount; ++emitted)
+    {
+        if (bestTriangle == s_InvalidIndex)
+        {
+            // dead end, nothing in the cache has triangles left: continue with the next triangle in input order
+            while (isEmitted[inputCursor])
+                ++inputCursor;
+            bestTriangle = inputCursor;
+        }
+
+        const uint32_t* triangle = indices + bestTriangle * 3;
+        result.insert(result.end(), triangle, triangle + 3);
+        isEmitted[bestTriangle] = true;
+
+        nextCache.clear();
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t vertex = triangle[k];
+            nextCache.push_back(vertex);
+
+            // swap the triangle out of the live range of the vertex
+            uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            uint32_t* end = begin + liveTriangles[vertex];
+            uint32_t* it = std::find(begin, end, bestTriangle);
+            std::swap(*it, *(end - 1));
+            --liveTriangles[vertex];
+        }
+        for (uint32_t vertex : cache)
+        {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                nextCache.push_back(vertex);
+        }
+        std::swap(cache, nextCache);
+
+        // rescores the cached vertices and the triangles that use them, the best one is drawn next
+        bestTriangle = s_InvalidIndex;
+        bestScore = -1.0f;
+        for (uint32_t i = 0; i < (uint32_t)cache.size(); ++i)
+        {
+            uint32_t vertex = cache[i];
+            cachePositions[vertex] = i < s_ForsythCacheSize ? (int32_t)i : -1;
+            vertexScores[vertex] = s_Tables.GetScore(cachePositions[vertex], liveTriangles[vertex]);
+        }
+        for (uint32_t vertex : cache)
+        {
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            for (const uint32_t* it = begin; it != begin + liveTriangles[vertex]; ++it)
+            {
+                float score = getTriangleScore(*it);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = *it;
+                }
+            }
+        }
+        if (cache.size() > s_ForsythCacheSize)
+            cache.resize(s_ForsythCacheSize);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, uint32_t vertexCount, float threshold)
+{
+    uint32_t triangleCount = (uint32_t)(indexCount / 3);
+    if (triangleCount == 0)
+        return;
+
+    FifoCache cache(vertexCount, s_ReportCacheSize);
+
+    // hard boundaries: a triangle that misses with its 3 vertices usually starts another patch of the surface
+    std::vector<uint32_t> hardClusters;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        if (cache.AccessTriangle(indices + t * 3) == 3 || t == 0)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // soft boundaries: a hard cluster is split again wherever the part before the split is about as cache friendly as the whole
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+    {
+        uint32_t begin = hardClusters[c];
+        uint32_t end = hardClusters[c + 1];
+
+        cache.Flush();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+            clusterMisses += cache.AccessTriangle(indices + t * 3);
+        float clusterThreshold = threshold * (float)clusterMisses / (float)(end - begin);
+
+        clusters.push_back(begin);
+        cache.Flush();
+        uint32_t runningMisses = 0;
+        uint32_t runningTriangles = 0;
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            runningMisses += cache.AccessTriangle(indices + t * 3);
+            ++runningTriangles;
+            if (t + 1 < end && (float)runningMisses / (float)runningTriangles <= clusterThreshold)
+            {
+                clusters.push_back(t + 1);
+                cache.Flush();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    auto getPosition = [&](uint32_t t, uint32_t k) { return vertices[indices[t * 3 + k]].Position; };
+
+    glm::vec3 meshCentroid{ 0.0f };
+    float meshArea = 0.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        glm::vec3 p0 = getPosition(t, 0), p1 = getPosition(t, 1), p2 = getPosition(t, 2);
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * area;
+        meshArea += area;
+    }
+    meshCentroid /= meshArea > 0.0f ? meshArea * 3.0f : 1.0f;
+
+    // the clusters facing away from the center are in front of the others from most directions, they are drawn first
+    std::vector<float> sortKeys(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); ++c)
+    {
+        glm::vec3 centroid{ 0.0f };
+        glm::vec3 normal{ 0.0f };
+        float area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            glm::vec3 p0 = getPosition(t, 0), p1 = getPosition(t, 1), p2 = getPosition(t, 2);
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            centroid += (p0 + p1 + p2) * faceArea;
+            normal += faceNormal;
+            area += faceArea;
+        }
+        float normalLength = glm::length(normal);
+        if (area <= 0.0f || normalLength <= 0.0f)
+            continue;
+        centroid /= area * 3.0f;
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal / normalLength);
+    }
+
+    std::vector<uint32_t> order(sortKeys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+    for (uint32_t c : order)
+        result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    std::copy(result.begin(), result.end(), indices);
+}
+
+uint32_t MeshOptimizer::OptimizeVertexFetch(Vertex* vertices, uint32_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, s_InvalidIndex);
+    std::vector<Vertex> result;
+    result.reserve(vertexCount);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& index = indices[i];
+        if (remap[index] == s_InvalidIndex)
+        {
+            remap[index] = (uint32_t)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    std::copy(result.begin(), result.end(), vertices);
+    return (uint32_t)result.size();
+}
+
+float MeshOptimizer::Simplify(const uint32_t* indices, size_t indexCount, const Vertex* vertices, uint32_t vertexCount,
+    size_t targetIndexCount, float maxError, std::vector<uint32_t>& result)
+{
+    result.assign(indices, indices + indexCount / 3 * 3);
+    if (result.size() <= targetIndexCount)
+        return 0.0f;
+
+    // vertices sharing a position are the sides of an attribute seam, collapsing one of them would open a crack
+    std::vector<bool> isLocked(vertexCount, false);
+    std::vector<uint32_t> sortedVertices(vertexCount);
+    std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+    auto positionLess = [&](uint32_t a, uint32_t b)
+    {
+        const glm::vec3& pa = vertices[a].Position;
+        const glm::vec3& pb = vertices[b].Position;
+        return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+    };
+    std::sort(sortedVertices.begin(), sortedVertices.end(), positionLess);
+    for (uint32_t i = 1; i < vertexCount; ++i)
+    {
+        if (vertices[sortedVertices[i - 1]].Position == vertices[sortedVertices[i]].Position)
+            isLocked[sortedVertices[i - 1]] = isLocked[sortedVertices[i]] = true;
+    }
+
+    // so do the vertices of the borders, where a half-edge has no opposite, and of the edges shared by more than two triangles
+    std::unordered_map<uint64_t, uint32_t> halfEdges;
+    auto edgeKey = [](uint32_t from, uint32_t to) { return (uint64_t)from << 32 | to; };
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+            ++halfEdges[edgeKey(result[i + k], result[i + (k + 1) % 3])];
+    }
+    for (const auto& [key, count] : halfEdges)
+    {
+        uint32_t from = (uint32_t)(key >> 32);
+        uint32_t to = (uint32_t)key;
+        if (count > 1 || halfEdges.contains(edgeKey(to, from)) == false)
+            isLocked[from] = isLocked[to] = true;
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        glm::dvec3 p0 = vertices[result[i]].Position;
+        glm::dvec3 normal = glm::cross(glm::dvec3(vertices[result[i + 1]].Position) - p0, glm::dvec3(vertices[result[i + 2]].Position) - p0);
+        double doubleArea = glm::length(normal);
+        if (doubleArea == 0.0)
+            continue;
+
+        normal /= doubleArea;
+        for (uint32_t k = 0; k < 3; ++k)
+            quadrics[result[i + k]].AddPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+    }
+
+    // the costs are compared squared
+    double maxCost = (double)maxError * (double)maxError;
+    double reachedCost = 0.0;
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::iota(remap.begin(), remap.end(), 0);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<EdgeCollapse> collapses;
+    std::vector<bool> isCollapsed(vertexCount);
+
+    // moving the vertex onto the other end of the edge must not turn any of its remaining triangles over, nor close to it:
+    // several passes of small turns would add up to a fold
+    auto flipsTriangles = [&](const EdgeCollapse& collapse)
+    {
+        const glm::vec3& target = vertices[collapse.To].Position;
+        for (uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; ++a)
+        {
+            const uint32_t* triangle = result.data() + adjacency[a] * 3;
+            std::array<uint32_t, 3> corners{ remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] };
+            if (corners[0] == collapse.To || corners[1] == collapse.To || corners[2] == collapse.To)
+                continue;
+
+            std::array<glm::vec3, 3> before{ vertices[corners[0]].Position, vertices[corners[1]].Position, vertices[corners[2]].Position };
+            std::array<glm::vec3, 3> after = before;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (corners[k] == collapse.From)
+                    after[k] = target;
+            }
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(normalBefore, normalAfter) <= s_MaxNormalTurnCos * glm::length(normalBefore) * glm::length(normalAfter))
+                return true;
+        }
+        return false;
+    };
+
+    // each pass collapses the cheapest edges whose vertices weren't touched yet, then rebuilds the triangles
+    while (result.size() > targetIndexCount)
+    {
+        uint32_t triangleCount = (uint32_t)(result.size() / 3);
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result)
+            ++adjacencyOffsets[index + 1];
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+                adjacency[fill[result[t * 3 + k]]++] = t;
+        }
+
+        // an interior edge is seen from both of its triangles, it is only listed from the one where it goes up
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                uint32_t v0 = result[i + k];
+                uint32_t v1 = result[i + (k + 1) % 3];
+                if (v0 > v1)
+                    continue;
+                if (isLocked[v0] == false)
+                    collapses.push_back({ v0, v1, quadrics[v0].Evaluate(vertices[v1].Position) });
+                if (isLocked[v1] == false)
+                    collapses.push_back({ v1, v0, quadrics[v1].Evaluate(vertices[v0].Position) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.Cost < b.Cost; });
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t removedTriangles = 0;
+        uint32_t collapseCount = 0;
+        std::fill(isCollapsed.begin(), isCollapsed.end(), false);
+        for (const EdgeCollapse& collapse : collapses)
+        {
+            if (collapse.Cost > maxCost || removedTriangles >= trianglesToRemove)
+                break;
+            if (isCollapsed[collapse.From] || isCollapsed[collapse.To] || flipsTriangles(collapse))
+                continue;
+
+            for (uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; ++a)
+            {
+                const uint32_t* triangle = result.data() + adjacency[a] * 3;
+                removedTriangles += remap[triangle[0]] == collapse.To || remap[triangle[1]] == collapse.To || remap[triangle[2]] == collapse.To;
+            }
+            remap[collapse.From] = collapse.To;
+            quadrics[collapse.To].Add(quadrics[collapse.From]);
+            // neither end moves again in this pass, the adjacency and the flip test stay exact
+            isCollapsed[collapse.From] = isCollapsed[collapse.To] = true;
+            reachedCost = std::max(reachedCost, collapse.Cost);
+            ++collapseCount;
+        }
+        if (collapseCount == 0)
+            break;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t v0 = remap[result[i]];
+            uint32_t v1 = remap[result[i + 1]];
+            uint32_t v2 = remap[result[i + 2]];
+            if (v0 == v1 || v1 == v2 || v0 == v2)
+                continue;
+            result[kept++] = v0;
+            result[kept++] = v1;
+            result[kept++] = v2;
+        }
+        result.resize(kept);
+    }
+
+    return (float)std::sqrt(reachedCost);
+}
+
+void MeshOptimizer::BuildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, uint32_t vertexCount,
+    uint32_t baseIndex, std::vector<Meshlet>& meshlets)
+{
+    // index of the last meshlet that used each vertex
+    std::vector<uint32_t> vertexMeshlets(vertexCount, s_InvalidIndex);
+    uint32_t meshletIndex = 0;
+    uint32_t meshletVertices = 0;
+    size_t meshletBegin = 0;
+
+    auto emitMeshlet = [&](size_t end)
+    {
+        Meshlet meshlet{};
+        meshlet.BaseIndex = (uint32_t)meshletBegin;
+        meshlet.IndexCount = (uint32_t)(end - meshletBegin);
+        ComputeMeshletBounds(meshlet, indices + meshletBegin, vertices);
+        meshlet.BaseIndex += baseIndex;
+        meshlets.push_back(meshlet);
+
+        ++meshletIndex;
+        meshletVertices = 0;
+        meshletBegin = end;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32_t* triangle = indices + i;
+        uint32_t newVertices = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+            newVertices += vertexMeshlets[triangle[k]] != meshletIndex;
+        // a repeated index is counted twice, the budget only gets stricter
+        if (meshletVertices + newVertices > Meshlet::s_MaxVertices || (i - meshletBegin) / 3 == Meshlet::s_MaxTriangles)
+        {
+            emitMeshlet(i);
+            newVertices = 3;
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+            vertexMeshlets[triangle[k]] = meshletIndex;
+        meshletVertices += newVertices;
+    }
+    if (meshletBegin < indexCount / 3 * 3)
+        emitMeshlet(indexCount / 3 * 3);
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace lne
+{
+/// <summary>
+/// Import time reordering of indexed triangle lists, run by MeshFile::Cook on every submesh. With vertex pulling each
+/// post-transform cache miss is an extra storage buffer fetch in the vertex shader, the passes are run in this order:
+/// OptimizeVertexCache, OptimizeOverdraw (which keeps most of the cache locality) then OptimizeVertexFetch.
+/// Simplify derives the coarser levels of detail from the result, BuildMeshlets splits each level in clusters.
+/// The indices are local to the vertices passed along.
+/// </summary>
+class MeshOptimizer
+{
+public:
+    // FIFO size used to report the ACMR, close to the post-transform caches of current GPUs
+    static constexpr uint32_t s_ReportCacheSize = 16;
+
+    /// <summary>
+    /// Average cache miss ratio: vertex shader invocations per triangle with a FIFO cache of the given size.
+    /// 3 is the worst, 0.5 the best a regular grid can reach.
+    /// </summary>
+    [[nodiscard]] static float ComputeACMR(const uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = s_ReportCacheSize);
+
+    /// <summary>
+    /// Reorders the triangles for the post-transform cache with Forsyth's linear speed algorithm.
+    /// </summary>
+    static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+    /// <summary>
+    /// Splits the cache optimized triangles in clusters and sorts the clusters from the outside in, so that the triangles
+    /// drawn first tend to occlude the others (Sander, Nehab and Barczak 2007). A cluster boundary is only added where the
+    /// ACMR of the cluster stays under threshold times the one of the mesh.
+    /// </summary>
+    static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const struct Vertex* vertices, uint32_t vertexCount, float threshold = 1.05f);
+    /// <summary>
+    /// Renumbers the vertices in the order the triangles first use them and moves them accordingly. The unreferenced
+    /// vertices are dropped, returns the number of vertices kept.
+    /// </summary>
+    [[nodiscard]] static uint32_t OptimizeVertexFetch(struct Vertex* vertices, uint32_t* indices, size_t indexCount, uint32_t vertexCount);
+    /// <summary>
+    /// Removes triangles by collapsing edges in the order of their quadric error (Garland and Heckbert 1997). A vertex is
+    /// collapsed onto one of its neighbours and never moved, so that every level shares the vertices of the full detail one.
+    /// The vertices on a border, a non-manifold edge or an attribute seam are kept. Stops at targetIndexCount or before the
+    /// surface moves more than maxError. Writes the remaining triangles and returns the error reached, both in the units
+    /// of the positions.
+    /// </summary>
+    [[nodiscard]] static float Simplify(const uint32_t* indices, size_t indexCount, const struct Vertex* vertices, uint32_t vertexCount,
+        size_t targetIndexCount, float maxError, std::vector<uint32_t>& result);
+    /// <summary>
+    /// Cuts the triangles in meshlets without reordering them, a meshlet ends when the next triangle would exceed its vertex
+    /// or triangle budget. Appends the meshlets with their bounding sphere and normal cone, baseIndex is added to their range.
+    /// </summary>
+    static void BuildMeshlets(const uint32_t* indices, size_t indexCount, const struct Vertex* vertices, uint32_t vertexCount,
+        uint32_t baseIndex, std::vector<struct Meshlet>& meshlets);
+};
+}
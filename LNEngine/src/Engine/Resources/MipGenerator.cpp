@@ -0,0 +1,265 @@
+#include "MipGenerator.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#define LNE_MIP_SSE
+#endif
+
+namespace lne
+{
+namespace
+{
+constexpr uint32_t s_MaxTaps = 6;
+// resolution of the linear to sRGB table, fine enough to round the darkest sRGB values right
+constexpr uint32_t s_LinearSteps = 65535;
+
+struct MipKernel
+{
+    // offset of the first tap from the first of the two source texels under the destination texel
+    int32_t First;
+    uint32_t Count;
+    float Weights[s_MaxTaps];
+};
+
+float SrgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (uint32_t k = 1; k < 32; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+const MipKernel& GetKernel(EMipFilter filter)
+{
+    static const MipKernel box{ 0, 2, { 0.5f, 0.5f } };
+    static const MipKernel kaiser = []()
+    {
+        // the source texel centers sit at 0.5, 1.5 and 2.5 texels on each side of the destination texel center,
+        // the sinc is stretched to the destination rate and windowed over 3 source texels
+        constexpr double alpha = 4.0;
+        constexpr double radius = 3.0;
+        constexpr double pi = 3.14159265358979323846;
+
+        MipKernel kernel{ -2, 6, {} };
+        double total = 0.0;
+        double weights[s_MaxTaps]{};
+        for (uint32_t i = 0; i < kernel.Count; ++i)
+        {
+            double distance = std::abs((double)i - 2.5);
+            double x = pi * distance * 0.5;
+            double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+            double ratio = distance / radius;
+            double window = BesselI0(alpha * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / BesselI0(alpha);
+            weights[i] = sinc * window;
+            total += weights[i];
+        }
+        for (uint32_t i = 0; i < kernel.Count; ++i)
+            kernel.Weights[i] = (float)(weights[i] / total);
+        return kernel;
+    }();
+    return filter == EMipFilter::eKaiser ? kaiser : box;
+}
+
+struct ConversionTables
+{
+    float SrgbToLinear[256];
+    float UnormToFloat[256];
+    uint8_t LinearToSrgb[s_LinearSteps + 1];
+};
+
+const ConversionTables& GetTables()
+{
+    static const std::unique_ptr<ConversionTables> tables = []()
+    {
+        auto tables = std::make_unique<ConversionTables>();
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            tables->SrgbToLinear[i] = SrgbToLinear(i / 255.0f);
+            tables->UnormToFloat[i] = i / 255.0f;
+        }
+        for (uint32_t i = 0; i <= s_LinearSteps; ++i)
+            tables->LinearToSrgb[i] = (uint8_t)(LinearToSrgb((float)i / s_LinearSteps) * 255.0f + 0.5f);
+        return tables;
+    }();
+    return *tables;
+}
+
+// decodes a row to linear RGBA floats
+void ToLinear(const uint8_t* src, uint32_t width, bool isSrgb, float* dst)
+{
+    const ConversionTables& tables = GetTables();
+    const float* color = isSrgb ? tables.SrgbToLinear : tables.UnormToFloat;
+    for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+    {
+        dst[0] = color[src[0]];
+        dst[1] = color[src[1]];
+        dst[2] = color[src[2]];
+        dst[3] = tables.UnormToFloat[src[3]];
+    }
+}
+
+// filters a linear row horizontally to the destination width
+void FilterRow(const float* src, uint32_t srcWidth, float* dst, uint32_t dstWidth, const MipKernel& kernel)
+{
+    int32_t last = (int32_t)srcWidth - 1;
+    for (uint32_t x = 0; x < dstWidth; ++x, dst += 4)
+    {
+        int32_t first = (int32_t)x * 2 + kernel.First;
+#ifdef LNE_MIP_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t i = 0; i < kernel.Count; ++i)
+        {
+            int32_t sx = std::clamp(first + (int32_t)i, 0, last);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + sx * 4), _mm_set1_ps(kernel.Weights[i])));
+        }
+        _mm_storeu_ps(dst, sum);
+#else
+        float sum[4]{};
+        for (uint32_t i = 0; i < kernel.Count; ++i)
+        {
+            const float* texel = src + std::clamp(first + (int32_t)i, 0, last) * 4;
+            for (uint32_t c = 0; c < 4; ++c)
+                sum[c] += texel[c] * kernel.Weights[i];
+        }
+        memcpy(dst, sum, sizeof(sum));
+#endif
+    }
+}
+
+// dst = sum of rows[i] * weights[i], over count floats
+void BlendRows(const float* const* rows, const float* weights, uint32_t rowCount, float* dst, uint32_t count)
+{
+    uint32_t i = 0;
+#ifdef __AVX__
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (uint32_t r = 0; r < rowCount; ++r)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[r] + i), _mm256_set1_ps(weights[r])));
+        _mm256_storeu_ps(dst + i, sum);
+    }
+#endif
+#ifdef LNE_MIP_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t r = 0; r < rowCount; ++r)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[r] + i), _mm_set1_ps(weights[r])));
+        _mm_storeu_ps(dst + i, sum);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        float sum = 0.0f;
+        for (uint32_t r = 0; r < rowCount; ++r)
+            sum += rows[r][i] * weights[r];
+        dst[i] = sum;
+    }
+}
+
+// encodes linear RGBA floats back to RGBA8, the negative lobes of the kernel can overshoot so the values are clamped
+void FromLinear(const float* src, uint32_t width, bool isSrgb, uint8_t* dst)
+{
+    const uint8_t* toSrgb = GetTables().LinearToSrgb;
+    for (uint32_t x = 0; x < width; ++x, src += 4, dst += 4)
+    {
+        int32_t steps[4];
+        int32_t bytes[4];
+#ifdef LNE_MIP_SSE
+        __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        _mm_storeu_si128((__m128i*)steps, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps((float)s_LinearSteps)), _mm_set1_ps(0.5f))));
+        _mm_storeu_si128((__m128i*)bytes, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f))));
+#else
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            float value = std::clamp(src[c], 0.0f, 1.0f);
+            steps[c] = (int32_t)(value * s_LinearSteps + 0.5f);
+            bytes[c] = (int32_t)(value * 255.0f + 0.5f);
+        }
+#endif
+        for (uint32_t c = 0; c < 3; ++c)
+            dst[c] = isSrgb ? toSrgb[steps[c]] : (uint8_t)bytes[c];
+        dst[3] = (uint8_t)bytes[3];
+    }
+}
+}
+
+uint64_t MipGenerator::GetMipOffset(uint32_t width, uint32_t height, uint32_t mip, uint32_t layerCount)
+{
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < mip; ++i)
+        offset += (uint64_t)std::max(1u, width >> i) * std::max(1u, height >> i) * 4 * layerCount;
+    return offset;
+}
+
+void MipGenerator::Downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight,
+    uint32_t rowBegin, uint32_t rowEnd, EMipFilter filter, bool isSrgb)
+{
+    const MipKernel& kernel = GetKernel(filter);
+    rowEnd = std::min(rowEnd, dstHeight);
+
+    // the horizontally filtered source rows, the consecutive destination rows of the wide kernel share most of them
+    std::vector<float> linear((size_t)srcWidth * 4);
+    std::vector<float> cache((size_t)kernel.Count * dstWidth * 4);
+    int32_t cachedRows[s_MaxTaps];
+    std::fill(std::begin(cachedRows), std::end(cachedRows), -1);
+    std::vector<float> blended((size_t)dstWidth * 4);
+
+    int32_t last = (int32_t)srcHeight - 1;
+    for (uint32_t y = rowBegin; y < rowEnd; ++y)
+    {
+        const float* rows[s_MaxTaps];
+        int32_t first = (int32_t)y * 2 + kernel.First;
+        for (uint32_t i = 0; i < kernel.Count; ++i)
+        {
+            // the taps cover consecutive rows, they never share a slot
+            int32_t sy = std::clamp(first + (int32_t)i, 0, last);
+            uint32_t slot = (uint32_t)sy % kernel.Count;
+            float* row = cache.data() + (size_t)slot * dstWidth * 4;
+            if (cachedRows[slot] != sy)
+            {
+                ToLinear(src + (size_t)sy * srcWidth * 4, srcWidth, isSrgb, linear.data());
+                FilterRow(linear.data(), srcWidth, row, dstWidth, kernel);
+                cachedRows[slot] = sy;
+            }
+            rows[i] = row;
+        }
+
+        BlendRows(rows, kernel.Weights, kernel.Count, blended.data(), dstWidth * 4);
+        FromLinear(blended.data(), dstWidth, isSrgb, dst + (size_t)y * dstWidth * 4);
+    }
+}
+
+void MipGenerator::GenerateChain(uint8_t* chain, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t layerCount,
+    EMipFilter filter, bool isSrgb)
+{
+    for (uint32_t mip = 1; mip < mipCount; ++mip)
+    {
+        uint32_t srcWidth = std::max(1u, width >> (mip - 1));
+        uint32_t srcHeight = std::max(1u, height >> (mip - 1));
+        uint32_t dstWidth = std::max(1u, width >> mip);
+        uint32_t dstHeight = std::max(1u, height >> mip);
+        uint8_t* src = chain + GetMipOffset(width, height, mip - 1, layerCount);
+        uint8_t* dst = chain + GetMipOffset(width, height, mip, layerCount);
+        for (uint32_t layer = 0; layer < layerCount; ++layer)
+        {
+            Downsample(src + (size_t)layer * srcWidth * srcHeight * 4, srcWidth, srcHeight,
+                dst + (size_t)layer * dstWidth * dstHeight * 4, dstWidth, dstHeight, 0, dstHeight, filter, isSrgb);
+        }
+    }
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace lne
+{
+enum class EMipFilter : uint8_t
+{
+    // 2x2 average, cheapest
+    eBox,
+    // 6 taps windowed sinc, sharper mips with less aliasing
+    eKaiser,
+};
+
+/// <summary>
+/// Builds the mip chain of RGBA8 images on the CPU. sRGB colors are filtered in linear space, alpha is always linear.
+/// A chain is laid out mip after mip, finest first, with the layers of a mip next to each other: the layout
+/// copyBufferToImage expects for one region per mip.
+/// </summary>
+class MipGenerator
+{
+public:
+    [[nodiscard]] static uint64_t GetMipOffset(uint32_t width, uint32_t height, uint32_t mip, uint32_t layerCount = 1);
+    [[nodiscard]] static uint64_t GetChainSize(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t layerCount = 1)
+    {
+        return GetMipOffset(width, height, mipCount, layerCount);
+    }
+
+    /// <summary>
+    /// Writes the rows [rowBegin, rowEnd) of dst, the next mip of src. The rows are independent so that
+    /// large images can be split between threads.
+    /// </summary>
+    static void Downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight,
+        uint32_t rowBegin, uint32_t rowEnd, EMipFilter filter, bool isSrgb = true);
+
+    /// <summary>
+    /// Fills the mips [1, mipCount) of a chain whose first mip is already written, on the calling thread.
+    /// </summary>
+    static void GenerateChain(uint8_t* chain, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t layerCount,
+        EMipFilter filter, bool isSrgb = true);
+};
+}
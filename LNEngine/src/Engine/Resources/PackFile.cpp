@@ -0,0 +1,237 @@
+#include "Core/Utils/Log.h"
+
+#include "MeshFile.h"
+#include "TextureFile.h"
+#include "PackFile.h"
+
+namespace lne
+{
+namespace
+{
+constexpr uint64_t AlignOffset(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool ReadWholeFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+
+    data.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)data.data(), (std::streamsize)data.size());
+    return (bool)file;
+}
+}
+
+std::string PackFile::NormalizePath(std::string_view path)
+{
+    std::string normalized(path);
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    normalized = std::filesystem::path(normalized).lexically_normal().generic_string();
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return normalized;
+}
+
+uint64_t PackFile::HashPath(std::string_view normalizedPath)
+{
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : normalizedPath)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool PackFile::Build(const std::filesystem::path& directory, const std::filesystem::path& destination, ECompression compression)
+{
+    if (compression == ECompression::eZstd)
+    {
+        LNE_ERROR("Zstd isn't supported by this build, use LZ4 or no compression");
+        return false;
+    }
+
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (entry.is_regular_file() && IsPackFile(entry.path()) == false)
+            files.push_back(entry.path());
+    }
+    if (error)
+    {
+        LNE_ERROR("Failed to list the files of {0}", directory.string());
+        return false;
+    }
+
+    std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        LNE_ERROR("Failed to create pack file: {0}", destination.string());
+        return false;
+    }
+
+    PackFileHeader header{};
+    file.write((const char*)&header, sizeof(PackFileHeader));
+
+    std::vector<PackFileEntry> entries;
+    std::string paths;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> compressed;
+    uint64_t offset = sizeof(PackFileHeader);
+    uint64_t totalSize = 0;
+
+    for (const auto& path : files)
+    {
+        if (ReadWholeFile(path, data) == false)
+        {
+            LNE_ERROR("Failed to read {0}", path.string());
+            return false;
+        }
+
+        std::string relative = NormalizePath(path.lexically_relative(directory).generic_string());
+        PackFileEntry entry{
+            .PathHash = HashPath(relative),
+            .Offset = AlignOffset(offset, s_DataAlignment),
+            .StoredSize = data.size(),
+            .Size = data.size(),
+            .PathOffset = (uint32_t)paths.size(),
+            .PathLength = (uint32_t)relative.size(),
+            .Compression = ECompression::eNone,
+        };
+        paths += relative;
+
+        const uint8_t* stored = data.data();
+        bool isMapped = MeshFile::IsMeshFile(path) || TextureFile::IsTextureFile(path);
+        if (compression == ECompression::eLZ4 && isMapped == false && data.empty() == false)
+        {
+            compressed.resize(LZ4::GetCompressBound(data.size()));
+            size_t compressedSize = LZ4::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+            if (compressedSize != 0 && compressedSize <= data.size() - data.size() / 8)
+            {
+                entry.Compression = ECompression::eLZ4;
+                entry.StoredSize = compressedSize;
+                stored = compressed.data();
+            }
+        }
+
+        static constexpr char padding[s_DataAlignment]{};
+        file.write(padding, (std::streamsize)(entry.Offset - offset));
+        file.write((const char*)stored, (std::streamsize)entry.StoredSize);
+        offset = entry.Offset + entry.StoredSize;
+        totalSize += entry.Size;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const PackFileEntry& a, const PackFileEntry& b) { return a.PathHash < b.PathHash; });
+    for (size_t i = 1; i < entries.size(); ++i)
+    {
+        if (entries[i].PathHash == entries[i - 1].PathHash)
+        {
+            LNE_ERROR("Path hash collision in pack file: {0} and {1}", paths.substr(entries[i].PathOffset, entries[i].PathLength),
+                paths.substr(entries[i - 1].PathOffset, entries[i - 1].PathLength));
+            return false;
+        }
+    }
+
+    header.EntryCount = (uint32_t)entries.size();
+    header.TocOffset = AlignOffset(offset, alignof(PackFileEntry));
+    header.PathsOffset = header.TocOffset + entries.size() * sizeof(PackFileEntry);
+    header.PathsSize = paths.size();
+
+    static constexpr char padding[alignof(PackFileEntry)]{};
+    file.write(padding, (std::streamsize)(header.TocOffset - offset));
+    file.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(PackFileEntry)));
+    file.write(paths.data(), (std::streamsize)paths.size());
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(PackFileHeader));
+
+    LNE_INFO("Packed {0} files from {1}: {2} bytes stored in {3} bytes", entries.size(), directory.string(), totalSize, offset);
+    return (bool)file;
+}
+
+bool PackFile::Open(const std::filesystem::path& path)
+{
+    if (m_File.Open(path, false) == false)
+        return false;
+
+    const PackFileHeader& header = *(const PackFileHeader*)m_File.GetData();
+    if (m_File.GetSize() < sizeof(PackFileHeader) || header.Magic != PackFileHeader::s_Magic || header.Version != PackFileHeader::s_Version)
+    {
+        LNE_ERROR("Not a pack file or an incompatible version: {0}", path.string());
+        Close();
+        return false;
+    }
+    if (header.PathsOffset + header.PathsSize > m_File.GetSize() || header.TocOffset + (uint64_t)header.EntryCount * sizeof(PackFileEntry) > header.PathsOffset)
+    {
+        LNE_ERROR("Truncated pack file: {0}", path.string());
+        Close();
+        return false;
+    }
+
+    m_Entries = (const PackFileEntry*)(m_File.GetData() + header.TocOffset);
+    m_EntryCount = header.EntryCount;
+    m_Paths = (const char*)(m_File.GetData() + header.PathsOffset);
+    // the table of contents is used for every lookup, keep it resident
+    m_File.Prefetch(header.TocOffset, m_File.GetSize() - header.TocOffset);
+    return true;
+}
+
+void PackFile::Close()
+{
+    m_File.Close();
+    m_Entries = nullptr;
+    m_EntryCount = 0;
+    m_Paths = nullptr;
+}
+
+const PackFileEntry* PackFile::Find(std::string_view normalizedPath) const
+{
+    uint64_t hash = HashPath(normalizedPath);
+    const PackFileEntry* end = m_Entries + m_EntryCount;
+    const PackFileEntry* entry = std::lower_bound(m_Entries, end, hash, [](const PackFileEntry& e, uint64_t h) { return e.PathHash < h; });
+    if (entry == end || entry->PathHash != hash || GetPath(*entry) != normalizedPath)
+        return nullptr;
+    return entry;
+}
+
+std::string_view PackFile::GetPath(const PackFileEntry& entry) const
+{
+    return std::string_view(m_Paths + entry.PathOffset, entry.PathLength);
+}
+
+bool PackFile::Unpack(const PackFileEntry& entry, uint8_t* dst, uint64_t size) const
+{
+    size = std::min(size, entry.Size);
+    switch (entry.Compression)
+    {
+    case ECompression::eNone:
+        memcpy(dst, GetStoredData(entry), size);
+        return true;
+    case ECompression::eLZ4:
+        if (size == entry.Size ? LZ4::Decompress(GetStoredData(entry), entry.StoredSize, dst, size)
+            : LZ4::DecompressPrefix(GetStoredData(entry), entry.StoredSize, dst, size))
+            return true;
+        LNE_ERROR("Corrupted pack entry: {0}", GetPath(entry));
+        return false;
+    default:
+        LNE_ERROR("Pack entry {0} uses a compression this build doesn't support", GetPath(entry));
+        return false;
+    }
+}
+
+void PackFile::Prefetch(const PackFileEntry& entry, uint64_t offset, uint64_t size) const
+{
+    // compressed entries are decoded as a whole
+    if (entry.Compression != ECompression::eNone)
+    {
+        offset = 0;
+        size = entry.StoredSize;
+    }
+    m_File.Prefetch(entry.Offset + offset, std::min(size, entry.StoredSize - std::min(offset, entry.StoredSize)));
+}
+}
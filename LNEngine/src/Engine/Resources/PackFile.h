@@ -0,0 +1,88 @@
+#pragma once
+#include "Engine/Core/Utils/MappedFile.h"
+#include "Compression.h"
+
+namespace lne
+{
+/// <summary>
+/// Header of an asset archive (.lnpak).
+/// The file data comes first, each entry aligned so that uncompressed files can be used in place from the mapping.
+/// The table of contents follows, sorted by path hash, then the paths it points to.
+/// </summary>
+struct PackFileHeader
+{
+    static constexpr uint32_t s_Magic = 0x4B504E4C; // "LNPK"
+    static constexpr uint32_t s_Version = 1;
+
+    uint32_t Magic{ s_Magic };
+    uint32_t Version{ s_Version };
+    uint32_t EntryCount{};
+    uint32_t Reserved{};
+    uint64_t TocOffset{};
+    uint64_t PathsOffset{};
+    uint64_t PathsSize{};
+};
+
+struct PackFileEntry
+{
+    uint64_t PathHash;
+    uint64_t Offset;
+    // size in the archive, equal to Size when the entry isn't compressed
+    uint64_t StoredSize;
+    uint64_t Size;
+    uint32_t PathOffset;
+    uint32_t PathLength;
+    ECompression Compression;
+    uint32_t Reserved;
+};
+
+class PackFile
+{
+public:
+    static constexpr std::string_view s_Extension = ".lnpak";
+    static constexpr uint64_t s_DataAlignment = 64;
+
+    /// <summary>
+    /// Paths are stored relative to the packed directory, with forward slashes and lowercased so that the lookups
+    /// behave the same as the case insensitive loose file paths on Windows.
+    /// </summary>
+    [[nodiscard]] static std::string NormalizePath(std::string_view path);
+    [[nodiscard]] static uint64_t HashPath(std::string_view normalizedPath);
+
+    /// <summary>
+    /// Packs every file under the directory. Entries are compressed when it saves at least an eighth of their size,
+    /// except the cooked meshes and textures that are mapped or streamed by ranges and have to stay in place.
+    /// </summary>
+    static bool Build(const std::filesystem::path& directory, const std::filesystem::path& destination, ECompression compression = ECompression::eLZ4);
+
+    [[nodiscard]] static bool IsPackFile(const std::filesystem::path& path) { return path.extension() == s_Extension; }
+
+public:
+    /// <summary>
+    /// Maps the archive without reading it, the entries are paged in when they are read.
+    /// </summary>
+    [[nodiscard]] bool Open(const std::filesystem::path& path);
+    void Close();
+    [[nodiscard]] bool IsOpen() const { return m_File.IsOpen(); }
+
+    [[nodiscard]] const PackFileEntry* Find(std::string_view normalizedPath) const;
+    [[nodiscard]] std::string_view GetPath(const PackFileEntry& entry) const;
+    [[nodiscard]] uint32_t GetEntryCount() const { return m_EntryCount; }
+
+    /// <summary>
+    /// Stored bytes of the entry, compressed or not.
+    /// </summary>
+    [[nodiscard]] const uint8_t* GetStoredData(const PackFileEntry& entry) const { return m_File.GetData() + entry.Offset; }
+    /// <summary>
+    /// Decompresses the first size bytes of the entry into dst, the whole entry by default.
+    /// </summary>
+    [[nodiscard]] bool Unpack(const PackFileEntry& entry, uint8_t* dst, uint64_t size = ~0ull) const;
+    void Prefetch(const PackFileEntry& entry, uint64_t offset = 0, uint64_t size = ~0ull) const;
+
+private:
+    MappedFile m_File;
+    const PackFileEntry* m_Entries{ nullptr };
+    uint32_t m_EntryCount{ 0 };
+    const char* m_Paths{ nullptr };
+};
+}
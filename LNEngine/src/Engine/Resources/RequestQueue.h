@@ -0,0 +1,152 @@
+#pragma once
+
+namespace lne
+{
+/// <summary>
+/// Max-heap of requests ordered by a caller supplied priority, FIFO between equal priorities.
+/// Every request is tagged with a key (the asset it loads) so that its priority can be changed while it is pending.
+/// Re-prioritization pushes a new heap entry and bumps the request version, stale entries are dropped when they reach the top.
+/// Not thread safe, the owner locks around it.
+/// </summary>
+template<typename Request>
+class RequestQueue
+{
+public:
+    void Push(Request request, float priority, const void* key)
+    {
+        uint64_t id = m_NextId++;
+        m_Pending.emplace(id, Pending{ std::move(request), key, 0 });
+        m_IdsByKey.emplace(key, id);
+        PushEntry(priority, id, 0);
+    }
+
+    /// <summary>
+    /// Pops the request with the highest priority. Returns false if the queue is empty.
+    /// </summary>
+    bool Pop(Request& request)
+    {
+        while (m_Heap.empty() == false)
+        {
+            std::pop_heap(m_Heap.begin(), m_Heap.end(), CompareEntries);
+            Entry entry = m_Heap.back();
+            m_Heap.pop_back();
+
+            auto it = m_Pending.find(entry.Id);
+            if (it == m_Pending.end() || it->second.Version != entry.Version)
+                continue;
+
+            request = std::move(it->second.Data);
+            EraseKey(it->second.Key, entry.Id);
+            m_Pending.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// Changes the priority of every pending request for the key. Returns false if there is none.
+    /// </summary>
+    bool SetPriority(const void* key, float priority)
+    {
+        auto [begin, end] = m_IdsByKey.equal_range(key);
+        if (begin == end)
+            return false;
+
+        for (auto it = begin; it != end; ++it)
+        {
+            Pending& pending = m_Pending.at(it->second);
+            PushEntry(priority, it->second, ++pending.Version);
+        }
+
+        // the heap only grows with re-prioritization, rebuild it once stale entries dominate
+        if (m_Heap.size() > 2 * m_Pending.size() + 32)
+            Compact();
+        return true;
+    }
+
+    /// <summary>
+    /// Removes every pending request for the key and returns them, their heap entries become stale.
+    /// </summary>
+    std::vector<Request> Extract(const void* key)
+    {
+        std::vector<Request> requests;
+        auto [begin, end] = m_IdsByKey.equal_range(key);
+        for (auto it = begin; it != end; ++it)
+        {
+            auto pending = m_Pending.find(it->second);
+            requests.push_back(std::move(pending->second.Data));
+            m_Pending.erase(pending);
+        }
+        m_IdsByKey.erase(begin, end);
+        return requests;
+    }
+
+    [[nodiscard]] bool IsEmpty() const { return m_Pending.empty(); }
+    [[nodiscard]] size_t GetSize() const { return m_Pending.size(); }
+
+    void Clear()
+    {
+        m_Heap.clear();
+        m_Pending.clear();
+        m_IdsByKey.clear();
+    }
+
+private:
+    struct Entry
+    {
+        float Priority;
+        uint64_t Id;
+        uint32_t Version;
+    };
+
+    struct Pending
+    {
+        Request Data;
+        const void* Key;
+        uint32_t Version;
+    };
+
+    std::vector<Entry> m_Heap;
+    std::unordered_map<uint64_t, Pending> m_Pending;
+    std::unordered_multimap<const void*, uint64_t> m_IdsByKey;
+    uint64_t m_NextId{ 0 };
+
+private:
+    static bool CompareEntries(const Entry& a, const Entry& b)
+    {
+        if (a.Priority != b.Priority)
+            return a.Priority < b.Priority;
+        // older requests first
+        return a.Id > b.Id;
+    }
+
+    void PushEntry(float priority, uint64_t id, uint32_t version)
+    {
+        m_Heap.push_back({ priority, id, version });
+        std::push_heap(m_Heap.begin(), m_Heap.end(), CompareEntries);
+    }
+
+    void EraseKey(const void* key, uint64_t id)
+    {
+        auto [begin, end] = m_IdsByKey.equal_range(key);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (it->second == id)
+            {
+                m_IdsByKey.erase(it);
+                return;
+            }
+        }
+    }
+
+    void Compact()
+    {
+        std::erase_if(m_Heap, [this](const Entry& entry)
+        {
+            auto it = m_Pending.find(entry.Id);
+            return it == m_Pending.end() || it->second.Version != entry.Version;
+        });
+        std::make_heap(m_Heap.begin(), m_Heap.end(), CompareEntries);
+    }
+};
+}
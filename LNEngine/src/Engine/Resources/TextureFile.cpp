@@ -0,0 +1,140 @@
+#include <stb/stb_image.h>
+
+#include "Core/Utils/Log.h"
+
+#include "AsyncFileReader.h"
+#include "VirtualFileSystem.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
+
+namespace lne
+{
+bool TextureFile::ReadHeader(const std::filesystem::path& path, TextureFileHeader& header, std::vector<TextureFileMip>& mips)
+{
+    auto& vfs = VirtualFileSystem::Get();
+    uint64_t fileSize = vfs.GetFileSize(path);
+    if (fileSize == UINT64_MAX)
+    {
+        LNE_ERROR("Failed to open texture file: {0}", path.string());
+        return false;
+    }
+
+    SafePtr<FileRead> file = fileSize >= sizeof(TextureFileHeader) ? vfs.Read(path, 0, sizeof(TextureFileHeader)) : nullptr;
+    if (file == nullptr || file->Wait() == false || ((const TextureFileHeader*)file->GetData())->Magic != TextureFileHeader::s_Magic)
+    {
+        LNE_ERROR("Not a texture file: {0}", path.string());
+        return false;
+    }
+    memcpy(&header, file->GetData(), sizeof(TextureFileHeader));
+    if (header.Version != TextureFileHeader::s_Version)
+    {
+        LNE_ERROR("Unsupported texture file version {0}: {1}", header.Version, path.string());
+        return false;
+    }
+
+    uint64_t tableSize = (uint64_t)header.MipCount * sizeof(TextureFileMip);
+    file = sizeof(TextureFileHeader) + tableSize <= fileSize ? vfs.Read(path, sizeof(TextureFileHeader), tableSize) : nullptr;
+    if (file == nullptr || file->Wait() == false)
+    {
+        LNE_ERROR("Truncated mip table in texture file: {0}", path.string());
+        return false;
+    }
+    mips.resize(header.MipCount);
+    memcpy(mips.data(), file->GetData(), tableSize);
+    return true;
+}
+
+bool TextureFile::GetMipRange(const std::filesystem::path& path, uint32_t firstMip, uint32_t mipCount,
+    std::vector<TextureMipRegion>& regions, uint64_t& offset, uint64_t& size)
+{
+    TextureFileHeader header{};
+    std::vector<TextureFileMip> mips;
+    if (ReadHeader(path, header, mips) == false)
+        return false;
+
+    if (mipCount == 0 || firstMip + mipCount > header.MipCount)
+    {
+        LNE_ERROR("Invalid mip range [{0}, {1}) for texture file: {2}", firstMip, firstMip + mipCount, path.string());
+        return false;
+    }
+
+    // coarsest first, so the range starts with the last requested mip
+    const TextureFileMip& coarsest = mips[firstMip + mipCount - 1];
+    const TextureFileMip& finest = mips[firstMip];
+    offset = coarsest.Offset;
+    size = finest.Offset + finest.Size - offset;
+
+    regions.clear();
+    regions.reserve(mipCount);
+    for (uint32_t mip = firstMip; mip < firstMip + mipCount; ++mip)
+        regions.emplace_back(TextureMipRegion{ mip, mips[mip].Offset - offset });
+
+    return true;
+}
+
+bool TextureFile::Write(const std::filesystem::path& path, uint32_t width, uint32_t height, vk::Format format,
+    const std::vector<std::vector<uint8_t>>& mips)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        LNE_ERROR("Failed to create texture file: {0}", path.string());
+        return false;
+    }
+
+    TextureFileHeader header{};
+    header.Width = width;
+    header.Height = height;
+    header.MipCount = (uint32_t)mips.size();
+    header.Format = (uint32_t)format;
+
+    std::vector<TextureFileMip> table(mips.size());
+    uint64_t offset = sizeof(TextureFileHeader) + table.size() * sizeof(TextureFileMip);
+    for (int32_t mip = (int32_t)mips.size() - 1; mip >= 0; --mip)
+    {
+        table[mip] = TextureFileMip{
+            .Offset = offset,
+            .Size = mips[mip].size(),
+            .Width = std::max(1u, width >> mip),
+            .Height = std::max(1u, height >> mip)
+        };
+        offset += mips[mip].size();
+    }
+
+    file.write((const char*)&header, sizeof(TextureFileHeader));
+    file.write((const char*)table.data(), table.size() * sizeof(TextureFileMip));
+    for (int32_t mip = (int32_t)mips.size() - 1; mip >= 0; --mip)
+        file.write((const char*)mips[mip].data(), mips[mip].size());
+
+    return (bool)file;
+}
+
+bool TextureFile::CookFromImage(const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    int width, height, channels;
+    uint8_t* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        LNE_ERROR("Failed to load texture image: {0}", source.string());
+        return false;
+    }
+
+    uint32_t mipCount = Texture::GetMaxMipLevels(width, height);
+    std::vector<std::vector<uint8_t>> mips(mipCount);
+    mips[0].assign(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+
+    for (uint32_t mip = 1; mip < mipCount; ++mip)
+    {
+        uint32_t srcWidth = std::max(1u, (uint32_t)width >> (mip - 1));
+        uint32_t srcHeight = std::max(1u, (uint32_t)height >> (mip - 1));
+        uint32_t dstWidth = std::max(1u, (uint32_t)width >> mip);
+        uint32_t dstHeight = std::max(1u, (uint32_t)height >> mip);
+        mips[mip].resize((size_t)dstWidth * dstHeight * 4);
+        // cooking is offline, the sharper filter is worth its cost
+        MipGenerator::Downsample(mips[mip - 1].data(), srcWidth, srcHeight, mips[mip].data(), dstWidth, dstHeight, 0, dstHeight, EMipFilter::eKaiser);
+    }
+
+    return Write(destination, width, height, vk::Format::eR8G8B8A8Srgb, mips);
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Engine/Graphics/Texture.h"
+
+namespace lne
+{
+/// <summary>
+/// Header of a mip-ordered texture file (.lntex).
+/// The levels are stored coarsest first so that the mip tail can be read with a single contiguous read
+/// and the finer levels can be streamed one after the other.
+/// </summary>
+struct TextureFileHeader
+{
+    static constexpr uint32_t s_Magic = 0x58544E4C; // "LNTX"
+    static constexpr uint32_t s_Version = 1;
+
+    uint32_t Magic{ s_Magic };
+    uint32_t Version{ s_Version };
+    uint32_t Width{};
+    uint32_t Height{};
+    uint32_t MipCount{};
+    uint32_t LayerCount{ 1 };
+    uint32_t Format{}; // vk::Format
+    uint32_t Reserved{};
+};
+
+/// <summary>
+/// Entry of the mip table that follows the header. The table is indexed by mip level (0 is the finest).
+/// </summary>
+struct TextureFileMip
+{
+    uint64_t Offset;
+    uint64_t Size;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+class TextureFile
+{
+public:
+    static constexpr std::string_view s_Extension = ".lntex";
+
+    [[nodiscard]] static bool ReadHeader(const std::filesystem::path& path, TextureFileHeader& header, std::vector<TextureFileMip>& mips);
+
+    /// <summary>
+    /// Locates the mips [firstMip, firstMip + mipCount) in the file. They are contiguous and can be fetched with a single read.
+    /// </summary>
+    /// <param name="regions">: receives the offset of each mip relative to the start of the range</param>
+    /// <param name="offset">: receives the offset of the range in the file</param>
+    /// <param name="size">: receives the size of the range</param>
+    [[nodiscard]] static bool GetMipRange(const std::filesystem::path& path, uint32_t firstMip, uint32_t mipCount,
+        std::vector<TextureMipRegion>& regions, uint64_t& offset, uint64_t& size);
+
+    /// <summary>
+    /// Writes a file from a full mip chain. mips[0] is the finest level.
+    /// </summary>
+    static bool Write(const std::filesystem::path& path, uint32_t width, uint32_t height, vk::Format format,
+        const std::vector<std::vector<uint8_t>>& mips);
+
+    /// <summary>
+    /// Decodes an image, builds its sRGB mip chain on the CPU and writes it as a .lntex file.
+    /// </summary>
+    static bool CookFromImage(const std::filesystem::path& source, const std::filesystem::path& destination);
+
+    [[nodiscard]] static bool IsTextureFile(const std::filesystem::path& path) { return path.extension() == s_Extension; }
+};
+}
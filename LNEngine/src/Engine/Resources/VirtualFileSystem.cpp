@@ -0,0 +1,135 @@
+#include "Core/Utils/Log.h"
+
+#include "AsyncFileReader.h"
+#include "PackFile.h"
+#include "VirtualFileSystem.h"
+
+namespace lne
+{
+VirtualFileSystem::VirtualFileSystem() = default;
+VirtualFileSystem::~VirtualFileSystem() = default;
+
+bool VirtualFileSystem::Mount(const std::filesystem::path& root, const std::filesystem::path& packPath)
+{
+    Unmount();
+
+    std::error_code error;
+    std::filesystem::path absoluteRoot = std::filesystem::absolute(root, error);
+    m_Root = PackFile::NormalizePath((error ? root : absoluteRoot).generic_string());
+    if (m_Root.empty() == false && m_Root.back() != '/')
+        m_Root += '/';
+
+    // the cooker mounts its sources without a pack
+    if (packPath.empty())
+        return false;
+    if (std::filesystem::exists(packPath, error) == false)
+    {
+        LNE_INFO("No pack file at {0}, assets are read from {1}", packPath.string(), root.string());
+        return false;
+    }
+
+    m_Pack = std::make_unique<PackFile>();
+    if (m_Pack->Open(packPath) == false)
+    {
+        m_Pack.reset();
+        return false;
+    }
+
+    LNE_INFO("Mounted {0} ({1} files) on {2}", packPath.string(), m_Pack->GetEntryCount(), root.string());
+    return true;
+}
+
+void VirtualFileSystem::Unmount()
+{
+    m_Pack.reset();
+    m_Root.clear();
+}
+
+const PackFileEntry* VirtualFileSystem::FindEntry(const std::filesystem::path& path) const
+{
+    if (m_Pack == nullptr)
+        return nullptr;
+
+    std::string relative = GetRelativePath(path);
+    return relative.empty() ? nullptr : m_Pack->Find(relative);
+}
+
+std::string VirtualFileSystem::GetRelativePath(const std::filesystem::path& path) const
+{
+    if (m_Root.empty())
+        return {};
+
+    // the asset paths are built from GetAssetsPath with backslashes, which aren't separators on Linux
+    std::string generic = path.generic_string();
+    std::replace(generic.begin(), generic.end(), '\\', '/');
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(generic, error);
+
+    std::string normalized = PackFile::NormalizePath((error ? std::filesystem::path(generic) : absolute).generic_string());
+    if (normalized.starts_with(m_Root) == false)
+        return {};
+    normalized.erase(0, m_Root.size());
+    return normalized;
+}
+
+bool VirtualFileSystem::Exists(const std::filesystem::path& path) const
+{
+    if (FindEntry(path))
+        return true;
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+uint64_t VirtualFileSystem::GetFileSize(const std::filesystem::path& path) const
+{
+    if (const PackFileEntry* entry = FindEntry(path))
+        return entry->Size;
+
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    return error ? UINT64_MAX : size;
+}
+
+SafePtr<FileRead> VirtualFileSystem::Read(const std::filesystem::path& path, uint64_t offset, uint64_t size) const
+{
+    const PackFileEntry* entry = FindEntry(path);
+    if (entry == nullptr)
+        return AsyncFileReader::Get().Read(path, offset, size);
+
+    if (size == 0)
+        size = entry->Size - std::min(offset, entry->Size);
+    if (offset + size > entry->Size)
+    {
+        LNE_ERROR("Read [{0}, {1}) out of the bounds of packed file {2}", offset, offset + size, path.string());
+        return AsyncFileReader::Get().Produce(path, 0, [](uint8_t*) { return false; });
+    }
+
+    m_Pack->Prefetch(*entry, offset, size);
+    if (entry->Compression == ECompression::eNone)
+        return AsyncFileReader::Get().Wrap(path, m_Pack->GetStoredData(*entry) + offset, size);
+
+    return AsyncFileReader::Get().Produce(path, size, [&](uint8_t* dst)
+    {
+        if (offset == 0)
+            return m_Pack->Unpack(*entry, dst, size);
+
+        // ranges of compressed entries are decoded from the start of the entry, up to their end
+        std::vector<uint8_t> unpacked(offset + size);
+        if (m_Pack->Unpack(*entry, unpacked.data(), offset + size) == false)
+            return false;
+        memcpy(dst, unpacked.data() + offset, size);
+        return true;
+    });
+}
+
+const uint8_t* VirtualFileSystem::Map(const std::filesystem::path& path, uint64_t& size) const
+{
+    const PackFileEntry* entry = FindEntry(path);
+    if (entry == nullptr || entry->Compression != ECompression::eNone)
+        return nullptr;
+
+    m_Pack->Prefetch(*entry);
+    size = entry->Size;
+    return m_Pack->GetStoredData(*entry);
+}
+}
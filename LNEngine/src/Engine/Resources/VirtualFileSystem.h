@@ -0,0 +1,63 @@
+#pragma once
+#include "Engine/Core/SafePtr.h"
+#include "Engine/Core/Utils/Defines.h"
+
+namespace lne
+{
+/// <summary>
+/// Resolves the asset paths used by the loaders. Files under the mounted root are looked up in the pack first and read
+/// from the mapped archive, every other path (or a root without a pack) goes to the loose files on disk.
+/// Mount at startup, before any loader runs: the lookups aren't synchronized with it.
+/// </summary>
+class VirtualFileSystem
+{
+public:
+    MOVABLE_ONLY(VirtualFileSystem);
+
+    static VirtualFileSystem& Get()
+    {
+        static VirtualFileSystem instance;
+        return instance;
+    }
+
+    /// <summary>
+    /// Returns false if the pack is empty, doesn't exist or is invalid, the loose files under the root stay usable.
+    /// </summary>
+    bool Mount(const std::filesystem::path& root, const std::filesystem::path& packPath);
+    void Unmount();
+
+    [[nodiscard]] bool Exists(const std::filesystem::path& path) const;
+    [[nodiscard]] bool IsPacked(const std::filesystem::path& path) const { return FindEntry(path) != nullptr; }
+    /// <summary>
+    /// Returns UINT64_MAX if the file doesn't exist.
+    /// </summary>
+    [[nodiscard]] uint64_t GetFileSize(const std::filesystem::path& path) const;
+
+    /// <summary>
+    /// Reads [offset, offset + size) of the file, a size of 0 reads until the end.
+    /// Packed files are returned completed: uncompressed ones point into the mapping and compressed ones are decoded on the calling thread,
+    /// from the start of the entry to the end of the range.
+    /// </summary>
+    [[nodiscard]] SafePtr<class FileRead> Read(const std::filesystem::path& path, uint64_t offset = 0, uint64_t size = 0) const;
+    /// <summary>
+    /// Returns the bytes of an uncompressed packed file without copying them, nullptr otherwise.
+    /// They stay valid until Unmount.
+    /// </summary>
+    [[nodiscard]] const uint8_t* Map(const std::filesystem::path& path, uint64_t& size) const;
+    /// <summary>
+    /// Path relative to the mounted root, normalized like the packed paths. Empty if the path isn't under the root.
+    /// </summary>
+    [[nodiscard]] std::string GetRelativePath(const std::filesystem::path& path) const;
+
+private:
+    // normalized, with a trailing slash
+    std::string m_Root;
+    std::unique_ptr<class PackFile> m_Pack;
+
+private:
+    VirtualFileSystem();
+    ~VirtualFileSystem();
+
+    [[nodiscard]] const struct PackFileEntry* FindEntry(const std::filesystem::path& path) const;
+};
+}
@@ -13,40 +13,49 @@ struct TransformComponent
 
     glm::mat4 GetModelMatrix() const
     {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, Position);
-        model = glm::rotate(model, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, Scale);
-        return model;
+        // translate * rotate X * rotate Y * rotate Z * scale, written out
+        glm::mat3 rotation = ComputeRotation(Rotation);
+        return glm::mat4(
+            glm::vec4(rotation[0] * Scale.x, 0.0f),
+            glm::vec4(rotation[1] * Scale.y, 0.0f),
+            glm::vec4(rotation[2] * Scale.z, 0.0f),
+            glm::vec4(Position, 1.0f));
     }
 
     glm::mat4 GetRotationMatrix() const
     {
-        glm::mat4 rotation = glm::mat4(1.0f);
-        rotation = glm::rotate(rotation, glm::radians(Rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        rotation = glm::rotate(rotation, glm::radians(Rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        rotation = glm::rotate(rotation, glm::radians(Rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-        return rotation;
+        return glm::mat4(ComputeRotation(Rotation));
     }
 
     glm::vec3 GetForward() const
     {
-        glm::vec4 forward = GetRotationMatrix() * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
-        return glm::normalize(glm::vec3(forward));
+        return ComputeRotation(Rotation)[2];
     }
 
     glm::vec3 GetRight() const
     {
-        glm::vec4 right = GetRotationMatrix() * glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-        return glm::normalize(glm::vec3(right));
+        return ComputeRotation(Rotation)[0];
     }
 
     glm::vec3 GetUp() const
     {
-        glm::vec4 up = GetRotationMatrix() * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
-        return glm::normalize(glm::vec3(up));
+        return ComputeRotation(Rotation)[1];
+    }
+
+    /// <summary>
+    /// Rotation of the Euler angles in degrees, around X then Y then Z in the local frame (X * Y * Z), from one sine and
+    /// cosine per axis instead of three matrix products.
+    /// </summary>
+    static glm::mat3 ComputeRotation(const glm::vec3& rotation)
+    {
+        glm::vec3 radians = glm::radians(rotation);
+        float sx = sinf(radians.x), cx = cosf(radians.x);
+        float sy = sinf(radians.y), cy = cosf(radians.y);
+        float sz = sinf(radians.z), cz = cosf(radians.z);
+        return glm::mat3(
+            glm::vec3(cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz),
+            glm::vec3(-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz),
+            glm::vec3(sy, -sx * cy, cx * cy));
     }
 
     void LookAt(const glm::vec3& target)
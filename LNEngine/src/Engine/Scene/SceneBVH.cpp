@@ -0,0 +1,575 @@
+#include "SceneBVH.h"
+#include "Components.h"
+#include "Graphics/Mesh.h"
+#include "Core/Utils/_Defines.h"
+
+#include <enkiTS/src/TaskScheduler.h>
+
+namespace lne
+{
+namespace
+{
+constexpr uint32_t s_MaxLeafObjects = 4;
+constexpr uint32_t s_BinCount = 16;
+// the refit tree is rebuilt once its cost grows this much past the one it was built with
+constexpr float s_MaxRefitDegradation = 1.5f;
+// below this many references a subtree is built on the thread that reached it
+constexpr uint32_t s_MinParallelBuildSize = 1024;
+// past this many moved objects the whole tree is refit bottom-up instead of walking up from each leaf
+constexpr float s_FullRefitRatio = 0.125f;
+
+enum class EOverlap
+{
+    eOutside,
+    eIntersecting,
+    eInside,
+};
+
+AABB EmptyBounds()
+{
+    return AABB{ .Min = glm::vec3(std::numeric_limits<float>::max()), .Max = glm::vec3(std::numeric_limits<float>::lowest()) };
+}
+
+AABB Merge(const AABB& a, const AABB& b)
+{
+    return AABB{ .Min = glm::min(a.Min, b.Min), .Max = glm::max(a.Max, b.Max) };
+}
+
+bool operator==(const AABB& a, const AABB& b)
+{
+    return a.Min == b.Min && a.Max == b.Max;
+}
+
+float SurfaceArea(const AABB& bounds)
+{
+    glm::vec3 extents = glm::max(bounds.Max - bounds.Min, glm::vec3(0.0f));
+    return 2.0f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+}
+
+bool Overlaps(const AABB& a, const AABB& b)
+{
+    return glm::all(glm::lessThanEqual(a.Min, b.Max)) && glm::all(glm::lessThanEqual(b.Min, a.Max));
+}
+
+// the positive vertex of the box decides if it is outside a plane, the negative one if it is inside
+EOverlap TestFrustum(const std::array<glm::vec4, 6>& planes, const AABB& bounds)
+{
+    EOverlap result = EOverlap::eInside;
+    for (const glm::vec4& plane : planes)
+    {
+        glm::vec3 normal(plane);
+        glm::vec3 positive = glm::mix(bounds.Min, bounds.Max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+        if (glm::dot(normal, positive) + plane.w < 0.0f)
+            return EOverlap::eOutside;
+        glm::vec3 negative = glm::mix(bounds.Max, bounds.Min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+        if (glm::dot(normal, negative) + plane.w < 0.0f)
+            result = EOverlap::eIntersecting;
+    }
+    return result;
+}
+
+// slab test, the distance where the ray enters the box or a negative value when it misses it
+float IntersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const AABB& bounds)
+{
+    glm::vec3 t0 = (bounds.Min - origin) * inverseDirection;
+    glm::vec3 t1 = (bounds.Max - origin) * inverseDirection;
+    glm::vec3 tMin = glm::min(t0, t1);
+    glm::vec3 tMax = glm::max(t0, t1);
+    float enter = std::max({ tMin.x, tMin.y, tMin.z, 0.0f });
+    float exit = std::min({ tMax.x, tMax.y, tMax.z, maxDistance });
+    return enter <= exit ? enter : -1.0f;
+}
+
+glm::vec3 GetInverseDirection(const glm::vec3& direction)
+{
+    // an axis the ray is parallel to gets an infinite slab distance of the right sign
+    return glm::vec3(1.0f) / direction;
+}
+}
+
+AABB SceneBVH::ComputeBounds(const StaticMesh& mesh, const TransformComponent& transform)
+{
+    return ComputeBounds(mesh, transform.GetModelMatrix());
+}
+
+AABB SceneBVH::ComputeBounds(const StaticMesh& mesh, const glm::mat4& model)
+{
+    AABB bounds = EmptyBounds();
+    for (const SubMesh& submesh : mesh.GetSubMeshes())
+    {
+        // the submeshes skipped by the cook have a zero box at their origin
+        if (submesh.VertexCount > 0)
+            bounds = Merge(bounds, TransformBounds(submesh.BoundingBox, model * submesh.WorldTransform));
+    }
+    return bounds;
+}
+
+AABB SceneBVH::TransformBounds(const AABB& bounds, const glm::mat4& transform)
+{
+    // Arvo: the extents of the transformed box are the absolute matrix applied to the extents
+    glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.Min + bounds.Max) * 0.5f, 1.0f));
+    glm::vec3 extents = (bounds.Max - bounds.Min) * 0.5f;
+    glm::mat3 absolute(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+    glm::vec3 transformedExtents = absolute * extents;
+    return AABB{ .Min = center - transformedExtents, .Max = center + transformedExtents };
+}
+
+uint32_t SceneBVH::AddObject(const AABB& bounds, bool isStatic)
+{
+    uint32_t object;
+    if (m_FreeObjects.empty())
+    {
+        object = (uint32_t)m_Objects.size();
+        m_Objects.emplace_back();
+    }
+    else
+    {
+        object = m_FreeObjects.back();
+        m_FreeObjects.pop_back();
+    }
+
+    m_Objects[object] = Object{ .Bounds = bounds, .IsStatic = isStatic, .IsAlive = true };
+    GetTree(m_Objects[object]).NeedsRebuild = true;
+    return object;
+}
+
+void SceneBVH::RemoveObject(uint32_t object)
+{
+    LNE_ASSERT(object < m_Objects.size() && m_Objects[object].IsAlive, "Not an object of the BVH");
+    m_Objects[object].IsAlive = false;
+    GetTree(m_Objects[object]).NeedsRebuild = true;
+    m_RemovedObjects.push_back(object);
+}
+
+void SceneBVH::UpdateObject(uint32_t object, const AABB& bounds)
+{
+    LNE_ASSERT(object < m_Objects.size() && m_Objects[object].IsAlive, "Not an object of the BVH");
+    Object& entry = m_Objects[object];
+    if (entry.Bounds == bounds)
+        return;
+
+    entry.Bounds = bounds;
+    Tree& tree = GetTree(entry);
+    if (entry.IsStatic)
+        tree.NeedsRebuild = true;
+    else if (entry.IsDirty == false && entry.Leaf != s_InvalidNode)
+    {
+        entry.IsDirty = true;
+        tree.DirtyObjects.push_back(object);
+    }
+}
+
+void SceneBVH::Commit(std::shared_ptr<enki::TaskScheduler> scheduler)
+{
+    if (m_DynamicTree.NeedsRebuild == false && m_DynamicTree.DirtyObjects.empty() == false)
+    {
+        RefitTree(m_DynamicTree);
+        m_DynamicTree.NeedsRebuild = m_DynamicTree.Cost > m_DynamicTree.BuiltCost * s_MaxRefitDegradation;
+    }
+    if (m_StaticTree.NeedsRebuild)
+        BuildTree(m_StaticTree, true, scheduler);
+    if (m_DynamicTree.NeedsRebuild)
+        BuildTree(m_DynamicTree, false, scheduler);
+
+    m_FreeObjects.insert(m_FreeObjects.end(), m_RemovedObjects.begin(), m_RemovedObjects.end());
+    m_RemovedObjects.clear();
+}
+
+void SceneBVH::Rebuild(std::shared_ptr<enki::TaskScheduler> scheduler)
+{
+    m_StaticTree.NeedsRebuild = true;
+    m_DynamicTree.NeedsRebuild = true;
+    Commit(scheduler);
+}
+
+void SceneBVH::BuildTree(Tree& tree, bool isStatic, const std::shared_ptr<enki::TaskScheduler>& scheduler)
+{
+    std::vector<BuildRef> refs;
+    for (uint32_t o = 0; o < (uint32_t)m_Objects.size(); ++o)
+    {
+        Object& object = m_Objects[o];
+        if (object.IsStatic != isStatic)
+            continue;
+        object.Leaf = s_InvalidNode;
+        object.IsDirty = false;
+        if (object.IsAlive)
+            refs.push_back(BuildRef{ object.Bounds, (object.Bounds.Min + object.Bounds.Max) * 0.5f, o });
+    }
+
+    tree.Nodes.clear();
+    tree.Parents.clear();
+    tree.Objects.clear();
+    tree.DirtyObjects.clear();
+    tree.NeedsRebuild = false;
+    tree.Cost = tree.BuiltCost = tree.InnerArea = 0.0f;
+    if (refs.empty())
+        return;
+
+    // a binary tree with at least one reference per leaf
+    uint32_t refCount = (uint32_t)refs.size();
+    tree.Nodes.resize(2 * (size_t)refCount - 1);
+    tree.Parents.resize(tree.Nodes.size());
+    tree.Parents[0] = s_InvalidNode;
+    std::atomic<uint32_t> nodeCount{ 1 };
+
+    // the top of the tree is split on this thread until the ranges are small enough to be spread across the task threads
+    uint32_t threadCount = scheduler ? scheduler->GetNumTaskThreads() : 1;
+    if (threadCount > 1 && refCount >= 2 * s_MinParallelBuildSize)
+    {
+        uint32_t parallelSize = std::max(s_MinParallelBuildSize, refCount / (threadCount * 4));
+        // node, begin and end of the ranges left to the tasks
+        std::vector<std::array<uint32_t, 3>> deferred;
+        BuildNode(tree, refs, nodeCount, 0, 0, refCount, parallelSize, &deferred);
+
+        enki::TaskSet task((uint32_t)deferred.size(), [&](enki::TaskSetPartition range, uint32_t)
+        {
+            for (uint32_t i = range.start; i < range.end; ++i)
+                BuildNode(tree, refs, nodeCount, deferred[i][0], deferred[i][1], deferred[i][2], 0, nullptr);
+        });
+        task.m_MinRange = 1;
+        scheduler->AddTaskSetToPipe(&task);
+        scheduler->WaitforTask(&task);
+    }
+    else
+    {
+        BuildNode(tree, refs, nodeCount, 0, 0, refCount, 0, nullptr);
+    }
+
+    tree.Nodes.resize(nodeCount.load());
+    tree.Parents.resize(tree.Nodes.size());
+    tree.Objects.resize(refCount);
+    for (uint32_t i = 0; i < refCount; ++i)
+        tree.Objects[i] = refs[i].Object;
+    for (uint32_t n = 0; n < (uint32_t)tree.Nodes.size(); ++n)
+    {
+        const Node& node = tree.Nodes[n];
+        for (uint32_t i = node.First; i < node.First + node.Count; ++i)
+            m_Objects[tree.Objects[i]].Leaf = n;
+    }
+
+    UpdateCost(tree);
+    tree.BuiltCost = tree.Cost;
+}
+
+void SceneBVH::BuildNode(Tree& tree, std::vector<BuildRef>& refs, std::atomic<uint32_t>& nodeCount, uint32_t nodeIndex, uint32_t begin, uint32_t end,
+    uint32_t parallelSize, std::vector<std::array<uint32_t, 3>>* deferred)
+{
+    AABB bounds = EmptyBounds();
+    AABB centroidBounds = EmptyBounds();
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds = Merge(bounds, refs[i].Bounds);
+        centroidBounds = Merge(centroidBounds, AABB{ refs[i].Centroid, refs[i].Centroid });
+    }
+    Node& node = tree.Nodes[nodeIndex];
+    node.Bounds = bounds;
+
+    uint32_t count = end - begin;
+    glm::vec3 centroidExtents = centroidBounds.Max - centroidBounds.Min;
+    if (count <= s_MaxLeafObjects)
+    {
+        node.First = begin;
+        node.Count = count;
+        return;
+    }
+
+    // binned SAH: the references are counted in bins along each axis, a split between two bins costs the area of each
+    // side times its reference count
+    struct Bin
+    {
+        AABB Bounds;
+        uint32_t Count;
+    };
+    float bestCost = std::numeric_limits<float>::max();
+    uint32_t bestAxis = 0;
+    uint32_t bestSplit = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (centroidExtents[axis] <= 0.0f)
+            continue;
+
+        std::array<Bin, s_BinCount> bins;
+        bins.fill(Bin{ EmptyBounds(), 0 });
+        float binScale = s_BinCount / centroidExtents[axis];
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint32_t bin = std::min((uint32_t)((refs[i].Centroid[axis] - centroidBounds.Min[axis]) * binScale), s_BinCount - 1);
+            bins[bin].Bounds = Merge(bins[bin].Bounds, refs[i].Bounds);
+            ++bins[bin].Count;
+        }
+
+        // the right side of every split swept from the end, then the left side from the start
+        std::array<float, s_BinCount - 1> rightCosts;
+        AABB rightBounds = EmptyBounds();
+        uint32_t rightCount = 0;
+        for (uint32_t split = s_BinCount - 1; split > 0; --split)
+        {
+            rightBounds = Merge(rightBounds, bins[split].Bounds);
+            rightCount += bins[split].Count;
+            rightCosts[split - 1] = rightCount > 0 ? SurfaceArea(rightBounds) * rightCount : 0.0f;
+        }
+        AABB leftBounds = EmptyBounds();
+        uint32_t leftCount = 0;
+        for (uint32_t split = 0; split < s_BinCount - 1; ++split)
+        {
+            leftBounds = Merge(leftBounds, bins[split].Bounds);
+            leftCount += bins[split].Count;
+            if (leftCount == 0 || leftCount == count)
+                continue;
+            float cost = SurfaceArea(leftBounds) * leftCount + rightCosts[split];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    uint32_t middle;
+    if (bestCost < std::numeric_limits<float>::max())
+    {
+        float binScale = s_BinCount / centroidExtents[bestAxis];
+        float splitMin = centroidBounds.Min[bestAxis];
+        auto it = std::partition(refs.begin() + begin, refs.begin() + end, [&](const BuildRef& ref)
+        {
+            return std::min((uint32_t)((ref.Centroid[bestAxis] - splitMin) * binScale), s_BinCount - 1) <= bestSplit;
+        });
+        middle = (uint32_t)(it - refs.begin());
+    }
+    else
+    {
+        // every centroid at the same place, any split is as good
+        middle = begin + count / 2;
+    }
+
+    uint32_t left = nodeCount.fetch_add(2);
+    node.First = left;
+    node.Count = 0;
+    tree.Parents[left] = nodeIndex;
+    tree.Parents[left + 1] = nodeIndex;
+
+    std::array<std::array<uint32_t, 2>, 2> children{ { { begin, middle }, { middle, end } } };
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        if (deferred && children[c][1] - children[c][0] <= parallelSize)
+            deferred->push_back({ left + c, children[c][0], children[c][1] });
+        else
+            BuildNode(tree, refs, nodeCount, left + c, children[c][0], children[c][1], parallelSize, deferred);
+    }
+}
+
+void SceneBVH::RefitTree(Tree& tree)
+{
+    auto refitLeaf = [&](Node& node)
+    {
+        AABB bounds = EmptyBounds();
+        for (uint32_t i = node.First; i < node.First + node.Count; ++i)
+            bounds = Merge(bounds, m_Objects[tree.Objects[i]].Bounds);
+        node.Bounds = bounds;
+    };
+
+    if (tree.DirtyObjects.size() > tree.Nodes.size() * s_FullRefitRatio)
+    {
+        // the children are always after their parent
+        for (uint32_t n = (uint32_t)tree.Nodes.size(); n-- > 0;)
+        {
+            Node& node = tree.Nodes[n];
+            if (node.Count > 0)
+                refitLeaf(node);
+            else
+                node.Bounds = Merge(tree.Nodes[node.First].Bounds, tree.Nodes[node.First + 1].Bounds);
+        }
+        UpdateCost(tree);
+    }
+    else
+    {
+        for (uint32_t object : tree.DirtyObjects)
+        {
+            uint32_t n = m_Objects[object].Leaf;
+            refitLeaf(tree.Nodes[n]);
+            // up to the first ancestor that doesn't change
+            for (n = tree.Parents[n]; n != s_InvalidNode; n = tree.Parents[n])
+            {
+                Node& node = tree.Nodes[n];
+                AABB bounds = Merge(tree.Nodes[node.First].Bounds, tree.Nodes[node.First + 1].Bounds);
+                if (bounds == node.Bounds)
+                    break;
+                if (n != 0)
+                    tree.InnerArea += SurfaceArea(bounds) - SurfaceArea(node.Bounds);
+                node.Bounds = bounds;
+            }
+        }
+        float rootArea = SurfaceArea(tree.Nodes[0].Bounds);
+        tree.Cost = rootArea > 0.0f ? tree.InnerArea / rootArea : 0.0f;
+    }
+
+    for (uint32_t object : tree.DirtyObjects)
+        m_Objects[object].IsDirty = false;
+    tree.DirtyObjects.clear();
+}
+
+void SceneBVH::UpdateCost(Tree& tree)
+{
+    // the root is always visited, the other inner nodes in proportion to their area
+    tree.InnerArea = 0.0f;
+    for (uint32_t n = 1; n < (uint32_t)tree.Nodes.size(); ++n)
+    {
+        if (tree.Nodes[n].Count == 0)
+            tree.InnerArea += SurfaceArea(tree.Nodes[n].Bounds);
+    }
+    float rootArea = tree.Nodes.empty() ? 0.0f : SurfaceArea(tree.Nodes[0].Bounds);
+    tree.Cost = rootArea > 0.0f ? tree.InnerArea / rootArea : 0.0f;
+}
+
+template<typename NodeTest, typename ObjectVisitor>
+void SceneBVH::Traverse(const Tree& tree, NodeTest&& nodeTest, ObjectVisitor&& visitor) const
+{
+    if (tree.Nodes.empty())
+        return;
+
+    // a node inside the query has every object of its subtree inside as well, they aren't tested anymore
+    std::vector<std::pair<uint32_t, bool>> stack;
+    stack.reserve(64);
+    stack.emplace_back(0, false);
+    while (stack.empty() == false)
+    {
+        auto [n, isInside] = stack.back();
+        stack.pop_back();
+        const Node& node = tree.Nodes[n];
+        if (isInside == false)
+        {
+            EOverlap overlap = nodeTest(node.Bounds);
+            if (overlap == EOverlap::eOutside)
+                continue;
+            isInside = overlap == EOverlap::eInside;
+        }
+
+        if (node.Count == 0)
+        {
+            stack.emplace_back(node.First + 1, isInside);
+            stack.emplace_back(node.First, isInside);
+            continue;
+        }
+        for (uint32_t i = node.First; i < node.First + node.Count; ++i)
+        {
+            uint32_t object = tree.Objects[i];
+            const Object& entry = m_Objects[object];
+            if (entry.IsAlive && (isInside || nodeTest(entry.Bounds) != EOverlap::eOutside))
+                visitor(object);
+        }
+    }
+}
+
+void SceneBVH::QueryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& objects) const
+{
+    // Gribb and Hartmann, the rows of the matrix combined give the clip planes in world space (depth from 0 to 1)
+    auto row = [&viewProj](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+    std::array<glm::vec4, 6> planes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2),
+    };
+    for (auto& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    auto nodeTest = [&planes](const AABB& bounds) { return TestFrustum(planes, bounds); };
+    auto visitor = [&objects](uint32_t object) { objects.push_back(object); };
+    Traverse(m_StaticTree, nodeTest, visitor);
+    Traverse(m_DynamicTree, nodeTest, visitor);
+}
+
+void SceneBVH::QueryBox(const AABB& bounds, std::vector<uint32_t>& objects) const
+{
+    auto nodeTest = [&bounds](const AABB& nodeBounds)
+    {
+        if (Overlaps(bounds, nodeBounds) == false)
+            return EOverlap::eOutside;
+        bool isInside = glm::all(glm::lessThanEqual(bounds.Min, nodeBounds.Min)) && glm::all(glm::lessThanEqual(nodeBounds.Max, bounds.Max));
+        return isInside ? EOverlap::eInside : EOverlap::eIntersecting;
+    };
+    auto visitor = [&objects](uint32_t object) { objects.push_back(object); };
+    Traverse(m_StaticTree, nodeTest, visitor);
+    Traverse(m_DynamicTree, nodeTest, visitor);
+}
+
+void SceneBVH::CastRay(const Ray& ray, std::vector<RayHit>& hits) const
+{
+    glm::vec3 inverseDirection = GetInverseDirection(ray.Direction);
+    size_t firstHit = hits.size();
+    auto nodeTest = [&](const AABB& bounds)
+    {
+        return IntersectRay(ray.Origin, inverseDirection, ray.MaxDistance, bounds) < 0.0f ? EOverlap::eOutside : EOverlap::eIntersecting;
+    };
+    auto visitor = [&](uint32_t object)
+    {
+        hits.push_back(RayHit{ object, IntersectRay(ray.Origin, inverseDirection, ray.MaxDistance, m_Objects[object].Bounds) });
+    };
+    Traverse(m_StaticTree, nodeTest, visitor);
+    Traverse(m_DynamicTree, nodeTest, visitor);
+    std::sort(hits.begin() + firstHit, hits.end(), [](const RayHit& a, const RayHit& b) { return a.Distance < b.Distance; });
+}
+
+bool SceneBVH::CastRayNearest(const Ray& ray, RayHit& hit, const std::function<bool(uint32_t object, const Ray& ray, float& distance)>& intersect) const
+{
+    glm::vec3 inverseDirection = GetInverseDirection(ray.Direction);
+    hit = RayHit{};
+    float maxDistance = ray.MaxDistance;
+
+    std::vector<std::pair<uint32_t, float>> stack;
+    stack.reserve(64);
+    for (const Tree* tree : { &m_StaticTree, &m_DynamicTree })
+    {
+        if (tree->Nodes.empty())
+            continue;
+        float rootDistance = IntersectRay(ray.Origin, inverseDirection, maxDistance, tree->Nodes[0].Bounds);
+        if (rootDistance < 0.0f)
+            continue;
+
+        stack.emplace_back(0, rootDistance);
+        while (stack.empty() == false)
+        {
+            auto [n, distance] = stack.back();
+            stack.pop_back();
+            // a closer hit was found since the node was pushed
+            if (distance > maxDistance)
+                continue;
+
+            const Node& node = tree->Nodes[n];
+            if (node.Count == 0)
+            {
+                float leftDistance = IntersectRay(ray.Origin, inverseDirection, maxDistance, tree->Nodes[node.First].Bounds);
+                float rightDistance = IntersectRay(ray.Origin, inverseDirection, maxDistance, tree->Nodes[node.First + 1].Bounds);
+                // the nearest child is popped first
+                std::pair<uint32_t, float> near{ node.First, leftDistance };
+                std::pair<uint32_t, float> far{ node.First + 1, rightDistance };
+                if (far.second >= 0.0f && (near.second < 0.0f || far.second < near.second))
+                    std::swap(near, far);
+                if (far.second >= 0.0f)
+                    stack.push_back(far);
+                if (near.second >= 0.0f)
+                    stack.push_back(near);
+                continue;
+            }
+
+            for (uint32_t i = node.First; i < node.First + node.Count; ++i)
+            {
+                uint32_t object = tree->Objects[i];
+                if (m_Objects[object].IsAlive == false)
+                    continue;
+                float objectDistance = IntersectRay(ray.Origin, inverseDirection, maxDistance, m_Objects[object].Bounds);
+                if (objectDistance < 0.0f)
+                    continue;
+                if (intersect && (intersect(object, ray, objectDistance) == false || objectDistance > maxDistance))
+                    continue;
+                maxDistance = objectDistance;
+                hit = RayHit{ object, objectDistance };
+            }
+        }
+    }
+    return hit.Object != s_InvalidObject;
+}
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "Engine/Core/Utils/Defines.h"
+#include "Engine/Graphics/Structs.h"
+
+namespace enki
+{
+class TaskScheduler;
+}
+
+namespace lne
+{
+struct Ray
+{
+    glm::vec3 Origin;
+    // the distances of the hits are in lengths of the direction, which doesn't have to be normalized
+    glm::vec3 Direction;
+    float MaxDistance{ std::numeric_limits<float>::max() };
+};
+
+struct RayHit
+{
+    uint32_t Object{ 0xFFFFFFFF };
+    float Distance{ std::numeric_limits<float>::max() };
+};
+
+/// <summary>
+/// Bounding volume hierarchy over the world space boxes of the objects of a scene, for visibility and picking queries.
+/// The static objects go in a tree built with the surface area heuristic and only rebuilt when they change. The moving
+/// ones go in a second tree whose boxes are refit in place when they move, it is rebuilt once the refits have made it
+/// too loose. Changes show in the queries after Commit. Queries can run concurrently, not with the changes.
+/// </summary>
+class SceneBVH
+{
+public:
+    static constexpr uint32_t s_InvalidObject = 0xFFFFFFFF;
+
+    SceneBVH() = default;
+    MOVABLE_ONLY(SceneBVH);
+
+    /// <summary>
+    /// World space box of the submeshes of a mesh drawn with the transform, the mesh must be ready.
+    /// </summary>
+    [[nodiscard]] static AABB ComputeBounds(const class StaticMesh& mesh, const struct TransformComponent& transform);
+    [[nodiscard]] static AABB ComputeBounds(const class StaticMesh& mesh, const glm::mat4& model);
+    [[nodiscard]] static AABB TransformBounds(const AABB& bounds, const glm::mat4& transform);
+
+    /// <summary>
+    /// Returns the handle of the object, reused once the object is removed and the change committed.
+    /// </summary>
+    [[nodiscard]] uint32_t AddObject(const AABB& bounds, bool isStatic = true);
+    void RemoveObject(uint32_t object);
+    /// <summary>
+    /// Moving a static object rebuilds the static tree, prefer adding the objects that move as moving ones.
+    /// </summary>
+    void UpdateObject(uint32_t object, const AABB& bounds);
+
+    /// <summary>
+    /// Rebuilds the trees whose objects were added or removed, or that the refits made too loose, and refits the others.
+    /// The large builds are split across the task threads when there is a scheduler.
+    /// </summary>
+    void Commit(std::shared_ptr<enki::TaskScheduler> scheduler = nullptr);
+    /// <summary>
+    /// Builds both trees from scratch.
+    /// </summary>
+    void Rebuild(std::shared_ptr<enki::TaskScheduler> scheduler = nullptr);
+
+    /// <summary>
+    /// Appends the objects whose box is at least partly inside the frustum of the matrix (depth from 0 to 1).
+    /// </summary>
+    void QueryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& objects) const;
+    /// <summary>
+    /// Appends the objects whose box overlaps the given one.
+    /// </summary>
+    void QueryBox(const AABB& bounds, std::vector<uint32_t>& objects) const;
+    /// <summary>
+    /// Appends every object whose box the ray goes through, closest first. The distance is where the ray enters the box.
+    /// </summary>
+    void CastRay(const Ray& ray, std::vector<RayHit>& hits) const;
+    /// <summary>
+    /// Closest object along the ray, false when there is none. The boxes are visited front to back and the ones behind
+    /// the closest hit so far are skipped. The intersect function, if any, is called with the objects whose box is hit
+    /// to test them precisely: it returns false when the object is missed and sets the distance of the hit otherwise.
+    /// </summary>
+    [[nodiscard]] bool CastRayNearest(const Ray& ray, RayHit& hit,
+        const std::function<bool(uint32_t object, const Ray& ray, float& distance)>& intersect = nullptr) const;
+
+    [[nodiscard]] uint32_t GetObjectCount() const { return (uint32_t)(m_Objects.size() - m_FreeObjects.size() - m_RemovedObjects.size()); }
+    [[nodiscard]] const AABB& GetObjectBounds(uint32_t object) const { return m_Objects[object].Bounds; }
+
+private:
+    static constexpr uint32_t s_InvalidNode = 0xFFFFFFFF;
+
+    struct Node
+    {
+        AABB Bounds;
+        // first object of a leaf, first of the two children of an inner node
+        uint32_t First;
+        // objects of a leaf, 0 for an inner node
+        uint32_t Count;
+    };
+
+    struct Tree
+    {
+        std::vector<Node> Nodes{};
+        std::vector<uint32_t> Parents{};
+        // the leaves reference contiguous ranges of it
+        std::vector<uint32_t> Objects{};
+        std::vector<uint32_t> DirtyObjects{};
+        // surface area of the inner nodes relative to the root, the expected traversal cost of a ray
+        float Cost{ 0.0f };
+        float BuiltCost{ 0.0f };
+        float InnerArea{ 0.0f };
+        bool NeedsRebuild{ false };
+    };
+
+    struct Object
+    {
+        AABB Bounds;
+        uint32_t Leaf{ s_InvalidNode };
+        bool IsStatic{ true };
+        bool IsAlive{ false };
+        bool IsDirty{ false };
+    };
+
+    // intermediate of a build, partitioned in place
+    struct BuildRef
+    {
+        AABB Bounds;
+        glm::vec3 Centroid;
+        uint32_t Object;
+    };
+
+    std::vector<Object> m_Objects{};
+    std::vector<uint32_t> m_FreeObjects{};
+    // freed once the trees don't reference them anymore
+    std::vector<uint32_t> m_RemovedObjects{};
+    Tree m_StaticTree{};
+    Tree m_DynamicTree{};
+
+private:
+    Tree& GetTree(const Object& object) { return object.IsStatic ? m_StaticTree : m_DynamicTree; }
+    void BuildTree(Tree& tree, bool isStatic, const std::shared_ptr<enki::TaskScheduler>& scheduler);
+    /// <summary>
+    /// Splits the references of the node with the binned surface area heuristic. Ranges of at most parallelSize references
+    /// are left for later in deferred when it is given, built right away otherwise.
+    /// </summary>
+    void BuildNode(Tree& tree, std::vector<BuildRef>& refs, std::atomic<uint32_t>& nodeCount, uint32_t nodeIndex, uint32_t begin, uint32_t end,
+        uint32_t parallelSize, std::vector<std::array<uint32_t, 3>>* deferred);
+    void RefitTree(Tree& tree);
+    void UpdateCost(Tree& tree);
+
+    template<typename NodeTest, typename ObjectVisitor>
+    void Traverse(const Tree& tree, NodeTest&& nodeTest, ObjectVisitor&& visitor) const;
+};
+}
@@ -0,0 +1,345 @@
+#include "TransformStore.h"
+#include "Components.h"
+#include "Core/Utils/_Defines.h"
+
+#include <enkiTS/src/TaskScheduler.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <immintrin.h>
+#define LNE_TRANSFORM_SSE
+#endif
+
+namespace lne
+{
+namespace
+{
+// local matrices per task, a few microseconds of work
+constexpr uint32_t s_LocalMatrixRange = 1024;
+constexpr uint32_t s_MinParallelLocalMatrices = 4 * s_LocalMatrixRange;
+
+glm::mat4 ComposeMatrix(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    glm::mat3 rotationMatrix = TransformComponent::ComputeRotation(rotation);
+    return glm::mat4(
+        glm::vec4(rotationMatrix[0] * scale.x, 0.0f),
+        glm::vec4(rotationMatrix[1] * scale.y, 0.0f),
+        glm::vec4(rotationMatrix[2] * scale.z, 0.0f),
+        glm::vec4(position, 1.0f));
+}
+
+#ifdef LNE_TRANSFORM_SSE
+// odd polynomial of the sine on [-90, 90] degrees, accurate to a few ulps
+__m128 SinePolynomial(__m128 degrees)
+{
+    __m128 x = _mm_mul_ps(degrees, _mm_set1_ps(glm::pi<float>() / 180.0f));
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(-1.0f / 39916800.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 362880.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, x);
+}
+
+// sine and cosine of 4 angles in degrees. The angles are brought back to [-180, 180] then folded to [-90, 90],
+// the cosine is the sine of 90 - |angle|
+void SinCos(__m128 degrees, __m128& sine, __m128& cosine)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 halfTurn = _mm_set1_ps(180.0f);
+    const __m128 quarterTurn = _mm_set1_ps(90.0f);
+
+    __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(degrees, _mm_set1_ps(1.0f / 360.0f))));
+    __m128 angle = _mm_sub_ps(degrees, _mm_mul_ps(turns, _mm_set1_ps(360.0f)));
+    __m128 sign = _mm_and_ps(angle, signMask);
+    __m128 absolute = _mm_andnot_ps(signMask, angle);
+
+    // sin(x) = sin(180 - x)
+    __m128 isFolded = _mm_cmpgt_ps(absolute, quarterTurn);
+    __m128 folded = _mm_or_ps(_mm_sub_ps(halfTurn, absolute), sign);
+    __m128 sineAngle = _mm_or_ps(_mm_and_ps(isFolded, folded), _mm_andnot_ps(isFolded, angle));
+    __m128 cosineAngle = _mm_sub_ps(quarterTurn, absolute);
+
+    sine = SinePolynomial(sineAngle);
+    cosine = SinePolynomial(cosineAngle);
+}
+
+// a * b with the columns of a combined by the elements of each column of b
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+    __m128 columns[4] = { _mm_loadu_ps(&a[0][0]), _mm_loadu_ps(&a[1][0]), _mm_loadu_ps(&a[2][0]), _mm_loadu_ps(&a[3][0]) };
+    for (int c = 0; c < 4; ++c)
+    {
+        __m128 column = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(b[c][0])), _mm_mul_ps(columns[1], _mm_set1_ps(b[c][1]))),
+            _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(b[c][2])), _mm_mul_ps(columns[3], _mm_set1_ps(b[c][3]))));
+        _mm_storeu_ps(&result[c][0], column);
+    }
+}
+#else
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+    result = a * b;
+}
+#endif
+}
+
+uint32_t TransformStore::Create(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale, uint32_t parent)
+{
+    uint32_t transform;
+    if (m_FreeTransforms.empty())
+    {
+        transform = (uint32_t)m_Flags.size();
+        size_t size = m_Flags.size() + 1;
+        for (auto* component : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+            component->resize(size);
+        m_Flags.resize(size);
+        m_LocalMatrices.resize(size);
+        m_WorldMatrices.resize(size);
+        m_Parents.resize(size);
+        m_FirstChildren.resize(size);
+        m_NextSiblings.resize(size);
+    }
+    else
+    {
+        transform = m_FreeTransforms.back();
+        m_FreeTransforms.pop_back();
+    }
+
+    // still in the dirty list if it was destroyed since the last Update
+    m_Flags[transform] = s_Alive | (m_Flags[transform] & s_Dirty);
+    m_Parents[transform] = s_InvalidTransform;
+    m_FirstChildren[transform] = s_InvalidTransform;
+    m_NextSiblings[transform] = s_InvalidTransform;
+    SetTransform(transform, position, rotation, scale);
+    if (parent != s_InvalidTransform)
+        Attach(transform, parent);
+
+    // readable right away, Update refines it once the parent is known
+    m_LocalMatrices[transform] = ComposeMatrix(position, rotation, scale);
+    m_WorldMatrices[transform] = parent != s_InvalidTransform ? m_WorldMatrices[parent] * m_LocalMatrices[transform] : m_LocalMatrices[transform];
+    return transform;
+}
+
+void TransformStore::Destroy(uint32_t transform)
+{
+    LNE_ASSERT(transform < m_Flags.size() && (m_Flags[transform] & s_Alive), "Not a transform of the store");
+    while (m_FirstChildren[transform] != s_InvalidTransform)
+    {
+        uint32_t child = m_FirstChildren[transform];
+        Detach(child);
+        MarkDirty(child);
+    }
+    Detach(transform);
+
+    // left in the dirty list, Update skips it if it isn't created again by then
+    m_Flags[transform] &= s_Dirty;
+    m_FreeTransforms.push_back(transform);
+}
+
+void TransformStore::SetParent(uint32_t transform, uint32_t parent)
+{
+    if (m_Parents[transform] == parent)
+        return;
+    for (uint32_t ancestor = parent; ancestor != s_InvalidTransform; ancestor = m_Parents[ancestor])
+        LNE_ASSERT(ancestor != transform, "A transform can't be parented to one of its descendants");
+
+    Detach(transform);
+    if (parent != s_InvalidTransform)
+        Attach(transform, parent);
+    MarkDirty(transform);
+}
+
+void TransformStore::SetPosition(uint32_t transform, const glm::vec3& position)
+{
+    m_PositionX[transform] = position.x;
+    m_PositionY[transform] = position.y;
+    m_PositionZ[transform] = position.z;
+    MarkDirty(transform);
+}
+
+void TransformStore::SetRotation(uint32_t transform, const glm::vec3& rotation)
+{
+    m_RotationX[transform] = rotation.x;
+    m_RotationY[transform] = rotation.y;
+    m_RotationZ[transform] = rotation.z;
+    MarkDirty(transform);
+}
+
+void TransformStore::SetScale(uint32_t transform, const glm::vec3& scale)
+{
+    m_ScaleX[transform] = scale.x;
+    m_ScaleY[transform] = scale.y;
+    m_ScaleZ[transform] = scale.z;
+    MarkDirty(transform);
+}
+
+void TransformStore::SetTransform(uint32_t transform, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    SetPosition(transform, position);
+    SetRotation(transform, rotation);
+    SetScale(transform, scale);
+}
+
+void TransformStore::Update(std::shared_ptr<enki::TaskScheduler> scheduler)
+{
+    // destroyed since they were changed
+    std::erase_if(m_DirtyTransforms, [this](uint32_t transform)
+    {
+        if (m_Flags[transform] & s_Alive)
+            return false;
+        m_Flags[transform] = 0;
+        return true;
+    });
+    if (m_DirtyTransforms.empty())
+        return;
+
+    uint32_t dirtyCount = (uint32_t)m_DirtyTransforms.size();
+    if (scheduler == nullptr || dirtyCount < s_MinParallelLocalMatrices)
+    {
+        UpdateLocalMatrices(0, dirtyCount);
+    }
+    else
+    {
+        // whole groups of 4 per task, only the last one has a scalar tail
+        uint32_t groupCount = (dirtyCount + 3) / 4;
+        enki::TaskSet task(groupCount, [&](enki::TaskSetPartition range, uint32_t)
+        {
+            UpdateLocalMatrices(range.start * 4, std::min(range.end * 4, dirtyCount));
+        });
+        task.m_MinRange = s_LocalMatrixRange / 4;
+        scheduler->AddTaskSetToPipe(&task);
+        scheduler->WaitforTask(&task);
+    }
+
+    UpdateWorldMatrices();
+    for (uint32_t transform : m_DirtyTransforms)
+        m_Flags[transform] &= ~s_Dirty;
+    m_DirtyTransforms.clear();
+}
+
+void TransformStore::MarkDirty(uint32_t transform)
+{
+    if (m_Flags[transform] & s_Dirty)
+        return;
+    m_Flags[transform] |= s_Dirty;
+    m_DirtyTransforms.push_back(transform);
+}
+
+void TransformStore::Attach(uint32_t transform, uint32_t parent)
+{
+    LNE_ASSERT(parent < m_Flags.size() && (m_Flags[parent] & s_Alive), "Not a transform of the store");
+    m_Parents[transform] = parent;
+    m_NextSiblings[transform] = m_FirstChildren[parent];
+    m_FirstChildren[parent] = transform;
+}
+
+void TransformStore::Detach(uint32_t transform)
+{
+    uint32_t parent = m_Parents[transform];
+    if (parent == s_InvalidTransform)
+        return;
+
+    uint32_t* link = &m_FirstChildren[parent];
+    while (*link != transform)
+        link = &m_NextSiblings[*link];
+    *link = m_NextSiblings[transform];
+    m_Parents[transform] = s_InvalidTransform;
+    m_NextSiblings[transform] = s_InvalidTransform;
+}
+
+void TransformStore::UpdateLocalMatrices(uint32_t begin, uint32_t end)
+{
+    const uint32_t* transforms = m_DirtyTransforms.data();
+    uint32_t i = begin;
+#ifdef LNE_TRANSFORM_SSE
+    // 4 transforms per iteration, one per lane: the components are gathered from the arrays, the 12 elements of the
+    // matrices computed side by side, then transposed into the columns of each matrix
+    auto gather = [&](const std::vector<float>& component)
+    {
+        return _mm_setr_ps(component[transforms[i]], component[transforms[i + 1]], component[transforms[i + 2]], component[transforms[i + 3]]);
+    };
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 sx, cx, sy, cy, sz, cz;
+        SinCos(gather(m_RotationX), sx, cx);
+        SinCos(gather(m_RotationY), sy, cy);
+        SinCos(gather(m_RotationZ), sz, cz);
+        __m128 scaleX = gather(m_ScaleX);
+        __m128 scaleY = gather(m_ScaleY);
+        __m128 scaleZ = gather(m_ScaleZ);
+
+        // same rotation as TransformComponent::ComputeRotation
+        __m128 sxsy = _mm_mul_ps(sx, sy);
+        __m128 cxsy = _mm_mul_ps(cx, sy);
+        __m128 columns[4][4] = {
+            {
+                _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX),
+                _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), scaleX),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX),
+                _mm_setzero_ps()
+            },
+            {
+                _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cy, sz)), scaleY),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY),
+                _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)), scaleY),
+                _mm_setzero_ps()
+            },
+            {
+                _mm_mul_ps(sy, scaleZ),
+                _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sx, cy)), scaleZ),
+                _mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ),
+                _mm_setzero_ps()
+            },
+            {
+                gather(m_PositionX),
+                gather(m_PositionY),
+                gather(m_PositionZ),
+                _mm_set1_ps(1.0f)
+            }
+        };
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+            for (uint32_t lane = 0; lane < 4; ++lane)
+                _mm_storeu_ps(&m_LocalMatrices[transforms[i + lane]][c][0], columns[c][lane]);
+        }
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        uint32_t transform = transforms[i];
+        m_LocalMatrices[transform] = ComposeMatrix(GetPosition(transform), GetRotation(transform), GetScale(transform));
+    }
+}
+
+void TransformStore::UpdateWorldMatrices()
+{
+    // the subtree of a dirty transform is updated from it, unless one of its ancestors is dirty as well and updates it
+    for (uint32_t transform : m_DirtyTransforms)
+    {
+        bool hasDirtyAncestor = false;
+        for (uint32_t ancestor = m_Parents[transform]; ancestor != s_InvalidTransform && hasDirtyAncestor == false; ancestor = m_Parents[ancestor])
+            hasDirtyAncestor = m_Flags[ancestor] & s_Dirty;
+        if (hasDirtyAncestor)
+            continue;
+
+        m_UpdateStack.push_back(transform);
+        while (m_UpdateStack.empty() == false)
+        {
+            uint32_t node = m_UpdateStack.back();
+            m_UpdateStack.pop_back();
+            uint32_t parent = m_Parents[node];
+            if (parent == s_InvalidTransform)
+                m_WorldMatrices[node] = m_LocalMatrices[node];
+            else
+                MultiplyMatrices(m_WorldMatrices[parent], m_LocalMatrices[node], m_WorldMatrices[node]);
+
+            for (uint32_t child = m_FirstChildren[node]; child != s_InvalidTransform; child = m_NextSiblings[child])
+                m_UpdateStack.push_back(child);
+        }
+    }
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "Engine/Core/Utils/Defines.h"
+
+namespace enki
+{
+class TaskScheduler;
+}
+
+namespace lne
+{
+/// <summary>
+/// Position, rotation and scale of many objects kept as structure of arrays, with their local and world matrices cached.
+/// The setters only flag the transform, Update then rebuilds the local matrices of the changed ones four at a time with
+/// SSE and the world matrices of them and their descendants, once per frame whatever the number of changes. The matrices
+/// read between the setters and Update are the ones of the previous Update. Rotations are Euler angles in degrees, like
+/// TransformComponent.
+/// </summary>
+class TransformStore
+{
+public:
+    static constexpr uint32_t s_InvalidTransform = 0xFFFFFFFF;
+
+    TransformStore() = default;
+    MOVABLE_ONLY(TransformStore);
+
+    /// <summary>
+    /// Returns the handle of the transform, reused once it is destroyed. The world matrix is the local one when there
+    /// is no parent, the parent's world matrix times it otherwise.
+    /// </summary>
+    [[nodiscard]] uint32_t Create(const glm::vec3& position = glm::vec3(0.0f), const glm::vec3& rotation = glm::vec3(0.0f),
+        const glm::vec3& scale = glm::vec3(1.0f), uint32_t parent = s_InvalidTransform);
+    /// <summary>
+    /// The children are detached and keep their local transform.
+    /// </summary>
+    void Destroy(uint32_t transform);
+    void SetParent(uint32_t transform, uint32_t parent);
+
+    void SetPosition(uint32_t transform, const glm::vec3& position);
+    void SetRotation(uint32_t transform, const glm::vec3& rotation);
+    void SetScale(uint32_t transform, const glm::vec3& scale);
+    void SetTransform(uint32_t transform, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+    [[nodiscard]] glm::vec3 GetPosition(uint32_t transform) const { return { m_PositionX[transform], m_PositionY[transform], m_PositionZ[transform] }; }
+    [[nodiscard]] glm::vec3 GetRotation(uint32_t transform) const { return { m_RotationX[transform], m_RotationY[transform], m_RotationZ[transform] }; }
+    [[nodiscard]] glm::vec3 GetScale(uint32_t transform) const { return { m_ScaleX[transform], m_ScaleY[transform], m_ScaleZ[transform] }; }
+    [[nodiscard]] uint32_t GetParent(uint32_t transform) const { return m_Parents[transform]; }
+
+    [[nodiscard]] const glm::mat4& GetLocalMatrix(uint32_t transform) const { return m_LocalMatrices[transform]; }
+    [[nodiscard]] const glm::mat4& GetWorldMatrix(uint32_t transform) const { return m_WorldMatrices[transform]; }
+    /// <summary>
+    /// Axes of the world matrix, without its scale.
+    /// </summary>
+    [[nodiscard]] glm::vec3 GetForward(uint32_t transform) const { return glm::normalize(glm::vec3(m_WorldMatrices[transform][2])); }
+    [[nodiscard]] glm::vec3 GetRight(uint32_t transform) const { return glm::normalize(glm::vec3(m_WorldMatrices[transform][0])); }
+    [[nodiscard]] glm::vec3 GetUp(uint32_t transform) const { return glm::normalize(glm::vec3(m_WorldMatrices[transform][1])); }
+
+    [[nodiscard]] bool IsDirty(uint32_t transform) const { return m_Flags[transform] & s_Dirty; }
+    [[nodiscard]] uint32_t GetCount() const { return (uint32_t)(m_Flags.size() - m_FreeTransforms.size()); }
+
+    /// <summary>
+    /// Rebuilds the matrices of the transforms changed since the last call. The local matrices are split across the task
+    /// threads when there is a scheduler and enough of them changed.
+    /// </summary>
+    void Update(std::shared_ptr<enki::TaskScheduler> scheduler = nullptr);
+
+private:
+    static constexpr uint8_t s_Alive = 1 << 0;
+    static constexpr uint8_t s_Dirty = 1 << 1;
+
+    std::vector<float> m_PositionX{};
+    std::vector<float> m_PositionY{};
+    std::vector<float> m_PositionZ{};
+    std::vector<float> m_RotationX{};
+    std::vector<float> m_RotationY{};
+    std::vector<float> m_RotationZ{};
+    std::vector<float> m_ScaleX{};
+    std::vector<float> m_ScaleY{};
+    std::vector<float> m_ScaleZ{};
+    std::vector<uint8_t> m_Flags{};
+
+    std::vector<glm::mat4> m_LocalMatrices{};
+    std::vector<glm::mat4> m_WorldMatrices{};
+
+    // the children of a transform are a linked list through their siblings
+    std::vector<uint32_t> m_Parents{};
+    std::vector<uint32_t> m_FirstChildren{};
+    std::vector<uint32_t> m_NextSiblings{};
+
+    std::vector<uint32_t> m_DirtyTransforms{};
+    std::vector<uint32_t> m_FreeTransforms{};
+    // subtrees left to update, reused across the calls
+    std::vector<uint32_t> m_UpdateStack{};
+
+private:
+    void MarkDirty(uint32_t transform);
+    void Attach(uint32_t transform, uint32_t parent);
+    void Detach(uint32_t transform);
+    /// <summary>
+    /// Local matrices of the transforms of the dirty list in the range.
+    /// </summary>
+    void UpdateLocalMatrices(uint32_t begin, uint32_t end);
+    void UpdateWorldMatrices();
+};
+}
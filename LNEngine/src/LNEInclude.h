@@ -35,6 +35,9 @@
 #include "Engine/Core/SafePtr.h"
 #include "Engine/Core/ApplicationBase.h"
 #include "Engine/Core/Layer.h"
+#include "Engine/Core/Async/Task.h"
+#include "Engine/Core/Async/WhenAll.h"
+#include "Engine/Core/Async/CoroutineScheduler.h"
 #include "Engine/Core/Events/ApplicationEvents.h"
 #include "Engine/Core/Events/KeyboardEvents.h"
 #include "Engine/Core/Events/MouseEvents.h"
@@ -50,7 +53,10 @@
 #include "Engine/Graphics/ImGui/ImGuiService.h"
 #include "Engine/Graphics/Material.h"
 #include "Engine/Graphics/Mesh.h"
+#include "Engine/Graphics/BufferUploadBatch.h"
+#include "Engine/Graphics/ProceduralMesh.h"
 #include "Engine/Scene/Components.h"
+#include "Engine/Scene/TransformStore.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -46,4 +46,5 @@ group "Vendors"
 group""
 
 include "LNEngine"
-include "LNApp"
\ No newline at end of file
+include "LNApp"
+include "LNCook"
\ No newline at end of file